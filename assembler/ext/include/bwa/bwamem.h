@@ -20,6 +20,8 @@ typedef struct __smem_i smem_i;
 #define MEM_F_SOFTCLIP  0x200
 #define MEM_F_SMARTPE   0x400
 
+struct mem_aln_s;
+
 typedef struct mem_opt_s {
 	int a, b;               // match score and mismatch penalty
 	int o_del, e_del;
@@ -52,6 +54,10 @@ typedef struct mem_opt_s {
 	int max_matesw;         // perform maximally max_matesw rounds of mate-SW for each end
 	int max_XA_hits, max_XA_hits_alt; // if there are max_hits or fewer, output them all
 	int8_t mat[25];         // scoring matrix; mat[0] == 0 if unset
+	// if set, every alignment record is passed here (with the final flag) instead of being written to bseq1_t::sam;
+	// $which is the index of the record among the hits of the read, called concurrently for different reads
+	void (*aln_cb)(void *data, const bseq1_t *s, const struct mem_aln_s *p, int which);
+	void *aln_cb_data;
 } mem_opt_t;
 
 typedef struct {
@@ -82,7 +88,7 @@ typedef struct {
 	double avg, std; // mean and stddev of the insert size distribution
 } mem_pestat_t;
 
-typedef struct { // This struct is only used for the convenience of API.
+typedef struct mem_aln_s { // This struct is only used for the convenience of API.
 	int64_t pos;     // forward strand 5'-end mapping position
 	int rid;         // reference sequence index in bntseq_t; <0 for unmapped
 	int flag;        // extra flag
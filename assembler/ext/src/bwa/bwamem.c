@@ -825,6 +825,10 @@ void mem_aln2sam(const mem_opt_t *opt, const bntseq_t *bns, kstring_t *str, bseq
 		m->rid = p->rid, m->pos = p->pos, m->is_rev = p->is_rev, m->n_cigar = 0;
 	p->flag |= p->is_rev? 0x10 : 0; // is on the reverse strand
 	p->flag |= m && m->is_rev? 0x20 : 0; // is mate on the reverse strand
+	if (opt->aln_cb) { // hand the record over instead of printing it
+		opt->aln_cb(opt->aln_cb_data, s, p, which);
+		return;
+	}
 
 	// print up to CIGAR
 	l_name = strlen(s->name);
@@ -0,0 +1,70 @@
+//***************************************************************************
+//* Copyright (c) 2016 Saint Petersburg State University
+//* All Rights Reserved
+//* See file LICENSE for details.
+//***************************************************************************
+
+#pragma once
+
+#include <cstddef>
+
+// Plain fixed-width k-mer image. Used to dispatch the hot loops over the
+// actual number of storage words: comparisons get unrolled and swaps are
+// plain copies instead of going through array_vector proxies.
+template<class ElTy, unsigned N>
+struct fixed_width_kmer {
+    ElTy data[N];
+
+    bool operator<(const fixed_width_kmer &that) const {
+        for (unsigned i = 0; i < N; ++i) {
+            if (data[i] != that.data[i])
+                return data[i] < that.data[i];
+        }
+
+        return false;
+    }
+
+    bool operator==(const fixed_width_kmer &that) const {
+        for (unsigned i = 0; i < N; ++i) {
+            if (data[i] != that.data[i])
+                return false;
+        }
+
+        return true;
+    }
+};
+
+template<class ElTy, unsigned N>
+inline bool fixed_width_equal(const ElTy *lhs, const ElTy *rhs) {
+    typedef fixed_width_kmer<ElTy, N> kmer;
+    return *(const kmer *) lhs == *(const kmer *) rhs;
+}
+
+// Compares two k-mers of sz storage words each
+template<class ElTy>
+inline bool kmer_words_equal(const ElTy *lhs, const ElTy *rhs, size_t sz) {
+    switch (sz) {
+        case 1: return fixed_width_equal<ElTy, 1>(lhs, rhs);
+        case 2: return fixed_width_equal<ElTy, 2>(lhs, rhs);
+        case 3: return fixed_width_equal<ElTy, 3>(lhs, rhs);
+        case 4: return fixed_width_equal<ElTy, 4>(lhs, rhs);
+        default:
+            break;
+    }
+
+    for (size_t i = 0; i < sz; ++i) {
+        if (lhs[i] != rhs[i])
+            return false;
+    }
+
+    return true;
+}
+
+// Index of the first differing word of two k-mers of sz storage words each, sz if they are equal
+template<class ElTy>
+inline size_t kmer_words_mismatch(const ElTy *lhs, const ElTy *rhs, size_t sz) {
+    size_t i = 0;
+    while (i < sz && lhs[i] == rhs[i])
+        ++i;
+    return i;
+}
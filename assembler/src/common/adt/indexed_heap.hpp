@@ -0,0 +1,291 @@
+//***************************************************************************
+//* Copyright (c) 2016 Saint Petersburg State University
+//* All Rights Reserved
+//* See file LICENSE for details.
+//***************************************************************************
+
+#pragma once
+
+#include "utils/verify.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+namespace adt {
+
+/**
+ * Sort key of the element. By default the element itself is compared. If the comparator
+ * defines key_type, key(el) and operator()(key_type, key_type), the keys are computed once
+ * and then compared instead of the elements (e.g. to avoid fetching the edge data on
+ * every comparison).
+ */
+template<class T, class Comparator, class Enable = void>
+struct sort_key {
+    typedef T type;
+
+    static const T& get(const Comparator&, const T& el) {
+        return el;
+    }
+};
+
+template<class T, class Comparator>
+struct sort_key<T, Comparator,
+                typename std::conditional<true, void, typename Comparator::key_type>::type> {
+    typedef typename Comparator::key_type type;
+
+    static type get(const Comparator& comparator, const T& el) {
+        return comparator.key(el);
+    }
+};
+
+/**
+ * Indexed d-ary heap (the minimal element on top) with the same interface as
+ * erasable_priority_queue. Elements must have integer ids (el.int_id()), their
+ * positions in the heap are stored in a vector indexed by the id, so membership tests,
+ * erasure and key updates take no search. The sort keys are cached: pushing an element
+ * which is already in the heap recomputes its key and moves it up or down.
+ * Memory taken by the index is proportional to the maximal id pushed, so the heap is
+ * intended for the worklists over the whole graph rather than for the small sets.
+ * Ids which are too large for the count of elements (e.g. the ones distributed after
+ * loading the graph with reserved ids) are indexed with the hash map.
+ */
+template<typename T, typename Comparator, unsigned Arity = 4>
+class indexed_heap {
+    static_assert(Arity >= 2, "Heap arity should be at least 2");
+
+    typedef sort_key<T, Comparator> key_traits;
+    typedef typename key_traits::type key_type;
+    typedef uint32_t pos_type;
+    static const pos_type NO_POS = pos_type(-1);
+    //dense index is grown up to SPARSITY * (element count) + MIN_DENSE_SIZE
+    static const size_t MIN_DENSE_SIZE = 4096;
+    static const size_t SPARSITY = 16;
+
+    struct Entry {
+        key_type key;
+        T el;
+    };
+
+    Comparator comparator_;
+    std::vector<Entry> heap_;
+    std::vector<pos_type> pos_;
+    std::unordered_map<size_t, pos_type> sparse_pos_;
+
+public:
+    indexed_heap(const Comparator& comparator = Comparator())
+            : comparator_(comparator) {
+    }
+
+    template<typename InputIterator>
+    indexed_heap(InputIterator begin, InputIterator end,
+                 const Comparator& comparator = Comparator())
+            : comparator_(comparator) {
+        insert(begin, end);
+    }
+
+    void pop() {
+        VERIFY(!heap_.empty());
+        Remove(0);
+    }
+
+    const T& top() const {
+        VERIFY(!heap_.empty());
+        return heap_.front().el;
+    }
+
+    //Inserts the element or updates its key if it is already there
+    void push(const T& el) {
+        pos_type pos = position(el);
+        if (pos == NO_POS) {
+            Append(el);
+            SiftUp(pos_type(heap_.size() - 1));
+        } else {
+            heap_[pos].key = key_traits::get(comparator_, el);
+            Fix(pos);
+        }
+    }
+
+    bool erase(const T& el) {
+        pos_type pos = position(el);
+        if (pos == NO_POS)
+            return false;
+        Remove(pos);
+        return true;
+    }
+
+    bool contains(const T& el) const {
+        return position(el) != NO_POS;
+    }
+
+    void clear() {
+        for (const auto& entry : heap_)
+            SetPosition(entry.el.int_id(), NO_POS);
+        heap_.clear();
+    }
+
+    bool empty() const {
+        return heap_.empty();
+    }
+
+    size_t size() const {
+        return heap_.size();
+    }
+
+    //Bulk insertion, the heap is rebuilt at once if many elements are inserted
+    template <class InputIterator>
+    void insert(InputIterator first, InputIterator last) {
+        size_t old_size = heap_.size();
+        size_t max_id = 0, cnt = 0;
+        for (auto it = first; it != last; ++it) {
+            max_id = std::max(max_id, size_t((*it).int_id()));
+            ++cnt;
+        }
+        ReserveIndex(max_id, old_size + cnt);
+
+        std::vector<T> updated;
+        for (auto it = first; it != last; ++it) {
+            pos_type pos = position(*it);
+            if (pos == NO_POS) {
+                Append(*it);
+            } else {
+                heap_[pos].key = key_traits::get(comparator_, *it);
+                updated.push_back(*it);
+            }
+        }
+
+        size_t changed = heap_.size() - old_size + updated.size();
+        if (changed > heap_.size() / Arity) {
+            Heapify();
+            return;
+        }
+        for (const auto& el : updated)
+            Fix(position(el));
+        for (size_t i = old_size; i < heap_.size(); ++i)
+            SiftUp(pos_type(i));
+    }
+
+private:
+    pos_type position(const T& el) const {
+        size_t id = el.int_id();
+        if (id < pos_.size())
+            return pos_[id];
+        auto it = sparse_pos_.find(id);
+        return it == sparse_pos_.end() ? NO_POS : it->second;
+    }
+
+    void SetPosition(size_t id, pos_type pos) {
+        if (id < pos_.size())
+            pos_[id] = pos;
+        else if (pos == NO_POS)
+            sparse_pos_.erase(id);
+        else
+            sparse_pos_[id] = pos;
+    }
+
+    //Grows the dense index to cover the id unless it gets too sparse for cnt elements
+    void ReserveIndex(size_t id, size_t cnt) {
+        if (id < pos_.size())
+            return;
+        size_t limit = SPARSITY * cnt + MIN_DENSE_SIZE;
+        if (id >= limit)
+            return;
+        pos_.resize(std::min(std::max(id + 1, pos_.size() * 2), limit), NO_POS);
+        for (auto it = sparse_pos_.begin(); it != sparse_pos_.end(); ) {
+            if (it->first < pos_.size()) {
+                pos_[it->first] = it->second;
+                it = sparse_pos_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    void Append(const T& el) {
+        size_t id = el.int_id();
+        ReserveIndex(id, heap_.size() + 1);
+        VERIFY(heap_.size() < NO_POS);
+        SetPosition(id, pos_type(heap_.size()));
+        heap_.push_back(Entry{key_traits::get(comparator_, el), el});
+    }
+
+    void Remove(pos_type pos) {
+        SetPosition(heap_[pos].el.int_id(), NO_POS);
+        pos_type last = pos_type(heap_.size() - 1);
+        if (pos != last) {
+            Place(pos, std::move(heap_[last]));
+            heap_.pop_back();
+            Fix(pos);
+        } else {
+            heap_.pop_back();
+        }
+    }
+
+    bool Less(const Entry& a, const Entry& b) const {
+        return comparator_(a.key, b.key);
+    }
+
+    void Place(pos_type pos, Entry&& entry) {
+        SetPosition(entry.el.int_id(), pos);
+        heap_[pos] = std::move(entry);
+    }
+
+    void Fix(pos_type pos) {
+        if (pos > 0 && Less(heap_[pos], heap_[(pos - 1) / Arity]))
+            SiftUp(pos);
+        else
+            SiftDown(pos);
+    }
+
+    void SiftUp(pos_type pos) {
+        Entry entry = std::move(heap_[pos]);
+        while (pos > 0) {
+            pos_type parent = (pos - 1) / Arity;
+            if (!Less(entry, heap_[parent]))
+                break;
+            Place(pos, std::move(heap_[parent]));
+            pos = parent;
+        }
+        Place(pos, std::move(entry));
+    }
+
+    void SiftDown(pos_type pos) {
+        size_t size = heap_.size();
+        Entry entry = std::move(heap_[pos]);
+        while (true) {
+            size_t first = size_t(pos) * Arity + 1;
+            if (first >= size)
+                break;
+            size_t best = first;
+            for (size_t child = first + 1; child < std::min(first + Arity, size); ++child) {
+                if (Less(heap_[child], heap_[best]))
+                    best = child;
+            }
+            if (!Less(heap_[best], entry))
+                break;
+            Place(pos, std::move(heap_[best]));
+            pos = pos_type(best);
+        }
+        Place(pos, std::move(entry));
+    }
+
+    void Heapify() {
+        if (heap_.size() < 2)
+            return;
+        for (size_t i = (heap_.size() - 2) / Arity + 1; i > 0; --i)
+            SiftDown(pos_type(i - 1));
+    }
+};
+
+template<typename T, typename Comparator, unsigned Arity>
+const typename indexed_heap<T, Comparator, Arity>::pos_type indexed_heap<T, Comparator, Arity>::NO_POS;
+
+template<typename T, typename Comparator, unsigned Arity>
+const size_t indexed_heap<T, Comparator, Arity>::MIN_DENSE_SIZE;
+
+template<typename T, typename Comparator, unsigned Arity>
+const size_t indexed_heap<T, Comparator, Arity>::SPARSITY;
+
+}
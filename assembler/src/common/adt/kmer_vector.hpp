@@ -9,14 +9,92 @@
 #define __KMER_VECTOR_HPP__
 
 #include "array_vector.hpp"
+#include "fixed_width_kmer.hpp"
 #include "config.hpp"
 
+#include <libcxx/sort.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
 #ifdef SPADES_USE_JEMALLOC
 
 # include <jemalloc/jemalloc.h>
 
 #endif
 
+template<class ElTy, unsigned N>
+size_t sort_unique_fixed_width(ElTy *data, size_t cnt) {
+    typedef fixed_width_kmer<ElTy, N> kmer;
+    static_assert(sizeof(kmer) == N * sizeof(ElTy), "Fixed width k-mer should not be padded");
+
+    kmer *begin = (kmer *) data, *end = begin + cnt;
+    std::sort(begin, end);
+    return std::unique(begin, end) - begin;
+}
+
+// Sorts and deduplicates cnt k-mers of el_sz words each stored contiguously
+// at data (the order is the same as of array_less). Returns the number of
+// unique k-mers left at the beginning of the storage.
+template<class ElTy>
+size_t sort_unique_kmers(ElTy *data, size_t cnt, size_t el_sz) {
+    switch (el_sz) {
+        case 1: return sort_unique_fixed_width<ElTy, 1>(data, cnt);
+        case 2: return sort_unique_fixed_width<ElTy, 2>(data, cnt);
+        case 3: return sort_unique_fixed_width<ElTy, 3>(data, cnt);
+        case 4: return sort_unique_fixed_width<ElTy, 4>(data, cnt);
+        default:
+            break;
+    }
+
+    array_vector<ElTy> v(data, cnt, el_sz);
+    libcxx::sort(v.begin(), v.end(), array_less<ElTy>());
+    return std::unique(v.begin(), v.end(), array_equal_to<ElTy>()) - v.begin();
+}
+
+template<class ElTy, unsigned N>
+size_t sort_count_fixed_width(ElTy *data, size_t cnt, uint32_t *counts) {
+    typedef fixed_width_kmer<ElTy, N> kmer;
+
+    kmer *begin = (kmer *) data, *end = begin + cnt;
+    std::sort(begin, end);
+    size_t res = 0;
+    for (kmer *it = begin; it != end; ) {
+        kmer *run = it;
+        while (++it != end && *it == *run) {}
+        begin[res] = *run;
+        counts[res++] = uint32_t(std::min<size_t>(it - run, std::numeric_limits<uint32_t>::max()));
+    }
+    return res;
+}
+
+// Same as sort_unique_kmers, but also stores the number of occurrences of
+// every unique k-mer into counts (which should have room for cnt entries).
+template<class ElTy>
+size_t sort_count_kmers(ElTy *data, size_t cnt, size_t el_sz, uint32_t *counts) {
+    switch (el_sz) {
+        case 1: return sort_count_fixed_width<ElTy, 1>(data, cnt, counts);
+        case 2: return sort_count_fixed_width<ElTy, 2>(data, cnt, counts);
+        case 3: return sort_count_fixed_width<ElTy, 3>(data, cnt, counts);
+        case 4: return sort_count_fixed_width<ElTy, 4>(data, cnt, counts);
+        default:
+            break;
+    }
+
+    array_vector<ElTy> v(data, cnt, el_sz);
+    libcxx::sort(v.begin(), v.end(), array_less<ElTy>());
+    size_t res = 0;
+    for (auto it = v.begin(), end = v.end(); it != end; ) {
+        auto run = it;
+        while (++it != end && array_equal_to<ElTy>()(*it, *run)) {}
+        if (res != size_t(run - v.begin()))
+            v[res] = *run;
+        counts[res++] = uint32_t(std::min<size_t>(it - run, std::numeric_limits<uint32_t>::max()));
+    }
+    return res;
+}
+
 template<class Seq>
 class KMerVector {
 private:
@@ -134,6 +212,22 @@ public:
         vector_.set_size(size_);
     }
 
+    // Sorts the k-mers and removes the duplicates, returns the number of unique ones
+    size_t sort_unique() {
+        size_ = sort_unique_kmers(storage_, size_, el_sz_);
+        vector_.set_size(size_);
+        return size_;
+    }
+
+    // Same as above, counts receive the number of occurrences of every unique k-mer
+    size_t sort_unique(std::vector<uint32_t> &counts) {
+        counts.resize(size_);
+        size_ = sort_count_kmers(storage_, size_, el_sz_, counts.data());
+        counts.resize(size_);
+        vector_.set_size(size_);
+        return size_;
+    }
+
     void shrink_to_fit() {
         capacity_ = std::max(size_, size_t(1));
         vector_.set_data(realloc());
@@ -68,13 +68,14 @@ public:
 
 };
 
-template<typename T, typename Comparator = std::less<T>>
+template<typename T, typename Comparator = std::less<T>,
+         typename Queue = erasable_priority_queue<T, Comparator>>
 class DynamicQueueIterator {
 
     bool current_actual_;
     bool current_deleted_;
     T current_;
-    erasable_priority_queue<T, Comparator> queue_;
+    Queue queue_;
 
 public:
 
@@ -0,0 +1,191 @@
+#pragma once
+//***************************************************************************
+//* Copyright (c) 2015 Saint Petersburg State University
+//* All Rights Reserved
+//* See file LICENSE for details.
+//***************************************************************************
+
+#include "utils/openmp_wrapper.h"
+#include "utils/verify.hpp"
+
+#include <boost/noncopyable.hpp>
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <type_traits>
+#include <cstdlib>
+#include <cstddef>
+
+namespace adt {
+
+struct SlabAllocatorStats {
+    size_t live;        // Pairs currently allocated
+    size_t allocations; // Pairs allocated during the whole lifetime
+    size_t slabs;
+    size_t bytes;       // Memory held by slabs
+};
+
+// Slab allocator for objects which are created and destroyed in pairs (e.g.
+// an element of the graph and its conjugate). Every cell holds two adjacent
+// objects, so both members of a pair share a cache line (or two) and are
+// allocated / freed with a single operation. Cells are carved from large slabs
+// which are never returned to the system until the allocator is destroyed (or
+// release() is called), freed cells are recycled via intrusive free lists.
+//
+// The allocator only manages raw memory: the caller is responsible for
+// constructing the objects (placement new) and calling their destructors.
+//
+// allocate() / deallocate() are thread-safe. Every thread uses its own shard
+// (selected by OpenMP thread number) protected by a spinlock, so there is no
+// contention in the common case of an OpenMP team working on the same pool.
+template<class T>
+class PairedSlabAllocator : private boost::noncopyable {
+    union Cell {
+        Cell *next;
+        typename std::aligned_storage<2 * sizeof(T), std::alignment_of<T>::value>::type items;
+    };
+
+    static const size_t MIN_SLAB_CELLS = 64;
+    static const size_t MAX_SLAB_CELLS = 64 * 1024;
+    static const unsigned SHARDS = 64;
+
+    struct ShardState {
+        std::atomic_flag lock;
+        Cell *free_list;
+        Cell *cur, *end;
+        size_t slab_cells;
+        size_t live;
+        size_t allocations;
+    };
+
+    struct Shard : ShardState {
+        // Avoid false sharing between the shards of different threads
+        char padding[64 - sizeof(ShardState) % 64];
+    };
+
+    class ShardLock {
+        Shard &shard_;
+    public:
+        ShardLock(Shard &shard) : shard_(shard) {
+            while (shard_.lock.test_and_set(std::memory_order_acquire))
+                ;
+        }
+        ~ShardLock() {
+            shard_.lock.clear(std::memory_order_release);
+        }
+    };
+
+public:
+    typedef SlabAllocatorStats Stats;
+
+    PairedSlabAllocator() : bytes_(0) {
+        for (unsigned i = 0; i < SHARDS; ++i) {
+            Shard &s = shards_[i];
+            s.lock.clear();
+            s.free_list = s.cur = s.end = nullptr;
+            s.slab_cells = MIN_SLAB_CELLS;
+            s.live = s.allocations = 0;
+        }
+    }
+
+    ~PairedSlabAllocator() {
+        release();
+    }
+
+    // Returns storage for two adjacent objects: result[0] and result[1]
+    T *allocate() {
+        Shard &s = shard();
+        ShardLock lock(s);
+        Cell *cell = s.free_list;
+        if (cell) {
+            s.free_list = cell->next;
+        } else {
+            if (s.cur == s.end)
+                NewSlab(s);
+            cell = s.cur++;
+        }
+        s.live += 1;
+        s.allocations += 1;
+
+        return reinterpret_cast<T*>(&cell->items);
+    }
+
+    // Returns the storage obtained via allocate() to the pool. The objects must
+    // be already destroyed.
+    void deallocate(T *ptr) {
+        Cell *cell = reinterpret_cast<Cell*>(ptr);
+        Shard &s = shard();
+        ShardLock lock(s);
+        cell->next = s.free_list;
+        s.free_list = cell;
+        // Cells might be freed by a thread other than the one allocated them,
+        // so the per-shard counter may become "negative"
+        s.live -= 1;
+    }
+
+    // Returns the first of two objects in a pair given pointers to both of them
+    static T *pair_base(T *a, T *b) {
+        return a < b ? a : b;
+    }
+
+    // Frees all the memory at once. All the objects must be already destroyed
+    // (or have trivial destructors), no cells might be used afterwards.
+    void release() {
+        std::lock_guard<std::mutex> guard(slabs_lock_);
+        for (Cell *slab : slabs_)
+            std::free(slab);
+        slabs_.clear();
+        bytes_ = 0;
+
+        for (unsigned i = 0; i < SHARDS; ++i) {
+            Shard &s = shards_[i];
+            s.free_list = s.cur = s.end = nullptr;
+            s.slab_cells = MIN_SLAB_CELLS;
+            s.live = 0;
+        }
+    }
+
+    Stats stats() const {
+        Stats res = { 0, 0, 0, 0 };
+        for (unsigned i = 0; i < SHARDS; ++i) {
+            res.live += shards_[i].live;
+            res.allocations += shards_[i].allocations;
+        }
+        std::lock_guard<std::mutex> guard(slabs_lock_);
+        res.slabs = slabs_.size();
+        res.bytes = bytes_;
+
+        return res;
+    }
+
+private:
+    Shard &shard() {
+        return shards_[unsigned(omp_get_thread_num()) % SHARDS];
+    }
+
+    void NewSlab(Shard &s) {
+        size_t bytes = s.slab_cells * sizeof(Cell);
+        Cell *slab = static_cast<Cell*>(std::malloc(bytes));
+        VERIFY_MSG(slab, "Cannot allocate " << bytes << " bytes for a new slab");
+        {
+            std::lock_guard<std::mutex> guard(slabs_lock_);
+            slabs_.push_back(slab);
+            bytes_ += bytes;
+        }
+
+        s.cur = slab;
+        s.end = slab + s.slab_cells;
+        // Start small (many tiny graphs are created for components, etc.) and
+        // grow geometrically for the large ones
+        if (s.slab_cells < MAX_SLAB_CELLS)
+            s.slab_cells *= 2;
+    }
+
+    Shard shards_[SHARDS];
+    mutable std::mutex slabs_lock_;
+    std::vector<Cell*> slabs_;
+    size_t bytes_;
+};
+
+}
@@ -0,0 +1,156 @@
+#pragma once
+//***************************************************************************
+//* Copyright (c) 2015 Saint Petersburg State University
+//* All Rights Reserved
+//* See file LICENSE for details.
+//***************************************************************************
+
+#include "utils/verify.hpp"
+
+#include <type_traits>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+
+namespace adt {
+
+// Vector with the storage for the first N elements embedded into the object
+// itself. Switches to the heap storage only when the size exceeds N. Elements
+// must be trivially copyable (they are moved around via memmove and never
+// destroyed). Only the small subset of std::vector interface is provided.
+template<class T, unsigned N>
+class SmallVector {
+    typedef SmallVector<T, N> self;
+
+public:
+    typedef T value_type;
+    typedef T *iterator;
+    typedef const T *const_iterator;
+
+    SmallVector() : size_(0), capacity_(N) {}
+
+    SmallVector(const self &other) : size_(0), capacity_(N) {
+        assign(other);
+    }
+
+    SmallVector(self &&other) : size_(0), capacity_(N) {
+        steal(other);
+    }
+
+    self &operator=(const self &other) {
+        if (this != &other) {
+            size_ = 0;
+            assign(other);
+        }
+        return *this;
+    }
+
+    self &operator=(self &&other) {
+        if (this != &other) {
+            if (!is_small())
+                std::free(heap_);
+            size_ = 0;
+            capacity_ = N;
+            steal(other);
+        }
+        return *this;
+    }
+
+    ~SmallVector() {
+        if (!is_small())
+            std::free(heap_);
+    }
+
+    iterator begin() { return data(); }
+    iterator end() { return data() + size_; }
+    const_iterator begin() const { return data(); }
+    const_iterator end() const { return data() + size_; }
+    const_iterator cbegin() const { return data(); }
+    const_iterator cend() const { return data() + size_; }
+
+    size_t size() const { return size_; }
+    size_t capacity() const { return capacity_; }
+    bool empty() const { return size_ == 0; }
+
+    T &operator[](size_t i) { return data()[i]; }
+    const T &operator[](size_t i) const { return data()[i]; }
+
+    T *data() { return is_small() ? reinterpret_cast<T*>(&inline_) : heap_; }
+    const T *data() const { return is_small() ? reinterpret_cast<const T*>(&inline_) : heap_; }
+
+    void push_back(const T &value) {
+        insert(end(), value);
+    }
+
+    iterator insert(const_iterator pos, const T &value) {
+        size_t idx = pos - cbegin();
+        // The value might refer to the element of the vector itself
+        T copy(value);
+        if (size_ == capacity_)
+            grow(2 * capacity_);
+
+        T *ptr = data() + idx;
+        std::memmove((void*)(ptr + 1), (const void*)ptr, (size_ - idx) * sizeof(T));
+        new (ptr) T(copy);
+        size_ += 1;
+
+        return ptr;
+    }
+
+    iterator erase(const_iterator pos) {
+        size_t idx = pos - cbegin();
+        T *ptr = data() + idx;
+        std::memmove((void*)ptr, (const void*)(ptr + 1), (size_ - idx - 1) * sizeof(T));
+        size_ -= 1;
+
+        return ptr;
+    }
+
+    void clear() {
+        size_ = 0;
+    }
+
+private:
+    bool is_small() const { return capacity_ == N; }
+
+    void assign(const self &other) {
+        if (other.size_ > capacity_)
+            grow(other.size_);
+        std::memcpy((void*)data(), (const void*)other.data(), other.size_ * sizeof(T));
+        size_ = other.size_;
+    }
+
+    // Takes the heap storage of the other vector, the inline elements are copied.
+    // The other vector is left empty.
+    void steal(self &other) {
+        if (other.is_small()) {
+            assign(other);
+        } else {
+            heap_ = other.heap_;
+            capacity_ = other.capacity_;
+            size_ = other.size_;
+            other.capacity_ = N;
+        }
+        other.size_ = 0;
+    }
+
+    void grow(size_t capacity) {
+        VERIFY(capacity > capacity_ && capacity <= UINT32_MAX);
+        T *storage = static_cast<T*>(std::malloc(capacity * sizeof(T)));
+        VERIFY(storage);
+        std::memcpy((void*)storage, (const void*)data(), size_ * sizeof(T));
+        if (!is_small())
+            std::free(heap_);
+        heap_ = storage;
+        capacity_ = uint32_t(capacity);
+    }
+
+    uint32_t size_;
+    uint32_t capacity_;
+    union {
+        T *heap_;
+        typename std::aligned_storage<N * sizeof(T), std::alignment_of<T>::value>::type inline_;
+    };
+};
+
+}
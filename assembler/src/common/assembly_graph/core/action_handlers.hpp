@@ -12,6 +12,7 @@
 #include "utils/logger/logger.hpp"
 
 #include <boost/noncopyable.hpp>
+#include <initializer_list>
 #include <string>
 #include <vector>
 
@@ -19,6 +20,9 @@ namespace omnigraph {
 
 using std::vector;
 
+template<typename VertexId, typename EdgeId>
+class GraphEventBatch;
+
 /**
 * ActionHandler is base listening class for graph events. All structures and information storages
 * which are meant to synchronize with graph should use this structure. In order to make handler listen
@@ -118,6 +122,26 @@ public:
         return false;
     }
 
+    /**
+     * Descendants which can process the events of a graph event batch at once (see ObservableGraph::BeginBatch)
+     * should override this method together with HandleBatch.
+     */
+    virtual bool IsBatchable() const {
+        return false;
+    }
+
+    /**
+     * Event which is triggered when graph event batch is committed. Batch contains all the events which
+     * happened since the batch start in the order they happened. Batchable handler may only rely on the data
+     * of the elements mentioned in the events (deleted elements are kept alive till the end of the commit),
+     * graph topology and other handlers may have changed since.
+     * Default implementation replays the events one by one.
+     * @param batch recorded events
+     */
+    virtual void HandleBatch(const GraphEventBatch<VertexId, EdgeId> &batch) {
+        batch.Replay(*this);
+    }
+
     bool IsAttached() const {
         return attached_;
     }
@@ -133,6 +157,133 @@ public:
     }
 };
 
+/**
+* GraphEventBatch records graph events (see ObservableGraph::BeginBatch). Events are stored in the order
+* they happened, edge arguments of all the events are kept in one array.
+*/
+template<typename VertexId, typename EdgeId>
+class GraphEventBatch : public ActionHandler<VertexId, EdgeId> {
+public:
+    enum class EventType {
+        AddVertex, AddEdge, DeleteVertex, DeleteEdge, Merge, Glue, Split
+    };
+
+    /**
+     * Edge arguments of the event are: the edge for edge addition/deletion, old edges followed by the new one
+     * for merge, new edge, edge1 and edge2 for glue, old edge followed by the new ones for split.
+     */
+    struct Event {
+        EventType type;
+        VertexId vertex;
+        size_t edges_begin;
+        size_t edges_end;
+    };
+
+private:
+    std::vector<Event> events_;
+    std::vector<EdgeId> edges_;
+
+    void Record(EventType type, VertexId v, std::initializer_list<EdgeId> edges) {
+        size_t begin = edges_.size();
+        edges_.insert(edges_.end(), edges);
+        events_.push_back(Event{type, v, begin, edges_.size()});
+    }
+
+public:
+    GraphEventBatch() : ActionHandler<VertexId, EdgeId>("GraphEventBatch") {
+    }
+
+    const std::vector<Event> &events() const {
+        return events_;
+    }
+
+    size_t size() const {
+        return events_.size();
+    }
+
+    bool empty() const {
+        return events_.empty();
+    }
+
+    void clear() {
+        events_.clear();
+        edges_.clear();
+    }
+
+    size_t edge_count(const Event &event) const {
+        return event.edges_end - event.edges_begin;
+    }
+
+    EdgeId edge(const Event &event, size_t i = 0) const {
+        VERIFY(event.edges_begin + i < event.edges_end);
+        return edges_[event.edges_begin + i];
+    }
+
+    void HandleAdd(VertexId v) override {
+        Record(EventType::AddVertex, v, {});
+    }
+
+    void HandleAdd(EdgeId e) override {
+        Record(EventType::AddEdge, VertexId(), {e});
+    }
+
+    void HandleDelete(VertexId v) override {
+        Record(EventType::DeleteVertex, v, {});
+    }
+
+    void HandleDelete(EdgeId e) override {
+        Record(EventType::DeleteEdge, VertexId(), {e});
+    }
+
+    void HandleMerge(const vector<EdgeId> &old_edges, EdgeId new_edge) override {
+        size_t begin = edges_.size();
+        edges_.insert(edges_.end(), old_edges.begin(), old_edges.end());
+        edges_.push_back(new_edge);
+        events_.push_back(Event{EventType::Merge, VertexId(), begin, edges_.size()});
+    }
+
+    void HandleGlue(EdgeId new_edge, EdgeId edge1, EdgeId edge2) override {
+        Record(EventType::Glue, VertexId(), {new_edge, edge1, edge2});
+    }
+
+    void HandleSplit(EdgeId old_edge, EdgeId new_edge_1, EdgeId new_edge_2) override {
+        Record(EventType::Split, VertexId(), {old_edge, new_edge_1, new_edge_2});
+    }
+
+    /**
+     * Passes the recorded events to the handler one by one.
+     */
+    void Replay(ActionHandler<VertexId, EdgeId> &handler) const {
+        for (const Event &event : events_) {
+            switch (event.type) {
+                case EventType::AddVertex:
+                    handler.HandleAdd(event.vertex);
+                    break;
+                case EventType::AddEdge:
+                    handler.HandleAdd(edge(event));
+                    break;
+                case EventType::DeleteVertex:
+                    handler.HandleDelete(event.vertex);
+                    break;
+                case EventType::DeleteEdge:
+                    handler.HandleDelete(edge(event));
+                    break;
+                case EventType::Merge:
+                    handler.HandleMerge(vector<EdgeId>(edges_.begin() + event.edges_begin,
+                                                       edges_.begin() + event.edges_end - 1),
+                                        edges_[event.edges_end - 1]);
+                    break;
+                case EventType::Glue:
+                    handler.HandleGlue(edge(event, 0), edge(event, 1), edge(event, 2));
+                    break;
+                case EventType::Split:
+                    handler.HandleSplit(edge(event, 0), edge(event, 1), edge(event, 2));
+                    break;
+            }
+        }
+    }
+};
+
 template<class Graph>
 class GraphActionHandler : public ActionHandler<typename Graph::VertexId,
         typename Graph::EdgeId> {
@@ -43,26 +43,22 @@ public:
 
     void LinkIncomingEdge(VertexId v, EdgeId e) {
         VERIFY(graph_.EdgeEnd(e) == VertexId(0));
-        graph_.conjugate(v)->AddOutgoingEdge(graph_.conjugate(e));
+        graph_.LinkEdge(graph_.conjugate(v), graph_.conjugate(e));
         e->SetEndVertex(v);
     }
 
     void LinkOutgoingEdge(VertexId v, EdgeId e) {
         VERIFY(graph_.EdgeEnd(graph_.conjugate(e)) == VertexId(0));
-        v->AddOutgoingEdge(e);
+        graph_.LinkEdge(v, e);
         graph_.conjugate(e)->SetEndVertex(graph_.conjugate(v));
     }
 
     void DeleteLink(VertexId v, EdgeId e) {
-        v->RemoveOutgoingEdge(e);
+        graph_.UnlinkEdge(v, e);
     }
 
     void DeleteUnlinkedEdge(EdgeId e) {
-        EdgeId rc = graph_.conjugate(e);
-        if (e != rc) {
-            delete rc.get();
-        }
-        delete e.get();
+        graph_.DestroyEdge(e);
     }
 
     VertexId CreateVertex(const VertexData &data) {
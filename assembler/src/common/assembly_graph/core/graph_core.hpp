@@ -6,8 +6,11 @@
 
 #pragma once
 
+#include <atomic>
 #include <vector>
 #include <set>
+#include "adt/slab_allocator.hpp"
+#include "adt/small_vector.hpp"
 #include "utils/verify.hpp"
 #include "utils/logger/logger.hpp"
 #include "order_and_law.hpp"
@@ -92,7 +95,9 @@ private:
     typedef typename DataMaster::VertexData VertexData;
     typedef restricted::pure_pointer<PairedEdge<DataMaster>> EdgeId;
     typedef restricted::pure_pointer<PairedVertex<DataMaster>> VertexId;
-    typedef typename std::vector<EdgeId>::const_iterator edge_raw_iterator;
+    // Most of the vertices have at most two outgoing edges, keep them inline
+    typedef adt::SmallVector<EdgeId, 2> edge_container;
+    typedef typename edge_container::const_iterator edge_raw_iterator;
 
     class conjugate_iterator : public boost::iterator_facade<conjugate_iterator,
             EdgeId, boost::forward_traversal_tag, EdgeId> {
@@ -137,7 +142,7 @@ private:
     friend class PairedElementManipulationHelper<VertexId>;
     friend class conjugate_iterator;
 
-    std::vector<EdgeId> outgoing_edges_;
+    edge_container outgoing_edges_;
 
     VertexId conjugate_;
 
@@ -239,6 +244,25 @@ private:
    restricted::LocalIdDistributor id_distributor_;
    DataMaster master_;
    std::set<VertexId> vertices_;
+   // Vertices and edges are allocated together with their conjugates
+   adt::PairedSlabAllocator<PairedVertex<DataMaster>> vertex_allocator_;
+   adt::PairedSlabAllocator<PairedEdge<DataMaster>> edge_allocator_;
+   // Deleted elements which are destroyed later (see DeferDestruction)
+   bool defer_destruction_;
+   std::vector<VertexId> deferred_vertices_;
+   std::vector<EdgeId> deferred_edges_;
+   // Edges linked to the vertices, conjugate edges are counted separately
+   std::atomic<size_t> edge_count_;
+
+   void LinkEdge(VertexId v, EdgeId e) {
+       v->AddOutgoingEdge(e);
+       ++edge_count_;
+   }
+
+   void UnlinkEdge(VertexId v, EdgeId e) {
+       if (v->RemoveOutgoingEdge(e))
+           --edge_count_;
+   }
 
    friend class ConstructionHelper<DataMaster>;
 public:
@@ -258,6 +282,11 @@ public:
        return vertices_.size();
    }
 
+   // Number of the edges (as iterated over, i.e. with the conjugate ones)
+   size_t e_size() const {
+       return edge_count_;
+   }
+
    edge_const_iterator out_begin(VertexId v) const {
        return v->out_begin();
    }
@@ -276,14 +305,37 @@ public:
 
 private:
    void DeleteVertexFromGraph(VertexId vertex) {
-       this->vertices_.erase(vertex);
-       this->vertices_.erase(conjugate(vertex));
+       // Vertices might be removed concurrently when different threads modify disjoint parts of the graph
+#pragma omp critical(graph_vertex_set)
+       {
+           this->vertices_.erase(vertex);
+           this->vertices_.erase(conjugate(vertex));
+       }
    }
 
    void DestroyVertex(VertexId vertex) {
-       VertexId conjugate = vertex->conjugate();
-       delete vertex.get();
-       delete conjugate.get();
+       if (defer_destruction_) {
+#          pragma omp critical(graph_deferred_destruction)
+           deferred_vertices_.push_back(vertex);
+           return;
+       }
+       PairedVertex<DataMaster> *v1 = vertex.get(), *v2 = vertex->conjugate().get();
+       v1->~PairedVertex();
+       v2->~PairedVertex();
+       vertex_allocator_.deallocate(vertex_allocator_.pair_base(v1, v2));
+   }
+
+   void DestroyEdge(EdgeId edge) {
+       if (defer_destruction_) {
+#          pragma omp critical(graph_deferred_destruction)
+           deferred_edges_.push_back(edge);
+           return;
+       }
+       PairedEdge<DataMaster> *e1 = edge.get(), *e2 = edge->conjugate().get();
+       e1->~PairedEdge();
+       if (e1 != e2)
+           e2->~PairedEdge();
+       edge_allocator_.deallocate(edge_allocator_.pair_base(e1, e2));
    }
 
    bool AdditionalCompressCondition(VertexId v) const {
@@ -293,8 +345,9 @@ private:
 protected:
 
    VertexId CreateVertex(const VertexData& data1, const VertexData& data2, restricted::IdDistributor& id_distributor) {
-       VertexId vertex1(new PairedVertex<DataMaster>(data1), id_distributor);
-       VertexId vertex2(new PairedVertex<DataMaster>(data2), id_distributor);
+       PairedVertex<DataMaster> *storage = vertex_allocator_.allocate();
+       VertexId vertex1(new (storage) PairedVertex<DataMaster>(data1), id_distributor);
+       VertexId vertex2(new (storage + 1) PairedVertex<DataMaster>(data2), id_distributor);
        vertex1->set_conjugate(vertex2);
        vertex2->set_conjugate(vertex1);
        return vertex1;
@@ -309,8 +362,11 @@ protected:
     }
 
     void AddVertexToGraph(VertexId vertex) {
-        vertices_.insert(vertex);
-        vertices_.insert(conjugate(vertex));
+#pragma omp critical(graph_vertex_set)
+        {
+            vertices_.insert(vertex);
+            vertices_.insert(conjugate(vertex));
+        }
     }
 
     VertexId HiddenAddVertex(const VertexData& data, restricted::IdDistributor& id_distributor) {
@@ -331,21 +387,25 @@ protected:
     /////////////////////////low-level ops (move to helper?!)
 
     ////what with this method?
-    EdgeId AddSingleEdge(VertexId v1, VertexId v2, const EdgeData &data,
+    // Storage is the memory for the edge itself, the conjugate one (if any) is
+    // placed right after it
+    EdgeId AddSingleEdge(PairedEdge<DataMaster> *storage,
+                         VertexId v1, VertexId v2, const EdgeData &data,
                          restricted::IdDistributor &idDistributor) {
-        EdgeId newEdge(new PairedEdge<DataMaster>(v2, data), idDistributor);
+        EdgeId newEdge(new (storage) PairedEdge<DataMaster>(v2, data), idDistributor);
         if (v1 != VertexId(0))
-            v1->AddOutgoingEdge(newEdge);
+            LinkEdge(v1, newEdge);
         return newEdge;
     }
 
     EdgeId HiddenAddEdge(const EdgeData& data, restricted::IdDistributor& id_distributor) {
-        EdgeId result = AddSingleEdge(VertexId(0), VertexId(0), data, id_distributor);
+        PairedEdge<DataMaster> *storage = edge_allocator_.allocate();
+        EdgeId result = AddSingleEdge(storage, VertexId(0), VertexId(0), data, id_distributor);
         if (this->master().isSelfConjugate(data)) {
             result->set_conjugate(result);
             return result;
         }
-        EdgeId rcEdge = AddSingleEdge(VertexId(0), VertexId(0), this->master().conjugate(data), id_distributor);
+        EdgeId rcEdge = AddSingleEdge(storage + 1, VertexId(0), VertexId(0), this->master().conjugate(data), id_distributor);
         result->set_conjugate(rcEdge);
         rcEdge->set_conjugate(result);
         return result;
@@ -358,7 +418,8 @@ protected:
     EdgeId HiddenAddEdge(VertexId v1, VertexId v2, const EdgeData& data, restricted::IdDistributor& id_distributor) {
         //      todo was suppressed for concurrent execution reasons (see concurrent_graph_component.hpp)
         //      VERIFY(this->vertices_.find(v1) != this->vertices_.end() && this->vertices_.find(v2) != this->vertices_.end());
-        EdgeId result = AddSingleEdge(v1, v2, data, id_distributor);
+        PairedEdge<DataMaster> *storage = edge_allocator_.allocate();
+        EdgeId result = AddSingleEdge(storage, v1, v2, data, id_distributor);
         if (this->master().isSelfConjugate(data) && (v1 == conjugate(v2))) {
             //              todo why was it removed???
             //          Because of some split issues: when self-conjugate edge is split armageddon happends
@@ -367,7 +428,7 @@ protected:
             result->set_conjugate(result);
             return result;
         }
-        EdgeId rcEdge = AddSingleEdge(v2->conjugate(), v1->conjugate(), this->master().conjugate(data), id_distributor);
+        EdgeId rcEdge = AddSingleEdge(storage + 1, v2->conjugate(), v1->conjugate(), this->master().conjugate(data), id_distributor);
         result->set_conjugate(rcEdge);
         rcEdge->set_conjugate(result);
         return result;
@@ -382,12 +443,42 @@ protected:
         EdgeId rcEdge = conjugate(edge);
         VertexId rcStart = conjugate(edge->end());
         VertexId start = conjugate(rcEdge->end());
-        start->RemoveOutgoingEdge(edge);
-        rcStart->RemoveOutgoingEdge(rcEdge);
-        if (edge != rcEdge) {
-            delete rcEdge.get();
+        UnlinkEdge(start, edge);
+        UnlinkEdge(rcStart, rcEdge);
+        DestroyEdge(edge);
+    }
+
+    // Destroys all the vertices and edges at once bypassing the usual
+    // one-by-one deletion. Edges not linked to any vertex are not touched.
+    void HiddenDeleteAll() {
+        for (VertexId v : vertices_) {
+            for (EdgeId e : v->outgoing_edges_)
+                e->~PairedEdge();
+            v->outgoing_edges_.clear();
         }
-        delete edge.get();
+        for (VertexId v : vertices_)
+            v->~PairedVertex();
+        vertices_.clear();
+        edge_count_ = 0;
+
+        edge_allocator_.release();
+        vertex_allocator_.release();
+    }
+
+    // Deleted vertices and edges are unlinked from the graph as usual, but
+    // their storage (and the data) is kept alive till DestroyDeferred
+    void DeferDestruction() {
+        defer_destruction_ = true;
+    }
+
+    void DestroyDeferred() {
+        defer_destruction_ = false;
+        for (EdgeId e : deferred_edges_)
+            DestroyEdge(e);
+        for (VertexId v : deferred_vertices_)
+            DestroyVertex(v);
+        deferred_edges_.clear();
+        deferred_vertices_.clear();
     }
 
     void HiddenDeletePath(const std::vector<EdgeId>& edgesToDelete, const std::vector<VertexId>& verticesToDelete) {
@@ -399,13 +490,29 @@ protected:
 
 public:
 
-    GraphCore(const DataMaster& master) : master_(master) {
+    GraphCore(const DataMaster& master) : master_(master), defer_destruction_(false), edge_count_(0) {
     }
 
     virtual ~GraphCore() {
         VERIFY(size() == 0);
     }
 
+    adt::SlabAllocatorStats vertex_allocation_stats() const {
+        return vertex_allocator_.stats();
+    }
+
+    adt::SlabAllocatorStats edge_allocation_stats() const {
+        return edge_allocator_.stats();
+    }
+
+    void ReportAllocation() const {
+        auto vstats = vertex_allocator_.stats(), estats = edge_allocator_.stats();
+        INFO("Graph storage: " << vstats.live << " vertex pairs, " << estats.live << " edge pairs, "
+             << (vstats.bytes + estats.bytes) / 1024 / 1024 << " Mb in "
+             << (vstats.slabs + estats.slabs) << " slabs ("
+             << vstats.allocations << " / " << estats.allocations << " vertex / edge pair allocations)");
+    }
+
     class IteratorContainer {
     public:
         typedef edge_const_iterator const_iterator;
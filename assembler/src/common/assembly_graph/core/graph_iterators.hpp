@@ -8,6 +8,7 @@
 #pragma once
 
 #include "common/adt/queue_iterator.hpp"
+#include "common/adt/indexed_heap.hpp"
 #include "func/pred.hpp"
 #include "action_handlers.hpp"
 #include "utils/simple_tools.hpp"
@@ -20,10 +21,11 @@ namespace omnigraph {
  * iteration. And as GraphActionHandler SmartIterator can change collection contents with respect to the
  * way graph is changed. Also one can define order of iteration by specifying Comparator.
  */
-template<class Graph, typename ElementId, typename Comparator = std::less<ElementId>>
+template<class Graph, typename ElementId, typename Comparator = std::less<ElementId>,
+         typename Queue = erasable_priority_queue<ElementId, Comparator>>
 class SmartIterator : public GraphActionHandler<Graph> {
     typedef GraphActionHandler<Graph> base;
-    DynamicQueueIterator<ElementId, Comparator> inner_it_;
+    DynamicQueueIterator<ElementId, Comparator, Queue> inner_it_;
     bool add_new_;
     bool canonical_only_;
     //todo think of checking it in HandleAdd
@@ -31,18 +33,24 @@ class SmartIterator : public GraphActionHandler<Graph> {
 
 protected:
 
+    bool Accepts(const ElementId& el) const {
+        return (!canonical_only_ || el <= this->g().conjugate(el)) && add_condition_(el);
+    }
+
     void push(const ElementId& el) {
-        if ((!canonical_only_ || el <= this->g().conjugate(el)) &&
-            add_condition_(el)) {
+        if (Accepts(el)) {
             inner_it_.push(el);
         }
     }
 
     template<typename InputIterator>
     void insert(InputIterator begin, InputIterator end) {
+        std::vector<ElementId> accepted;
         for (auto it = begin; it != end; ++it) {
-            push(*it);
+            if (Accepts(*it))
+                accepted.push_back(*it);
         }
+        inner_it_.insert(accepted.begin(), accepted.end());
     }
 
     void erase(const ElementId& el) {
@@ -110,9 +118,10 @@ public:
  * way graph is changed. Also one can define order of iteration by specifying Comparator.
  */
 template<class Graph, typename ElementId,
-         typename Comparator = std::less<ElementId>>
-class SmartSetIterator : public SmartIterator<Graph, ElementId, Comparator> {
-    typedef SmartIterator<Graph, ElementId, Comparator> base;
+         typename Comparator = std::less<ElementId>,
+         typename Queue = erasable_priority_queue<ElementId, Comparator>>
+class SmartSetIterator : public SmartIterator<Graph, ElementId, Comparator, Queue> {
+    typedef SmartIterator<Graph, ElementId, Comparator, Queue> base;
 
 public:
     SmartSetIterator(const Graph &g,
@@ -147,6 +156,15 @@ public:
     }
 };
 
+/**
+ * SmartSetIterator backed by the indexed heap (see adt::indexed_heap) instead of the ordered set.
+ * It is meant for the worklists over the whole graph, e.g. the ones of PersistentProcessingAlgorithm.
+ */
+template<class Graph, typename ElementId,
+         typename Comparator = std::less<ElementId>>
+using SmartHeapIterator = SmartSetIterator<Graph, ElementId, Comparator,
+                                           adt::indexed_heap<ElementId, Comparator>>;
+
 /**
  * SmartVertexIterator iterates through vertices of graph. It listens to AddVertex/DeleteVertex graph events
  * and correspondingly edits the set of vertices to iterate through. Note: high level event handlers are
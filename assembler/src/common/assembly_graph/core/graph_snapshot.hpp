@@ -0,0 +1,262 @@
+//***************************************************************************
+//* Copyright (c) 2015 Saint Petersburg State University
+//* All Rights Reserved
+//* See file LICENSE for details.
+//***************************************************************************
+
+#pragma once
+
+#include "action_handlers.hpp"
+#include "utils/openmp_wrapper.h"
+#include "utils/verify.hpp"
+#include "utils/logger/logger.hpp"
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+
+namespace omnigraph {
+
+/**
+* Immutable compressed-sparse-row view of the graph for the read-only phases.
+* Vertices and edges get dense indices [0, vertex_count()) / [0, edge_count()),
+* so per-element data can be kept in plain arrays. Outgoing edges of a vertex
+* form a contiguous range of edge indices, incoming edges are stored in
+* a separate CSR array.
+*
+* Edge lengths and coverages are copied at Build() time. The snapshot listens
+* to the graph and becomes invalid after any modification. Coverage updates
+* are not graph modifications, so the coverage array is only meaningful if
+* coverage is not changed while the snapshot is used. All accessors check
+* the validity, call Build() again to refresh the snapshot.
+*/
+template<class Graph>
+class GraphSnapshot : public GraphActionHandler<Graph> {
+    typedef GraphActionHandler<Graph> base;
+    typedef typename Graph::VertexId VertexId;
+    typedef typename Graph::EdgeId EdgeId;
+
+public:
+    typedef uint32_t Index;
+    static const Index NO_INDEX = std::numeric_limits<Index>::max();
+
+    class IndexRange {
+        const Index *begin_, *end_;
+    public:
+        IndexRange(const Index *begin, const Index *end)
+                : begin_(begin), end_(end) {}
+        const Index *begin() const { return begin_; }
+        const Index *end() const { return end_; }
+        size_t size() const { return end_ - begin_; }
+    };
+
+    GraphSnapshot(const Graph &g, size_t nthreads = omp_get_max_threads())
+            : base(g, "GraphSnapshot"), valid_(false) {
+        Build(nthreads);
+    }
+
+    void Build(size_t nthreads = omp_get_max_threads()) {
+        const Graph &g = this->g();
+
+        vertices_.assign(g.begin(), g.end());
+        VERIFY_MSG(vertices_.size() < NO_INDEX, "Too many vertices for the graph snapshot");
+        size_t vcnt = vertices_.size();
+
+        out_offsets_.assign(vcnt + 1, 0);
+        in_offsets_.assign(vcnt + 1, 0);
+
+        // Ids might be distributed concurrently, so do not rely on id distributor
+        size_t max_id = 0;
+#       pragma omp parallel for num_threads(nthreads) reduction(max : max_id)
+        for (size_t i = 0; i < vcnt; ++i) {
+            VertexId v = vertices_[i];
+            max_id = std::max(max_id, g.int_id(v));
+            for (EdgeId e : g.OutgoingEdges(v))
+                max_id = std::max(max_id, g.int_id(e));
+            out_offsets_[i + 1] = Index(g.OutgoingEdgeCount(v));
+            in_offsets_[i + 1] = Index(g.IncomingEdgeCount(v));
+        }
+
+        vertex_idx_.Reset(max_id, vcnt);
+
+        for (size_t i = 0; i < vcnt; ++i) {
+            VERIFY_MSG(size_t(out_offsets_[i]) + out_offsets_[i + 1] < NO_INDEX,
+                       "Too many edges for the graph snapshot");
+            out_offsets_[i + 1] += out_offsets_[i];
+            in_offsets_[i + 1] += in_offsets_[i];
+        }
+
+        // Edges are numbered in the order of their start vertices, therefore
+        // outgoing edges of a vertex are just the range of edge indices
+        size_t ecnt = out_offsets_[vcnt];
+        edge_idx_.Reset(max_id, ecnt);
+        edges_.resize(ecnt);
+        start_.resize(ecnt);
+        end_.resize(ecnt);
+        conjugate_.resize(ecnt);
+        length_.resize(ecnt);
+        coverage_.resize(ecnt);
+        in_edges_.resize(in_offsets_[vcnt]);
+
+#       pragma omp parallel for num_threads(nthreads)
+        for (size_t i = 0; i < vcnt; ++i) {
+            vertex_idx_.SetDense(g.int_id(vertices_[i]), Index(i));
+            Index idx = out_offsets_[i];
+            for (EdgeId e : g.OutgoingEdges(vertices_[i])) {
+                edges_[idx] = e;
+                edge_idx_.SetDense(g.int_id(e), idx);
+                start_[idx] = Index(i);
+                ++idx;
+            }
+        }
+
+        // The hash maps are not concurrent, so sparse ids are indexed separately
+        if (vertex_idx_.has_sparse() || edge_idx_.has_sparse()) {
+            for (size_t i = 0; i < vcnt; ++i)
+                vertex_idx_.SetSparse(g.int_id(vertices_[i]), Index(i));
+            for (size_t idx = 0; idx < ecnt; ++idx)
+                edge_idx_.SetSparse(g.int_id(edges_[idx]), Index(idx));
+        }
+
+#       pragma omp parallel for num_threads(nthreads)
+        for (size_t i = 0; i < vcnt; ++i) {
+            for (Index idx = out_offsets_[i]; idx < out_offsets_[i + 1]; ++idx) {
+                EdgeId e = edges_[idx];
+                end_[idx] = vertex_idx_.Get(g.int_id(g.EdgeEnd(e)));
+                conjugate_[idx] = edge_idx_.Get(g.int_id(g.conjugate(e)));
+                length_[idx] = g.length(e);
+                coverage_[idx] = g.coverage(e);
+            }
+
+            Index pos = in_offsets_[i];
+            for (EdgeId e : g.IncomingEdges(vertices_[i]))
+                in_edges_[pos++] = edge_idx_.Get(g.int_id(e));
+        }
+
+        valid_ = true;
+        DEBUG("Graph snapshot built: " << vcnt << " vertices, " << ecnt << " edges");
+    }
+
+    bool valid() const { return valid_; }
+
+    size_t vertex_count() const { Check(); return vertices_.size(); }
+    size_t edge_count() const { Check(); return edges_.size(); }
+
+    // Dense index by graph element, NO_INDEX if the element is not in the snapshot
+    Index index(VertexId v) const {
+        Check();
+        return vertex_idx_.Get(v.int_id());
+    }
+
+    Index index(EdgeId e) const {
+        Check();
+        return edge_idx_.Get(e.int_id());
+    }
+
+    VertexId vertex(Index v) const { Check(); return vertices_[v]; }
+    EdgeId edge(Index e) const { Check(); return edges_[e]; }
+
+    const std::vector<VertexId> &vertices() const { Check(); return vertices_; }
+    const std::vector<EdgeId> &edges() const { Check(); return edges_; }
+
+    Index EdgeStart(Index e) const { Check(); return start_[e]; }
+    Index EdgeEnd(Index e) const { Check(); return end_[e]; }
+    Index conjugate(Index e) const { Check(); return conjugate_[e]; }
+    size_t length(Index e) const { Check(); return length_[e]; }
+    double coverage(Index e) const { Check(); return coverage_[e]; }
+    Index out_begin(Index v) const { Check(); return out_offsets_[v]; }
+    Index out_end(Index v) const { Check(); return out_offsets_[v + 1]; }
+    size_t OutgoingEdgeCount(Index v) const { return out_end(v) - out_begin(v); }
+
+    IndexRange IncomingEdges(Index v) const {
+        Check();
+        return IndexRange(in_edges_.data() + in_offsets_[v], in_edges_.data() + in_offsets_[v + 1]);
+    }
+    size_t IncomingEdgeCount(Index v) const { return IncomingEdges(v).size(); }
+
+    void HandleAdd(VertexId) override { Invalidate(); }
+    void HandleAdd(EdgeId) override { Invalidate(); }
+    void HandleDelete(VertexId) override { Invalidate(); }
+    void HandleDelete(EdgeId) override { Invalidate(); }
+    void HandleMerge(const std::vector<EdgeId> &, EdgeId) override { Invalidate(); }
+    void HandleGlue(EdgeId, EdgeId, EdgeId) override { Invalidate(); }
+    void HandleSplit(EdgeId, EdgeId, EdgeId) override { Invalidate(); }
+
+private:
+    // int_id -> dense index. Ids which are too large for the count of elements
+    // (e.g. the ones distributed after loading the graph with reserved ids)
+    // are indexed with the hash map, see also adt::indexed_heap
+    class IdIndex {
+        //dense part covers ids up to SPARSITY * (element count) + MIN_DENSE_SIZE
+        static const size_t MIN_DENSE_SIZE = 4096;
+        static const size_t SPARSITY = 16;
+
+        std::vector<Index> dense_;
+        std::unordered_map<size_t, Index> sparse_;
+        bool has_sparse_;
+
+    public:
+        IdIndex() : has_sparse_(false) {}
+
+        void Reset(size_t max_id, size_t cnt) {
+            size_t limit = SPARSITY * cnt + MIN_DENSE_SIZE;
+            dense_.assign(std::min(max_id + 1, limit), NO_INDEX);
+            sparse_.clear();
+            has_sparse_ = max_id >= dense_.size();
+        }
+
+        bool has_sparse() const { return has_sparse_; }
+
+        // Might be called concurrently, ids out of the dense part are skipped
+        void SetDense(size_t id, Index idx) {
+            if (id < dense_.size())
+                dense_[id] = idx;
+        }
+
+        void SetSparse(size_t id, Index idx) {
+            if (id >= dense_.size())
+                sparse_[id] = idx;
+        }
+
+        Index Get(size_t id) const {
+            if (id < dense_.size())
+                return dense_[id];
+            auto it = sparse_.find(id);
+            return it == sparse_.end() ? NO_INDEX : it->second;
+        }
+    };
+
+    void Invalidate() {
+        valid_ = false;
+    }
+
+    void Check() const {
+        VERIFY_MSG(valid_, "Graph snapshot is used after the graph was modified");
+    }
+
+    bool valid_;
+
+    std::vector<VertexId> vertices_;
+    std::vector<EdgeId> edges_;
+    IdIndex vertex_idx_;
+    IdIndex edge_idx_;
+
+    std::vector<Index> out_offsets_;
+    std::vector<Index> in_offsets_;
+    std::vector<Index> in_edges_;
+
+    std::vector<Index> start_;
+    std::vector<Index> end_;
+    std::vector<Index> conjugate_;
+    std::vector<size_t> length_;
+    std::vector<double> coverage_;
+
+    DECL_LOGGER("GraphSnapshot");
+};
+
+template<class Graph>
+const typename GraphSnapshot<Graph>::Index GraphSnapshot<Graph>::NO_INDEX;
+
+}
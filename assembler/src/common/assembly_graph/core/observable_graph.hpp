@@ -10,7 +10,9 @@
 #include <vector>
 #include <set>
 #include <cstring>
+#include <sstream>
 #include "utils/logger/logger.hpp"
+#include "utils/perfcounter.hpp"
 #include "graph_core.hpp"
 #include "graph_iterators.hpp"
 
@@ -40,6 +42,35 @@ private:
    //todo switch to smart iterators
    mutable std::vector<Handler*> action_handler_list_;
    const HandlerApplier<VertexId, EdgeId> *applier_;
+   // Graph event batch state, see BeginBatch
+   size_t batch_depth_;
+   mutable std::vector<Handler*> batch_handlers_;
+   mutable GraphEventBatch<VertexId, EdgeId> batch_;
+   // Concurrent modification state, see BeginConcurrentModification
+   size_t concurrent_depth_;
+
+   bool Batched(const Handler* handler) const {
+       return !batch_handlers_.empty() &&
+               std::find(batch_handlers_.begin(), batch_handlers_.end(), handler) != batch_handlers_.end();
+   }
+
+   template<class F>
+   void RecordToBatch(F apply) const {
+       if (batch_handlers_.empty())
+           return;
+#      pragma omp critical(graph_event_batch)
+       apply(batch_);
+   }
+
+   template<class F>
+   void Dispatch(Handler &handler, F apply) const {
+       if (concurrent_depth_ == 0 || handler.IsThreadSafe()) {
+           apply(handler);
+           return;
+       }
+#      pragma omp critical(graph_event_dispatch)
+       apply(handler);
+   }
 
 public:
 //todo move to graph core
@@ -81,6 +112,34 @@ public:
 
     bool VerifyAllDetached();
 
+    /**
+     * Starts the graph event batch. Till the matching CommitBatch the events for the attached handlers
+     * which opted into batching (see ActionHandler::IsBatchable) are recorded and delivered to them at once
+     * on commit, other handlers get the events immediately as usual. Deleted vertices and edges are destroyed
+     * on commit only, so batched handlers can still access their data.
+     * Batches can be nested, the outermost one is committed. Must not be called from a parallel region.
+     */
+    void BeginBatch();
+
+    void CommitBatch();
+
+    /**
+     * Starts the concurrent modification. Till the matching EndConcurrentModification different threads
+     * are allowed to modify disjoint parts of the graph (the vertices and the edges processed by one thread
+     * are neither touched nor adjacent to the ones of the others), every thread using its own id distributor.
+     * The events are delivered to the thread safe handlers (see ActionHandler::IsThreadSafe) directly from
+     * the modifying threads, the other handlers get them one at a time.
+     * Must not be called from a parallel region.
+     */
+    void BeginConcurrentModification() {
+        ++concurrent_depth_;
+    }
+
+    void EndConcurrentModification() {
+        VERIFY(concurrent_depth_ > 0);
+        --concurrent_depth_;
+    }
+
     //smart iterators
     template<typename Comparator>
     SmartVertexIterator<ObservableGraph, Comparator> SmartVertexBegin(
@@ -110,7 +169,8 @@ public:
     void FireDeletePath(const std::vector<EdgeId>& edges_to_delete, const std::vector<VertexId>& vertices_to_delete) const;
 
     ObservableGraph(const DataMaster& master) :
-            base(master), applier_(new PairedHandlerApplier<ObservableGraph>(*this)) {
+            base(master), applier_(new PairedHandlerApplier<ObservableGraph>(*this)), batch_depth_(0),
+            concurrent_depth_(0) {
     }
 
     virtual ~ObservableGraph();
@@ -160,14 +220,54 @@ public:
 
     EdgeId MergePath(const std::vector<EdgeId>& path, bool safe_merging = true);
 
-    std::pair<EdgeId, EdgeId> SplitEdge(EdgeId edge, size_t position);
+    std::pair<EdgeId, EdgeId> SplitEdge(EdgeId edge, size_t position) {
+        return SplitEdge(edge, position, GetGraphIdDistributor());
+    }
+
+    std::pair<EdgeId, EdgeId> SplitEdge(EdgeId edge, size_t position, restricted::IdDistributor& id_distributor);
+
+    EdgeId GlueEdges(EdgeId edge1, EdgeId edge2) {
+        return GlueEdges(edge1, edge2, GetGraphIdDistributor());
+    }
 
-    EdgeId GlueEdges(EdgeId edge1, EdgeId edge2);
+    EdgeId GlueEdges(EdgeId edge1, EdgeId edge2, restricted::IdDistributor& id_distributor);
 
 private:
     DECL_LOGGER("ObservableGraph")
 };
 
+/**
+* Graph event batch for the lifetime of the object, see ObservableGraph::BeginBatch.
+*/
+template<class Graph>
+class GraphEventBatchScope : private boost::noncopyable {
+    Graph &g_;
+public:
+    explicit GraphEventBatchScope(Graph &g) : g_(g) {
+        g_.BeginBatch();
+    }
+
+    ~GraphEventBatchScope() {
+        g_.CommitBatch();
+    }
+};
+
+/**
+* Concurrent modification for the lifetime of the object, see ObservableGraph::BeginConcurrentModification.
+*/
+template<class Graph>
+class ConcurrentModificationScope : private boost::noncopyable {
+    Graph &g_;
+public:
+    explicit ConcurrentModificationScope(Graph &g) : g_(g) {
+        g_.BeginConcurrentModification();
+    }
+
+    ~ConcurrentModificationScope() {
+        g_.EndConcurrentModification();
+    }
+};
+
 template<class DataMaster>
 typename ObservableGraph<DataMaster>::VertexId ObservableGraph<DataMaster>::AddVertex(const VertexData& data, restricted::IdDistributor& id_distributor) {
     VertexId v = base::HiddenAddVertex(data, id_distributor);
@@ -290,6 +390,9 @@ bool ObservableGraph<DataMaster>::RemoveActionHandler(const Handler* action_hand
         auto it = std::find(action_handler_list_.begin(), action_handler_list_.end(), action_handler);
         if (it != action_handler_list_.end()) {
             action_handler_list_.erase(it);
+            auto batch_it = std::find(batch_handlers_.begin(), batch_handlers_.end(), action_handler);
+            if (batch_it != batch_handlers_.end())
+                batch_handlers_.erase(batch_it);
             TRACE("Action handler " << action_handler->name() << " removed");
             result = true;
         } else {
@@ -319,66 +422,73 @@ void ObservableGraph<DataMaster>::PrintHandlersNames() const {
 template<class DataMaster>
 void ObservableGraph<DataMaster>::FireAddVertex(VertexId v) const {
     for (Handler* handler_ptr : action_handler_list_) {
-        if (handler_ptr->IsAttached()) {
+        if (handler_ptr->IsAttached() && !Batched(handler_ptr)) {
             TRACE("FireAddVertex to handler " << handler_ptr->name());
-            applier_->ApplyAdd(*handler_ptr, v);
+            Dispatch(*handler_ptr, [&](Handler &h) { applier_->ApplyAdd(h, v); });
         }
     }
+    RecordToBatch([&](Handler &batch) { applier_->ApplyAdd(batch, v); });
 }
 
 template<class DataMaster>
 void ObservableGraph<DataMaster>::FireAddEdge(EdgeId e) const {
     for (Handler* handler_ptr : action_handler_list_) {
-        if (handler_ptr->IsAttached()) {
+        if (handler_ptr->IsAttached() && !Batched(handler_ptr)) {
             TRACE("FireAddEdge to handler " << handler_ptr->name());
-            applier_->ApplyAdd(*handler_ptr, e);
+            Dispatch(*handler_ptr, [&](Handler &h) { applier_->ApplyAdd(h, e); });
         }
     }
+    RecordToBatch([&](Handler &batch) { applier_->ApplyAdd(batch, e); });
 }
 
 template<class DataMaster>
 void ObservableGraph<DataMaster>::FireDeleteVertex(VertexId v) const {
     for (auto it = action_handler_list_.rbegin(); it != action_handler_list_.rend(); ++it) {
-        if ((*it)->IsAttached()) {
-            applier_->ApplyDelete(**it, v);
+        if ((*it)->IsAttached() && !Batched(*it)) {
+            Dispatch(**it, [&](Handler &h) { applier_->ApplyDelete(h, v); });
         }
     }
+    RecordToBatch([&](Handler &batch) { applier_->ApplyDelete(batch, v); });
 }
 
 template<class DataMaster>
 void ObservableGraph<DataMaster>::FireDeleteEdge(EdgeId e) const {
     for (auto it = action_handler_list_.rbegin(); it != action_handler_list_.rend(); ++it) {
-        if ((*it)->IsAttached()) {
-            applier_->ApplyDelete(**it, e);
+        if ((*it)->IsAttached() && !Batched(*it)) {
+            Dispatch(**it, [&](Handler &h) { applier_->ApplyDelete(h, e); });
         }
     };
+    RecordToBatch([&](Handler &batch) { applier_->ApplyDelete(batch, e); });
 }
 
 template<class DataMaster>
 void ObservableGraph<DataMaster>::FireMerge(vector<EdgeId> old_edges, EdgeId new_edge) const {
     for (Handler* handler_ptr : action_handler_list_) {
-        if (handler_ptr->IsAttached()) {
-            applier_->ApplyMerge(*handler_ptr, old_edges, new_edge);
+        if (handler_ptr->IsAttached() && !Batched(handler_ptr)) {
+            Dispatch(*handler_ptr, [&](Handler &h) { applier_->ApplyMerge(h, old_edges, new_edge); });
         }
     }
+    RecordToBatch([&](Handler &batch) { applier_->ApplyMerge(batch, old_edges, new_edge); });
 }
 
 template<class DataMaster>
 void ObservableGraph<DataMaster>::FireGlue(EdgeId new_edge, EdgeId edge1, EdgeId edge2) const {
     for (Handler* handler_ptr : action_handler_list_) {
-        if (handler_ptr->IsAttached()) {
-            applier_->ApplyGlue(*handler_ptr, new_edge, edge1, edge2);
+        if (handler_ptr->IsAttached() && !Batched(handler_ptr)) {
+            Dispatch(*handler_ptr, [&](Handler &h) { applier_->ApplyGlue(h, new_edge, edge1, edge2); });
         }
     };
+    RecordToBatch([&](Handler &batch) { applier_->ApplyGlue(batch, new_edge, edge1, edge2); });
 }
 
 template<class DataMaster>
 void ObservableGraph<DataMaster>::FireSplit(EdgeId edge, EdgeId new_edge1, EdgeId new_edge2) const {
     for (Handler* handler_ptr : action_handler_list_) {
-        if (handler_ptr->IsAttached()) {
-            applier_->ApplySplit(*handler_ptr, edge, new_edge1, new_edge2);
+        if (handler_ptr->IsAttached() && !Batched(handler_ptr)) {
+            Dispatch(*handler_ptr, [&](Handler &h) { applier_->ApplySplit(h, edge, new_edge1, new_edge2); });
         }
     }
+    RecordToBatch([&](Handler &batch) { applier_->ApplySplit(batch, edge, new_edge1, new_edge2); });
 }
 
 template<class DataMaster>
@@ -391,6 +501,48 @@ bool ObservableGraph<DataMaster>::VerifyAllDetached() {
     return true;
 }
 
+template<class DataMaster>
+void ObservableGraph<DataMaster>::BeginBatch() {
+    if (batch_depth_++ > 0)
+        return;
+    VERIFY(batch_handlers_.empty() && batch_.empty());
+    for (Handler* handler_ptr : action_handler_list_) {
+        if (handler_ptr->IsAttached() && handler_ptr->IsBatchable())
+            batch_handlers_.push_back(handler_ptr);
+    }
+    // Nothing to batch, the events are dispatched as usual
+    if (!batch_handlers_.empty())
+        base::DeferDestruction();
+}
+
+template<class DataMaster>
+void ObservableGraph<DataMaster>::CommitBatch() {
+    VERIFY(batch_depth_ > 0);
+    if (--batch_depth_ > 0 || batch_handlers_.empty())
+        return;
+    if (batch_.empty()) {
+        batch_handlers_.clear();
+        base::DestroyDeferred();
+        return;
+    }
+
+    std::vector<Handler*> handlers;
+    handlers.swap(batch_handlers_);
+    std::stringstream times;
+    for (Handler* handler_ptr : handlers) {
+        // Detached handlers are expected to be refilled before the next attachment
+        if (!handler_ptr->IsAttached())
+            continue;
+        perf_counter pc;
+        handler_ptr->HandleBatch(batch_);
+        times << " " << handler_ptr->name() << " " << pc.time() << " s";
+    }
+    DEBUG("Graph event batch of " << batch_.size() << " events committed:" << times.str());
+
+    batch_.clear();
+    base::DestroyDeferred();
+}
+
 template<class DataMaster>
 void ObservableGraph<DataMaster>::FireDeletePath(const vector<EdgeId>& edgesToDelete, const vector<VertexId>& verticesToDelete) const {
     for (auto it = edgesToDelete.begin(); it != edgesToDelete.end(); ++it)
@@ -401,6 +553,13 @@ void ObservableGraph<DataMaster>::FireDeletePath(const vector<EdgeId>& edgesToDe
 
 template<class DataMaster>
 ObservableGraph<DataMaster>::~ObservableGraph<DataMaster>() {
+    VERIFY(batch_depth_ == 0 && concurrent_depth_ == 0);
+    // Nobody is listening, so there is no need to delete the elements one by one
+    if (action_handler_list_.empty()) {
+        base::HiddenDeleteAll();
+        return;
+    }
+
     while (base::size() > 0) {
         ForceDeleteVertex(*base::begin());
     }
@@ -459,14 +618,15 @@ typename ObservableGraph<DataMaster>::EdgeId ObservableGraph<DataMaster>::MergeP
 }
 
 template<class DataMaster>
-std::pair<typename ObservableGraph<DataMaster>::EdgeId, typename ObservableGraph<DataMaster>::EdgeId> ObservableGraph<DataMaster>::SplitEdge(EdgeId edge, size_t position) {
+std::pair<typename ObservableGraph<DataMaster>::EdgeId, typename ObservableGraph<DataMaster>::EdgeId> ObservableGraph<DataMaster>::SplitEdge(EdgeId edge, size_t position, restricted::IdDistributor& id_distributor) {
     bool sc_flag = (edge == conjugate(edge));
     VERIFY_MSG(position > 0 && position < (sc_flag ? base::length(edge) / 2 + 1 : base::length(edge)),
             "Edge length is " << base::length(edge) << " but split pos was " << position);
     std::pair<VertexData, std::pair<EdgeData, EdgeData> > newData = base::master().SplitData(base::data(edge), position, sc_flag);
-    VertexId splitVertex = base::HiddenAddVertex(newData.first);
-    EdgeId new_edge1 = base::HiddenAddEdge(base::EdgeStart(edge), splitVertex, newData.second.first);
-    EdgeId new_edge2 = base::HiddenAddEdge(splitVertex, sc_flag ? conjugate(splitVertex) : base::EdgeEnd(edge), newData.second.second);
+    VertexId splitVertex = base::HiddenAddVertex(newData.first, id_distributor);
+    EdgeId new_edge1 = base::HiddenAddEdge(base::EdgeStart(edge), splitVertex, newData.second.first, id_distributor);
+    EdgeId new_edge2 = base::HiddenAddEdge(splitVertex, sc_flag ? conjugate(splitVertex) : base::EdgeEnd(edge),
+                                           newData.second.second, id_distributor);
     VERIFY(!sc_flag || new_edge2 == conjugate(new_edge2))
     FireSplit(edge, new_edge1, new_edge2);
     FireDeleteEdge(edge);
@@ -478,8 +638,9 @@ std::pair<typename ObservableGraph<DataMaster>::EdgeId, typename ObservableGraph
 }
 
 template<class DataMaster>
-typename ObservableGraph<DataMaster>::EdgeId ObservableGraph<DataMaster>::GlueEdges(EdgeId edge1, EdgeId edge2) {
-    EdgeId new_edge = base::HiddenAddEdge(base::EdgeStart(edge2), base::EdgeEnd(edge2), base::master().GlueData(base::data(edge1), base::data(edge2)));
+typename ObservableGraph<DataMaster>::EdgeId ObservableGraph<DataMaster>::GlueEdges(EdgeId edge1, EdgeId edge2, restricted::IdDistributor& id_distributor) {
+    EdgeId new_edge = base::HiddenAddEdge(base::EdgeStart(edge2), base::EdgeEnd(edge2),
+                                          base::master().GlueData(base::data(edge1), base::data(edge2)), id_distributor);
     FireGlue(new_edge, edge1, edge2);
     FireDeleteEdge(edge1);
     FireDeleteEdge(edge2);
@@ -7,12 +7,18 @@
 #pragma once
 
 #include "utils/simple_tools.hpp"
+#include "utils/openmp_wrapper.h"
 #include "dijkstra_settings.hpp"
 
 #include <queue>
 #include <vector>
 #include <set>
 #include <map>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <type_traits>
 
 namespace omnigraph {
 
@@ -48,16 +54,278 @@ public:
   }
 };
 
+/**
+ * Priority queue of the Dijkstra search: radix heap over the integral
+ * distances. The search never pushes a distance smaller than the last popped
+ * one, so the elements are spread over the buckets by the highest bit in which
+ * their distance differs from the last popped one, and only the first
+ * non-empty bucket is redistributed on pop. The elements with equal distances
+ * are popped in the order of ReverseDistanceComparator, as from the binary
+ * heap. Buckets keep their memory when cleared.
+ */
+template<typename Graph, typename distance_t>
+class DijkstraRadixHeap {
+    static_assert(std::is_integral<distance_t>::value && std::is_unsigned<distance_t>::value,
+                  "Radix heap requires unsigned integral distances");
+
+    typedef element_t<Graph, distance_t> element;
+    typedef ReverseDistanceComparator<element> comparator;
+
+    static const size_t BUCKETS = sizeof(unsigned long long) * 8 + 1;
+
+    std::vector<element> buckets_[BUCKETS];
+    distance_t last_;
+    size_t size_;
+
+    size_t bucket(distance_t distance) const {
+        return distance == last_ ? 0 : BUCKETS - 1 - __builtin_clzll((unsigned long long) (distance ^ last_));
+    }
+
+    // Moves the elements with the minimal distance to the first bucket
+    void Prepare() {
+        if (!buckets_[0].empty())
+            return;
+
+        size_t i = 1;
+        while (buckets_[i].empty())
+            ++i;
+        std::vector<element> &b = buckets_[i];
+        last_ = std::min_element(b.begin(), b.end(),
+                                 [](const element &a, const element &b) { return a.distance < b.distance; })->distance;
+        for (const element &e : b)
+            buckets_[bucket(e.distance)].push_back(e);
+        b.clear();
+        std::make_heap(buckets_[0].begin(), buckets_[0].end(), comparator());
+    }
+
+public:
+    DijkstraRadixHeap()
+            : last_(0), size_(0) {}
+
+    bool empty() const {
+        return size_ == 0;
+    }
+
+    void clear() {
+        for (auto &b : buckets_)
+            b.clear();
+        last_ = 0;
+        size_ = 0;
+    }
+
+    // Memory held by the buckets
+    size_t bytes() const {
+        size_t res = 0;
+        for (const auto &b : buckets_)
+            res += b.capacity() * sizeof(element);
+        return res;
+    }
+
+    void push(const element &e) {
+        VERIFY(e.distance >= last_);
+        size_t i = bucket(e.distance);
+        buckets_[i].push_back(e);
+        if (i == 0)
+            std::push_heap(buckets_[0].begin(), buckets_[0].end(), comparator());
+        ++size_;
+    }
+
+    const element &top() {
+        Prepare();
+        return buckets_[0].front();
+    }
+
+    void pop() {
+        Prepare();
+        std::pop_heap(buckets_[0].begin(), buckets_[0].end(), comparator());
+        buckets_[0].pop_back();
+        --size_;
+    }
+};
+
+/**
+ * Storage of the Dijkstra search. The vertices get dense indices in the order
+ * their distances are counted, the per-vertex state lives in the plain array
+ * indexed by them. Vertices are mapped to the indices via the open addressing
+ * table, which slots are invalidated all at once by bumping the generation
+ * stamp. Vertex ids are sparse and never reused, so the arrays indexed by the
+ * ids themselves would take O(max id) memory per search.
+ *
+ * Workspaces are recycled through the pool (see Acquire / Release), so the
+ * searches created over and over again do not allocate after the warm-up.
+ * The pool keeps only a few small workspaces per thread and at most
+ * MAX_POOLED_BYTES in total, the rest are freed on release.
+ */
+template<class Graph, typename distance_t>
+class DijkstraWorkspace {
+    typedef typename Graph::VertexId VertexId;
+    typedef typename Graph::EdgeId EdgeId;
+
+public:
+    struct VertexState {
+        VertexId vertex;
+        VertexId prev_vertex;
+        EdgeId edge;
+        distance_t distance;
+        bool processed;
+    };
+
+    static const size_t NOT_FOUND = size_t(-1);
+
+    DijkstraWorkspace()
+            : stamp_(0), bits_(0) {}
+
+    void Reset() {
+        states_.clear();
+        heap_.clear();
+        if (++stamp_ == 0) {
+            for (auto &slot : slots_)
+                slot.stamp = 0;
+            stamp_ = 1;
+        }
+    }
+
+    // Index of the vertex state, NOT_FOUND if there is no such vertex
+    size_t Find(VertexId vertex) const {
+        if (slots_.empty())
+            return NOT_FOUND;
+
+        size_t mask = slots_.size() - 1;
+        for (size_t i = Hash(vertex); ; i = (i + 1) & mask) {
+            const Slot &slot = slots_[i];
+            if (slot.stamp != stamp_)
+                return NOT_FOUND;
+            if (states_[slot.index].vertex == vertex)
+                return slot.index;
+        }
+    }
+
+    // The vertex must not be added yet
+    VertexState &Add(VertexId vertex, distance_t distance, VertexId prev_vertex, EdgeId edge) {
+        if (2 * (states_.size() + 1) > slots_.size())
+            Rehash(std::max(slots_.size() * 2, size_t(64)));
+
+        Insert(vertex, states_.size());
+        states_.push_back(VertexState{vertex, prev_vertex, edge, distance, false});
+        return states_.back();
+    }
+
+    const VertexState &state(size_t idx) const {
+        return states_[idx];
+    }
+
+    const std::vector<VertexState> &states() const {
+        return states_;
+    }
+
+    DijkstraRadixHeap<Graph, distance_t> &heap() {
+        return heap_;
+    }
+
+    // Memory held by the workspace, it is kept between the searches
+    size_t bytes() const {
+        return sizeof(DijkstraWorkspace) + states_.capacity() * sizeof(VertexState) +
+                slots_.capacity() * sizeof(Slot) + heap_.bytes();
+    }
+
+    static std::unique_ptr<DijkstraWorkspace> Acquire() {
+        Shard &s = shard();
+        {
+            std::lock_guard<std::mutex> lock(s.lock);
+            if (!s.pool.empty()) {
+                std::unique_ptr<DijkstraWorkspace> res = std::move(s.pool.back());
+                s.pool.pop_back();
+                pooled_bytes() -= res->bytes();
+                return res;
+            }
+        }
+        return std::unique_ptr<DijkstraWorkspace>(new DijkstraWorkspace());
+    }
+
+    static void Release(std::unique_ptr<DijkstraWorkspace> workspace) {
+        // Do not let the occasional huge searches hold the memory
+        size_t bytes = workspace->bytes();
+        if (bytes > MAX_POOLED_WORKSPACE_BYTES)
+            return;
+
+        Shard &s = shard();
+        std::lock_guard<std::mutex> lock(s.lock);
+        if (s.pool.size() >= MAX_POOLED)
+            return;
+        if ((pooled_bytes() += bytes) > MAX_POOLED_BYTES) {
+            pooled_bytes() -= bytes;
+            return;
+        }
+        s.pool.push_back(std::move(workspace));
+    }
+
+    // Memory held by the pooled workspaces of all threads
+    static size_t PooledBytes() {
+        return pooled_bytes();
+    }
+
+private:
+    struct Slot {
+        uint32_t stamp;
+        uint32_t index;
+    };
+
+    struct Shard {
+        std::mutex lock;
+        std::vector<std::unique_ptr<DijkstraWorkspace>> pool;
+    };
+
+    static const unsigned SHARDS = 64;
+    static const size_t MAX_POOLED = 4;
+    static const size_t MAX_POOLED_WORKSPACE_BYTES = 8 << 20;
+    static const size_t MAX_POOLED_BYTES = 64 << 20;
+
+    static std::atomic<size_t> &pooled_bytes() {
+        static std::atomic<size_t> bytes(0);
+        return bytes;
+    }
+
+    // Every thread of OpenMP team uses its own part of the pool
+    static Shard &shard() {
+        static Shard shards[SHARDS];
+        return shards[unsigned(omp_get_thread_num()) % SHARDS];
+    }
+
+    size_t Hash(VertexId vertex) const {
+        return size_t((vertex.int_id() * 0x9E3779B97F4A7C15ull) >> (64 - bits_));
+    }
+
+    void Insert(VertexId vertex, size_t idx) {
+        size_t mask = slots_.size() - 1;
+        size_t i = Hash(vertex);
+        while (slots_[i].stamp == stamp_)
+            i = (i + 1) & mask;
+        slots_[i].stamp = stamp_;
+        slots_[i].index = uint32_t(idx);
+    }
+
+    void Rehash(size_t size) {
+        slots_.assign(size, Slot{0, 0});
+        bits_ = unsigned(__builtin_ctzll(size));
+        for (size_t i = 0; i < states_.size(); ++i)
+            Insert(states_[i].vertex, i);
+    }
+
+    std::vector<VertexState> states_;
+    std::vector<Slot> slots_;
+    uint32_t stamp_;
+    unsigned bits_;
+    DijkstraRadixHeap<Graph, distance_t> heap_;
+};
+
 template<class Graph, class DijkstraSettings, typename distance_t = size_t>
 class Dijkstra {
     typedef typename Graph::VertexId VertexId;
     typedef typename Graph::EdgeId EdgeId;
     typedef distance_t DistanceType;
 
-    typedef std::map<VertexId, distance_t> distances_map;
-    typedef typename distances_map::const_iterator distances_map_ci;
-    typedef typename std::priority_queue<element_t<Graph, distance_t>, std::vector<element_t<Graph, distance_t>>,
-            ReverseDistanceComparator<element_t<Graph, distance_t>>> queue_t;
+    typedef DijkstraWorkspace<Graph, distance_t> workspace_t;
+    typedef DijkstraRadixHeap<Graph, distance_t> queue_t;
 
     // constructor parameters
     const Graph& graph_;
@@ -70,19 +338,15 @@ class Dijkstra {
     bool vertex_limit_exceeded_;
 
     // accumulative structures
-    distances_map distances_;
-    std::set<VertexId> processed_vertices_;
-    std::map<VertexId, pair<VertexId, EdgeId>> prev_vert_map_;
+    std::unique_ptr<workspace_t> workspace_;
 
     void Init(VertexId start, queue_t &queue) {
         vertex_number_ = 0;
-        distances_.clear();
-        processed_vertices_.clear();
-        prev_vert_map_.clear();
+        vertex_limit_exceeded_ = false;
+        workspace_->Reset();
         set_finished(false);
         settings_.Init(start);
         queue.push(element_t<Graph, distance_t>(0, start, VertexId(0), EdgeId(0)));
-        prev_vert_map_[start] = std::pair<VertexId, EdgeId>(VertexId(0), EdgeId(0));
     }
 
     void set_finished(bool state) {
@@ -126,6 +390,17 @@ class Dijkstra {
         TRACE("All neighbours of vertex " << graph_.str(cur_vertex) << " processed");
     }
 
+    // Vertices of the states satisfying the predicate in the order of ids
+    template<class Predicate>
+    std::vector<VertexId> CollectVertices(Predicate pred) const {
+        std::vector<VertexId> result;
+        for (const auto &state : workspace_->states())
+            if (pred(state))
+                result.push_back(state.vertex);
+        std::sort(result.begin(), result.end());
+        return result;
+    }
+
 public:
     Dijkstra(const Graph &graph, DijkstraSettings settings, size_t max_vertex_number = size_t(-1)) :
         graph_(graph),
@@ -133,7 +408,15 @@ public:
         max_vertex_number_(max_vertex_number),
         finished_(false),
         vertex_number_(0),
-        vertex_limit_exceeded_(false) {}
+        vertex_limit_exceeded_(false),
+        workspace_(workspace_t::Acquire()) {
+        workspace_->Reset();
+    }
+
+    ~Dijkstra() {
+        if (workspace_)
+            workspace_t::Release(std::move(workspace_));
+    }
 
     Dijkstra(Dijkstra&& /*other*/) = default; 
 
@@ -148,33 +431,26 @@ public:
     }
 
     bool DistanceCounted(VertexId vertex) const {
-        return distances_.find(vertex) != distances_.end();
+        return workspace_->Find(vertex) != workspace_t::NOT_FOUND;
     }
 
     distance_t GetDistance(VertexId vertex) const {
-        VERIFY(DistanceCounted(vertex));
-        return distances_.find(vertex)->second;
-    }
-
-    std::pair<distances_map_ci, distances_map_ci> GetDistances() const {
-        distances_map_ci begin = distances_.begin();
-        distances_map_ci end = distances_.end();
-        return make_pair(begin, end);
+        size_t idx = workspace_->Find(vertex);
+        VERIFY(idx != workspace_t::NOT_FOUND);
+        return workspace_->state(idx).distance;
     }
 
     void Run(VertexId start) {
         TRACE("Starting dijkstra run from vertex " << graph_.str(start));
-        queue_t queue;
+        queue_t &queue = workspace_->heap();
         Init(start, queue);
         TRACE("Priority queue initialized. Starting search");
 
         while (!queue.empty() && !finished()) {
             TRACE("Dijkstra iteration started");
-            const element_t<Graph, distance_t>& next = queue.top();
+            const element_t<Graph, distance_t> next = queue.top();
             distance_t distance = next.distance;
             VertexId vertex = next.curr_vertex;
-
-            prev_vert_map_[vertex] = std::pair<VertexId, EdgeId>(next.prev_vertex, next.edge_between);
             queue.pop();
             TRACE("Vertex " << graph_.str(vertex) << " with distance " << distance << " fetched from queue");
 
@@ -182,7 +458,8 @@ public:
                 TRACE("Distance to vertex " << graph_.str(vertex) << " already counted. Proceeding to next queue entry.");
                 continue;
             }
-            distances_.insert(make_pair(vertex, distance));
+            // The first entry fetched is the one on the shortest path
+            auto &state = workspace_->Add(vertex, distance, next.prev_vertex, next.edge_between);
 
             TRACE("Vertex " << graph_.str(vertex) << " is found to be at distance "
                     << distance << " from vertex " << graph_.str(start));
@@ -190,45 +467,38 @@ public:
                 TRACE("Check for processing vertex failed. Proceeding to the next queue entry.");
                 continue;
             }
-            processed_vertices_.insert(vertex);
+            state.processed = true;
             AddNeighboursToQueue(vertex, distance, queue);
         }
+        queue.clear();
         set_finished(true);
         TRACE("Finished dijkstra run from vertex " << graph_.str(start));
     }
 
     std::vector<EdgeId> GetShortestPathTo(VertexId vertex) {
         std::vector<EdgeId> path;
-        if (prev_vert_map_.find(vertex) == prev_vert_map_.end())
+        size_t idx = workspace_->Find(vertex);
+        if (idx == workspace_t::NOT_FOUND)
             return path;
 
-        VertexId curr_vertex = vertex;
-        VertexId prev_vertex = get(prev_vert_map_, vertex).first;
-        EdgeId edge = get(prev_vert_map_, curr_vertex).second;
-
-        while (prev_vertex != VertexId(0)) {
-            if (graph_.EdgeStart(edge) == prev_vertex)
-                path.insert(path.begin(), edge);
+        while (workspace_->state(idx).prev_vertex != VertexId(0)) {
+            const auto &state = workspace_->state(idx);
+            if (graph_.EdgeStart(state.edge) == state.prev_vertex)
+                path.insert(path.begin(), state.edge);
             else
-                path.push_back(edge);
-            curr_vertex = prev_vertex;
-            const auto& prev_v_e = get(prev_vert_map_, curr_vertex);
-            prev_vertex = prev_v_e.first;
-            edge = prev_v_e.second;
+                path.push_back(state.edge);
+            idx = workspace_->Find(state.prev_vertex);
+            VERIFY(idx != workspace_t::NOT_FOUND);
         }
         return path;
     }
 
     vector<VertexId> ReachedVertices() const {
-        vector<VertexId> result;
-        for (auto it = distances_.begin(); it != distances_.end(); ++it) {
-            result.push_back(it->first);
-        }
-        return result;
+        return CollectVertices([](const typename workspace_t::VertexState &) { return true; });
     }
 
-    const set<VertexId>& ProcessedVertices() const {
-        return processed_vertices_;
+    vector<VertexId> ProcessedVertices() const {
+        return CollectVertices([](const typename workspace_t::VertexState &state) { return state.processed; });
     }
 
     bool VertexLimitExceeded() const {
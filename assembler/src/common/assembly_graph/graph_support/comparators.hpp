@@ -1,4 +1,9 @@
 #pragma once
+
+#include "math/xmath.h"
+
+#include <utility>
+
 namespace omnigraph {
 
 template<class Graph>
@@ -8,18 +13,31 @@ private:
     typedef typename Graph::VertexId VertexId;
     const Graph &graph_;
 public:
+    typedef std::pair<double, EdgeId> key_type;
+
     CoverageComparator(const Graph &graph)
             : graph_(graph) {
     }
 
+    /**
+     * Sort key to be cached by the indexed heap, see adt::sort_key.
+     */
+    key_type key(EdgeId edge) const {
+        return key_type(graph_.coverage(edge), edge);
+    }
+
+    bool operator()(const key_type &key1, const key_type &key2) const {
+        if (math::eq(key1.first, key2.first)) {
+            return key1.second < key2.second;
+        }
+        return math::ls(key1.first, key2.first);
+    }
+
     /**
      * Standard comparator function as used in collections.
      */
     bool operator()(EdgeId edge1, EdgeId edge2) const {
-        if (math::eq(graph_.coverage(edge1), graph_.coverage(edge2))) {
-            return edge1 < edge2;
-        }
-        return math::ls(graph_.coverage(edge1), graph_.coverage(edge2));
+        return (*this)(key(edge1), key(edge2));
     }
 };
 
@@ -45,18 +63,28 @@ public:
          * Construct TipComparator for given graph
          * @param graph graph for which comparator is created
          */
+        typedef std::pair<size_t, EdgeId> key_type;
+
         LengthComparator(const Graph &graph)
                 : graph_(graph) {
         }
 
+        /**
+         * Sort key to be cached by the indexed heap, see adt::sort_key.
+         */
+        key_type key(EdgeId edge) const {
+            return key_type(graph_.length(edge), edge);
+        }
+
+        bool operator()(const key_type &key1, const key_type &key2) const {
+            return key1 < key2;
+        }
+
         /**
          * Standard comparator function as used in collections.
          */
         bool operator()(EdgeId edge1, EdgeId edge2) const {
-            if (graph_.length(edge1) == graph_.length(edge2)) {
-                return edge1 < edge2;
-            }
-            return graph_.length(edge1) < graph_.length(edge2);
+            return (*this)(key(edge1), key(edge2));
         }
     };
 }
\ No newline at end of file
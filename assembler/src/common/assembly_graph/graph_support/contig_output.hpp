@@ -8,6 +8,7 @@
 #pragma once
 
 #include "assembly_graph/stats/picture_dump.hpp"
+#include "assembly_graph/core/graph_snapshot.hpp"
 #include <io/reads/osequencestream.hpp>
 #include "assembly_graph/components/connected_component.hpp"
 #include "assembly_graph/stats/statistics.hpp"
@@ -136,6 +137,9 @@ template<class Graph>
 class GFAWriter {
 private:
     typedef typename Graph::EdgeId EdgeId;
+    typedef omnigraph::GraphSnapshot<Graph> Snapshot;
+    typedef typename Snapshot::Index Index;
+
     const Graph &graph_;
     const path_extend::PathContainer &paths_;
     const string filename_;
@@ -153,20 +157,24 @@ private:
         return IsCanonical(e) ? "+" : "-";
     }
 
-    void WriteSegments(std::ofstream &stream) {
+    void WriteSegments(std::ofstream &stream, const Snapshot &snapshot) {
         GFASegmentWriter segment_writer(stream);
         for (auto it = graph_.ConstEdgeBegin(true); !it.IsEnd(); ++it) {
-            segment_writer.Write((*it).int_id(), graph_.EdgeNucls(*it), graph_.coverage(*it) * double(graph_.length(*it)));
+            Index e = snapshot.index(*it);
+            segment_writer.Write((*it).int_id(), graph_.EdgeNucls(*it), snapshot.coverage(e) * double(snapshot.length(e)));
         }
     }
 
-    void WriteLinks(std::ofstream &stream) {
+    void WriteLinks(std::ofstream &stream, const Snapshot &snapshot) {
         GFALinkWriter link_writer(stream, graph_.k());
         for (auto it = graph_.SmartVertexBegin(); !it.IsEnd(); ++it) {
-            for (auto inc_edge : graph_.IncomingEdges(*it)) {
+            Index v = snapshot.index(*it);
+            for (Index inc : snapshot.IncomingEdges(v)) {
+                EdgeId inc_edge = snapshot.edge(inc);
                 std::string orientation_first = GetOrientation(inc_edge);
                 size_t segment_first = IsCanonical(inc_edge) ? inc_edge.int_id() : graph_.conjugate(inc_edge).int_id();
-                for (auto out_edge : graph_.OutgoingEdges(*it)) {
+                for (Index out = snapshot.out_begin(v); out < snapshot.out_end(v); ++out) {
+                    EdgeId out_edge = snapshot.edge(out);
                     size_t segment_second = IsCanonical(out_edge) ? out_edge.int_id() : graph_.conjugate(out_edge).int_id();
                     std::string orientation_second = GetOrientation(out_edge);
                     link_writer.Write(segment_first, orientation_first, segment_second, orientation_second);
@@ -213,8 +221,9 @@ public:
     void Write() {
         std::ofstream stream;
         stream.open(filename_);
-        WriteSegments(stream);
-        WriteLinks(stream);
+        Snapshot snapshot(graph_);
+        WriteSegments(stream, snapshot);
+        WriteLinks(stream, snapshot);
         WritePaths(stream);
     }
 };
@@ -392,6 +401,9 @@ void MakeContigIdMap(const Graph& graph, map<EdgeId, ExtendedContigIdT>& ids, co
 template<class Graph>
 class ContigPrinter {
 private:
+    typedef omnigraph::GraphSnapshot<Graph> Snapshot;
+    typedef typename Snapshot::Index Index;
+
     const Graph &graph_;
     ContigConstructor<Graph> &constructor_;
     template<class sequence_stream>
@@ -425,26 +437,33 @@ public:
     void PrintContigsFASTG(sequence_stream &os, const ConnectedComponentCounter & cc_counter) {
         map<EdgeId, ExtendedContigIdT> ids;
         MakeContigIdMap(graph_, ids, cc_counter, "EDGE");
+
+        // Ids of the successors are collected for every edge, so they are
+        // looked up by the snapshot indices instead of the map
+        Snapshot snapshot(graph_);
+        vector<string> full_ids(snapshot.edge_count());
+        for (Index e = 0; e < full_ids.size(); ++e)
+            full_ids[e] = ids[snapshot.edge(e)].full_id_;
+
         for (auto it = graph_.ConstEdgeBegin(true); !it.IsEnd(); ++it) {
-            set<string> next;
-            VertexId v = graph_.EdgeEnd(*it);
-            auto edges = graph_.OutgoingEdges(v);
-            for (auto next_it = edges.begin(); next_it != edges.end(); ++next_it) {
-                next.insert(ids[*next_it].full_id_);
-            }
-            ReportEdge(os, constructor_.construct(*it).first, ids[*it].full_id_, next);
-            if (*it != graph_.conjugate(*it))
-            {
-                set<string> next_conj;
-                v = graph_.EdgeEnd(graph_.conjugate(*it));
-                edges = graph_.OutgoingEdges(v);
-                for (auto next_it = edges.begin(); next_it != edges.end(); ++next_it) {
-                    next_conj.insert(ids[*next_it].full_id_);
-                }
-                ReportEdge(os, constructor_.construct(graph_.conjugate(*it)).first, ids[graph_.conjugate(*it)].full_id_, next_conj);               
+            Index e = snapshot.index(*it);
+            ReportEdge(os, constructor_.construct(*it).first, full_ids[e], NextIds(snapshot, full_ids, e));
+            if (*it != graph_.conjugate(*it)) {
+                Index conj = snapshot.conjugate(e);
+                ReportEdge(os, constructor_.construct(graph_.conjugate(*it)).first, full_ids[conj],
+                           NextIds(snapshot, full_ids, conj));
             }
         }
     }
+
+private:
+    set<string> NextIds(const Snapshot &snapshot, const vector<string> &full_ids, Index e) const {
+        set<string> next;
+        Index v = snapshot.EdgeEnd(e);
+        for (Index next_e = snapshot.out_begin(v); next_e < snapshot.out_end(v); ++next_e)
+            next.insert(full_ids[next_e]);
+        return next;
+    }
 };
 
 template<class Graph>
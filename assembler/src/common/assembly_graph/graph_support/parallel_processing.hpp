@@ -9,6 +9,7 @@
 
 #include "utils/logger/logger.hpp"
 #include "assembly_graph/core/graph_iterators.hpp"
+#include "assembly_graph/core/observable_graph.hpp"
 #include "assembly_graph/graph_support/graph_processing_algorithm.hpp"
 #include "utils/openmp_wrapper.h"
 
@@ -152,7 +153,7 @@ protected:
     CandidateFinderPtr interest_el_finder_;
 
 private:
-    SmartSetIterator<Graph, ElementId, Comparator> it_;
+    SmartHeapIterator<Graph, ElementId, Comparator> it_;
     bool tracking_;
     size_t total_iteration_estimate_;
     size_t curr_iteration_;
@@ -193,7 +194,10 @@ public:
             it_.clear();
             TRACE("Primary launch.");
             TRACE("Start searching for relevant elements");
-            interest_el_finder_->Run(this->g(), [&](ElementId el) {it_.push(el);});
+            std::vector<ElementId> candidates;
+            interest_el_finder_->Run(this->g(), [&](ElementId el) {candidates.push_back(el);});
+            //heap is built at once
+            it_.insert(candidates.begin(), candidates.end());
             TRACE(it_.size() << " elements to consider");
         } else {
             TRACE(it_.size() << " elements to consider");
@@ -265,6 +269,12 @@ public:
                    edge_remover_(g, removal_handler) {
     }
 
+    size_t Run(bool force_primary_launch = false) override {
+        // Mass removal, batchable handlers get the events at once
+        GraphEventBatchScope<Graph> batch(this->g());
+        return base::Run(force_primary_launch);
+    }
+
 private:
     DECL_LOGGER("ParallelEdgeRemovingAlgorithm");
 };
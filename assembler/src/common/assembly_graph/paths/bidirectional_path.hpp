@@ -14,6 +14,7 @@
 #pragma once
 
 #include <atomic>
+#include "utils/openmp_wrapper.h"
 #include "assembly_graph/core/graph.hpp"
 #include "assembly_graph/components/connected_component.hpp"
 
@@ -45,15 +46,74 @@ public:
     virtual void BackEdgeAdded(EdgeId e, BidirectionalPath * path, Gap gap) = 0;
     virtual void FrontEdgeRemoved(EdgeId e, BidirectionalPath * path) = 0;
     virtual void BackEdgeRemoved(EdgeId e, BidirectionalPath * path) = 0;
+
+    // Several edges pushed to the back at once, by default they are reported one by one
+    virtual void BackEdgesAdded(const std::vector<EdgeId>& edges, const std::vector<Gap>& gaps, BidirectionalPath * path) {
+        for (size_t i = 0; i < edges.size(); ++i)
+            BackEdgeAdded(edges[i], path, gaps[i]);
+    }
+
+    // Several edges popped from the back at once (in the order of removal)
+    virtual void BackEdgesRemoved(const std::vector<EdgeId>& edges, BidirectionalPath * path) {
+        for (EdgeId e : edges)
+            BackEdgeRemoved(e, path);
+    }
+
     virtual ~PathListener() {
     }
 };
 
 
+/**
+ * While the scope is alive, paths created by the (OpenMP) thread which opened
+ * it take ids from the private counter starting at zero instead of the global
+ * one. Paths grown in parallel (see CompositeExtender) are renumbered later
+ * exactly as if they were created one after another.
+ */
+class PathIdScope {
+public:
+    static const unsigned MAX_THREADS = 1024;
+
+    PathIdScope()
+            : next_(0) {
+        PathIdScope *&scope = current();
+        VERIFY(scope == nullptr);
+        scope = this;
+    }
+
+    ~PathIdScope() {
+        current() = nullptr;
+    }
+
+    uint64_t Next() {
+        return next_++;
+    }
+
+    // Number of ids taken so far
+    uint64_t used() const {
+        return next_;
+    }
+
+    static PathIdScope *&current() {
+        static PathIdScope *scopes[MAX_THREADS];
+        unsigned thread = unsigned(omp_get_thread_num());
+        VERIFY(thread < MAX_THREADS);
+        return scopes[thread];
+    }
+
+private:
+    uint64_t next_;
+};
+
 class BidirectionalPath : public PathListener {
 private:
     static std::atomic<uint64_t> path_id_;
 
+    static uint64_t NextId() {
+        PathIdScope *scope = PathIdScope::current();
+        return scope ? scope->Next() : path_id_++;
+    }
+
 
 public:
     BidirectionalPath(const Graph& g)
@@ -63,7 +123,7 @@ public:
               cumulative_len_(),
               gap_len_(),
               listeners_(),
-              id_(path_id_++),
+              id_(NextId()),
               weight_(1.0),
               has_overlaped_begin_(false),
               has_overlaped_end_(false),
@@ -84,19 +144,29 @@ public:
     }
 
     BidirectionalPath(const BidirectionalPath& path)
+            : BidirectionalPath(path, NextId()) {
+    }
+
+    // Copy with the given id, see PathIdScope
+    BidirectionalPath(const BidirectionalPath& path, uint64_t id)
             : g_(path.g_),
               data_(path.data_),
               conj_path_(NULL),
               cumulative_len_(path.cumulative_len_),
               gap_len_(path.gap_len_),
               listeners_(),
-              id_(path_id_++),
+              id_(id),
               weight_(path.weight_),
               has_overlaped_begin_(path.has_overlaped_begin_),
               has_overlaped_end_(path.has_overlaped_end_),
               overlap_(path.overlap_) {
     }
 
+    // Takes count consecutive ids from the global counter, returns the first one
+    static uint64_t ReserveIds(uint64_t count) {
+        return path_id_.fetch_add(count);
+    }
+
 public:
     void Subscribe(PathListener * listener) {
         listeners_.push_back(listener);
@@ -213,9 +283,22 @@ public:
     }
 
     void PushBack(const BidirectionalPath& path) {
+        if (listeners_.empty()) {
+            for (size_t i = 0; i < path.Size(); ++i)
+                PushBackSilently(path.At(i), path.GapInfoAt(i));
+            return;
+        }
+        std::vector<EdgeId> edges;
+        std::vector<Gap> gaps;
+        edges.reserve(path.Size());
+        gaps.reserve(path.Size());
         for (size_t i = 0; i < path.Size(); ++i) {
-            PushBack(path.At(i), path.GapAt(i), path.TrashPreviousAt(i), path.TrashCurrentAt(i));
+            PushBackSilently(path.At(i), path.GapInfoAt(i));
+            edges.push_back(path.At(i));
+            gaps.push_back(path.GapInfoAt(i));
         }
+        if (!edges.empty())
+            NotifyBackEdgesAdded(edges, gaps);
     }
 
     void PopBack() {
@@ -230,15 +313,19 @@ public:
     }
 
     void PopBack(size_t count) {
-        for (size_t i = 0; i < count; ++i) {
-            PopBack();
+        std::vector<EdgeId> edges;
+        for (size_t i = 0; i < count && !data_.empty(); ++i) {
+            edges.push_back(data_.back());
+            DecreaseLengths();
+            gap_len_.pop_back();
+            data_.pop_back();
         }
+        if (!edges.empty())
+            NotifyBackEdgesRemoved(edges);
     }
 
     void Clear() {
-        while (!Empty()) {
-            PopBack();
-        }
+        PopBack(Size());
     }
 
     virtual void FrontEdgeAdded(EdgeId, BidirectionalPath*, int) {
@@ -683,6 +770,24 @@ private:
         }
     }
 
+    void NotifyBackEdgesAdded(const std::vector<EdgeId>& edges, const std::vector<Gap>& gaps) {
+        for (auto i = listeners_.begin(); i != listeners_.end(); ++i) {
+            (*i)->BackEdgesAdded(edges, gaps, this);
+        }
+    }
+
+    void NotifyBackEdgesRemoved(const std::vector<EdgeId>& edges) {
+        for (auto i = listeners_.begin(); i != listeners_.end(); ++i) {
+            (*i)->BackEdgesRemoved(edges, this);
+        }
+    }
+
+    void PushBackSilently(EdgeId e, const Gap& gap) {
+        data_.push_back(e);
+        gap_len_.push_back(gap);
+        IncreaseLengths(g_.length(e), gap);
+    }
+
     void NotifyFrontEdgeRemoved(EdgeId e) {
         for (auto i = listeners_.begin(); i != listeners_.end(); ++i) {
             (*i)->FrontEdgeRemoved(e, this);
@@ -64,16 +64,16 @@ void path_extend::TranscriptToGeneJoiner::Construct(const PathContainer &paths)
     GraphCoverageMap edges_coverage(g_, paths);
 
     DEBUG("Union trees");
-    //For all edges in coverage map
-    for (auto iterator = edges_coverage.begin(); iterator != edges_coverage.end(); ++iterator) {
+    //For all covered edges
+    for (auto iterator = g_.ConstEdgeBegin(); !iterator.IsEnd(); ++iterator) {
         //Select a path covering an edge
-        EdgeId edge = iterator->first;
-        GraphCoverageMap::MapDataT *edge_paths = iterator->second;
+        EdgeId edge = *iterator;
+        const GraphCoverageMap::MapDataT *edge_paths = edges_coverage.GetEdgePaths(edge);
 
         if (g_.length(edge) > min_edge_len_ && edge_paths->size() > 1) {
             DEBUG("Long edge " << edge.int_id() << " Paths " << edge_paths->size());
             //For all other paths covering this edge join then into single gene with the first path
-            for (auto it_edge = ++edge_paths->begin(); it_edge != edge_paths->end(); ++it_edge) {
+            for (auto it_edge = std::next(edge_paths->begin()); it_edge != edge_paths->end(); ++it_edge) {
                 size_t first = path_id_[*edge_paths->begin()];
                 size_t next = path_id_[*it_edge];
                 DEBUG("Edge " << edge.int_id() << " First " << first << " Next " << next);
@@ -16,8 +16,10 @@
 
 #include "io/reads/binary_converter.hpp"
 #include "io/reads/io_helper.hpp"
+#include "io/reads/async_read_stream.hpp"
 #include "dataset_readers.hpp"
 #include "utils/simple_tools.hpp"
+#include "utils/perfcounter.hpp"
 
 #include <fstream>
 
@@ -30,7 +32,7 @@ typedef SequencingLibrary<DataSetData> SequencingLibraryT;
 class ReadConverter {
 
 private:
-    const static size_t current_binary_format_version = 11;
+    const static size_t current_binary_format_version = 12;
 
     static bool CheckBinaryReadsExist(SequencingLibraryT& lib) {
         return path::FileExists(lib.data().binary_reads_info.bin_reads_info_file);
@@ -74,6 +76,28 @@ private:
         return true;
     }
 
+    // Input streams for the conversion, one per file (pair of files). Every
+    // file is parsed ahead in its own thread, the reads are still converted
+    // in the order of the files.
+    static ReadStreamList<PairedRead> PairedInputStreams(const SequencingLibraryT& lib) {
+        ReadStreamList<PairedRead> streams;
+        for (const auto& read_pair : lib.paired_reads()) {
+            PairedStreamPtr reader = make_shared<SeparatePairedReadStream>(read_pair.first, read_pair.second,
+                                                                           0, false, false, lib.orientation(),
+                                                                           PhredOffset, /*async*/true);
+            streams.push_back(make_shared<AsyncReadStream<PairedRead>>(
+                    WrapPairedStream(reader, false, true, lib.orientation())));
+        }
+        return streams;
+    }
+
+    static ReadStreamList<SingleRead> SingleInputStreams(const SequencingLibraryT& lib) {
+        ReadStreamList<SingleRead> streams;
+        for (const auto& read : lib.single_reads())
+            streams.push_back(make_shared<AsyncReadStream<SingleRead>>(EasyStream(read, false)));
+        return streams;
+    }
+
     static void ConvertToBinary(SequencingLibraryT& lib) {
         auto& data = lib.data();
         std::ofstream info;
@@ -82,28 +106,34 @@ private:
         info.close();
 
         INFO("Converting reads to binary format for library #" << data.lib_index << " (takes a while)");
+        perf_counter pc;
         INFO("Converting paired reads");
-        PairedStreamPtr paired_reader = paired_easy_reader(lib, false, 0, false, false);
+        auto paired_readers = PairedInputStreams(lib);
         BinaryWriter paired_converter(data.binary_reads_info.paired_read_prefix,
                                           data.binary_reads_info.chunk_num,
                                           data.binary_reads_info.buffer_size);
 
-        ReadStreamStat paired_stat = paired_converter.ToBinary(*paired_reader, lib.orientation());
+        ReadStreamStat paired_stat = paired_converter.ToBinary(paired_readers, lib.orientation());
         paired_stat.read_count_ *= 2;
 
         INFO("Converting single reads");
 
-        SingleStreamPtr single_reader = single_easy_reader(lib, false, false);
+        auto single_readers = SingleInputStreams(lib);
         BinaryWriter single_converter(data.binary_reads_info.single_read_prefix,
                                           data.binary_reads_info.chunk_num,
                                           data.binary_reads_info.buffer_size);
-        ReadStreamStat single_stat = single_converter.ToBinary(*single_reader);
+        ReadStreamStat single_stat = single_converter.ToBinary(single_readers);
 
         paired_stat.merge(single_stat);
         data.read_length = paired_stat.max_len_;
         data.read_count = paired_stat.read_count_;
         data.total_nucls = paired_stat.total_len_;
 
+        double time = pc.time();
+        INFO("Library #" << data.lib_index << " converted in " << human_readable_time(time) << ": "
+             << size_t((double) data.read_count / time) << " reads/s, "
+             << (double) data.total_nucls / time / 1e6 << " Mbp/s");
+
         info.open(data.binary_reads_info.bin_reads_info_file.c_str(), std::ios_base::out);
         info << current_binary_format_version << " " <<
             data.binary_reads_info.chunk_num << " " <<
@@ -130,40 +160,65 @@ public:
 };
 
 
+// Opens the binary files of the library and splits their blocks between
+// stream_num streams (by default, one stream per file)
+template<class Stream, class... Args>
+ReadStreamList<typename Stream::ReadT> binary_block_readers(const std::string& file_name_prefix,
+                                                            size_t chunk_num, size_t stream_num,
+                                                            Args... args) {
+    typedef typename Stream::ReadT ReadT;
+
+    std::vector<std::shared_ptr<BinaryReadFile>> files;
+    for (size_t i = 0; i < chunk_num; ++i)
+        files.push_back(BinaryReadFile::Open(file_name_prefix, i));
+
+    ReadStreamList<ReadT> streams;
+    for (const auto& part : SplitBinaryBlocks(files, stream_num ? stream_num : chunk_num)) {
+        ReadStreamList<ReadT> ranges;
+        for (const auto& range : part)
+            ranges.push_back(make_shared<Stream>(files[range.file], range.first_block, range.last_block, args...));
+
+        if (ranges.size() == 1)
+            streams.push_back(ranges.ptr_at(0));
+        else
+            streams.push_back(MultifileWrap<ReadT>(ranges));
+    }
+    return streams;
+}
+
 inline
 BinaryPairedStreams raw_paired_binary_readers(SequencingLibraryT &lib,
                                                   bool followed_by_rc,
-                                                  size_t insert_size = 0) {
+                                                  size_t insert_size = 0,
+                                                  size_t stream_num = 0) {
     ReadConverter::ConvertToBinaryIfNeeded(lib);
     const auto& data = lib.data();
     VERIFY_MSG(data.binary_reads_info.binary_coverted, "Lib was not converted to binary, cannot produce binary stream");
 
-    ReadStreamList<PairedReadSeq> paired_streams;
-    for (size_t i = 0; i < data.binary_reads_info.chunk_num; ++i) {
-        paired_streams.push_back(make_shared<BinaryFilePairedStream>(data.binary_reads_info.paired_read_prefix,
-                                                                         i, insert_size));
-    }
+    ReadStreamList<PairedReadSeq> paired_streams =
+            binary_block_readers<BinaryFilePairedStream>(data.binary_reads_info.paired_read_prefix,
+                                                         data.binary_reads_info.chunk_num, stream_num,
+                                                         insert_size);
     return apply_paired_wrappers(followed_by_rc, paired_streams);
 }
 
 inline
 BinarySingleStreams raw_single_binary_readers(SequencingLibraryT &lib,
                                                   bool followed_by_rc,
-                                                  bool including_paired_reads) {
+                                                  bool including_paired_reads,
+                                                  size_t stream_num = 0) {
     const auto& data = lib.data();
     ReadConverter::ConvertToBinaryIfNeeded(lib);
     VERIFY_MSG(data.binary_reads_info.binary_coverted, "Lib was not converted to binary, cannot produce binary stream");
 
-    BinarySingleStreams single_streams;
-    for (size_t i = 0; i < data.binary_reads_info.chunk_num; ++i) {
-        single_streams.push_back(make_shared<BinaryFileSingleStream>(data.binary_reads_info.single_read_prefix, i));
-    }
+    BinarySingleStreams single_streams =
+            binary_block_readers<BinaryFileSingleStream>(data.binary_reads_info.single_read_prefix,
+                                                         data.binary_reads_info.chunk_num, stream_num);
     if (including_paired_reads) {
-        BinaryPairedStreams paired_streams;
-        for (size_t i = 0; i < data.binary_reads_info.chunk_num; ++i) {
-            paired_streams.push_back(make_shared<BinaryFilePairedStream>(data.binary_reads_info.paired_read_prefix,
-                                                                             i, 0));
-        }
+        BinaryPairedStreams paired_streams =
+                binary_block_readers<BinaryFilePairedStream>(data.binary_reads_info.paired_read_prefix,
+                                                             data.binary_reads_info.chunk_num, stream_num,
+                                                             size_t(0));
 
         return apply_single_wrappers(followed_by_rc, single_streams, &paired_streams);
     }
@@ -176,16 +231,18 @@ BinarySingleStreams raw_single_binary_readers(SequencingLibraryT &lib,
 inline
 BinaryPairedStreams paired_binary_readers(SequencingLibraryT &lib,
                                               bool followed_by_rc,
-                                              size_t insert_size = 0) {
-    return raw_paired_binary_readers(lib, followed_by_rc, insert_size);
+                                              size_t insert_size = 0,
+                                              size_t stream_num = 0) {
+    return raw_paired_binary_readers(lib, followed_by_rc, insert_size, stream_num);
 }
 
 
 inline
 BinarySingleStreams single_binary_readers(SequencingLibraryT &lib,
                                               bool followed_by_rc,
-                                              bool including_paired_reads) {
-    return raw_single_binary_readers(lib, followed_by_rc, including_paired_reads);
+                                              bool including_paired_reads,
+                                              size_t stream_num = 0) {
+    return raw_single_binary_readers(lib, followed_by_rc, including_paired_reads, stream_num);
 }
 
 
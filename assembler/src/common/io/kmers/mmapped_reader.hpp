@@ -30,6 +30,7 @@
 class MMappedReader {
     int StreamFile;
     bool Unlink;
+    bool Owned;
     std::string FileName;
 
     void remap() {
@@ -68,12 +69,18 @@ protected:
 
 public:
     MMappedReader()
-            : StreamFile(-1), Unlink(false), FileName(""), MappedRegion(0), FileSize(0), BytesRead(0),
+            : StreamFile(-1), Unlink(false), Owned(true), FileName(""), MappedRegion(0), FileSize(0), BytesRead(0),
               InitialOffset(0) { }
 
+    // Wraps the memory region which is not backed by any file (e.g. anonymous
+    // mapping). The region is unmapped in dtor iff owned is set.
+    MMappedReader(uint8_t *region, size_t sz, bool owned = true)
+            : StreamFile(-1), Unlink(false), Owned(owned), FileName(""), MappedRegion(region),
+              FileSize(sz), BlockOffset(0), BytesRead(0), BlockSize(sz), InitialOffset(0) { }
+
     MMappedReader(const std::string &filename, bool unlink = false,
                   size_t blocksize = 64 * 1024 * 1024, off_t off = 0, size_t sz = 0)
-            : Unlink(unlink), FileName(filename), BlockSize(blocksize) {
+            : Unlink(unlink), Owned(true), FileName(filename), BlockSize(blocksize) {
         struct stat buf;
 
         InitialOffset = off;
@@ -111,6 +118,7 @@ public:
         BlockSize = other.BlockSize;
         FileName = std::move(other.FileName);
         Unlink = other.Unlink;
+        Owned = other.Owned;
         StreamFile = other.StreamFile;
         InitialOffset = other.InitialOffset;
 
@@ -130,7 +138,7 @@ public:
     virtual ~MMappedReader() {
         if (StreamFile != -1)
             close(StreamFile);
-        if (MappedRegion)
+        if (MappedRegion && Owned)
             munmap(MappedRegion, BlockSize);
 
         if (Unlink) {
@@ -300,6 +308,13 @@ public:
         VERIFY(FileSize % (sizeof(T) * elcnt_) == 0);
     }
 
+    MMappedRecordArrayReader(uint8_t *region, size_t sz,
+                             size_t elcnt = 1,
+                             bool owned = true) :
+            MMappedReader(region, sz, owned), elcnt_(elcnt) {
+        VERIFY(FileSize % (sizeof(T) * elcnt_) == 0);
+    }
+
     void read(T *el, size_t amount) {
         MMappedReader::read(el, amount * sizeof(T) * elcnt_);
     }
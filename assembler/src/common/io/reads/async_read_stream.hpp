@@ -0,0 +1,139 @@
+//***************************************************************************
+//* Copyright (c) 2015 Saint Petersburg State University
+//* All Rights Reserved
+//* See file LICENSE for details.
+//***************************************************************************
+
+#pragma once
+
+#include "ireader.hpp"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+
+namespace io {
+
+/**
+* Reads the underlying stream ahead in a separate thread, so that decompression
+* and parsing overlap with the processing of the reads already obtained.
+* Reads are transferred in batches of batch_size, at most max_batches of them
+* are kept in flight.
+*/
+template<typename ReadType>
+class AsyncReadStream : public ReadStream<ReadType> {
+public:
+    typedef std::shared_ptr<ReadStream<ReadType>> ReadStreamPtrT;
+
+    explicit AsyncReadStream(ReadStreamPtrT reader,
+                             size_t batch_size = 4096, size_t max_batches = 4)
+            : reader_(reader), batch_size_(batch_size), max_batches_(max_batches),
+              pos_(0), done_(false), stop_(false) {
+        Start();
+    }
+
+    ~AsyncReadStream() {
+        Stop();
+    }
+
+    /* virtual */ bool is_open() {
+        return reader_->is_open();
+    }
+
+    /* virtual */ bool eof() {
+        while (pos_ == current_.size()) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this]() { return !queue_.empty() || done_; });
+            if (queue_.empty())
+                return true;
+
+            current_ = std::move(queue_.front());
+            queue_.pop_front();
+            pos_ = 0;
+            cv_.notify_all();
+        }
+        return false;
+    }
+
+    /* virtual */ AsyncReadStream& operator>>(ReadType& read) {
+        VERIFY(!eof());
+        read = std::move(current_[pos_++]);
+        return *this;
+    }
+
+    /* virtual */ void close() {
+        Stop();
+        reader_->close();
+    }
+
+    /* virtual */ void reset() {
+        Stop();
+        reader_->reset();
+        Start();
+    }
+
+    /* virtual */ ReadStreamStat get_stat() const {
+        return reader_->get_stat();
+    }
+
+private:
+    void Start() {
+        current_.clear();
+        queue_.clear();
+        pos_ = 0;
+        done_ = stop_ = false;
+        thread_ = std::thread(&AsyncReadStream::Prefetch, this);
+    }
+
+    void Stop() {
+        if (!thread_.joinable())
+            return;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        thread_.join();
+    }
+
+    void Prefetch() {
+        bool eof = false;
+        while (!eof) {
+            std::vector<ReadType> batch;
+            batch.reserve(batch_size_);
+            while (batch.size() < batch_size_ && !reader_->eof()) {
+                batch.emplace_back();
+                (*reader_) >> batch.back();
+            }
+            eof = reader_->eof();
+
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this]() { return queue_.size() < max_batches_ || stop_; });
+            if (stop_)
+                break;
+            if (!batch.empty())
+                queue_.push_back(std::move(batch));
+            done_ = eof;
+            cv_.notify_all();
+        }
+    }
+
+    ReadStreamPtrT reader_;
+    const size_t batch_size_;
+    const size_t max_batches_;
+
+    std::vector<ReadType> current_;
+    size_t pos_;
+
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<std::vector<ReadType>> queue_;
+    bool done_;
+    bool stop_;
+};
+
+}
@@ -16,9 +16,14 @@
 #define BINARY_IO_HPP_
 
 #include <fstream>
+#include <sstream>
+#include <future>
 
 #include "utils/verify.hpp"
+#include "utils/openmp_wrapper.h"
 #include "ireader.hpp"
+#include "read_stream_vector.hpp"
+#include "binary_format.hpp"
 #include "single_read.hpp"
 #include "paired_read.hpp"
 #include "pipeline/library.hpp"
@@ -85,6 +90,95 @@ public:
     }
 };
 
+/**
+* Writes a single binary read file (see binary_format.hpp). Records are packed
+* into the memory buffer and assigned to the blocks, the buffer is written to
+* the file with a single call on Flush().
+*/
+class BinaryBlockWriter {
+public:
+    BinaryBlockWriter(const std::string& filename, size_t block_size = BinaryBlockInfo::DEFAULT_SIZE)
+            : file_(filename, std::ios_base::binary), block_size_(block_size),
+              current_(sizeof(BinaryFileHeader)), finished_(false) {
+        VERIFY_MSG(file_.good(), "Cannot open binary read file " << filename);
+        // Placeholder, rewritten by Finish()
+        BinaryFileHeader header;
+        file_.write((const char *) &header, sizeof(header));
+    }
+
+    ~BinaryBlockWriter() {
+        Finish();
+    }
+
+    template<class Read>
+    void Write(const Read& r, const ReadBinaryWriter<Read>& read_writer) {
+        uint64_t start = buffer_.tellp();
+        read_writer.Write(buffer_, r);
+        uint64_t size = uint64_t(buffer_.tellp()) - start;
+
+        if (current_.read_count && current_.size + size > block_size_)
+            CloseBlock();
+
+        current_.size += size;
+        current_.read_count += 1;
+        current_.max_len = std::max(current_.max_len, uint64_t(r.size()));
+        current_.total_len += r.nucl_count();
+    }
+
+    size_t buffered() {
+        return buffer_.tellp();
+    }
+
+    void Flush() {
+        const std::string data = buffer_.str();
+        file_.write(data.data(), data.size());
+        buffer_.str("");
+    }
+
+    // Writes the block index and the header, no more reads might be written
+    void Finish() {
+        if (finished_)
+            return;
+
+        if (current_.read_count)
+            CloseBlock();
+        Flush();
+
+        BinaryFileHeader header;
+        header.block_count = index_.size();
+        header.index_offset = current_.offset;
+        for (const auto& block : index_) {
+            header.read_count += block.read_count;
+            header.max_len = std::max(header.max_len, block.max_len);
+            header.total_len += block.total_len;
+        }
+        file_.write((const char *) index_.data(), index_.size() * sizeof(BinaryBlockInfo));
+        file_.seekp(0);
+        file_.write((const char *) &header, sizeof(header));
+        file_.close();
+        finished_ = true;
+
+        stat_ = header.stat();
+    }
+
+    const ReadStreamStat& stat() const {
+        return stat_;
+    }
+
+private:
+    void CloseBlock() {
+        index_.push_back(current_);
+        current_ = BinaryBlockInfo(current_.end(), current_.first_read + current_.read_count);
+    }
+
+    std::ofstream file_;
+    std::ostringstream buffer_;
+    size_t block_size_;
+    std::vector<BinaryBlockInfo> index_;
+    BinaryBlockInfo current_;
+    ReadStreamStat stat_;
+    bool finished_;
+};
 
 class BinaryWriter {
 
@@ -93,20 +187,17 @@ private:
 
     size_t file_num_;
 
-    std::vector<std::ofstream*> file_ds_;
+    std::vector<std::unique_ptr<BinaryBlockWriter>> writers_;
 
     size_t buf_size_;
 
-    template<class Read>
-    void FlushBuffer(const std::vector<Read>& buffer, const ReadBinaryWriter<Read>& read_writer, std::ostream& file, size_t from, size_t to) {
-        for (size_t i = from; i < to; ++i) {
-            read_writer.Write(file, buffer[i]);
+    ReadStreamStat Finish() {
+        ReadStreamStat result;
+        for (size_t i = 0; i < file_num_; ++i) {
+            writers_[i]->Finish();
+            result.merge(writers_[i]->stat());
         }
-    }
-
-    template<class Read>
-    void FlushBuffer(const std::vector<Read>& buffer, const ReadBinaryWriter<Read>& read_writer, std::ostream& file) {
-        FlushBuffer(buffer, read_writer, file, 0, buffer.size());
+        return result;
     }
 
     template<class Read>
@@ -114,109 +205,119 @@ private:
             LibraryOrientation orientation) {
 
         ReadBinaryWriter<Read> read_writer(orientation);
-        size_t buffer_reads = buf_size / (sizeof (Read) * 4);
-        size_t reads_to_flush = buffer_reads * file_num_;
-
-        std::vector< std::vector<Read> > buf(file_num_, std::vector<Read>(buffer_reads) );
-        std::vector< ReadStreamStat > read_stats(file_num_);
-        std::vector< size_t > current_buf_sizes(file_num_, 0);
         size_t read_count = 0;
-
-        for (size_t i = 0; i < file_num_; ++i) {
-            file_ds_[i]->seekp(0);
-            read_stats[i].write(*file_ds_[i]);
-        }
-
-        size_t buf_index;
+        Read r;
         while (!stream.eof()) {
-            buf_index = read_count % file_num_;
-
-            Read& r = buf[buf_index][current_buf_sizes[buf_index]];
             stream >> r;
-            read_stats[buf_index].increase(r);
+            BinaryBlockWriter& writer = *writers_[read_count % file_num_];
+            writer.Write(r, read_writer);
+            if (writer.buffered() >= buf_size)
+                writer.Flush();
 
-            ++current_buf_sizes[buf_index];
             VERBOSE_POWER(++read_count, " reads processed");
+        }
+
+        INFO(read_count << " reads written");
+        return Finish();
+    }
 
-            if (read_count % reads_to_flush == 0) {
-                for (size_t i = 0; i < file_num_; ++i) {
-                    FlushBuffer(buf[i], read_writer, *file_ds_[i]);
-                    current_buf_sizes[i] = 0;
-                }
+
+    // Takes reads from the streams one after another, so that the reads are
+    // written in the input order. The streams reading ahead keep parsing the
+    // files further on while the current one is consumed.
+    template<class Read>
+    bool CollectBatch(io::ReadStreamList<Read>& streams, std::vector<Read>& batch,
+                      size_t batch_reads, size_t& current_stream) {
+        while (batch.size() < batch_reads && current_stream < streams.size()) {
+            auto& stream = streams[current_stream];
+            while (batch.size() < batch_reads && !stream.eof()) {
+                batch.emplace_back();
+                stream >> batch.back();
             }
+            if (stream.eof())
+                ++current_stream;
         }
 
-        ReadStreamStat result;
+        return !batch.empty();
+    }
+
+    // Packs the batch and appends it to the files, every file is written by a
+    // separate thread with a single call. Reads are distributed between the
+    // files in the round-robin manner, first_read is the number of reads
+    // written before the batch.
+    template<class Read>
+    void WriteBatch(const std::vector<Read>& batch, size_t first_read,
+                    const ReadBinaryWriter<Read>& read_writer) {
+#       pragma omp parallel for num_threads(file_num_) schedule(static, 1)
         for (size_t i = 0; i < file_num_; ++i) {
-            buf[i].resize(current_buf_sizes[i]);
-            FlushBuffer(buf[i], read_writer, *file_ds_[i]);
+            for (size_t j = (i + file_num_ - first_read % file_num_) % file_num_; j < batch.size(); j += file_num_)
+                writers_[i]->Write(batch[j], read_writer);
+            writers_[i]->Flush();
+        }
+    }
 
-            file_ds_[i]->seekp(0);
-            read_stats[i].write(*file_ds_[i]);
-            result.merge(read_stats[i]);
+    // Pipelined conversion: reads of the next batch are collected while the
+    // previous one is packed and written
+    template<class Read>
+    ReadStreamStat ToBinary(io::ReadStreamList<Read>& streams, size_t buf_size,
+                            LibraryOrientation orientation) {
+        ReadBinaryWriter<Read> read_writer(orientation);
+        size_t batch_reads = std::max(buf_size / (sizeof (Read) * 4), size_t(1)) * file_num_;
+
+        std::vector<Read> batch, pending;
+        batch.reserve(batch_reads);
+        pending.reserve(batch_reads);
+        std::future<void> flush;
+        size_t read_count = 0, next_report = 1 << 16, current_stream = 0;
+        while (CollectBatch(streams, batch, batch_reads, current_stream)) {
+            if (flush.valid())
+                flush.get();
+
+            std::swap(batch, pending);
+            batch.clear();
+            flush = std::async(std::launch::async, &BinaryWriter::WriteBatch<Read>, this,
+                               std::cref(pending), read_count, std::cref(read_writer));
+            read_count += pending.size();
+            for (; next_report <= read_count; next_report <<= 1)
+                INFO(read_count << " reads processed");
         }
+        if (flush.valid())
+            flush.get();
 
         INFO(read_count << " reads written");
-        return result;
+        return Finish();
     }
 
-
     template<class Read>
     ReadStreamStat ToBinaryForThread(io::ReadStream<Read>& stream, size_t buf_size,
             size_t thread_num, LibraryOrientation orientation) {
 
         ReadBinaryWriter<Read> read_writer(orientation);
-        size_t buffer_reads = buf_size / (sizeof (Read) * 4);
-        std::vector<Read> buf(buffer_reads);
-
-        ReadStreamStat stat;
-        file_ds_[thread_num]->seekp(0);
-        stat.write(*file_ds_[thread_num]);
-
-        size_t current = 0;
-
+        BinaryBlockWriter& writer = *writers_[thread_num];
+        Read r;
         while (!stream.eof()) {
-            Read& r = buf[current];
             stream >> r;
-            stat.increase(r);
-            ++current;
-
-            if (stat.read_count_ % buffer_reads == 0) {
-                FlushBuffer(buf, read_writer, *file_ds_[thread_num]);
-                current = 0;
-            }
+            writer.Write(r, read_writer);
+            if (writer.buffered() >= buf_size)
+                writer.Flush();
         }
 
-        buf.resize(current);
-        FlushBuffer(buf, read_writer, *file_ds_[thread_num]);
-
-        file_ds_[thread_num]->seekp(0);
-        stat.write(*file_ds_[thread_num]);
-
-        return stat;
+        writer.Finish();
+        return writer.stat();
     }
 
 
 public:
 
     BinaryWriter(const std::string& file_name_prefix, size_t file_num,
-            size_t buf_size):
+            size_t buf_size, size_t block_size = BinaryBlockInfo::DEFAULT_SIZE):
                 file_name_prefix_(file_name_prefix), file_num_(file_num),
-                file_ds_(), buf_size_(buf_size) {
+                writers_(), buf_size_(buf_size) {
 
         std::string fname;
         for (size_t i = 0; i < file_num_; ++i) {
             fname = file_name_prefix_ + "_" + ToString(i) + ".seq";
-            file_ds_.push_back(new std::ofstream(fname, std::ios_base::binary));
-        }
-    }
-
-    ~BinaryWriter() {
-        for (size_t i = 0; i < file_num_; ++i) {
-            if (file_ds_[i]->is_open()) {
-                file_ds_[i]->close();
-            }
-            delete file_ds_[i];
+            writers_.emplace_back(new BinaryBlockWriter(fname, block_size));
         }
     }
 
@@ -237,6 +338,14 @@ public:
         return ToBinary(stream, buf_size_ / (2 * file_num_), orientation);
     }
 
+    ReadStreamStat ToBinary(io::ReadStreamList<io::SingleRead>& streams) {
+        return ToBinary(streams, buf_size_ / file_num_, LibraryOrientation::Undefined);
+    }
+
+    ReadStreamStat ToBinary(io::ReadStreamList<io::PairedRead>& streams, LibraryOrientation orientation) {
+        return ToBinary(streams, buf_size_ / (2 * file_num_), orientation);
+    }
+
     ReadStreamStat ToBinaryForThread(io::ReadStream<io::SingleReadSeq>& stream, size_t thread_num) {
         return ToBinaryForThread(stream, buf_size_ / file_num_, thread_num, LibraryOrientation::Undefined);
     }
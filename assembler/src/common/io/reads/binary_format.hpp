@@ -0,0 +1,83 @@
+//***************************************************************************
+//* Copyright (c) 2015 Saint Petersburg State University
+//* All Rights Reserved
+//* See file LICENSE for details.
+//***************************************************************************
+
+#pragma once
+
+#include "ireader.hpp"
+
+#include <cstdint>
+
+namespace io {
+
+/*
+* Layout of the binary read files (*.seq):
+*
+*   header | block 0 | block 1 | ... | block N-1 | block index
+*
+* Reads are stored as a sequence of records (see SingleReadSeq::BinWrite and
+* PairedReadSeq::BinWrite), every record is padded to keep the packed data of
+* the sequences 8-byte aligned. Records are grouped into blocks of (roughly)
+* fixed size, a record never crosses the block boundary, blocks follow each
+* other without gaps. The block index at the end of the file gives the
+* position, the number of reads and the read statistics of every block, so any
+* range of blocks can be processed independently.
+*/
+
+struct BinaryFileHeader {
+    static const uint64_t MAGIC = 0x5245414453504153ULL; // "SPADSAER"
+    static const uint64_t VERSION = 1;
+
+    uint64_t magic;
+    uint64_t version;
+    uint64_t read_count;
+    uint64_t max_len;
+    uint64_t total_len;
+    uint64_t block_count;
+    uint64_t index_offset;
+
+    BinaryFileHeader()
+            : magic(MAGIC), version(VERSION), read_count(0), max_len(0), total_len(0),
+              block_count(0), index_offset(0) {}
+
+    ReadStreamStat stat() const {
+        ReadStreamStat res;
+        res.read_count_ = read_count;
+        res.max_len_ = max_len;
+        res.total_len_ = total_len;
+        return res;
+    }
+};
+
+struct BinaryBlockInfo {
+    // Default size of the block, records are appended to the block while it is smaller
+    static const size_t DEFAULT_SIZE = 1 << 20;
+
+    uint64_t offset;
+    uint64_t size;
+    uint64_t first_read;
+    uint64_t read_count;
+    uint64_t max_len;
+    uint64_t total_len;
+
+    BinaryBlockInfo(uint64_t offset = 0, uint64_t first_read = 0)
+            : offset(offset), size(0), first_read(first_read), read_count(0), max_len(0), total_len(0) {}
+
+    uint64_t end() const {
+        return offset + size;
+    }
+
+    ReadStreamStat stat() const {
+        ReadStreamStat res;
+        res.read_count_ = read_count;
+        res.max_len_ = max_len;
+        res.total_len_ = total_len;
+        return res;
+    }
+};
+
+static_assert(sizeof(BinaryFileHeader) % 8 == 0, "Binary file header breaks the alignment of the records");
+
+}
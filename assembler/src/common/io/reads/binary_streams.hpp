@@ -7,134 +7,227 @@
 
 #pragma once
 
-#include <fstream>
-
 #include "utils/verify.hpp"
+#include "io/kmers/mmapped_reader.hpp"
 #include "ireader.hpp"
+#include "binary_format.hpp"
 #include "single_read.hpp"
 #include "paired_read.hpp"
 
+#include <memory>
+#include <vector>
+
 namespace io {
 
-// == Deprecated classes ==
-// Use FileReadStream and InsertSizeModyfing instead
+/**
+* Memory-mapped binary read file (see binary_format.hpp). The file is shared by
+* all the streams reading its blocks, the sequences obtained from the streams
+* refer to the mapped data and keep the file alive.
+*/
+class BinaryReadFile : private boost::noncopyable {
+public:
+    explicit BinaryReadFile(const std::string& filename)
+            : filename_(filename), reader_(filename, /*unlink*/false, /*blocksize*/-1ULL) {
+        VERIFY_MSG(reader_.size() >= sizeof(BinaryFileHeader), "Binary read file " << filename_ << " is truncated");
+        memcpy(&header_, reader_.data(), sizeof(header_));
+        VERIFY_MSG(header_.magic == BinaryFileHeader::MAGIC && header_.version == BinaryFileHeader::VERSION,
+                   "Binary read file " << filename_ << " has unsupported format, remove it and restart");
+        VERIFY_MSG(header_.index_offset + header_.block_count * sizeof(BinaryBlockInfo) <= reader_.size(),
+                   "Binary read file " << filename_ << " is truncated");
 
-class BinaryFileSingleStream: public PredictableReadStream<SingleReadSeq> {
-private:
-    std::ifstream stream_;
-    ReadStreamStat read_stat_;
-    size_t current_;
+        index_.resize(header_.block_count);
+        memcpy(index_.data(), data() + header_.index_offset, index_.size() * sizeof(BinaryBlockInfo));
+    }
 
-public:
+    static std::shared_ptr<BinaryReadFile> Open(const std::string& file_name_prefix, size_t file_num) {
+        return std::make_shared<BinaryReadFile>(file_name_prefix + "_" + ToString(file_num) + ".seq");
+    }
 
-    BinaryFileSingleStream(const std::string& file_name_prefix, size_t file_num) {
-        std::string fname;
-        fname = file_name_prefix + "_" + ToString(file_num) + ".seq";
-        stream_.open(fname.c_str(), std::ios_base::binary | std::ios_base::in);
+    const std::string& filename() const { return filename_; }
+    size_t block_count() const { return index_.size(); }
+    const BinaryBlockInfo& block(size_t i) const { return index_[i]; }
+    ReadStreamStat stat() const { return header_.stat(); }
 
-        reset();
+    // Pointer to the first record of the block
+    const char *block_data(size_t i) const {
+        return data() + index_[i].offset;
     }
 
-    virtual bool is_open() {
-        return stream_.is_open();
+    // Statistics of the reads in the range of blocks
+    ReadStreamStat stat(size_t first_block, size_t last_block) const {
+        ReadStreamStat res;
+        for (size_t i = first_block; i < last_block; ++i)
+            res.merge(index_[i].stat());
+        return res;
     }
 
-    virtual bool eof() {
-        return current_ == read_stat_.read_count_;
+private:
+    const char *data() const {
+        return static_cast<const char *>(reader_.data());
     }
 
-    virtual BinaryFileSingleStream& operator>>(SingleReadSeq& read) {
-        read.BinRead(stream_);
-        VERIFY(current_ < read_stat_.read_count_);
+    std::string filename_;
+    MMappedReader reader_;
+    BinaryFileHeader header_;
+    std::vector<BinaryBlockInfo> index_;
+};
 
-        ++current_;
-        return *this;
+/**
+* Reads the range of blocks [first_block, last_block) of the binary read file.
+* Records are parsed right from the mapped memory, the sequences are not copied.
+*/
+template<class Read>
+class BinaryBlockStream : public PredictableReadStream<Read> {
+public:
+    BinaryBlockStream(std::shared_ptr<BinaryReadFile> file, size_t first_block, size_t last_block)
+            : file_(file), owner_(file), first_block_(first_block), last_block_(last_block),
+              stat_(file->stat(first_block, last_block)) {
+        VERIFY(first_block <= last_block && last_block <= file->block_count());
+        reset();
     }
 
-    virtual void close() {
-        current_ = 0;
-        stream_.close();
+    explicit BinaryBlockStream(std::shared_ptr<BinaryReadFile> file)
+            : BinaryBlockStream(file, 0, file->block_count()) {}
+
+    /* virtual */ bool is_open() {
+        return true;
     }
 
-    virtual void reset() {
-        stream_.clear();
-        stream_.seekg(0);
-        VERIFY(stream_.good());
-        read_stat_.read(stream_);
-        current_ = 0;
+    /* virtual */ bool eof() {
+        return current_ >= stat_.read_count_;
     }
 
-    virtual size_t size() const {
-        return read_stat_.read_count_;
+    /* virtual */ void close() {
+        current_ = stat_.read_count_;
     }
 
-    virtual ReadStreamStat get_stat() const {
-        return read_stat_;
+    /* virtual */ void reset() {
+        // Blocks are stored contiguously, so the range is just a chunk of memory
+        pos_ = first_block_ < last_block_ ? file_->block_data(first_block_) : nullptr;
+        current_ = 0;
     }
 
-};
+    /* virtual */ size_t size() const {
+        return stat_.read_count_;
+    }
 
-class BinaryFilePairedStream: public PredictableReadStream<PairedReadSeq> {
+    /* virtual */ ReadStreamStat get_stat() const {
+        return stat_;
+    }
 
-private:
-    std::ifstream stream_;
+protected:
+    // Returns the next record in the range
+    const char *next_record() {
+        VERIFY(!eof());
+        ++current_;
+        return pos_;
+    }
 
-    size_t insert_size_;
+    void set_position(const char *pos) {
+        pos_ = pos;
+    }
+
+    const std::shared_ptr<const void>& owner() const {
+        return owner_;
+    }
 
-    ReadStreamStat read_stat_;
+private:
+    std::shared_ptr<BinaryReadFile> file_;
+    std::shared_ptr<const void> owner_;
+    size_t first_block_;
+    size_t last_block_;
+    ReadStreamStat stat_;
 
+    const char *pos_;
     size_t current_;
+};
 
-
+class BinaryFileSingleStream: public BinaryBlockStream<SingleReadSeq> {
+    typedef BinaryBlockStream<SingleReadSeq> base;
 public:
+    BinaryFileSingleStream(const std::string& file_name_prefix, size_t file_num)
+            : base(BinaryReadFile::Open(file_name_prefix, file_num)) {}
 
-    BinaryFilePairedStream(const std::string& file_name_prefix, size_t file_num, size_t insert_szie): stream_(), insert_size_ (insert_szie) {
-        std::string fname;
-        fname = file_name_prefix + "_" + ToString(file_num) + ".seq";
-        stream_.open(fname.c_str(), std::ios_base::binary | std::ios_base::in);
-
-        reset();
-    }
-
-    virtual bool is_open() {
-        return stream_.is_open();
-    }
-
-    virtual bool eof() {
-        return current_ >= read_stat_.read_count_;
-    }
+    BinaryFileSingleStream(std::shared_ptr<BinaryReadFile> file, size_t first_block, size_t last_block)
+            : base(file, first_block, last_block) {}
 
-    virtual BinaryFilePairedStream& operator>>(PairedReadSeq& read) {
-        read.BinRead(stream_, insert_size_);
-        VERIFY(current_ < read_stat_.read_count_);
-
-        ++current_;
+    /* virtual */ BinaryFileSingleStream& operator>>(SingleReadSeq& read) {
+        set_position(read.BinRead(next_record(), owner()));
         return *this;
     }
+};
 
-    virtual void close() {
-        current_ = 0;
-        stream_.close();
-    }
-
+class BinaryFilePairedStream: public BinaryBlockStream<PairedReadSeq> {
+    typedef BinaryBlockStream<PairedReadSeq> base;
+public:
+    BinaryFilePairedStream(const std::string& file_name_prefix, size_t file_num, size_t insert_size)
+            : base(BinaryReadFile::Open(file_name_prefix, file_num)), insert_size_(insert_size) {}
 
-    virtual void reset() {
-        stream_.clear();
-        stream_.seekg(0);
-        VERIFY(stream_.good());
-        read_stat_.read(stream_);
-        current_ = 0;
-    }
+    BinaryFilePairedStream(std::shared_ptr<BinaryReadFile> file, size_t first_block, size_t last_block,
+                           size_t insert_size)
+            : base(file, first_block, last_block), insert_size_(insert_size) {}
 
-    virtual size_t size() const {
-        return read_stat_.read_count_;
+    /* virtual */ BinaryFilePairedStream& operator>>(PairedReadSeq& read) {
+        set_position(read.BinRead(next_record(), owner(), insert_size_));
+        return *this;
     }
 
-    ReadStreamStat get_stat() const {
-        ReadStreamStat stat = read_stat_;
+    /* virtual */ ReadStreamStat get_stat() const {
+        ReadStreamStat stat = base::get_stat();
         stat.read_count_ *= 2;
         return stat;
     }
+
+private:
+    size_t insert_size_;
 };
 
+struct BinaryBlockRange {
+    size_t file;
+    size_t first_block;
+    size_t last_block;
+};
+
+/**
+* Splits the blocks of the files into part_num parts of approximately equal
+* size (in bytes). Every part is a list of contiguous block ranges, a part might
+* span several files or be empty (if there are too few blocks). If the number
+* of parts is equal to the number of files, every part is just a file.
+*/
+inline std::vector<std::vector<BinaryBlockRange>> SplitBinaryBlocks(const std::vector<std::shared_ptr<BinaryReadFile>>& files,
+                                                                    size_t part_num) {
+    VERIFY(part_num > 0);
+    std::vector<std::vector<BinaryBlockRange>> parts;
+    if (part_num == files.size()) {
+        for (size_t i = 0; i < files.size(); ++i)
+            parts.push_back({ BinaryBlockRange{i, 0, files[i]->block_count()} });
+        return parts;
+    }
+
+    uint64_t total = 0;
+    for (const auto& file : files)
+        for (size_t j = 0; j < file->block_count(); ++j)
+            total += file->block(j).size;
+
+    parts.resize(1);
+    uint64_t processed = 0;
+    for (size_t i = 0; i < files.size(); ++i) {
+        size_t first = 0;
+        for (size_t j = 0; j < files[i]->block_count(); ++j) {
+            processed += files[i]->block(j).size;
+            // Close the part once it got its share of the data
+            if (processed * part_num >= total * parts.size() && parts.size() < part_num) {
+                parts.back().push_back(BinaryBlockRange{i, first, j + 1});
+                parts.emplace_back();
+                first = j + 1;
+            }
+        }
+        if (first < files[i]->block_count())
+            parts.back().push_back(BinaryBlockRange{i, first, files[i]->block_count()});
+    }
+    parts.resize(part_num);
+
+    return parts;
+}
+
 }
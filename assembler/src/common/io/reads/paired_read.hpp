@@ -122,6 +122,14 @@ public:
         return !file.fail();
     }
 
+    const char *BinRead(const char *buf, const std::shared_ptr<const void> &owner, size_t is = 0) {
+        buf = first_.BinRead(buf, owner);
+        buf = second_.BinRead(buf, owner);
+
+        insert_size_ = is - (size_t) first_.GetLeftOffset() - (size_t) second_.GetRightOffset();
+        return buf;
+    }
+
     bool BinWrite(std::ostream &file, bool rc1 = false, bool rc2 = false) const {
         first_.BinWrite(file, rc1);
         second_.BinWrite(file, rc2);
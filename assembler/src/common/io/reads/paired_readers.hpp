@@ -12,6 +12,7 @@
 #include "paired_read.hpp"
 #include "file_reader.hpp"
 #include "orientation.hpp"
+#include "async_read_stream.hpp"
 
 namespace io {
 
@@ -24,18 +25,19 @@ class SeparatePairedReadStream : public ReadStream<PairedRead> {
    * be opened.
    * @param distance Distance between parts of PairedReads.
    * @param offset The offset of the read quality.
+   * @param async Whether to parse the files in separate threads.
    */
   explicit SeparatePairedReadStream(const std::string& filename1, const std::string& filename2,
          size_t insert_size, bool change_order = false,
          bool use_orientation = true, LibraryOrientation orientation = LibraryOrientation::FR,
-         OffsetType offset_type = PhredOffset)
+         OffsetType offset_type = PhredOffset, bool async = false)
       : insert_size_(insert_size),
         change_order_(change_order),
         use_orientation_(use_orientation),
         changer_(GetOrientationChanger<PairedRead>(orientation)),
         offset_type_(offset_type),
-        first_(new FileReadStream(filename1, offset_type_)),
-        second_(new FileReadStream(filename2, offset_type_)),
+        first_(OpenFile(filename1, offset_type_, async)),
+        second_(OpenFile(filename2, offset_type_, async)),
         filename1_(filename1),
         filename2_(filename2){}
 
@@ -115,6 +117,13 @@ class SeparatePairedReadStream : public ReadStream<PairedRead> {
 
  private:
 
+  static ReadStream<SingleRead>* OpenFile(const std::string& filename, OffsetType offset_type, bool async) {
+    if (!async)
+      return new FileReadStream(filename, offset_type);
+
+    return new AsyncReadStream<SingleRead>(std::make_shared<FileReadStream>(filename, offset_type));
+  }
+
   size_t insert_size_;
 
   bool change_order_;
@@ -34,6 +34,17 @@ enum OffsetType {
 
 typedef uint16_t SequenceOffsetT;
 
+// Binary records of the reads (sequence followed by the offsets) are padded,
+// so that the packed data of every sequence is aligned in the binary files
+// and can be used in place (see binary_format.hpp)
+const size_t READ_RECORD_PADDING = (sizeof(seq_element_type) - 2 * sizeof(SequenceOffsetT) % sizeof(seq_element_type))
+                                   % sizeof(seq_element_type);
+
+inline void WriteRecordPadding(std::ostream &file) {
+    static const char padding[sizeof(seq_element_type)] = {};
+    file.write(padding, READ_RECORD_PADDING);
+}
+
 
 class SingleRead {
 public:
@@ -193,6 +204,7 @@ public:
             file.write((const char *) &left_offset_, sizeof(left_offset_));
             file.write((const char *) &right_offset_, sizeof(right_offset_));
         }
+        WriteRecordPadding(file);
         return !file.fail();
     }
 
@@ -270,9 +282,21 @@ public:
         seq_.BinRead(file);
         file.read((char *) &left_offset_, sizeof(left_offset_));
         file.read((char *) &right_offset_, sizeof(right_offset_));
+        file.ignore(READ_RECORD_PADDING);
         return !file.fail();
     }
 
+    // Zero-copy version for the memory-mapped files, the sequence refers to
+    // the data in the buffer. Returns the pointer to the next record.
+    const char *BinRead(const char *buf, const std::shared_ptr<const void> &owner) {
+        buf = seq_.BinRead(buf, owner);
+        memcpy(&left_offset_, buf, sizeof(left_offset_));
+        buf += sizeof(left_offset_);
+        memcpy(&right_offset_, buf, sizeof(right_offset_));
+        buf += sizeof(right_offset_);
+        return buf + READ_RECORD_PADDING;
+    }
+
     bool BinWrite(std::ostream &file, bool rc = false) const {
         if (rc)
             (!seq_).BinWrite(file);
@@ -285,6 +309,7 @@ public:
             file.write((const char *) &left_offset_, sizeof(left_offset_));
             file.write((const char *) &right_offset_, sizeof(right_offset_));
         }
+        WriteRecordPadding(file);
         return !file.fail();
     }
 
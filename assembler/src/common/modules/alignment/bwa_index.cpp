@@ -11,8 +11,10 @@
 #include "bwa/utils.h"
 #include "kseq/kseq.h"
 
+#include <functional>
 #include <string>
 #include <memory>
+#include <tuple>
 
 // all of the bwa and kseq stuff is in unaligned sequence
 // best way I had to keep from clashes with klib macros
@@ -50,6 +52,7 @@ static uint8_t* seqlib_add1(const kstring_t *seq, const kstring_t *name,
     p->name = strdup((char*)name->s);
     p->anno = strdup("(null");
     p->gi = 0; p->len = seq->l;
+    p->is_alt = 0;
     p->offset = (bns->n_seqs == 0)? 0 : (p-1)->offset + (p-1)->len;
     p->n_ambs = 0;
     for (size_t i = lasts = 0; i < seq->l; ++i) {
@@ -87,9 +90,12 @@ static uint8_t* seqlib_add1(const kstring_t *seq, const kstring_t *name,
     return pac;
 }
 
-static uint8_t* seqlib_make_pac(const debruijn_graph::Graph &g,
-                                const std::vector<debruijn_graph::EdgeId> &ids,
-                                bool for_only) {
+typedef std::function<std::pair<std::string, std::string>(size_t)> RefF;
+
+// ref(i) returns the name and the sequence of the i-th reference, if bns_out is provided,
+// the sequence annotations (names, offsets and holes) are stored there
+static uint8_t* seqlib_make_pac(size_t n, const RefF &ref,
+                                bool for_only, bntseq_t **bns_out = nullptr) {
     bntseq_t * bns = (bntseq_t*)calloc(1, sizeof(bntseq_t));
     uint8_t *pac = 0;
     int32_t m_seqs, m_holes;
@@ -105,16 +111,16 @@ static uint8_t* seqlib_make_pac(const debruijn_graph::Graph &g,
 
     // move through the sequences
     // FIXME: not kstring is required
-    for (auto e : ids) {
-        std::string ref = std::to_string(g.int_id(e));
-        std::string seq = g.EdgeNucls(e).str();
+    for (size_t i = 0; i < n; ++i) {
+        std::string ref_name, seq;
+        std::tie(ref_name, seq) = ref(i);
 
         // make the ref name kstring
         kstring_t * name = (kstring_t*)malloc(1 * sizeof(kstring_t));
-        name->l = ref.length() + 1;
-        name->m = ref.length() + 3;
+        name->l = ref_name.length() + 1;
+        name->m = ref_name.length() + 3;
         name->s = (char*)calloc(name->m, sizeof(char));
-        memcpy(name->s, ref.c_str(), ref.length()+1);
+        memcpy(name->s, ref_name.c_str(), ref_name.length()+1);
 
         // make the sequence kstring
         kstring_t * t = (kstring_t*)malloc(sizeof(kstring_t));
@@ -143,7 +149,12 @@ static uint8_t* seqlib_make_pac(const debruijn_graph::Graph &g,
             _set_pac(pac, bns->l_pac, 3-_get_pac(pac, l));
     }
 
-    bns_destroy(bns);
+    if (bns_out) {
+        VERIFY(for_only);
+        *bns_out = bns;
+    } else {
+        bns_destroy(bns);
+    }
 
     return pac;
 }
@@ -182,6 +193,18 @@ static bwt_t *seqlib_bwt_pac2bwt(const uint8_t *pac, size_t bwt_seq_lenr) {
     return bwt;
 }
 
+// makes the bwt with the suffix array from the forward-reverse pac
+static bwt_t *seqlib_make_bwt(uint8_t *pac, size_t l_pac) {
+    bwt_t *bwt = seqlib_bwt_pac2bwt(pac, l_pac*2); // *2 for fwd and rev
+    bwt_bwtupdate_core(bwt);
+
+    // construct sa from bwt and occ. adds it to bwt struct
+    bwt_cal_sa(bwt, 32);
+    bwt_gen_cnt_table(bwt);
+
+    return bwt;
+}
+
 static bntann1_t* seqlib_add_to_anns(const std::string& name, const std::string& seq, bntann1_t* ann, size_t offset) {
     ann->offset = offset;
     ann->name = (char*)malloc(name.length()+1); // +1 for \0
@@ -204,11 +227,15 @@ void BWAIndex::Init() {
         ids_.push_back(*it);
     }
 
+    auto ref = [&](size_t i) {
+        return std::make_pair(std::to_string(g_.int_id(ids_[i])), g_.EdgeNucls(ids_[i]).str());
+    };
+
     // construct the forward-only pac
-    uint8_t* fwd_pac = seqlib_make_pac(g_, ids_, true); //true->for_only
+    uint8_t* fwd_pac = seqlib_make_pac(ids_.size(), ref, true); //true->for_only
 
     // construct the forward-reverse pac ("packed" 2 bit sequence)
-    uint8_t* pac = seqlib_make_pac(g_, ids_, false); // don't write, becasue only used to make BWT
+    uint8_t* pac = seqlib_make_pac(ids_.size(), ref, false); // don't write, becasue only used to make BWT
 
     size_t tlen = 0;
     for (auto e : ids_)
@@ -219,15 +246,9 @@ void BWAIndex::Init() {
 #endif
 
     // make the bwt
-    bwt_t *bwt;
-    bwt = seqlib_bwt_pac2bwt(pac, tlen*2); // *2 for fwd and rev
-    bwt_bwtupdate_core(bwt);
+    bwt_t *bwt = seqlib_make_bwt(pac, tlen);
     free(pac); // done with fwd-rev pac
 
-    // construct sa from bwt and occ. adds it to bwt struct
-    bwt_cal_sa(bwt, 32);
-    bwt_gen_cnt_table(bwt);
-
     // make the bns
     bntseq_t * bns = (bntseq_t*) calloc(1, sizeof(bntseq_t));
     bns->l_pac = tlen;
@@ -324,4 +345,123 @@ omnigraph::MappingPath<debruijn_graph::EdgeId> BWAIndex::AlignSequence(const Seq
     return res;
 }
 
+BWASequenceIndex::BWASequenceIndex(const std::vector<std::string> &names,
+                                   const std::vector<std::string> &seqs,
+                                   unsigned nthreads)
+        : memopt_(mem_opt_init(), free),
+          idx_((bwaidx_t*)calloc(1, sizeof(bwaidx_t)), bwa_idx_destroy) {
+    VERIFY(names.size() == seqs.size());
+    memopt_->n_threads = (int)nthreads;
+    bwa_verbose = 1;
+
+    auto ref = [&](size_t i) {
+        return std::make_pair(names[i], seqs[i]);
+    };
+
+    // Holes are filled with the same random bases in both pacs, as "bwa index" does
+    bntseq_t *bns = nullptr;
+    srand48(11);
+    uint8_t* fwd_pac = seqlib_make_pac(seqs.size(), ref, true, &bns);
+    srand48(11);
+    uint8_t* pac = seqlib_make_pac(seqs.size(), ref, false);
+
+    idx_->bwt = seqlib_make_bwt(pac, bns->l_pac);
+    free(pac);
+    idx_->bns = bns;
+    idx_->pac = fwd_pac;
+}
+
+BWASequenceIndex::~BWASequenceIndex() {}
+
+size_t BWASequenceIndex::batch_bases() const {
+    return (size_t)memopt_->chunk_size * memopt_->n_threads;
+}
+
+// Mirrors the conversion done by mem_aln2sam
+static void CollectAlignment(void *data, const bseq1_t *s, const mem_aln_t *p, int which) {
+    // bwa cigar operations are MIDSH => 01234
+    static const uint32_t kBamCigarOp[] = { 0, 1, 2, 4, 5 };
+    auto &collector = *(std::pair<const mem_opt_t*, std::vector<std::vector<SequenceAlignment>>*>*)data;
+    const mem_opt_t *opt = collector.first;
+
+    SequenceAlignment a;
+    a.flag = (p->flag & 0xffff) | (p->flag & 0x10000 ? 0x100 : 0);
+    a.ref = p->rid;
+    a.pos = p->rid >= 0 ? p->pos : -1;
+    a.map_qual = p->rid >= 0 ? p->mapq : 0;
+    // use hard clipping for supplementary alignments
+    bool hard_clip = which && !(opt->flag & MEM_F_SOFTCLIP) && !p->is_alt;
+    if (p->rid >= 0) {
+        for (int i = 0; i < p->n_cigar; ++i) {
+            uint32_t op = p->cigar[i] & 0xf;
+            if (!(opt->flag & MEM_F_SOFTCLIP) && !p->is_alt && (op == 3 || op == 4))
+                op = which ? 4 : 3;
+            a.cigar.push_back((p->cigar[i] >> 4) << 4 | kBamCigarOp[op]);
+        }
+    }
+
+    // secondary alignments go without the sequence
+    if (!(a.flag & 0x100)) {
+        int qb = 0, qe = s->l_seq;
+        if (p->n_cigar && hard_clip) {
+            uint32_t first = p->cigar[0] & 0xf, last = p->cigar[p->n_cigar - 1] & 0xf;
+            int first_len = (first == 3 || first == 4) ? int(p->cigar[0] >> 4) : 0;
+            int last_len = (last == 3 || last == 4) ? int(p->cigar[p->n_cigar - 1] >> 4) : 0;
+            if (!p->is_rev)
+                qb += first_len, qe -= last_len;
+            else
+                qe -= first_len, qb += last_len;
+        }
+        a.seq.reserve(qe - qb);
+        if (!p->is_rev) {
+            for (int i = qb; i < qe; ++i)
+                a.seq.push_back("ACGTN"[(int)s->seq[i]]);
+        } else {
+            for (int i = qe - 1; i >= qb; --i)
+                a.seq.push_back("TGCAN"[(int)s->seq[i]]);
+        }
+    }
+
+    // records of one read come from one thread
+    (*collector.second)[s->id].push_back(std::move(a));
+}
+
+std::vector<std::vector<SequenceAlignment>> BWASequenceIndex::Align(const std::vector<io::SingleRead> &reads,
+                                                                    bool paired, size_t n_processed) const {
+    VERIFY(!paired || reads.size() % 2 == 0);
+    std::vector<std::vector<SequenceAlignment>> res(reads.size());
+    if (reads.empty())
+        return res;
+
+    bseq1_t *seqs = (bseq1_t*)calloc(reads.size(), sizeof(bseq1_t));
+    for (size_t i = 0; i < reads.size(); ++i) {
+        // bwa requires the mates to be named the same
+        const std::string &name = reads[paired ? i & ~size_t(1) : i].name();
+        std::string seq = reads[i].GetSequenceString();
+        seqs[i].name = strdup(name.substr(0, name.find_first_of(" \t")).c_str());
+        seqs[i].seq = strdup(seq.c_str());
+        seqs[i].l_seq = (int)seq.length();
+        seqs[i].id = (int)i;
+    }
+
+    // mem_process_seqs uses the flag to decide whether the mates are interleaved
+    mem_opt_t opt = *memopt_;
+    if (paired)
+        opt.flag |= MEM_F_PE;
+    auto collector = std::make_pair((const mem_opt_t*)&opt, &res);
+    opt.aln_cb = CollectAlignment;
+    opt.aln_cb_data = &collector;
+    mem_process_seqs(&opt, idx_->bwt, idx_->bns, idx_->pac,
+                     (int64_t)n_processed, (int)reads.size(), seqs, nullptr);
+
+    for (size_t i = 0; i < reads.size(); ++i) {
+        free(seqs[i].name);
+        free(seqs[i].seq);
+        free(seqs[i].sam);
+    }
+    free(seqs);
+
+    return res;
+}
+
 }
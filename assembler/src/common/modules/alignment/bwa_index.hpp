@@ -8,6 +8,10 @@
 
 #include "assembly_graph/core/graph.hpp"
 #include "assembly_graph/paths/mapping_path.hpp"
+#include "io/reads/single_read.hpp"
+
+#include <string>
+#include <vector>
 
 extern "C" {
 struct bwaidx_s;
@@ -40,5 +44,47 @@ class BWAIndex {
 
     std::vector<debruijn_graph::EdgeId> ids_;
 };
+
+// One record of "bwa mem" output: what goes to the SAM line except for the
+// read name, the qualities and the optional fields
+struct SequenceAlignment {
+    int ref;                     // index of the reference sequence, -1 if there is no coordinate
+    int64_t pos;                 // 0-based leftmost position
+    unsigned flag;               // SAM flag
+    unsigned map_qual;
+    std::vector<uint32_t> cigar; // BAM encoding, empty if the read is not aligned
+    std::string seq;             // the read on the reference strand, without the hard clipped bases
+
+    bool is_aligned() const {
+        return (flag & 0x4) == 0;
+    }
+
+    bool is_main_alignment() const {
+        return (flag & 0x900) == 0;
+    }
+};
+
+// In-memory "bwa index" + "bwa mem" over an arbitrary set of named sequences
+class BWASequenceIndex {
+  public:
+    BWASequenceIndex(const std::vector<std::string> &names,
+                     const std::vector<std::string> &seqs,
+                     unsigned nthreads);
+    ~BWASequenceIndex();
+
+    // Returns the records of every read, several ones if there are
+    // supplementary alignments, in the order "bwa mem" would print them.
+    // Paired reads are expected to be interleaved; n_processed is the number
+    // of the reads aligned before, it affects only the random choice between
+    // equally good hits.
+    std::vector<std::vector<SequenceAlignment>> Align(const std::vector<io::SingleRead> &reads,
+                                                      bool paired, size_t n_processed) const;
+
+    // Total length of the reads bwa itself would align in one batch
+    size_t batch_bases() const;
+  private:
+    std::unique_ptr<mem_opt_t, void(*)(void*)> memopt_;
+    std::unique_ptr<bwaidx_t, void(*)(bwaidx_t*)> idx_;
+};
     
 }
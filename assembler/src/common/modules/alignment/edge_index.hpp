@@ -23,12 +23,14 @@ template<class Graph>
 class EdgeIndex: public omnigraph::GraphActionHandler<Graph> {
 
 public:
+    typedef typename Graph::VertexId VertexId;
     typedef typename Graph::EdgeId EdgeId;
     using InnerIndex = KmerFreeEdgeIndex<Graph, DefaultStoring>;
     typedef Graph GraphT;
     typedef typename InnerIndex::KMer KMer;
     typedef typename InnerIndex::KMerIdx KMerIdx;
     typedef typename InnerIndex::KmerPos Value;
+    typedef typename InnerIndex::KeyLookup KmerLookup;
 
 private:
     InnerIndex inner_index_;
@@ -69,6 +71,31 @@ public:
         updater_.DeleteKmers(e);
     }
 
+    bool IsBatchable() const override {
+        return true;
+    }
+
+    /**
+     * Only the net effect of the batch is applied: k-mers of the deleted edges are dropped, then the ones
+     * of the added edges are put. Edges which were added and deleted within the batch are skipped.
+     */
+    void HandleBatch(const omnigraph::GraphEventBatch<VertexId, EdgeId> &batch) override {
+        typedef typename omnigraph::GraphEventBatch<VertexId, EdgeId>::EventType EventType;
+        std::unordered_set<EdgeId> added;
+        std::vector<EdgeId> deleted;
+        for (const auto &event : batch.events()) {
+            if (event.type == EventType::AddEdge) {
+                added.insert(batch.edge(event));
+            } else if (event.type == EventType::DeleteEdge) {
+                EdgeId e = batch.edge(event);
+                if (!added.erase(e))
+                    deleted.push_back(e);
+            }
+        }
+        updater_.DeleteKmers(deleted);
+        updater_.UpdateKmers(std::vector<EdgeId>(added.begin(), added.end()));
+    }
+
     bool contains(const KMer& kmer) const {
         VERIFY(this->IsAttached());
         return inner_index_.contains(inner_index_.ConstructKWH(kmer));
@@ -76,13 +103,25 @@ public:
 
     const pair<EdgeId, size_t> get(const KMer& kmer) const {
         VERIFY(this->IsAttached());
-        auto kwh = inner_index_.ConstructKWH(kmer);
-        if (!inner_index_.contains(kwh)) {
-            return make_pair(EdgeId(0), -1u);
-        } else {
-            EdgeInfo<EdgeId> entry = inner_index_.get_value(kwh);
-            return std::make_pair(entry.edge_id, (size_t)entry.offset);
-        }
+        return get(inner_index_.ConstructKWH(kmer));
+    }
+
+    /**
+     * Batched lookups: prefetch() and prefetch_value() are issued for a window
+     * of k-mers ahead of the one resolved by get(kmer, lookup), see
+     * PerfectHashMap::KeyLookup.
+     */
+    void prefetch(const KMer& kmer, KmerLookup &lookup) const {
+        inner_index_.prefetch(kmer, lookup);
+    }
+
+    void prefetch_value(KmerLookup &lookup) const {
+        inner_index_.prefetch_value(lookup);
+    }
+
+    const pair<EdgeId, size_t> get(const KMer& kmer, const KmerLookup &lookup) const {
+        VERIFY(this->IsAttached());
+        return get(inner_index_.ConstructKWH(kmer, lookup));
     }
 
     void Refill() {
@@ -99,5 +138,14 @@ public:
         inner_index_.clear();
     }
 
+private:
+    const pair<EdgeId, size_t> get(const typename InnerIndex::KeyWithHash &kwh) const {
+        if (!inner_index_.contains(kwh)) {
+            return make_pair(EdgeId(0), -1u);
+        } else {
+            EdgeInfo<EdgeId> entry = inner_index_.get_value(kwh);
+            return std::make_pair(entry.edge_id, (size_t)entry.offset);
+        }
+    }
 };
 }
@@ -0,0 +1,186 @@
+//***************************************************************************
+//* Copyright (c) 2016 Saint Petersburg State University
+//* All Rights Reserved
+//* See file LICENSE for details.
+//***************************************************************************
+
+#pragma once
+
+#include "utils/verify.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <unordered_map>
+#include <vector>
+
+namespace pacbio {
+
+/**
+ * @brief Bounded concurrent cache of the bounded Dijkstra results. A whole run from
+ *        the start vertex is stored at once (the distances to all the reached vertices),
+ *        so a single search answers the queries for all the end vertices, reached or not.
+ *        The cache is split into shards with their own locks; when a shard is full, the
+ *        runs are evicted with the CLOCK (second chance) policy: the runs form a ring in
+ *        the insertion order, new runs are put right behind the hand. Results are shared
+ *        and immutable, so they are read outside of the shard lock.
+ */
+template<class Graph>
+class DistanceCache {
+public:
+    typedef typename Graph::VertexId VertexId;
+    typedef std::vector<std::pair<VertexId, size_t>> Distances;
+    typedef std::shared_ptr<const Distances> DistancesPtr;
+
+    static const size_t NOT_REACHED = size_t(-1);
+
+private:
+    struct Slot {
+        VertexId start;
+        DistancesPtr distances;
+        bool referenced;
+    };
+
+    typedef std::list<Slot> Ring;
+
+    // Shards are not to share a cache line
+    struct alignas(64) Shard {
+        std::mutex lock;
+        std::unordered_map<VertexId, typename Ring::iterator> slot_index;
+        Ring slots;
+        typename Ring::iterator hand = slots.end();
+        size_t stored = 0;
+    };
+
+    // operator new does not respect the extended alignment before C++17
+    template<class T>
+    struct AlignedAllocator {
+        typedef T value_type;
+
+        AlignedAllocator() = default;
+        template<class U>
+        AlignedAllocator(const AlignedAllocator<U> &) {}
+
+        T *allocate(size_t n) {
+            void *p = nullptr;
+            if (posix_memalign(&p, alignof(T), n * sizeof(T)) != 0)
+                throw std::bad_alloc();
+            return static_cast<T*>(p);
+        }
+
+        void deallocate(T *p, size_t) {
+            free(p);
+        }
+
+        template<class U>
+        bool operator==(const AlignedAllocator<U> &) const { return true; }
+        template<class U>
+        bool operator!=(const AlignedAllocator<U> &) const { return false; }
+    };
+
+public:
+    /**
+     * @param capacity maximal total count of the cached distances
+     */
+    DistanceCache(size_t capacity, size_t shard_count = 64)
+            : shard_capacity_(std::max<size_t>(capacity / shard_count, 1)),
+              shards_(shard_count),
+              hits_(0), misses_(0), evictions_(0) {
+        VERIFY(shard_count > 0);
+    }
+
+    /**
+     * @brief Returns the cached run from the vertex, nullptr if there is none.
+     */
+    DistancesPtr Find(VertexId start) const {
+        Shard &shard = GetShard(start);
+        DistancesPtr res;
+        {
+            std::lock_guard<std::mutex> guard(shard.lock);
+            auto it = shard.slot_index.find(start);
+            if (it != shard.slot_index.end()) {
+                it->second->referenced = true;
+                res = it->second->distances;
+            }
+        }
+        (res ? hits_ : misses_).fetch_add(1, std::memory_order_relaxed);
+        return res;
+    }
+
+    /**
+     * @brief Stores the run from the vertex (distances should be sorted by vertex).
+     *        If another thread has stored the run already, that one is returned.
+     */
+    DistancesPtr Insert(VertexId start, Distances distances) {
+        DistancesPtr res = std::make_shared<const Distances>(std::move(distances));
+        Shard &shard = GetShard(start);
+        std::lock_guard<std::mutex> guard(shard.lock);
+        auto it = shard.slot_index.find(start);
+        if (it != shard.slot_index.end())
+            return it->second->distances;
+
+        while (!shard.slots.empty() && shard.stored + Weight(*res) > shard_capacity_)
+            Evict(shard);
+
+        shard.slot_index[start] = shard.slots.insert(shard.hand, Slot{start, res, false});
+        shard.stored += Weight(*res);
+        return res;
+    }
+
+    /**
+     * @brief Returns the distance to the vertex in the run, NOT_REACHED if it was not reached.
+     */
+    static size_t Distance(const Distances &distances, VertexId end) {
+        auto it = std::lower_bound(distances.begin(), distances.end(), end,
+                                   [](const std::pair<VertexId, size_t> &d, VertexId v) { return d.first < v; });
+        if (it == distances.end() || it->first != end)
+            return NOT_REACHED;
+        return it->second;
+    }
+
+    size_t hits() const { return hits_; }
+    size_t misses() const { return misses_; }
+    size_t evictions() const { return evictions_; }
+
+private:
+    Shard &GetShard(VertexId v) const {
+        return shards_[std::hash<VertexId>()(v) % shards_.size()];
+    }
+
+    // Empty runs still take a place
+    static size_t Weight(const Distances &distances) {
+        return distances.size() + 1;
+    }
+
+    void Evict(Shard &shard) {
+        while (true) {
+            if (shard.hand == shard.slots.end())
+                shard.hand = shard.slots.begin();
+            if (shard.hand->referenced) {
+                shard.hand->referenced = false;
+                ++shard.hand;
+                continue;
+            }
+
+            shard.stored -= Weight(*shard.hand->distances);
+            shard.slot_index.erase(shard.hand->start);
+            shard.hand = shard.slots.erase(shard.hand);
+            evictions_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+
+    const size_t shard_capacity_;
+    mutable std::vector<Shard, AlignedAllocator<Shard>> shards_;
+    mutable std::atomic<size_t> hits_, misses_;
+    std::atomic<size_t> evictions_;
+};
+
+template<class Graph>
+const size_t DistanceCache<Graph>::NOT_REACHED;
+
+}
@@ -14,6 +14,7 @@
 // FIXME: Layering violation, get rid of this
 #include "pipeline/config_struct.hpp"
 #include "pacbio_read_structures.hpp"
+#include "distance_cache.hpp"
 #include "assembly_graph/graph_support/basic_vertex_conditions.hpp"
 
 #include <algorithm>
@@ -60,6 +61,8 @@ private:
     const static int short_edge_cutoff = 0;
     const static size_t min_cluster_size = 8;
     const static int max_similarity_distance = 500;
+    //Total count of the cached distances
+    const static size_t max_cached_distances = 1 << 22;
 
 //Debug stasts
     int good_follow = 0;
@@ -68,7 +71,7 @@ private:
 
     set<Sequence> banned_kmers;
     debruijn_graph::DeBruijnEdgeMultiIndex<typename Graph::EdgeId> tmp_index;
-    mutable map<pair<VertexId, VertexId>, size_t> distance_cashed;
+    mutable DistanceCache<Graph> distance_cache_;
     size_t read_count;
     bool ignore_map_to_middle;
     debruijn_graph::config::debruijn_config::pacbio_processor pb_config_;
@@ -79,7 +82,8 @@ public:
             : g_(g),
               pacbio_k(k),
               debruijn_k(debruijn_k_),
-              tmp_index((unsigned) pacbio_k, out_dir), ignore_map_to_middle(ignore_map_to_middle), pb_config_(pb_config) {
+              tmp_index((unsigned) pacbio_k, out_dir), distance_cache_(max_cached_distances),
+              ignore_map_to_middle(ignore_map_to_middle), pb_config_(pb_config) {
         DEBUG("PB Mapping Index construction started");
         debruijn_graph::EdgeIndexRefiller().Refill(tmp_index, g_);
         INFO("Index constructed");
@@ -89,6 +93,11 @@ public:
     ~PacBioMappingIndex(){
         DEBUG("good/ugly/bad counts:" << good_follow << " "<<half_bad_follow << " " << bad_follow);
     }
+
+    void ReportDistanceCacheStats() const {
+        INFO("Distance cache: " << distance_cache_.hits() << " hits, " << distance_cache_.misses() << " misses, "
+             << distance_cache_.evictions() << " evictions");
+    }
     
     void FillBannedKmers() {
         for (int i = 0; i < 4; i++) {
@@ -677,34 +686,24 @@ public:
         VertexId start_v = g_.EdgeEnd(a_edge);
         size_t addition = g_.length(a_edge);
         VertexId end_v = g_.EdgeStart(b_edge);
-        pair<VertexId, VertexId> vertex_pair = make_pair(start_v, end_v);
 
-        size_t result = size_t(-1);
-        bool not_found = true;
-        auto distance_it = distance_cashed.begin();
-#pragma omp critical(pac_index)
-        {
-            distance_it = distance_cashed.find(vertex_pair);
-            not_found = (distance_it == distance_cashed.end());
-        }
-        if (not_found) {
+        auto distances = distance_cache_.Find(start_v);
+        if (!distances) {
 //TODO: constants
             omnigraph::DijkstraHelper<debruijn_graph::Graph>::BoundedDijkstra dijkstra(
                     omnigraph::DijkstraHelper<debruijn_graph::Graph>::CreateBoundedDijkstra(g_, pb_config_.max_path_in_dijkstra, pb_config_.max_vertex_in_dijkstra));
             dijkstra.Run(start_v);
-            if (dijkstra.DistanceCounted(end_v)) {
-                result = dijkstra.GetDistance(end_v);
-            }
-#pragma omp critical(pac_index)
-        {
-            distance_it = distance_cashed.insert({vertex_pair, result}).first;
-        }
+            //The whole run is cached, it answers the queries for all the end vertices
+            typename DistanceCache<Graph>::Distances reached;
+            for (VertexId v : dijkstra.ReachedVertices())
+                reached.push_back(make_pair(v, dijkstra.GetDistance(v)));
+            std::sort(reached.begin(), reached.end());
+            distances = distance_cache_.Insert(start_v, std::move(reached));
         } else {
             DEBUG("taking from cashed");
         }
 
-
-        result = distance_it->second;
+        size_t result = DistanceCache<Graph>::Distance(*distances, end_v);
         DEBUG (result);
         if (result == size_t(-1)) {
             return 0;
@@ -287,14 +287,48 @@ class BasicSequenceMapper: public AbstractSequenceMapper<Graph> {
   typedef typename Graph::EdgeId EdgeId;
   typedef typename Graph::VertexId VertexId;
   typedef typename Index::KMer Kmer;
+  typedef typename Index::KmerLookup KmerLookup;
   typedef KmerMapper<Graph> KmerSubs;
   const KmerSubs& kmer_mapper_;
   size_t k_;
   bool optimization_on_;
 
+  // Number of k-mers ahead of the current one whose index lookups are in
+  // flight while the read can not be threaded along the graph
+  static const size_t LOOKAHEAD = 16;
+
+  // Lookups of the k-mers [pos, hashed) are started (MPHF data prefetched),
+  // the ones of [pos, resolved) have their values prefetched as well
+  struct LookupWindow {
+    KmerLookup lookups[LOOKAHEAD];
+    Kmer next;
+    size_t hashed;
+    size_t resolved;
+
+    LookupWindow(const Kmer &kmer)
+        : next(kmer), hashed(0), resolved(0) {}
+  };
+
+  void Prefetch(const Sequence &sequence, const Kmer &kmer, size_t pos,
+                LookupWindow &window) const {
+    size_t kmer_cnt = sequence.size() - k_ + 1;
+    if (window.hashed <= pos) {
+      window.next = kmer;
+      window.hashed = pos;
+    }
+    for (size_t end = std::min(pos + LOOKAHEAD, kmer_cnt); window.hashed < end; ++window.hashed) {
+      index_.prefetch(window.next, window.lookups[window.hashed % LOOKAHEAD]);
+      if (window.hashed + 1 < kmer_cnt)
+        window.next <<= sequence[window.hashed + k_];
+    }
+    window.resolved = std::max(window.resolved, pos);
+    for (size_t end = std::min(pos + LOOKAHEAD / 2, kmer_cnt); window.resolved < end; ++window.resolved)
+      index_.prefetch_value(window.lookups[window.resolved % LOOKAHEAD]);
+  }
+
   bool FindKmer(const Kmer &kmer, size_t kmer_pos, std::vector<EdgeId> &passed,
-                RangeMappings& range_mappings) const {
-    std::pair<EdgeId, size_t> position = index_.get(kmer);
+                RangeMappings& range_mappings, const KmerLookup *lookup = nullptr) const {
+    std::pair<EdgeId, size_t> position = lookup ? index_.get(kmer, *lookup) : index_.get(kmer);
     if (position.second == -1u)
         return false;
     
@@ -345,7 +379,8 @@ class BasicSequenceMapper: public AbstractSequenceMapper<Graph> {
   }
 
   bool ProcessKmer(const Kmer &kmer, size_t kmer_pos, std::vector<EdgeId> &passed_edges,
-                   RangeMappings& range_mapping, bool try_thread) const {
+                   RangeMappings& range_mapping, bool try_thread,
+                   const KmerLookup *lookup = nullptr) const {
     if (try_thread) {
         if (!TryThread(kmer, kmer_pos, passed_edges, range_mapping)) {
             FindKmer(kmer_mapper_.Substitute(kmer), kmer_pos, passed_edges, range_mapping);
@@ -360,7 +395,7 @@ class BasicSequenceMapper: public AbstractSequenceMapper<Graph> {
         return false;
     }
 
-    return FindKmer(kmer, kmer_pos, passed_edges, range_mapping);
+    return FindKmer(kmer, kmer_pos, passed_edges, range_mapping, lookup);
   }
 
  public:
@@ -381,13 +416,24 @@ class BasicSequenceMapper: public AbstractSequenceMapper<Graph> {
     }
 
     Kmer kmer = sequence.start<Kmer>(k_);
+    LookupWindow window(kmer);
     bool try_thread = false;
-    try_thread = ProcessKmer(kmer, 0, passed_edges,
-                             range_mapping, try_thread);
-    for (size_t i = k_; i < sequence.size(); ++i) {
-      kmer <<= sequence[i];
-      try_thread = ProcessKmer(kmer, i - k_ + 1, passed_edges,
-                               range_mapping, try_thread);
+    // Lookups are batched only within the runs of k-mers missing the graph,
+    // mostly the reads are threaded right after the first k-mer is found
+    bool lookahead = false;
+    for (size_t i = k_ - 1; i < sequence.size(); ++i) {
+      if (i >= k_)
+        kmer <<= sequence[i];
+      size_t kmer_pos = i - k_ + 1;
+      const KmerLookup *lookup = nullptr;
+      if (lookahead) {
+        Prefetch(sequence, kmer, kmer_pos, window);
+        lookup = &window.lookups[kmer_pos % LOOKAHEAD];
+      }
+      bool threaded = try_thread;
+      try_thread = ProcessKmer(kmer, kmer_pos, passed_edges,
+                               range_mapping, try_thread, lookup);
+      lookahead = !threaded && !try_thread;
     }
 
     return MappingPath<EdgeId>(passed_edges, range_mapping);
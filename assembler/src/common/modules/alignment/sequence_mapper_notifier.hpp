@@ -14,7 +14,10 @@
 #include "io/reads/paired_read.hpp"
 #include "io/reads/read_stream_vector.hpp"
 #include "pipeline/graph_pack.hpp"
+#include "utils/telemetry.hpp"
 
+#include <atomic>
+#include <mutex>
 #include <vector>
 #include <cstdlib>
 
@@ -34,12 +37,17 @@ public:
     virtual void ProcessSingleRead(size_t /* thread_index */, const io::SingleReadSeq& /* r */, const MappingPath<EdgeId>& /* read */) {}
 
     virtual void MergeBuffer(size_t /* thread_index */) {}
-    
+
+    //MergeBuffer might be called for different threads concurrently
+    virtual bool IsMergeThreadSafe() const { return false; }
+
     virtual ~SequenceMapperListener() {}
 };
 
 class SequenceMapperNotifier {
     static constexpr size_t BUFFER_SIZE = 200000;
+    //Memory pressure is checked once per batch
+    static constexpr size_t READ_BATCH = 1000;
 public:
     typedef SequenceMapper<conj_graph_pack::graph_t> SequenceMapperT;
 
@@ -62,48 +70,45 @@ public:
 
         streams.reset();
         NotifyStartProcessLibrary(lib_index, threads_count);
-        size_t counter = 0, n = 15;
+        std::atomic<size_t> counter(0), mapped(0), next_report(1 << 15);
+        std::vector<std::mutex> merge_locks(listeners_[lib_index].size());
         size_t fmem = get_free_memory();
 
-        #pragma omp parallel for num_threads(threads_count) shared(counter)
+        #pragma omp parallel for num_threads(threads_count)
         for (size_t i = 0; i < streams.size(); ++i) {
-            size_t size = 0;
+            size_t size = 0, mapped_size = 0;
             ReadType r;
             auto& stream = streams[i];
             while (!stream.eof()) {
-                if (size == BUFFER_SIZE || 
+                for (size_t j = 0; j < READ_BATCH && !stream.eof(); ++j, ++size) {
+                    stream >> r;
+                    mapped_size += NotifyProcessRead(r, mapper, lib_index, i);
+                }
+                if (size >= BUFFER_SIZE ||
                     // Stop filling buffer if the amount of available is smaller
                     // than half of free memory.
-                    (10 * get_free_memory() / 4 < fmem && size > 10000)) {
-                    #pragma omp critical
-                    {
-                        counter += size;
-                        if (counter >> n) {
-                            INFO("Processed " << counter << " reads");
-                            n += 1;
-                        }
-                        size = 0;
-                        NotifyMergeBuffer(lib_index, i);
-                    }
+                    (size > 10000 && 10 * get_free_memory() / 4 < fmem)) {
+                    ReportProgress(counter += size, next_report);
+                    mapped += mapped_size;
+                    size = mapped_size = 0;
+                    NotifyMergeBuffer(lib_index, i, merge_locks);
                 }
-                stream >> r;
-                ++size;
-                NotifyProcessRead(r, mapper, lib_index, i);
             }
-            #pragma omp atomic
             counter += size;
+            mapped += mapped_size;
+            NotifyMergeBuffer(lib_index, i, merge_locks);
         }
 
-        for (size_t i = 0; i < threads_count; ++i)
-            NotifyMergeBuffer(lib_index, i);
-
         INFO("Total " << counter << " reads processed");
+        telemetry::add("reads_processed", (double) counter);
+        telemetry::add("reads_mapped", (double) mapped);
         NotifyStopProcessLibrary(lib_index);
     }
 
 private:
+    //Returns if the read (any of the paired ones) was mapped
     template<class ReadType>
-    void NotifyProcessRead(const ReadType& r, const SequenceMapperT& mapper, size_t ilib, size_t ithread) const;
+    bool NotifyProcessRead(const ReadType& r, const SequenceMapperT& mapper, size_t ilib, size_t ithread) const;
 
     void NotifyStartProcessLibrary(size_t ilib, size_t thread_count) const {
         for (const auto& listener : listeners_[ilib])
@@ -115,17 +120,38 @@ private:
             listener->StopProcessLibrary();
     }
 
-    void NotifyMergeBuffer(size_t ilib, size_t ithread) const {
-        for (const auto& listener : listeners_[ilib])
-            listener->MergeBuffer(ithread);
+    //Listeners which are not thread safe are merged under their own locks,
+    //so different listeners are merged simultaneously
+    void NotifyMergeBuffer(size_t ilib, size_t ithread, std::vector<std::mutex>& locks) const {
+        const auto& listeners = listeners_[ilib];
+        for (size_t i = 0; i < listeners.size(); ++i) {
+            if (listeners[i]->IsMergeThreadSafe()) {
+                listeners[i]->MergeBuffer(ithread);
+            } else {
+                std::lock_guard<std::mutex> lock(locks[i]);
+                listeners[i]->MergeBuffer(ithread);
+            }
+        }
+    }
+
+    //Reports each time the number of processed reads passes the next power of 2
+    void ReportProgress(size_t processed, std::atomic<size_t>& next_report) const {
+        size_t threshold = next_report;
+        while (processed >= threshold) {
+            if (next_report.compare_exchange_weak(threshold, threshold * 2)) {
+                INFO("Processed " << processed << " reads");
+                return;
+            }
+        }
     }
+
     const conj_graph_pack& gp_;
 
     std::vector<std::vector<SequenceMapperListener*> > listeners_;  //first vector's size = count libs
 };
 
 template<>
-inline void SequenceMapperNotifier::NotifyProcessRead(const io::PairedReadSeq& r,
+inline bool SequenceMapperNotifier::NotifyProcessRead(const io::PairedReadSeq& r,
                                                       const SequenceMapperT& mapper,
                                                       size_t ilib,
                                                       size_t ithread) const {
@@ -140,10 +166,11 @@ inline void SequenceMapperNotifier::NotifyProcessRead(const io::PairedReadSeq& r
         listener->ProcessSingleRead(ithread, r.first(), path1);
         listener->ProcessSingleRead(ithread, r.second(), path2);
     }
+    return path1.size() > 0 || path2.size() > 0;
 }
 
 template<>
-inline void SequenceMapperNotifier::NotifyProcessRead(const io::PairedRead& r,
+inline bool SequenceMapperNotifier::NotifyProcessRead(const io::PairedRead& r,
                                                       const SequenceMapperT& mapper,
                                                       size_t ilib,
                                                       size_t ithread) const {
@@ -155,10 +182,11 @@ inline void SequenceMapperNotifier::NotifyProcessRead(const io::PairedRead& r,
         listener->ProcessSingleRead(ithread, r.first(), path1);
         listener->ProcessSingleRead(ithread, r.second(), path2);
     }
+    return path1.size() > 0 || path2.size() > 0;
 }
 
 template<>
-inline void SequenceMapperNotifier::NotifyProcessRead(const io::SingleReadSeq& r,
+inline bool SequenceMapperNotifier::NotifyProcessRead(const io::SingleReadSeq& r,
                                                       const SequenceMapperT& mapper,
                                                       size_t ilib,
                                                       size_t ithread) const {
@@ -166,16 +194,18 @@ inline void SequenceMapperNotifier::NotifyProcessRead(const io::SingleReadSeq& r
     MappingPath<EdgeId> path = mapper.MapSequence(read);
     for (const auto& listener : listeners_[ilib])
         listener->ProcessSingleRead(ithread, r, path);
+    return path.size() > 0;
 }
 
 template<>
-inline void SequenceMapperNotifier::NotifyProcessRead(const io::SingleRead& r,
+inline bool SequenceMapperNotifier::NotifyProcessRead(const io::SingleRead& r,
                                                       const SequenceMapperT& mapper,
                                                       size_t ilib,
                                                       size_t ithread) const {
     MappingPath<EdgeId> path = mapper.MapRead(r);
     for (const auto& listener : listeners_[ilib])
         listener->ProcessSingleRead(ithread, r, path);
+    return path.size() > 0;
 }
 
 } /*debruijn_graph*/
@@ -115,7 +115,8 @@ void EarlyClipTips(size_t k, const config::debruijn_config::construction& params
 template<class Graph, class Read, class Index>
 ReadStatistics ConstructGraphUsingExtentionIndex(const config::debruijn_config::construction params,
                                                  io::ReadStreamList<Read>& streams, Graph& g,
-                                                 Index& index, io::SingleStreamPtr contigs_stream = io::SingleStreamPtr()) {
+                                                 Index& index, io::SingleStreamPtr contigs_stream = io::SingleStreamPtr(),
+                                                 KMerMultiplicities *multiplicities = nullptr) {
     size_t k = g.k();
     INFO("Constructing DeBruijn graph for k=" << k);
 
@@ -129,7 +130,8 @@ ReadStatistics ConstructGraphUsingExtentionIndex(const config::debruijn_config::
     ExtensionIndex ext((unsigned) k, index.inner_index().workdir());
 
     //fixme hack
-    ReadStatistics stats = ExtensionIndexBuilder().BuildExtensionIndexFromStream(ext, streams, (contigs_stream == 0) ? 0 : &(*contigs_stream), params.read_buffer_size);
+    ReadStatistics stats = ExtensionIndexBuilder().BuildExtensionIndexFromStream(ext, streams, (contigs_stream == 0) ? 0 : &(*contigs_stream), params.read_buffer_size,
+                                                                                 multiplicities);
 
     EarlyClipTips(k, params, stats.max_read_length_, ext);
 
@@ -137,6 +139,7 @@ ReadStatistics ConstructGraphUsingExtentionIndex(const config::debruijn_config::
     VERIFY(!index.IsAttached());
     DeBruijnGraphExtentionConstructor<Graph> g_c(g, ext);
     g_c.ConstructGraph(100, 10000, 1.2, params.keep_perfect_loops);//TODO move these parameters to config
+    g.ReportAllocation();
 
     INFO("Building index with from graph")
     //todo pass buffer size
@@ -149,9 +152,10 @@ ReadStatistics ConstructGraphUsingExtentionIndex(const config::debruijn_config::
 template<class Graph, class Index, class Streams>
 ReadStatistics ConstructGraph(const config::debruijn_config::construction &params,
                               Streams& streams, Graph& g,
-                              Index& index, io::SingleStreamPtr contigs_stream = io::SingleStreamPtr()) {
+                              Index& index, io::SingleStreamPtr contigs_stream = io::SingleStreamPtr(),
+                              KMerMultiplicities *multiplicities = nullptr) {
     if (params.con_mode == config::construction_mode::extention) {
-        return ConstructGraphUsingExtentionIndex(params, streams, g, index, contigs_stream);
+        return ConstructGraphUsingExtentionIndex(params, streams, g, index, contigs_stream, multiplicities);
 //    } else if(params.con_mode == construction_mode::con_old){
 //        return ConstructGraphUsingOldIndex(k, streams, g, index, contigs_stream);
     } else {
@@ -166,12 +170,18 @@ ReadStatistics ConstructGraphWithCoverage(const config::debruijn_config::constru
                                   Streams& streams, Graph& g,
                                   Index& index, FlankingCoverage<Graph>& flanking_cov,
                                   io::SingleStreamPtr contigs_stream = io::SingleStreamPtr()) {
-    ReadStatistics rs = ConstructGraph(params, streams, g, index, contigs_stream);
+    std::unique_ptr<KMerMultiplicities> multiplicities;
+    if (params.single_pass_coverage)
+        multiplicities.reset(new KMerMultiplicities(index.inner_index().workdir()));
+    ReadStatistics rs = ConstructGraph(params, streams, g, index, contigs_stream, multiplicities.get());
 
     typedef typename Index::InnerIndex InnerIndex;
     typedef typename EdgeIndexHelper<InnerIndex>::CoverageAndGraphPositionFillingIndexBuilderT IndexBuilder;
     INFO("Filling coverage index")
-    IndexBuilder().ParallelFillCoverage(index.inner_index(), streams);
+    if (multiplicities)
+        IndexBuilder().FillCoverageFromMultiplicities(index.inner_index(), *multiplicities, (unsigned) streams.size());
+    else
+        IndexBuilder().ParallelFillCoverage(index.inner_index(), streams);
     INFO("Filling coverage and flanking coverage from index");
     FillCoverageAndFlanking(index.inner_index(), g, flanking_cov);
     return rs;
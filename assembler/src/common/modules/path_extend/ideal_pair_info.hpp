@@ -15,6 +15,7 @@
 #ifndef IDEAL_PAIR_INFO_HPP_
 #define IDEAL_PAIR_INFO_HPP_
 #import <vector>
+#include <mutex>
 #include "pipeline/graph_pack.hpp"
 
 namespace path_extend {
@@ -43,16 +44,22 @@ public:
         PreCalculateNotTotalReadsWeight();
     }
 
+    // Thread-safe, the values are cached by the lengths of the edges
     double IdealPairedInfo(EdgeId e1, EdgeId e2, int dist, bool additive = false) const {
         std::pair<size_t, size_t> lengths = make_pair(g_.length(e1), g_.length(e2));
-        if (pi_.find(lengths) == pi_.end()) {
-            pi_.insert(make_pair(lengths, std::map<int, double>()));
+        {
+            std::lock_guard<std::mutex> lock(pi_mutex_);
+            auto it = pi_.find(lengths);
+            if (it != pi_.end()) {
+                auto weight = it->second.find(dist);
+                if (weight != it->second.end())
+                    return weight->second;
+            }
         }
-        std::map<int, double>& weights = pi_[lengths];
-        if (weights.find(dist) == weights.end()) {
-            weights.insert(make_pair(dist, IdealPairedInfo(g_.length(e1), g_.length(e2), dist, additive)));
-        }
-        return weights[dist];
+        double weight = IdealPairedInfo(lengths.first, lengths.second, dist, additive);
+        std::lock_guard<std::mutex> lock(pi_mutex_);
+        pi_[lengths].insert(make_pair(dist, weight));
+        return weight;
     }
 
     double IdealPairedInfo(size_t len1, size_t len2, int dist, bool additive = false) const {
@@ -119,6 +126,7 @@ private:
     std::vector<double> weights_;
     std::map<int, double> insert_size_distrib_;
     mutable std::map<std::pair<size_t, size_t>, std::map<int, double> > pi_;
+    mutable std::mutex pi_mutex_;
     std::vector<double> not_total_weights_right_;
     std::vector<double> not_total_weights_left_;
 protected:
@@ -17,7 +17,9 @@
 #include "path_filter.hpp"
 #include "overlap_analysis.hpp"
 #include "assembly_graph/graph_support/scaff_supplementary.hpp"
+#include "utils/openmp_wrapper.h"
 #include <cmath>
+#include <memory>
 
 namespace path_extend {
 
@@ -616,6 +618,40 @@ inline Gap MimicLAGapJoiner(Sequence& s1, Sequence& s2) {
 
 
 //Detects a cycle as a minsuffix > IS present earlier in the path. Overlap is allowed.
+class InsertSizeLoopDetector;
+
+/**
+ * Result of the path growth from a seed made speculatively, i.e. concurrently
+ * with the growth from the preceding seeds (see CompositeExtender). While the
+ * record is current for the thread, shared structures (UsedUniqueStorage,
+ * InsertSizeLoopDetector) keep their changes here and log the edges they were
+ * asked about instead of touching the shared state. Paths created during the
+ * growth get ids relative to the start of the growth (see PathIdScope).
+ */
+struct GrowthRecord {
+    // Grown path pair (if any) followed by the paths added by the extenders
+    PathContainer paths;
+    bool grown;
+    uint64_t ids_used;
+
+    set<EdgeId> covered_checked;
+    set<EdgeId> used_checked;
+    set<EdgeId> used_added;
+    set<EdgeId> cycles_checked;
+    vector<pair<InsertSizeLoopDetector*, std::unique_ptr<BidirectionalPath>>> cycles_added;
+
+    GrowthRecord()
+            : grown(false), ids_used(0) {}
+
+    // Record the current thread is growing the path for
+    static GrowthRecord *&current() {
+        static GrowthRecord *records[PathIdScope::MAX_THREADS];
+        unsigned thread = unsigned(omp_get_thread_num());
+        VERIFY(thread < PathIdScope::MAX_THREADS);
+        return records[thread];
+    }
+};
+
 class InsertSizeLoopDetector {
 protected:
     GraphCoverageMap visited_cycles_coverage_map_;
@@ -697,42 +733,15 @@ public:
         DEBUG("Checking existing loops");
         auto visited_cycles = visited_cycles_coverage_map_.GetEdgePaths(path.Back());
         for (auto cycle : *visited_cycles) {
-            DEBUG("checking  cycle ");
-            int pos = path.FindLast(*cycle);
-            if (pos == -1)
-                continue;
-
-            int start_cycle_pos = pos + (int) cycle->Size();
-            bool only_cycles_in_tail = true;
-            int last_cycle_pos = start_cycle_pos;
-            DEBUG("start_cycle pos "<< last_cycle_pos);
-            for (int i = start_cycle_pos; i < (int) path.Size() - (int) cycle->Size(); i += (int) cycle->Size()) {
-                if (!path.CompareFrom(i, *cycle)) {
-                    only_cycles_in_tail = false;
-                    break;
-                } else {
-                    last_cycle_pos = i + (int) cycle->Size();
-                    DEBUG("last cycle pos changed " << last_cycle_pos);
-                }
-            }
-            DEBUG("last_cycle_pos " << last_cycle_pos);
-            only_cycles_in_tail = only_cycles_in_tail && cycle->CompareFrom(0, path.SubPath(last_cycle_pos));
-            if (only_cycles_in_tail) {
-// seems that most of this is useless, checking
-                VERIFY (last_cycle_pos == start_cycle_pos);
-                DEBUG("find cycle " << last_cycle_pos);
-                DEBUG("path");
-                path.Print();
-                DEBUG("last subpath");
-                path.SubPath(last_cycle_pos).Print();
-                DEBUG("cycle");
-                cycle->Print();
-                DEBUG("last_cycle_pos " << last_cycle_pos << " path size " << path.Size());
-                VERIFY(last_cycle_pos <= (int)path.Size());
-                DEBUG("last cycle pos + cycle " << last_cycle_pos + (int)cycle->Size());
-                VERIFY(last_cycle_pos + (int)cycle->Size() >= (int)path.Size());
-
+            if (EndsWithCycle(path, *cycle))
                 return true;
+        }
+
+        if (GrowthRecord *record = GrowthRecord::current()) {
+            record->cycles_checked.insert(path.Back());
+            for (const auto& added : record->cycles_added) {
+                if (added.first == this && added.second->Contains(path.Back()) && EndsWithCycle(path, *added.second))
+                    return true;
             }
         }
         return false;
@@ -745,11 +754,61 @@ public:
         }
         BidirectionalPath * p = new BidirectionalPath(path.SubPath(pos));
         BidirectionalPath * cp = new BidirectionalPath(p->Conjugate());
-        visited_cycles_coverage_map_.Subscribe(p);
-        visited_cycles_coverage_map_.Subscribe(cp);
+        if (GrowthRecord *record = GrowthRecord::current()) {
+            record->cycles_added.emplace_back(this, std::unique_ptr<BidirectionalPath>(p));
+            record->cycles_added.emplace_back(this, std::unique_ptr<BidirectionalPath>(cp));
+        } else {
+            AddCycle(p);
+            AddCycle(cp);
+        }
         DEBUG("add cycle");
         p->Print();
     }
+
+    void AddCycle(BidirectionalPath *cycle) {
+        visited_cycles_coverage_map_.Subscribe(cycle);
+    }
+
+private:
+    bool EndsWithCycle(const BidirectionalPath& path, const BidirectionalPath& cycle) const {
+        DEBUG("checking  cycle ");
+        int pos = path.FindLast(cycle);
+        if (pos == -1)
+            return false;
+
+        int start_cycle_pos = pos + (int) cycle.Size();
+        bool only_cycles_in_tail = true;
+        int last_cycle_pos = start_cycle_pos;
+        DEBUG("start_cycle pos "<< last_cycle_pos);
+        for (int i = start_cycle_pos; i < (int) path.Size() - (int) cycle.Size(); i += (int) cycle.Size()) {
+            if (!path.CompareFrom(i, cycle)) {
+                only_cycles_in_tail = false;
+                break;
+            } else {
+                last_cycle_pos = i + (int) cycle.Size();
+                DEBUG("last cycle pos changed " << last_cycle_pos);
+            }
+        }
+        DEBUG("last_cycle_pos " << last_cycle_pos);
+        only_cycles_in_tail = only_cycles_in_tail && cycle.CompareFrom(0, path.SubPath(last_cycle_pos));
+        if (!only_cycles_in_tail)
+            return false;
+
+// seems that most of this is useless, checking
+        VERIFY (last_cycle_pos == start_cycle_pos);
+        DEBUG("find cycle " << last_cycle_pos);
+        DEBUG("path");
+        path.Print();
+        DEBUG("last subpath");
+        path.SubPath(last_cycle_pos).Print();
+        DEBUG("cycle");
+        cycle.Print();
+        DEBUG("last_cycle_pos " << last_cycle_pos << " path size " << path.Size());
+        VERIFY(last_cycle_pos <= (int)path.Size());
+        DEBUG("last cycle pos + cycle " << last_cycle_pos + (int)cycle.Size());
+        VERIFY(last_cycle_pos + (int)cycle.Size() >= (int)path.Size());
+        return true;
+    }
 };
 
 class RepeatDetector {
@@ -859,13 +918,22 @@ struct UsedUniqueStorage {
 
     void insert(EdgeId e) {
         if (unique_.IsUnique(e)) {
-            used_.insert(e);
-            used_.insert(e->conjugate());
+            set<EdgeId>& used = GrowthRecord::current() ? GrowthRecord::current()->used_added : used_;
+            used.insert(e);
+            used.insert(e->conjugate());
         }
     }
 
     bool IsUsedAndUnique(EdgeId e) const {
-        return (unique_.IsUnique(e) && used_.find(e) != used_.end());
+        if (!unique_.IsUnique(e))
+            return false;
+
+        if (GrowthRecord *record = GrowthRecord::current()) {
+            record->used_checked.insert(e);
+            if (record->used_added.count(e))
+                return true;
+        }
+        return used_.find(e) != used_.end();
     }
 
     bool UniqueCheckEnabled() const {
@@ -905,7 +973,8 @@ public:
               extenders_(),
               max_diff_len_(max_diff_len),
               max_repeat_len_(max_repeat_length),
-              detect_repeats_online_(detect_repeats_online) {
+              detect_repeats_online_(detect_repeats_online),
+              max_threads_(1) {
     }
 
     CompositeExtender(const Graph & g, GraphCoverageMap& cov_map,
@@ -913,14 +982,16 @@ public:
                       const ScaffoldingUniqueEdgeStorage& unique,
                       size_t max_diff_len,
                       size_t max_repeat_length,
-                      bool detect_repeats_online)
+                      bool detect_repeats_online,
+                      size_t max_threads = 1)
             : ContigsMaker(g),
               cover_map_(cov_map),
               repeat_detector_(g, cover_map_, 2 * max_repeat_length),
               extenders_(),
               max_diff_len_(max_diff_len),
               max_repeat_len_(max_repeat_length),
-              detect_repeats_online_(detect_repeats_online) {
+              detect_repeats_online_(detect_repeats_online),
+              max_threads_(max_threads) {
         extenders_ = pes;
         used_storage_ = make_shared<UsedUniqueStorage>(UsedUniqueStorage(unique));
         for (auto ex: extenders_) {
@@ -935,7 +1006,11 @@ public:
 
     void GrowAll(PathContainer& paths, PathContainer& result) override {
         result.clear();
-        GrowAllPaths(paths, result);
+        // Repeat detection modifies the paths grown earlier, so the seeds cannot be speculated
+        if (max_threads_ > 1 && !detect_repeats_online_)
+            GrowAllPathsParallel(paths, result);
+        else
+            GrowAllPaths(paths, result);
         LengthPathFilter filter(g_, 0);
         filter.filter(result);
     }
@@ -1015,59 +1090,192 @@ private:
     size_t max_diff_len_;
     size_t max_repeat_len_;
     bool detect_repeats_online_;
+    size_t max_threads_;
     shared_ptr<UsedUniqueStorage> used_storage_;
 
+    // Makes the record current for the thread while alive
+    class SpeculationScope {
+    public:
+        explicit SpeculationScope(GrowthRecord& record)
+                : record_(record) {
+            VERIFY(GrowthRecord::current() == nullptr);
+            GrowthRecord::current() = &record_;
+        }
+
+        ~SpeculationScope() {
+            record_.ids_used = ids_.used();
+            GrowthRecord::current() = nullptr;
+        }
+
+    private:
+        GrowthRecord& record_;
+        PathIdScope ids_;
+    };
+
+    // Edges affected by the records committed so far in the current window
+    struct WindowChanges {
+        set<EdgeId> covered;
+        set<EdgeId> used;
+        set<EdgeId> cycles;
+    };
+
     void SubscribeCoverageMap(BidirectionalPath * path) {
-        path->Subscribe(&cover_map_);
-        for (size_t i = 0; i < path->Size(); ++i) {
-            cover_map_.BackEdgeAdded(path->At(i), path, path->GapInfoAt(i));
+        cover_map_.Subscribe(path);
+    }
+
+    void ReportProgress(const PathContainer& paths, size_t i) const {
+        VERBOSE_POWER_T2(i, 100, "Processed " << i << " paths from " << paths.size() << " (" << i * 100 / paths.size() << "%)");
+        if (paths.size() > 10 && i % (paths.size() / 10 + 1) == 0) {
+            INFO("Processed " << i << " paths from " << paths.size() << " (" << i * 100 / paths.size() << "%)");
         }
     }
 
-    void GrowAllPaths(PathContainer& paths, PathContainer& result) {
-        for (size_t i = 0; i < paths.size(); ++i) {
-            VERBOSE_POWER_T2(i, 100, "Processed " << i << " paths from " << paths.size() << " (" << i * 100 / paths.size() << "%)");
-            if (paths.size() > 10 && i % (paths.size() / 10 + 1) == 0) {
-                INFO("Processed " << i << " paths from " << paths.size() << " (" << i * 100 / paths.size() << "%)");
-            }
-            //In 2015 modes do not use a seed already used in paths.
-            if (used_storage_->UniqueCheckEnabled()) {
-                bool was_used = false;
-                for (size_t ind =0; ind < paths.Get(i)->Size(); ind++) {
-                    EdgeId eid = paths.Get(i)->At(ind);
-                    if (used_storage_->IsUsedAndUnique(eid)) {
-                        DEBUG("Used edge " << g_.int_id(eid));
-                        was_used = true;
-                        break;
-                    } else {
-                        used_storage_->insert(eid);
-                    }
-                }
-                if (was_used) {
-                    DEBUG("skipping already used seed");
-                    continue;
+    // Grows the path from the i-th seed unless the seed is already covered,
+    // returns false if the seed was skipped
+    bool GrowSeed(const PathContainer& paths, size_t i, PathContainer& result) {
+        GrowthRecord *record = GrowthRecord::current();
+        //In 2015 modes do not use a seed already used in paths.
+        if (used_storage_->UniqueCheckEnabled()) {
+            bool was_used = false;
+            for (size_t ind =0; ind < paths.Get(i)->Size(); ind++) {
+                EdgeId eid = paths.Get(i)->At(ind);
+                if (used_storage_->IsUsedAndUnique(eid)) {
+                    DEBUG("Used edge " << g_.int_id(eid));
+                    was_used = true;
+                    break;
+                } else {
+                    used_storage_->insert(eid);
                 }
             }
+            if (was_used) {
+                DEBUG("skipping already used seed");
+                return false;
+            }
+        }
+
+        if (record) {
+            for (size_t ind = 0; ind < paths.Get(i)->Size(); ++ind)
+                record->covered_checked.insert(paths.Get(i)->At(ind));
+        }
+        if (cover_map_.IsCovered(*paths.Get(i)))
+            return false;
+
+        BidirectionalPath * path = new BidirectionalPath(*paths.Get(i));
+        BidirectionalPath * conjugatePath = new BidirectionalPath(*paths.GetConjugate(i));
+        result.AddPair(path, conjugatePath);
+        // Speculatively grown paths are subscribed on commit
+        if (!record) {
+            SubscribeCoverageMap(path);
+            SubscribeCoverageMap(conjugatePath);
+        }
+        size_t count_trying = 0;
+        size_t current_path_len = 0;
+        do {
+            current_path_len = path->Length();
+            count_trying++;
+            GrowPath(*path, &result);
+            GrowPath(*conjugatePath, &result);
+        } while (count_trying < 10 && (path->Length() != current_path_len));
+        path->CheckConjugateEnd(max_repeat_len_);
+        DEBUG("result path " << path->GetId());
+        path->Print();
+        return true;
+    }
+
+    void GrowAllPaths(PathContainer& paths, PathContainer& result) {
+        for (size_t i = 0; i < paths.size(); ++i) {
+            ReportProgress(paths, i);
+            GrowSeed(paths, i, result);
+        }
+    }
+
+    // Grows the seed against the current state, all the changes are kept in the record
+    std::unique_ptr<GrowthRecord> Speculate(const PathContainer& paths, size_t i) {
+        std::unique_ptr<GrowthRecord> record(new GrowthRecord());
+        {
+            SpeculationScope scope(*record);
+            record->grown = GrowSeed(paths, i, record->paths);
+        }
+        return record;
+    }
 
-            if (!cover_map_.IsCovered(*paths.Get(i))) {
-                BidirectionalPath * path = new BidirectionalPath(*paths.Get(i));
-                BidirectionalPath * conjugatePath = new BidirectionalPath(*paths.GetConjugate(i));
-                result.AddPair(path, conjugatePath);
+    static bool Intersects(const set<EdgeId>& checked, const set<EdgeId>& changed) {
+        for (EdgeId e : checked) {
+            if (changed.count(e))
+                return true;
+        }
+        return false;
+    }
+
+    // The record is outdated if it depends on the changes made by the records committed before it
+    static bool Conflicts(const GrowthRecord& record, const WindowChanges& changes) {
+        return Intersects(record.covered_checked, changes.covered) ||
+               Intersects(record.used_checked, changes.used) ||
+               Intersects(record.cycles_checked, changes.cycles);
+    }
+
+    // Applies the record as if the seed was grown right now
+    void Commit(const GrowthRecord& record, PathContainer& result, WindowChanges& changes) {
+        uint64_t first_id = BidirectionalPath::ReserveIds(record.ids_used);
+
+        for (EdgeId e : record.used_added) {
+            used_storage_->insert(e);
+            changes.used.insert(e);
+        }
+
+        for (const auto& cycle : record.cycles_added) {
+            BidirectionalPath *p = new BidirectionalPath(*cycle.second, first_id + cycle.second->GetId());
+            cycle.first->AddCycle(p);
+            for (size_t i = 0; i < p->Size(); ++i)
+                changes.cycles.insert(p->At(i));
+        }
+
+        for (size_t i = 0; i < record.paths.size(); ++i) {
+            const BidirectionalPath *p = record.paths.Get(i);
+            const BidirectionalPath *cp = record.paths.GetConjugate(i);
+            BidirectionalPath *path = new BidirectionalPath(*p, first_id + p->GetId());
+            BidirectionalPath *conjugatePath = new BidirectionalPath(*cp, first_id + cp->GetId());
+            result.AddPair(path, conjugatePath);
+            // Paths added by the extenders are not subscribed, as in GrowSeed
+            if (i == 0 && record.grown) {
                 SubscribeCoverageMap(path);
                 SubscribeCoverageMap(conjugatePath);
-                size_t count_trying = 0;
-                size_t current_path_len = 0;
-                do {
-                    current_path_len = path->Length();
-                    count_trying++;
-                    GrowPath(*path, &result);
-                    GrowPath(*conjugatePath, &result);
-                } while (count_trying < 10 && (path->Length() != current_path_len));
-                path->CheckConjugateEnd(max_repeat_len_);
-                DEBUG("result path " << path->GetId());
-                path->Print();
+                for (size_t j = 0; j < path->Size(); ++j)
+                    changes.covered.insert(path->At(j));
+                for (size_t j = 0; j < conjugatePath->Size(); ++j)
+                    changes.covered.insert(conjugatePath->At(j));
+            }
+        }
+    }
+
+    // Seeds of the window are grown speculatively in parallel, then the
+    // records are committed in the seed order. The record is regrown if a
+    // record committed before it changed anything it depends on, so the
+    // result is the same as the one of GrowAllPaths.
+    void GrowAllPathsParallel(PathContainer& paths, PathContainer& result) {
+        const size_t window = max_threads_ * 4;
+        size_t regrown = 0;
+        for (size_t start = 0; start < paths.size(); start += window) {
+            size_t end = std::min(start + window, paths.size());
+            vector<std::unique_ptr<GrowthRecord>> records(end - start);
+
+#           pragma omp parallel for num_threads(max_threads_) schedule(dynamic, 1)
+            for (size_t i = start; i < end; ++i)
+                records[i - start] = Speculate(paths, i);
+
+            WindowChanges changes;
+            for (size_t i = start; i < end; ++i) {
+                ReportProgress(paths, i);
+                std::unique_ptr<GrowthRecord>& record = records[i - start];
+                if (Conflicts(*record, changes)) {
+                    record = Speculate(paths, i);
+                    ++regrown;
+                }
+                Commit(*record, result, changes);
+                record.reset();
             }
         }
+        DEBUG(regrown << " of " << paths.size() << " seeds were regrown");
     }
 
 };
@@ -17,6 +17,12 @@
 
 #include "assembly_graph/paths/bidirectional_path.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
 namespace path_extend {
 
 using namespace debruijn_graph;
@@ -47,88 +53,285 @@ inline bool InBuble(EdgeId e, const Graph& g) {
 }
 
 
+// Paths covering an edge sorted by id (as in BidirectionalPathMultiset), the
+// path is listed once for every occurrence of the edge. Most of the edges are
+// covered by a couple of paths, such lists are stored inline.
+class CoveringPaths {
+    static const uint32_t INLINE_SIZE = 2;
+
+public:
+    typedef BidirectionalPath * const * const_iterator;
+
+    CoveringPaths()
+            : size_(0), capacity_(INLINE_SIZE) {}
+
+    ~CoveringPaths() {
+        if (!is_inline())
+            delete[] heap_;
+    }
+
+    CoveringPaths(const CoveringPaths&) = delete;
+    CoveringPaths& operator=(const CoveringPaths&) = delete;
+
+    const_iterator begin() const {
+        return data();
+    }
+
+    const_iterator end() const {
+        return data() + size_;
+    }
+
+    size_t size() const {
+        return size_;
+    }
+
+    bool empty() const {
+        return size_ == 0;
+    }
+
+    // Number of occurrences of the path
+    size_t count(BidirectionalPath *path) const {
+        auto range = std::equal_range(begin(), end(), path, PathComparator());
+        return size_t(range.second - range.first);
+    }
+
+    void insert(BidirectionalPath *path) {
+        if (size_ == capacity_)
+            Grow();
+        BidirectionalPath **first = data(), **last = first + size_;
+        BidirectionalPath **pos = std::upper_bound(first, last, path, PathComparator());
+        std::copy_backward(pos, last, last + 1);
+        *pos = path;
+        ++size_;
+    }
+
+    // Removes one occurrence of the path, returns false if there is none
+    bool erase(BidirectionalPath *path) {
+        BidirectionalPath **first = data(), **last = first + size_;
+        auto range = std::equal_range(first, last, path, PathComparator());
+        BidirectionalPath **pos = std::find(range.first, range.second, path);
+        if (pos == range.second)
+            return false;
+        std::copy(pos + 1, last, pos);
+        --size_;
+        return true;
+    }
+
+private:
+    bool is_inline() const {
+        return capacity_ == INLINE_SIZE;
+    }
+
+    BidirectionalPath **data() {
+        return is_inline() ? inline_ : heap_;
+    }
+
+    BidirectionalPath * const *data() const {
+        return is_inline() ? inline_ : heap_;
+    }
+
+    void Grow() {
+        BidirectionalPath **grown = new BidirectionalPath*[2 * capacity_];
+        std::copy(data(), data() + size_, grown);
+        if (!is_inline())
+            delete[] heap_;
+        heap_ = grown;
+        capacity_ *= 2;
+    }
+
+    union {
+        BidirectionalPath *inline_[INLINE_SIZE];
+        BidirectionalPath **heap_;
+    };
+    uint32_t size_;
+    uint32_t capacity_;
+};
+
 // Handles all paths in PathContainer.
 // For each edge output all paths  that _traverse_ this path. If path contains multiple instances - count them. Position of the edge is not reported.
+//
+// Lists of the paths are stored in the array indexed by the edge id, the array
+// is split into chunks allocated on the first use. The table of the chunks
+// grows when the edges with larger ids (e.g. created after the map) show up.
+// Updates (and the queries returning copies) are thread-safe.
 class GraphCoverageMap: public PathListener {
 
 public:
-    typedef BidirectionalPathMultiset MapDataT;
-
+    typedef CoveringPaths MapDataT;
 
 private:
+    static const size_t CHUNK_BITS = 10;
+    static const size_t CHUNK_SIZE = size_t(1) << CHUNK_BITS;
+    static const size_t LOCK_COUNT = 64;
+
+    struct Chunk {
+        MapDataT paths[CHUNK_SIZE];
+    };
+
+    struct ChunkTable {
+        size_t size;
+        std::unique_ptr<std::atomic<Chunk *>[]> chunks;
+
+        explicit ChunkTable(size_t size_)
+                : size(size_), chunks(new std::atomic<Chunk *>[size_]) {
+            for (size_t i = 0; i < size; ++i)
+                chunks[i].store(nullptr, std::memory_order_relaxed);
+        }
+    };
+
     const Graph& g_;
 
-    std::unordered_map <EdgeId, MapDataT * > edge_coverage_;
+    std::atomic<ChunkTable *> table_;
+    // All the tables ever used, the outgrown ones might still be read concurrently
+    std::vector<std::unique_ptr<ChunkTable>> tables_;
+    // Guards the growth of the table and the allocation of the chunks
+    std::mutex table_lock_;
+    mutable std::mutex locks_[LOCK_COUNT];
+    std::atomic<size_t> covered_;
+
+    MapDataT empty_;
+
+    size_t LockIndex(EdgeId e) const {
+        return g_.int_id(e) % LOCK_COUNT;
+    }
+
+    std::mutex& LockFor(EdgeId e) const {
+        return locks_[LockIndex(e)];
+    }
+
+    const MapDataT *Find(EdgeId e) const {
+        size_t id = g_.int_id(e);
+        const ChunkTable *table = table_.load(std::memory_order_acquire);
+        if ((id >> CHUNK_BITS) >= table->size)
+            return nullptr;
+        Chunk *chunk = table->chunks[id >> CHUNK_BITS].load(std::memory_order_acquire);
+        return chunk ? &chunk->paths[id & (CHUNK_SIZE - 1)] : nullptr;
+    }
+
+    MapDataT& Get(EdgeId e) {
+        size_t id = g_.int_id(e);
+        size_t idx = id >> CHUNK_BITS;
+        ChunkTable *table = table_.load(std::memory_order_acquire);
+        Chunk *chunk = idx < table->size ? table->chunks[idx].load(std::memory_order_acquire) : nullptr;
+        if (!chunk) {
+            std::lock_guard<std::mutex> lock(table_lock_);
+            table = table_.load(std::memory_order_relaxed);
+            if (idx >= table->size)
+                table = Grow(idx + 1);
+            chunk = table->chunks[idx].load(std::memory_order_relaxed);
+            if (!chunk) {
+                chunk = new Chunk();
+                table->chunks[idx].store(chunk, std::memory_order_release);
+            }
+        }
+        return chunk->paths[id & (CHUNK_SIZE - 1)];
+    }
 
-    MapDataT * empty_;
+    // Must be called under the table lock
+    ChunkTable *Grow(size_t min_size) {
+        const ChunkTable &old = *tables_.back();
+        ChunkTable *table = new ChunkTable(std::max(min_size, 2 * old.size));
+        for (size_t i = 0; i < old.size; ++i)
+            table->chunks[i].store(old.chunks[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        tables_.emplace_back(table);
+        table_.store(table, std::memory_order_release);
+        return table;
+    }
 
-    virtual void EdgeAdded(EdgeId e, BidirectionalPath * path, Gap /*gap*/) {
-        auto iter = edge_coverage_.find(e);
-        if (iter == edge_coverage_.end()) {
-            edge_coverage_.insert(std::make_pair(e, new MapDataT()));
+    // Must be called under the stripe lock of the edge
+    void Insert(MapDataT& paths, BidirectionalPath * path) {
+        if (paths.empty())
+            ++covered_;
+        paths.insert(path);
+    }
+
+    // Must be called under the stripe lock of the edge
+    void Erase(MapDataT& paths, BidirectionalPath * path) {
+        if (!paths.erase(path)) {
+            DEBUG("Error erasing path from coverage map");
+        } else if (paths.empty()) {
+            --covered_;
         }
-        edge_coverage_[e]->insert(path);
     }
 
-    virtual void EdgeRemoved(EdgeId e, BidirectionalPath * path) {
-        auto iter = edge_coverage_.find(e);
-        if (iter != edge_coverage_.end()) {
-            if (iter->second->count(path) == 0) {
-                DEBUG("Error erasing path from coverage map");
-            } else {
-                auto entry = iter->second->find(path);
-                iter->second->erase(entry);
-            }
+    // Applies f to the lists of the edges taking every stripe lock once
+    template<class F>
+    void UpdateByStripes(const std::vector<EdgeId>& edges, F f) {
+        std::vector<std::pair<size_t, MapDataT*>> updates;
+        updates.reserve(edges.size());
+        for (EdgeId e : edges)
+            updates.push_back(std::make_pair(LockIndex(e), &Get(e)));
+        std::stable_sort(updates.begin(), updates.end(),
+                         [](const std::pair<size_t, MapDataT*>& a, const std::pair<size_t, MapDataT*>& b) {
+                             return a.first < b.first;
+                         });
+        for (size_t i = 0; i < updates.size(); ) {
+            size_t lock_idx = updates[i].first;
+            std::lock_guard<std::mutex> lock(locks_[lock_idx]);
+            for (; i < updates.size() && updates[i].first == lock_idx; ++i)
+                f(*updates[i].second);
         }
     }
 
-    size_t EdgeCount() const {
-        size_t result = 0;
-        for (auto e = g_.ConstEdgeBegin(); !e.IsEnd(); ++e) {
-            ++result;
+    virtual void EdgeAdded(EdgeId e, BidirectionalPath * path, Gap /*gap*/) {
+        MapDataT& paths = Get(e);
+        std::lock_guard<std::mutex> lock(LockFor(e));
+        Insert(paths, path);
+    }
+
+    virtual void EdgeRemoved(EdgeId e, BidirectionalPath * path) {
+        MapDataT& paths = Get(e);
+        std::lock_guard<std::mutex> lock(LockFor(e));
+        Erase(paths, path);
+    }
+
+    // Registers all the edges of the path at once
+    void PathAdded(BidirectionalPath * path) {
+        std::vector<EdgeId> edges;
+        std::vector<Gap> gaps;
+        edges.reserve(path->Size());
+        gaps.reserve(path->Size());
+        for (size_t i = 0; i < path->Size(); ++i) {
+            edges.push_back(path->At(i));
+            gaps.push_back(path->GapInfoAt(i));
         }
-        return result;
+        BackEdgesAdded(edges, gaps, path);
     }
 
 public:
-    GraphCoverageMap(const Graph& g) : g_(g), edge_coverage_() {
-        empty_ = new MapDataT();
-        edge_coverage_.reserve(EdgeCount());
+    GraphCoverageMap(const Graph& g)
+            : g_(g),
+              covered_(0) {
+        tables_.emplace_back(new ChunkTable((g.GetGraphIdDistributor().GetMax() >> CHUNK_BITS) + 1));
+        table_.store(tables_.back().get(), std::memory_order_relaxed);
     }
 
-    GraphCoverageMap(const Graph& g, const PathContainer& paths, bool subscribe = false) : g_(g), edge_coverage_() {
-        empty_ = new MapDataT();
-        edge_coverage_.reserve(EdgeCount());
+    GraphCoverageMap(const Graph& g, const PathContainer& paths, bool subscribe = false)
+            : GraphCoverageMap(g) {
         AddPaths(paths, subscribe);
     }
 
     virtual ~GraphCoverageMap() {
-        delete empty_;
-        for (auto iter = edge_coverage_.begin(); iter != edge_coverage_.end(); ++iter) {
-            delete iter->second;
-        }
+        // The current table holds all the chunks
+        const ChunkTable &table = *tables_.back();
+        for (size_t i = 0; i < table.size; ++i)
+            delete table.chunks[i].load(std::memory_order_relaxed);
     }
 
     void AddPaths(const PathContainer& paths, bool subscribe = false) {
         for (size_t i = 0; i < paths.size(); ++i) {
             if (subscribe)
                 paths.Get(i)->Subscribe(this);
-            for (size_t j = 0; j < paths.Get(i)->Size(); ++j) {
-                EdgeAdded(paths.Get(i)->At(j), paths.Get(i), paths.Get(i)->GapAt(j));
-            }
+            PathAdded(paths.Get(i));
             if (subscribe)
                 paths.GetConjugate(i)->Subscribe(this);
-            for (size_t j = 0; j < paths.GetConjugate(i)->Size(); ++j) {
-                EdgeAdded(paths.GetConjugate(i)->At(j), paths.GetConjugate(i), paths.GetConjugate(i)->GapAt(j));
-            }
+            PathAdded(paths.GetConjugate(i));
         }
     }
 
     void Subscribe(BidirectionalPath * path) {
         path->Subscribe(this);
-        for (size_t i = 0; i < path->Size(); ++i) {
-            BackEdgeAdded(path->At(i), path, path->GapAt(i));
-        }
+        PathAdded(path);
     }
 
     //Inherited from PathListener
@@ -151,16 +354,29 @@ public:
         EdgeRemoved(e, path);
     }
 
-    MapDataT * GetEdgePaths(EdgeId e) const {
-        auto iter = edge_coverage_.find(e);
-        if (iter != edge_coverage_.end()) {
-            return iter->second;
-        }
-        return empty_;
+    //Inherited from PathListener
+    void BackEdgesAdded(const std::vector<EdgeId>& edges, const std::vector<Gap>& /*gaps*/,
+                        BidirectionalPath * path) override {
+        UpdateByStripes(edges, [&](MapDataT& paths) { Insert(paths, path); });
+    }
+
+    //Inherited from PathListener
+    void BackEdgesRemoved(const std::vector<EdgeId>& edges, BidirectionalPath * path) override {
+        UpdateByStripes(edges, [&](MapDataT& paths) { Erase(paths, path); });
+    }
+
+    // Not synchronized with the concurrent updates of the edge
+    const MapDataT * GetEdgePaths(EdgeId e) const {
+        const MapDataT *paths = Find(e);
+        return paths ? paths : &empty_;
     }
 
     int GetCoverage(EdgeId e) const {
-        return (int) GetEdgePaths(e)->size();
+        const MapDataT *paths = Find(e);
+        if (!paths)
+            return 0;
+        std::lock_guard<std::mutex> lock(LockFor(e));
+        return (int) paths->size();
     }
 
     bool IsCovered(EdgeId e) const {
@@ -177,16 +393,11 @@ public:
     }
 
     BidirectionalPathSet GetCoveringPaths(EdgeId e) const {
-        auto mapData = GetEdgePaths(e);
-        return BidirectionalPathSet(mapData->begin(), mapData->end());
-    }
-
-    std::unordered_map <EdgeId, MapDataT * >::const_iterator begin() const {
-        return edge_coverage_.begin();
-    }
-
-    std::unordered_map <EdgeId, MapDataT * >::const_iterator end() const {
-        return edge_coverage_.end();
+        const MapDataT *paths = Find(e);
+        if (!paths)
+            return BidirectionalPathSet();
+        std::lock_guard<std::mutex> lock(LockFor(e));
+        return BidirectionalPathSet(paths->begin(), paths->end());
     }
 
     // DEBUG output
@@ -216,8 +427,9 @@ public:
         }
     }
 
+    // Number of the covered edges
     size_t size() const {
-        return edge_coverage_.size();
+        return covered_;
     }
 
     const Graph& graph() const {
@@ -225,7 +437,7 @@ public:
     }
 
 private:
-    GraphCoverageMap(const GraphCoverageMap& t) : g_(t.g_), empty_(t.empty_) {}
+    GraphCoverageMap(const GraphCoverageMap&) = delete;
 };
 
 inline bool GetLoopAndExit(const Graph& g, EdgeId e, pair<EdgeId, EdgeId>& result) {
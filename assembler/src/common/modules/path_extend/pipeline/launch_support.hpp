@@ -42,7 +42,8 @@ struct PathExtendParamsContainer {
                               config::pipeline_type mode_,
                               bool uneven_depth_,
                               bool avoid_rc_connections_,
-                              bool use_scaffolder_):
+                              bool use_scaffolder_,
+                              size_t max_threads_ = 1):
         pe_cfg(pe_cfg_),
         pset(pe_cfg_.param_set),
         output_dir(output_dir_),
@@ -52,7 +53,8 @@ struct PathExtendParamsContainer {
         avoid_rc_connections(avoid_rc_connections_),
         use_scaffolder(use_scaffolder_),
         traverse_loops(true),
-        detect_repeats_online(mode_ != config::pipeline_type::meta && mode_ != config::pipeline_type::rna)
+        detect_repeats_online(mode_ != config::pipeline_type::meta && mode_ != config::pipeline_type::rna),
+        max_threads(max_threads_)
     {
         if (!(use_scaffolder && pset.scaffolder_options.enabled)) {
             traverse_loops = false;
@@ -83,6 +85,7 @@ struct PathExtendParamsContainer {
     bool use_scaffolder;
     bool traverse_loops;
     bool detect_repeats_online;
+    size_t max_threads;
 
     size_t min_edge_len;
     size_t max_path_diff;
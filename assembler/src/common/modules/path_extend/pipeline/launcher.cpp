@@ -420,7 +420,8 @@ void PathExtendLauncher::Launch() {
                                                                                       unique_data_.main_unique_storage_,
                                                                                       params_.max_path_diff,
                                                                                       params_.pset.extension_options.max_repeat_length,
-                                                                                      params_.detect_repeats_online);
+                                                                                      params_.detect_repeats_online,
+                                                                                      params_.max_threads);
 
     auto paths = resolver.ExtendSeeds(seeds, *composite_extender);
     paths.FilterEmptyPaths();
@@ -8,6 +8,7 @@
 #include "common/assembly_graph/graph_support/basic_edge_conditions.hpp"
 #include <map>
 #include <set>
+#include <mutex>
 
 
 namespace path_extend {
@@ -132,6 +133,7 @@ protected:
     size_t max_connection_length_;
     set<EdgeId> interesting_edge_set_;
     mutable map<EdgeId, map<EdgeId, double>> stored_distances_;
+    mutable std::mutex stored_distances_mutex_;
 public:
     AssemblyGraphConnectionCondition(const Graph &g, size_t max_connection_length,
                                      const ScaffoldingUniqueEdgeStorage& unique_edges);
@@ -119,7 +119,7 @@ class BulgeGluer {
     BulgeCallbackF opt_callback_;
     std::function<void(EdgeId)> removal_handler_;
 
-    void InnerProcessBulge(EdgeId edge, const vector<EdgeId>& path) {
+    void InnerProcessBulge(EdgeId edge, const vector<EdgeId>& path, restricted::IdDistributor& id_distributor) {
 
         EnsureEndsPositionAligner aligner(CumulativeLength(g_, path),
                 g_.length(edge));
@@ -151,16 +151,17 @@ class BulgeGluer {
 
                     pair<EdgeId, EdgeId> split_result = g_.SplitEdge(
                             edge_to_split,
-                            bulge_prefix_lengths[i] - prev_length);
+                            bulge_prefix_lengths[i] - prev_length,
+                            id_distributor);
 
                     edge_to_split = split_result.second;
 
                     TRACE("GlueEdges " << g_.str(split_result.first));
-                    g_.GlueEdges(split_result.first, path[i]);
+                    g_.GlueEdges(split_result.first, path[i], id_distributor);
 
                 } else {
                     TRACE("GlueEdges " << g_.str(edge_to_split));
-                    g_.GlueEdges(edge_to_split, path[i]);
+                    g_.GlueEdges(edge_to_split, path[i], id_distributor);
                 }
             }
             prev_length = bulge_prefix_lengths[i];
@@ -177,19 +178,27 @@ public:
 
     }
 
-    void operator()(EdgeId edge, const vector<EdgeId>& path) {
+    //Upper bound on the number of ids taken by Glue: every path edge leads to at most one split
+    //(vertex and two edges) and one glue (edge), each element takes the ids for itself and its conjugate
+    static size_t MaxIdCount(const vector<EdgeId>& path) {
+        return 8 * path.size();
+    }
+
+    void RunCallbacks(EdgeId edge, const vector<EdgeId>& path) {
         if (opt_callback_)
             opt_callback_(edge, path);
 
         if (removal_handler_)
             removal_handler_(edge);
+    }
 
-        VertexId start = g_.EdgeStart(edge);
-        VertexId end = g_.EdgeEnd(edge);
-
+    //Modifies only the ends of the edge and the vertices of the path, see ObservableGraph::BeginConcurrentModification
+    void Glue(EdgeId edge, const vector<EdgeId>& path, restricted::IdDistributor& id_distributor) {
         TRACE("Projecting edge " << g_.str(edge));
-        InnerProcessBulge(edge, path);
+        InnerProcessBulge(edge, path, id_distributor);
+    }
 
+    void CompressEnds(VertexId start, VertexId end) {
         TRACE("Compressing start vertex " << g_.str(start));
         g_.CompressVertex(start);
 
@@ -197,6 +206,16 @@ public:
         g_.CompressVertex(end);
     }
 
+    void operator()(EdgeId edge, const vector<EdgeId>& path) {
+        RunCallbacks(edge, path);
+
+        VertexId start = g_.EdgeStart(edge);
+        VertexId end = g_.EdgeEnd(edge);
+
+        Glue(edge, path, g_.GetGraphIdDistributor());
+        CompressEnds(start, end);
+    }
+
 };
 
 template<class Graph>
@@ -366,6 +385,16 @@ private:
     DECL_LOGGER("BulgeRemover")
 };
 
+/**
+ * Bulge remover working in rounds. Edges of similar coverage are taken into the buffer in the coverage order,
+ * their alternatives are searched in parallel on the unmodified graph. Then the bulges with disjoint vertex
+ * footprints are glued in the coverage order and the interacting ones are returned to the queue
+ * to be considered in the next round, so the result is the same as of the sequential BulgeRemover
+ * up to the order of processing of independent bulges.
+ * Independent bulges are glued concurrently (see ObservableGraph::BeginConcurrentModification), the handlers
+ * which are not thread safe get the events one at a time. Compression of the bulge ends merges the edges
+ * outside of the footprints, so it is done afterwards in the coverage order.
+ */
 template<class Graph>
 class ParallelBulgeRemover : public PersistentAlgorithmBase<Graph> {
 private:
@@ -373,6 +402,7 @@ private:
     typedef typename Graph::VertexId VertexId;
     typedef std::shared_ptr<InterestingElementFinder<Graph, EdgeId>> CandidateFinderPtr;
     typedef SmartSetIterator<Graph, EdgeId, CoverageComparator<Graph>> SmartEdgeSet;
+    typedef SmartHeapIterator<Graph, EdgeId, CoverageComparator<Graph>> SmartEdgeHeap;
 
     size_t buff_size_;
     double buff_cov_diff_;
@@ -385,7 +415,7 @@ private:
 
     size_t curr_iteration_;
 
-    SmartEdgeSet it_;
+    SmartEdgeHeap it_;
 
     static vector<EdgeId> EmptyPath() {
         static vector<EdgeId> vec = {};
@@ -438,27 +468,30 @@ private:
 
     };
 
-    bool CheckInteracting(const BulgeInfo& info, const std::unordered_set<EdgeId>& involved_edges) const {
-        if (involved_edges.count(info.e))
-            return true;
-        for (EdgeId e : info.alternative)
-            if (involved_edges.count(e))
-                return true;
-        return false;
+    //Vertices touched by the gluing: the ends of the edge and all the vertices of the alternative.
+    //Compression of the ends can only merge the edges incident to them,
+    //so the bulges with disjoint footprints do not affect each other
+    std::vector<VertexId> Footprint(const BulgeInfo& info) const {
+        std::vector<VertexId> answer;
+        answer.push_back(this->g().EdgeStart(info.e));
+        for (EdgeId e : info.alternative) {
+            answer.push_back(this->g().EdgeEnd(e));
+        }
+        return answer;
     }
 
-    void AccountEdge(EdgeId e, std::unordered_set<EdgeId>& involved_edges) const {
-        TRACE("Pushing edge " << this->g().str(e));
-        involved_edges.insert(e);
-        EdgeId conj = this->g().conjugate(e);
-        TRACE("Pushing edge " << this->g().str(conj));
-        involved_edges.insert(conj);
+    bool CheckInteracting(const BulgeInfo& info, const std::unordered_set<VertexId>& involved_vertices) const {
+        for (VertexId v : Footprint(info))
+            if (involved_vertices.count(v))
+                return true;
+        return false;
     }
 
-    void AccountEdges(const BulgeInfo& info, std::unordered_set<EdgeId>& involved_edges) const {
-        AccountEdge(info.e, involved_edges);
-        for (EdgeId e : info.alternative) {
-            AccountEdge(e, involved_edges);
+    void AccountVertices(const BulgeInfo& info, std::unordered_set<VertexId>& involved_vertices) const {
+        for (VertexId v : Footprint(info)) {
+            TRACE("Pushing vertex " << this->g().str(v));
+            involved_vertices.insert(v);
+            involved_vertices.insert(this->g().conjugate(v));
         }
     }
 
@@ -549,18 +582,17 @@ private:
 
         std::vector<BulgeInfo> filtered;
         filtered.reserve(bulges.size());
-        //fixme switch to involved vertices to bring fully parallel glueing closer
-        std::unordered_set<EdgeId> involved_edges;
+        std::unordered_set<VertexId> involved_vertices;
         SmartEdgeSet interacting_edges(this->g(), false, CoverageComparator<Graph>(this->g()));
 
         for (BulgeInfo& info : bulges) {
             TRACE("Analyzing interactions of " << info.str(this->g()));
-            if (CheckInteracting(info, involved_edges)) {
+            if (CheckInteracting(info, involved_vertices)) {
                 TRACE("Interacting");
                 interacting_edges.push(info.e);
             } else {
                 TRACE("Independent");
-                AccountEdges(info, involved_edges);
+                AccountVertices(info, involved_vertices);
                 filtered.push_back(std::move(info));
             }
         }
@@ -578,29 +610,42 @@ private:
         DEBUG("Processing bulges");
         perf_counter perf;
 
-        size_t triggered = 0;
-
+        size_t triggered = independent_bulges.size();
+        std::vector<std::pair<VertexId, VertexId>> ends;
+        ends.reserve(triggered);
+        //every bulge takes its own segment of the reserved ids
+        std::vector<size_t> id_offsets(1, 0);
+        id_offsets.reserve(triggered + 1);
         for (const BulgeInfo& info : independent_bulges) {
             TRACE("Processing bulge " << info.str(this->g()));
-            triggered++;
-            gluer_(info.e, info.alternative);
+            gluer_.RunCallbacks(info.e, info.alternative);
+            ends.push_back(std::make_pair(this->g().EdgeStart(info.e), this->g().EdgeEnd(info.e)));
+            id_offsets.push_back(id_offsets.back() + BulgeGluer<Graph>::MaxIdCount(info.alternative));
         }
 
+        if (triggered > 0) {
+            restricted::IdSegmentStorage segment_storage = this->g().GetGraphIdDistributor().Reserve(id_offsets.back());
+            ConcurrentModificationScope<Graph> scope(this->g());
+            #pragma omp parallel for schedule(guided)
+            for (size_t i = 0; i < triggered; ++i) {
+                auto id_distributor = segment_storage.GetSegmentIdDistributor(id_offsets[i], id_offsets[i + 1]);
+                gluer_.Glue(independent_bulges[i].e, independent_bulges[i].alternative, id_distributor);
+            }
+        }
         DEBUG("Independent bulges glued in " << perf.time() << " seconds");
-        perf.reset();
 
-        DEBUG("Processing remaining interacting bulges " << interacting_edges.size());
-        //usual br strategy
+        for (const auto& bulge_ends : ends)
+            gluer_.CompressEnds(bulge_ends.first, bulge_ends.second);
+        DEBUG("Bulge ends compressed in " << perf.time() << " seconds");
+
+        //interacting bulges are deferred to the next round, their alternatives are searched again
+        //(in parallel) on the updated graph. Edges removed by the gluing are already gone from the set.
+        DEBUG("Deferring remaining interacting bulges " << interacting_edges.size());
+        std::vector<EdgeId> deferred;
         for (; !interacting_edges.IsEnd(); ++interacting_edges) {
-            EdgeId e = *interacting_edges;
-            TRACE("Processing edge " << this->g().str(e));
-            std::vector<EdgeId> alternative = alternatives_analyzer_(e);
-            if (!alternative.empty()) {
-                gluer_(e, alternative);
-                triggered++;
-            }
+            deferred.push_back(*interacting_edges);
         }
-        DEBUG("Interacting edges processed in " << perf.time() << " seconds");
+        it_.insert(deferred.begin(), deferred.end());
         return triggered;
     }
 
@@ -641,7 +686,10 @@ public:
             it_.clear();
             TRACE("Primary launch.");
             TRACE("Start search for interesting edges");
-            interesting_edge_finder_->Run(this->g(), [&](EdgeId e) {it_.push(e);});
+            std::vector<EdgeId> candidates;
+            interesting_edge_finder_->Run(this->g(), [&](EdgeId e) {candidates.push_back(e);});
+            //heap is built at once
+            it_.insert(candidates.begin(), candidates.end());
             TRACE(it_.size() << " interesting edges to process");
         } else {
             VERIFY(tracking_);
@@ -804,6 +804,7 @@ bool RunEdgeAlgorithm(Graph& g, AlgoRunner& runner, Algo& algo, size_t chunk_cnt
 template<class Graph>
 void ParallelCompress(Graph &g, size_t chunk_cnt, bool loop_post_compression = true) {
     INFO("Parallel compression");
+    omnigraph::GraphEventBatchScope<Graph> batch(g);
     debruijn::simplification::ParallelCompressor<Graph> compressor(g);
     TwoStepAlgorithmRunner<Graph, typename Graph::VertexId> runner(g, false);
     RunVertexAlgorithm(g, runner, compressor, chunk_cnt);
@@ -824,6 +825,7 @@ bool ParallelClipTips(Graph &g,
                       size_t chunk_cnt,
                       omnigraph::EdgeRemovalHandlerF<Graph> removal_handler = nullptr) {
     INFO("Parallel tip clipping");
+    omnigraph::GraphEventBatchScope<Graph> batch(g);
 
     debruijn::simplification::ParallelTipClippingFunctor<Graph> tip_clipper(g,
                                                                             max_length, max_coverage, removal_handler);
@@ -874,6 +876,7 @@ bool ParallelEC(Graph &g,
                 size_t chunk_cnt,
                 omnigraph::EdgeRemovalHandlerF<Graph> removal_handler = nullptr) {
     INFO("Parallel ec remover");
+    omnigraph::GraphEventBatchScope<Graph> batch(g);
 
     debruijn::simplification::CriticalEdgeMarker<Graph> critical_marker(g, chunk_cnt);
     critical_marker.PutMarks();
@@ -12,6 +12,7 @@
 #include "utils/openmp_wrapper.h"
 
 #include "paired_info.hpp"
+#include "assembly_graph/core/graph_snapshot.hpp"
 #include "assembly_graph/paths/path_processor.hpp"
 #include "paired_info/pair_info_bounds.hpp"
 
@@ -181,9 +182,10 @@ public:
         const auto &index = this->index();
 
         DEBUG("Collecting edge infos");
-        std::vector<EdgeId> edges;
-        for (auto it = this->graph().ConstEdgeBegin(); !it.IsEnd(); ++it)
-            edges.push_back(*it);
+        // Edges of the snapshot are grouped by their start vertices, so
+        // neighbouring iterations touch neighbouring parts of the graph
+        GraphSnapshot<Graph> snapshot(this->graph(), nthreads);
+        const std::vector<EdgeId> &edges = snapshot.edges();
 
         DEBUG("Processing");
         PairedInfoBuffersT<Graph> buffer(this->graph(), nthreads);
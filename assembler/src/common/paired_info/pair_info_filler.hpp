@@ -57,6 +57,11 @@ public:
         ProcessPairedRead(read1, read2, r.distance());
     }
 
+    //Pair info goes directly to the concurrent buffer, nothing to merge
+    bool IsMergeThreadSafe() const override {
+        return true;
+    }
+
     virtual ~LatePairedIndexFiller() {}
 
 private:
@@ -219,6 +219,7 @@ void load(debruijn_config::construction& con,
     load(con.read_buffer_size, pt, "read_buffer_size", complete);
     con.read_buffer_size *= 1024 * 1024;
     load(con.early_tc, pt, "early_tip_clipper", complete);
+    load(con.single_pass_coverage, pt, "single_pass_coverage", false);
 }
 
 void load(debruijn_config::sensitive_mapper& sensitive_map,
@@ -675,6 +676,8 @@ void load_launch_info(debruijn_config &cfg, boost::property_tree::ptree const &p
     if (cfg.load_from[0] != '/') { // relative path
         cfg.load_from = cfg.output_dir + cfg.load_from;
     }
+    load(cfg.binary_saves, pt, "binary_saves", false);
+    load(cfg.telemetry_trace, pt, "telemetry_trace", false);
 
     load(cfg.tmp_dir, pt, "tmp_dir");
     load(cfg.main_iteration, pt, "main_iteration");
@@ -365,10 +365,12 @@ struct debruijn_config {
         early_tip_clipper early_tc;
         bool keep_perfect_loops;
         size_t read_buffer_size;
+        bool single_pass_coverage;
         construction() :
                 con_mode(construction_mode::extention),
                 keep_perfect_loops(true),
-                read_buffer_size(0) {}
+                read_buffer_size(0),
+                single_pass_coverage(false) {}
     };
 
     simplification simp;
@@ -533,6 +535,10 @@ struct debruijn_config {
     boost::optional<scaffold_correction> sc_cor;
     truseq_analysis tsa;
     std::string load_from;
+    // Save the graph pack of the stages as binary checkpoints rather than text
+    bool binary_saves;
+    // Write the Chrome trace-event timeline next to the telemetry report
+    bool telemetry_trace;
 
     std::string entry_point;
 
@@ -591,6 +597,8 @@ struct debruijn_config {
     bool need_mapping;
 
     debruijn_config() :
+            binary_saves(false),
+            telemetry_trace(false),
             use_single_reads(false) {
 
     }
@@ -21,10 +21,16 @@
 
 #include "assembly_graph/core/order_and_law.hpp"
 
+#include "io/kmers/mmapped_reader.hpp"
+#include "io/kmers/mmapped_writer.hpp"
+#include "utils/openmp_wrapper.h"
+
 #include <cmath>
 #include <set>
 #include <map>
 #include <algorithm>
+#include <numeric>
+#include <type_traits>
 #include <fstream>
 #include <cstdio>
 
@@ -153,6 +159,170 @@ inline void DeserializePoint(FILE* file, size_t& e1, size_t& e2, Point &p) {
     VERIFY(read_count == 5);
 }
 
+inline float PointVariance(const RawPoint &) {
+    return 0;
+}
+
+inline float PointVariance(const Point &p) {
+    return p.var;
+}
+
+inline void SetPoint(RawPoint &p, float d, float weight, float /*var*/) {
+    p = RawPoint(d, weight);
+}
+
+inline void SetPoint(Point &p, float d, float weight, float var) {
+    p = Point(d, weight, var);
+}
+
+/*
+* Binary checkpoints of the graph (.bgr) and of the paired info (.bprd). The
+* text saves take too long to parse on large graphs, so the stages might save
+* the graph pack in the binary format (see PrintAll), the loaders pick the
+* format of the files found.
+*
+* Every file is an array of 8-byte words: the header is followed by the
+* columns (one value per vertex, edge, histogram or point). The edge sequences
+* are packed one after another (see Sequence::BinWrite) after the columns. The
+* files are filled in parallel through the memory mapping and loaded via mmap,
+* so the loaded edge sequences refer to the mapped file.
+*/
+
+struct BinaryGraphHeader {
+    static const uint64_t MAGIC = 0x4850524753415053ULL; // "SPASGRPH"
+    static const uint64_t VERSION = 1;
+
+    uint64_t magic;
+    uint64_t version;
+    uint64_t k;
+    uint64_t max_id;
+    uint64_t vertex_count;
+    uint64_t edge_count;
+    uint64_t nucls_size; // in words
+
+    // The header is copied to and from the mapped file as is, so it stays
+    // trivial and is created here rather than by a constructor
+    static BinaryGraphHeader Create() {
+        BinaryGraphHeader h = BinaryGraphHeader();
+        h.magic = MAGIC;
+        h.version = VERSION;
+        return h;
+    }
+};
+static_assert(std::is_trivial<BinaryGraphHeader>::value, "Binary graph header must be trivial");
+
+// Positions (in words) of the columns of the graph file
+struct BinaryGraphLayout {
+    size_t vertex_ids, vertex_conjs;
+    size_t edge_ids, edge_starts, edge_ends, edge_conjs, edge_coverage, edge_nucls;
+    size_t nucls;
+    size_t size;
+
+    explicit BinaryGraphLayout(const BinaryGraphHeader &h) {
+        vertex_ids = sizeof(BinaryGraphHeader) / sizeof(uint64_t);
+        vertex_conjs = vertex_ids + h.vertex_count;
+        edge_ids = vertex_conjs + h.vertex_count;
+        edge_starts = edge_ids + h.edge_count;
+        edge_ends = edge_starts + h.edge_count;
+        edge_conjs = edge_ends + h.edge_count;
+        edge_coverage = edge_conjs + h.edge_count;
+        edge_nucls = edge_coverage + h.edge_count;
+        nucls = edge_nucls + h.edge_count;
+        size = nucls + h.nucls_size;
+    }
+};
+
+struct BinaryPairedHeader {
+    static const uint64_t MAGIC = 0x5249415053415053ULL; // "SPASPAIR"
+    static const uint64_t VERSION = 1;
+
+    uint64_t magic;
+    uint64_t version;
+    uint64_t hist_count;
+    uint64_t point_count;
+
+    static BinaryPairedHeader Create() {
+        BinaryPairedHeader h = BinaryPairedHeader();
+        h.magic = MAGIC;
+        h.version = VERSION;
+        return h;
+    }
+};
+static_assert(std::is_trivial<BinaryPairedHeader>::value, "Binary paired header must be trivial");
+
+// Positions (in words) of the columns of the paired info file. Histogram i
+// consists of the points [hist_points[i], hist_points[i + 1]), the point
+// columns are arrays of floats.
+struct BinaryPairedLayout {
+    size_t hist_e1, hist_e2, hist_points;
+    size_t point_d, point_weight, point_var;
+    size_t size;
+
+    explicit BinaryPairedLayout(const BinaryPairedHeader &h) {
+        size_t float_words = (h.point_count * sizeof(float) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+        hist_e1 = sizeof(BinaryPairedHeader) / sizeof(uint64_t);
+        hist_e2 = hist_e1 + h.hist_count;
+        hist_points = hist_e2 + h.hist_count;
+        point_d = hist_points + h.hist_count + 1;
+        point_weight = point_d + float_words;
+        point_var = point_weight + float_words;
+        size = point_var + float_words;
+    }
+};
+
+/**
+* Writes the binary checkpoint file of the given size (in words) through the
+* memory mapping, so its parts might be filled in parallel. The data goes to
+* the temporary file replacing the target one on Commit(): the target might be
+* still mapped by the graph loaded from it and must not be rewritten in place.
+*/
+class BinaryCheckpointWriter {
+  public:
+    BinaryCheckpointWriter(const string& file_name, size_t size)
+            : file_name_(file_name), writer_(file_name + ".tmp") {
+        writer_.reserve(size);
+    }
+
+    uint64_t *data() {
+        return writer_.data();
+    }
+
+    void Commit() {
+        std::string tmp_name = file_name_ + ".tmp";
+        VERIFY_MSG(::rename(tmp_name.c_str(), file_name_.c_str()) == 0,
+                   "rename(2) failed for " << tmp_name << ". Reason: " << strerror(errno) << ". Error code: " << errno);
+    }
+
+  private:
+    std::string file_name_;
+    MMappedRecordWriter<uint64_t> writer_;
+};
+
+/**
+* Memory-mapped binary checkpoint file. The objects referring to the mapped
+* data keep the mapping alive via owner().
+*/
+template<class Header>
+class BinaryCheckpointReader {
+  public:
+    explicit BinaryCheckpointReader(const string& file_name)
+            : reader_(std::make_shared<MMappedRecordReader<uint64_t>>(file_name, /*unlink*/false, -1ULL)) {
+        VERIFY_MSG(reader_->data_size() >= sizeof(Header), "Binary checkpoint " << file_name << " is truncated");
+        memcpy(&header_, reader_->data(), sizeof(header_));
+        VERIFY_MSG(header_.magic == Header::MAGIC && header_.version == Header::VERSION,
+                   "Binary checkpoint " << file_name << " has unsupported format");
+    }
+
+    const Header& header() const { return header_; }
+    const uint64_t *data() const { return reader_->data(); }
+    size_t size() const { return reader_->size(); }
+    std::shared_ptr<const void> owner() const { return reader_; }
+
+  private:
+    std::shared_ptr<MMappedRecordReader<uint64_t>> reader_;
+    Header header_;
+};
+
 
 template<class Graph>
 class DataPrinter {
@@ -192,6 +362,8 @@ class DataPrinter {
   public:
 
     void SaveGraph(const string& file_name) const {
+        // Otherwise the stale binary checkpoint would be loaded instead
+        ::unlink((file_name + ".bgr").c_str());
         FILE* gid_file = fopen((file_name + ".gid").c_str(), "w");
         size_t max_id = this->component().g().GetGraphIdDistributor().GetMax();
         fprintf(gid_file, "%zu\n", max_id);
@@ -244,6 +416,7 @@ class DataPrinter {
     template<class Index>
     void SavePaired(const string& file_name,
                     Index const& paired_index) const {
+        ::unlink((file_name + ".bprd").c_str());
         FILE* file = fopen((file_name + ".prd").c_str(), "w");
         DEBUG("Saving paired info, " << file_name <<" created");
         VERIFY(file != NULL);
@@ -277,6 +450,115 @@ class DataPrinter {
         fclose(file);
     }
 
+    // Saves the graph along with the edge sequences and the coverage as the
+    // binary checkpoint (see BinaryGraphHeader)
+    void SaveGraphBinary(const string& file_name) const {
+        const Graph& g = component_.g();
+        std::vector<VertexId> vertices(component_.v_begin(), component_.v_end());
+        std::vector<EdgeId> edges(component_.e_begin(), component_.e_end());
+        DEBUG("Binary graph saving to " << file_name << " started");
+        ::unlink((file_name + ".grp").c_str());
+
+        // Packed sequences go one after another, so that their positions are
+        // known beforehand and the edges might be written independently
+        std::vector<uint64_t> nucls_pos(edges.size() + 1, 0);
+        for (size_t i = 0; i < edges.size(); ++i)
+            nucls_pos[i + 1] = nucls_pos[i] + g.EdgeNucls(edges[i]).BinSize() / sizeof(uint64_t);
+
+        BinaryGraphHeader header = BinaryGraphHeader::Create();
+        header.k = g.k();
+        header.max_id = g.GetGraphIdDistributor().GetMax();
+        header.vertex_count = vertices.size();
+        header.edge_count = edges.size();
+        header.nucls_size = nucls_pos.back();
+        BinaryGraphLayout layout(header);
+
+        BinaryCheckpointWriter writer(file_name + ".bgr", layout.size);
+        uint64_t *data = writer.data();
+        memcpy(data, &header, sizeof(header));
+
+#       pragma omp parallel for schedule(guided)
+        for (size_t i = 0; i < vertices.size(); ++i) {
+            data[layout.vertex_ids + i] = vertices[i].int_id();
+            data[layout.vertex_conjs + i] = g.conjugate(vertices[i]).int_id();
+        }
+
+#       pragma omp parallel for schedule(guided)
+        for (size_t i = 0; i < edges.size(); ++i) {
+            EdgeId e = edges[i];
+            data[layout.edge_ids + i] = e.int_id();
+            data[layout.edge_starts + i] = g.EdgeStart(e).int_id();
+            data[layout.edge_ends + i] = g.EdgeEnd(e).int_id();
+            data[layout.edge_conjs + i] = g.conjugate(e).int_id();
+            data[layout.edge_coverage + i] = g.coverage_index().RawCoverage(e);
+            data[layout.edge_nucls + i] = nucls_pos[i];
+            g.EdgeNucls(e).BinWrite((char *) (data + layout.nucls + nucls_pos[i]));
+        }
+
+        writer.Commit();
+        DEBUG("Binary graph saving to " << file_name << " finished");
+    }
+
+    // Saves the same histograms as SavePaired as the binary checkpoint (see
+    // BinaryPairedHeader)
+    template<class Index>
+    void SavePairedBinary(const string& file_name,
+                          Index const& paired_index) const {
+        std::vector<EdgeId> edges(component_.e_begin(), component_.e_end());
+        DEBUG("Saving binary paired info, " << file_name << " created");
+        ::unlink((file_name + ".prd").c_str());
+
+        // Count the histograms of every edge first, so that the edges might
+        // be written independently
+        std::vector<uint64_t> hists(edges.size() + 1, 0), points(edges.size() + 1, 0);
+#       pragma omp parallel for schedule(guided)
+        for (size_t i = 0; i < edges.size(); ++i) {
+            for (auto entry : paired_index.GetHalf(edges[i])) {
+                if (!component_.contains(entry.first))
+                    continue;
+                hists[i + 1] += 1;
+                points[i + 1] += entry.second.size();
+            }
+        }
+        std::partial_sum(hists.begin(), hists.end(), hists.begin());
+        std::partial_sum(points.begin(), points.end(), points.begin());
+
+        BinaryPairedHeader header = BinaryPairedHeader::Create();
+        header.hist_count = hists.back();
+        header.point_count = points.back();
+        BinaryPairedLayout layout(header);
+
+        BinaryCheckpointWriter writer(file_name + ".bprd", layout.size);
+        uint64_t *data = writer.data();
+        memcpy(data, &header, sizeof(header));
+        float *ds = (float *) (data + layout.point_d);
+        float *weights = (float *) (data + layout.point_weight);
+        float *vars = (float *) (data + layout.point_var);
+        data[layout.hist_points + header.hist_count] = header.point_count;
+
+#       pragma omp parallel for schedule(guided)
+        for (size_t i = 0; i < edges.size(); ++i) {
+            size_t h = hists[i], p = points[i];
+            for (auto entry : paired_index.GetHalf(edges[i])) {
+                if (!component_.contains(entry.first))
+                    continue;
+                data[layout.hist_e1 + h] = edges[i].int_id();
+                data[layout.hist_e2 + h] = entry.first.int_id();
+                data[layout.hist_points + h] = p;
+                h += 1;
+                for (auto point : entry.second) {
+                    ds[p] = point.d;
+                    weights[p] = point.weight;
+                    vars[p] = PointVariance(point);
+                    p += 1;
+                }
+            }
+            VERIFY(h == hists[i + 1] && p == points[i + 1]);
+        }
+
+        writer.Commit();
+    }
+
     void SavePositions(const string& file_name,
                        EdgesPositionHandler<Graph> const& ref_pos) const {
         ofstream file((file_name + ".pos").c_str());
@@ -302,6 +584,7 @@ class DataPrinter {
     }
 
     const GraphComponent<Graph> component_;
+    bool binary_;
 
     virtual std::string ToPrint(VertexId v) const = 0;
     virtual std::string ToPrint(EdgeId e) const = 0;
@@ -314,7 +597,7 @@ class DataPrinter {
 //    }
 
     DataPrinter(GraphComponent<Graph>&& component) :
-            component_(std::move(component)) {
+            component_(std::move(component)), binary_(false) {
     }
 
     const GraphComponent<Graph>& component() const {
@@ -324,6 +607,16 @@ class DataPrinter {
   public:
     virtual ~DataPrinter() {
     }
+
+    // Whether the graph and the paired info are printed as the binary
+    // checkpoints rather than text (see PrintBasicGraph, PrintPairedIndex)
+    void set_binary(bool binary) {
+        binary_ = binary;
+    }
+
+    bool binary() const {
+        return binary_;
+    }
 };
 
 template<class Graph>
@@ -419,6 +712,9 @@ class DataScanner {
   public:
     virtual void LoadGraph(const string& file_name) = 0;
 
+    // Loads the graph, the edge sequences and the coverage from the binary checkpoint
+    virtual void LoadGraphBinary(const string& file_name) = 0;
+
     void LoadCoverage(const string& file_name) {
         INFO("Reading coverage from " << file_name);
         ifstream in(file_name + ".cvr");
@@ -441,6 +737,11 @@ class DataScanner {
                     Index& paired_index,
                     bool force_exists = true) {
         typedef typename Graph::EdgeId EdgeId;
+        if (path::FileExists(file_name + ".bprd")) {
+            LoadPairedBinary(file_name, paired_index);
+            return;
+        }
+
         FILE* file = fopen((file_name + ".prd").c_str(), "r");
         INFO((file_name + ".prd"));
         if (force_exists) {
@@ -478,6 +779,41 @@ class DataScanner {
         fclose(file);
     }
 
+    template<typename Index>
+    void LoadPairedBinary(const string& file_name,
+                          Index& paired_index) {
+        INFO("Reading binary paired info from " << file_name << " started");
+        BinaryCheckpointReader<BinaryPairedHeader> file(file_name + ".bprd");
+        const BinaryPairedHeader& header = file.header();
+        BinaryPairedLayout layout(header);
+        VERIFY_MSG(file.size() >= layout.size, "Binary checkpoint " << file_name << ".bprd is truncated");
+
+        const uint64_t *data = file.data();
+        const float *ds = (const float *) (data + layout.point_d);
+        const float *weights = (const float *) (data + layout.point_weight);
+        const float *vars = (const float *) (data + layout.point_var);
+        std::vector<typename Index::Point> points;
+        for (size_t i = 0; i < header.hist_count; ++i) {
+            auto e1 = this->edge_id_map().find(data[layout.hist_e1 + i]);
+            auto e2 = this->edge_id_map().find(data[layout.hist_e2 + i]);
+            VERIFY(e1 != this->edge_id_map().end());
+            if (e2 == this->edge_id_map().end())
+                continue;
+
+            //Need to prevent doubling of self-conjugate edge pairs (see LoadPaired)
+            auto ep = std::make_pair(e1->second, e2->second);
+            bool self_conj = (ep == paired_index.ConjugatePair(ep));
+            points.clear();
+            for (size_t j = data[layout.hist_points + i]; j < data[layout.hist_points + i + 1]; ++j) {
+                typename Index::Point point;
+                SetPoint(point, ds[j], self_conj ? math::round(weights[j] / 2) : weights[j], vars[j]);
+                points.push_back(point);
+            }
+            paired_index.AddMany(ep.first, ep.second, points);
+        }
+        DEBUG("PII SIZE " << paired_index.size());
+    }
+
     bool LoadPositions(const string& file_name,
                        EdgesPositionHandler<Graph>& edge_pos) {
         FILE* file = fopen((file_name + ".pos").c_str(), "r");
@@ -651,6 +987,50 @@ private:
         fclose(file);
         fclose(sequence_file);
     }
+
+    /*virtual*/
+    void LoadGraphBinary(const string& file_name) {
+        INFO("Reading conjugate de bruijn graph from " << file_name << ".bgr started");
+        BinaryCheckpointReader<BinaryGraphHeader> file(file_name + ".bgr");
+        const BinaryGraphHeader& header = file.header();
+        VERIFY_MSG(header.k == this->g().k(), "Cannot read graph, different Ks");
+        BinaryGraphLayout layout(header);
+        VERIFY_MSG(file.size() >= layout.size, "Binary checkpoint " << file_name << ".bgr is truncated");
+
+        const uint64_t *data = file.data();
+        restricted::IdSegmentStorage id_storage = this->g().GetGraphIdDistributor().ReserveUpTo(header.max_id);
+        for (size_t i = 0; i < header.vertex_count; ++i) {
+            size_t ids[2] = {data[layout.vertex_ids + i], data[layout.vertex_conjs + i]};
+            if (this->vertex_id_map().count(ids[0]))
+                continue;
+
+            auto id_distributor = id_storage.GetSegmentIdDistributor(ids, ids + 2);
+            VertexId vid = this->g().AddVertex(typename Graph::VertexData(), id_distributor);
+            this->vertex_id_map()[ids[0]] = vid;
+            this->vertex_id_map()[ids[1]] = this->g().conjugate(vid);
+        }
+
+        for (size_t i = 0; i < header.edge_count; ++i) {
+            size_t ids[2] = {data[layout.edge_ids + i], data[layout.edge_conjs + i]};
+            if (this->edge_id_map().count(ids[0]))
+                continue;
+
+            // The sequence refers to the mapped file, nothing is copied
+            Sequence s;
+            s.BinRead((const char *) (data + layout.nucls + data[layout.edge_nucls + i]), file.owner());
+            auto id_distributor = id_storage.GetSegmentIdDistributor(ids, ids + 2);
+            EdgeId eid = this->g().AddEdge(this->vertex_id_map()[data[layout.edge_starts + i]],
+                                           this->vertex_id_map()[data[layout.edge_ends + i]],
+                                           s, id_distributor);
+            this->edge_id_map()[ids[0]] = eid;
+            this->edge_id_map()[ids[1]] = this->g().conjugate(eid);
+        }
+
+        for (size_t i = 0; i < header.edge_count; ++i)
+            this->g().coverage_index().SetRawCoverage(this->edge_id_map()[data[layout.edge_ids + i]],
+                                                      (unsigned) data[layout.edge_coverage + i]);
+    }
+
   public:
     ConjugateDataScanner(Graph& g) :
             base(g) {
@@ -667,6 +1047,11 @@ inline std::string MakeSingleReadsFileName(const std::string& file_name,
 
 template<class Graph>
 void PrintBasicGraph(const string& file_name, DataPrinter<Graph>& printer) {
+    if (printer.binary()) {
+        printer.SaveGraphBinary(file_name);
+        return;
+    }
+
     printer.SaveGraph(file_name);
     printer.SaveEdgeSequences(file_name);
     printer.SaveCoverage(file_name);
@@ -694,16 +1079,25 @@ void PrintGraphPack(const string& file_name, const graph_pack& gp) {
     PrintGraphPack(file_name, printer, gp);
 }
 
+template<class Graph, class Index>
+void PrintPaired(const string& file_name, DataPrinter<Graph>& printer,
+                 const Index& paired_index) {
+    if (printer.binary())
+        printer.SavePairedBinary(file_name, paired_index);
+    else
+        printer.SavePaired(file_name, paired_index);
+}
+
 template<class Graph>
 void PrintPairedIndex(const string& file_name, DataPrinter<Graph>& printer,
                       const PairedInfoIndexT<Graph>& paired_index) {
-    printer.SavePaired(file_name, paired_index);
+    PrintPaired(file_name, printer, paired_index);
 }
 
 template<class Graph>
 void PrintUnclusteredIndex(const string& file_name, DataPrinter<Graph>& printer,
                            const UnclusteredPairedInfoIndexT<Graph>& paired_index) {
-    printer.SavePaired(file_name, paired_index);
+    PrintPaired(file_name, printer, paired_index);
 }
 
 template<class Graph>
@@ -796,9 +1190,11 @@ void PrintSingleLongReads(const string& file_name, const LongReadContainer<Graph
     }
 }
 
+// Binary checkpoints are much faster to save and load, text is kept for the export
 template<class graph_pack>
-void PrintAll(const string& file_name, const graph_pack& gp) {
+void PrintAll(const string& file_name, const graph_pack& gp, bool binary = false) {
     ConjugateDataPrinter<typename graph_pack::graph_t> printer(gp.g, gp.g.begin(), gp.g.end());
+    printer.set_binary(binary);
     PrintGraphPack(file_name, printer, gp);
     PrintUnclusteredIndices(file_name, printer, gp.paired_indices);
     PrintClusteredIndices(file_name, printer, gp.clustered_indices);
@@ -866,6 +1262,11 @@ void PrintWithClusteredIndices(const string& file_name, const graph_pack& gp,
 
 template<class Graph>
 void ScanBasicGraph(const string& file_name, DataScanner<Graph>& scanner) {
+    if (path::FileExists(file_name + ".bgr")) {
+        scanner.LoadGraphBinary(file_name);
+        return;
+    }
+
     scanner.LoadGraph(file_name);
     scanner.LoadCoverage(file_name);
 }
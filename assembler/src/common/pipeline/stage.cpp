@@ -9,6 +9,7 @@
 #include "pipeline/graphio.hpp"
 
 #include "utils/logger/log_writers.hpp"
+#include "utils/telemetry.hpp"
 
 #include <algorithm>
 #include <cstring>
@@ -31,10 +32,15 @@ void AssemblyStage::save(const debruijn_graph::conj_graph_pack& gp,
     std::string p = path::append_path(save_to, prefix == NULL ? id_ : prefix);
     INFO("Saving current state to " << p);
 
-    debruijn_graph::graphio::PrintAll(p, gp);
+    debruijn_graph::graphio::PrintAll(p, gp, cfg::get().binary_saves);
     debruijn_graph::config::write_lib_data(p);
 }
 
+static void ReportGraphSize(const debruijn_graph::conj_graph_pack& gp) {
+    telemetry::set("vertices", (double) gp.g.size());
+    telemetry::set("edges", (double) gp.g.e_size());
+}
+
 class StageIdComparator {
   public:
     StageIdComparator(const char* id)
@@ -94,7 +100,11 @@ void CompositeStageBase::run(debruijn_graph::conj_graph_pack& gp,
         PhaseBase *phase = start_phase->get();
 
         INFO("PROCEDURE == " << phase->name());
-        phase->run(gp, started_from);
+        {
+            telemetry::ScopeGuard scope(phase->name(), std::string(id()) + ":" + phase->id());
+            phase->run(gp, started_from);
+            ReportGraphSize(gp);
+        }
 
         if (parent_->saves_policy().make_saves_) {
             std::string composite_id(id());
@@ -124,7 +134,11 @@ void StageManager::run(debruijn_graph::conj_graph_pack& g,
         AssemblyStage *stage = start_stage->get();
 
         INFO("STAGE == " << stage->name());
-        stage->run(g, start_from);
+        {
+            telemetry::ScopeGuard scope(stage->name(), stage->id());
+            stage->run(g, start_from);
+            ReportGraphSize(g);
+        }
         if (saves_policy_.make_saves_)
             stage->save(g, saves_policy_.save_to_);
     }
@@ -17,6 +17,7 @@
 
 #include <string>
 #include "utils/verify.hpp"
+#include "adt/fixed_width_kmer.hpp"
 #include <array>
 #include <algorithm>
 #include "nucl.hpp"
@@ -590,12 +591,7 @@ public:
     bool operator==(const RuntimeSeq<max_size_, T> &s) const {
         VERIFY(size_ == s.size_);
 
-        size_t data_size = GetDataSize(size_);
-        for (size_t i = 0; i < data_size; ++i)
-            if (data_[i] != s.data_[i])
-                return false;
-
-        return true;
+        return kmer_words_equal(data_.data(), s.data_.data(), GetDataSize(size_));
     }
 
     /**
@@ -686,14 +682,34 @@ public:
         }
     };
 
+    /**
+     * Nucleotide-wise order. The sequences of the same size are compared by words,
+     * the first differing nucleotide is the lowest differing bit pair of the first differing word.
+     */
     struct less2 {
         int operator()(const RuntimeSeq<max_size_, T> &l, const RuntimeSeq<max_size_, T> &r) const {
-            for (size_t i = 0; i < l.size(); ++i) {
-                if (l[i] != r[i]) {
-                    return (l[i] < r[i]);
+            if (l.size() != r.size()) {
+                for (size_t i = 0; i < l.size(); ++i) {
+                    if (l[i] != r[i]) {
+                        return (l[i] < r[i]);
+                    }
                 }
+                return l.size() < r.size();
             }
-            return l.size() < r.size();
+
+            size_t data_size = l.data_size();
+            size_t i = kmer_words_mismatch(l.data(), r.data(), data_size);
+            if (i == data_size)
+                return false;
+
+            T diff = l.data()[i] ^ r.data()[i];
+            if (i + 1 == data_size)
+                diff &= (T) MaskForLastBucket(l.size());
+            if (!diff)
+                return false;
+
+            unsigned shift = __builtin_ctzll(diff) & ~1u;
+            return ((l.data()[i] >> shift) & 3) < ((r.data()[i] >> shift) & 3);
         }
     };
 
@@ -721,13 +737,7 @@ public:
 
 template<size_t max_size_, typename T = seq_element_type>
 bool operator<(const RuntimeSeq<max_size_, T> &l, const RuntimeSeq<max_size_, T> &r) {
-    for (size_t i = 0; i < l.size(); ++i) {
-        if (l[i] != r[i]) {
-            return (l[i] < r[i]);
-        }
-    }
-
-    return l.size() < r.size();
+    return typename RuntimeSeq<max_size_, T>::less2()(l, r);
 }
 
 template<size_t max_size_, typename T>
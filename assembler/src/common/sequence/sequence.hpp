@@ -12,6 +12,9 @@
 #include <string>
 #include <memory>
 #include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <functional>
 
 #include "seq.hpp"
 #include "rtseq.hpp"
@@ -36,6 +39,8 @@ private:
     size_t size_;
     bool rtl_; // Right to left + complimentary (?)
     std::shared_ptr<ST> data_;
+    // Cached hash(), zero if not computed yet
+    mutable std::atomic<size_t> hash_;
 
     static size_t DataSize(size_t size) {
         return (size + STN - 1) >> STNBits;
@@ -94,6 +99,56 @@ private:
             bytes[cur] = 0;
     }
 
+    // Reverses the order of nucleotides in the word
+    static ST ReverseNucls(ST w) {
+        w = ((w >> 2) & 0x3333333333333333ull) | ((w & 0x3333333333333333ull) << 2);
+        w = ((w >> 4) & 0x0F0F0F0F0F0F0F0Full) | ((w & 0x0F0F0F0F0F0F0F0Full) << 4);
+        return __builtin_bswap64(w);
+    }
+
+    /**
+     * Packs cnt <= STN nucleotides starting from position pos into a single
+     * word, nucleotide pos goes to the lowest bits (same as operator[] would
+     * return them one by one). Handles both unaligned and rtl sequences.
+     */
+    ST Word(size_t pos, size_t cnt) const {
+        const ST *bytes = data_.get();
+        size_t i = rtl_ ? from_ + size_ - pos - cnt : from_ + pos;
+        size_t idx = i >> STNBits, shift = (i & (STN - 1)) << 1;
+
+        ST res = bytes[idx] >> shift;
+        // Do not touch the next word unless we really need it: it might be
+        // past the end of the data
+        if (shift && ((i + cnt - 1) >> STNBits) != idx)
+            res |= bytes[idx + 1] << (STBits - shift);
+
+        if (rtl_)
+            return ~ReverseNucls(res) >> (STBits - 2 * cnt);
+
+        return cnt == STN ? res : res & ((ST(1) << (2 * cnt)) - 1);
+    }
+
+    // Position of the first mismatch within the first s nucleotides (s if none)
+    size_t ComputeHash() const {
+        uint64_t h = 0x9E3779B97F4A7C15ull ^ size_;
+        for (size_t pos = 0; pos < size_; pos += STN) {
+            h ^= Word(pos, std::min(size_t(STN), size_ - pos));
+            h *= 0xFF51AFD7ED558CCDull;
+            h ^= h >> 32;
+        }
+        return h;
+    }
+
+    size_t FirstMismatch(const Sequence &that, size_t s) const {
+        for (size_t pos = 0; pos < s; pos += STN) {
+            size_t cnt = std::min(size_t(STN), s - pos);
+            ST diff = Word(pos, cnt) ^ that.Word(pos, cnt);
+            if (diff)
+                return pos + (__builtin_ctzll(diff) >> 1);
+        }
+        return s;
+    }
+
 
 public:
     /**
@@ -102,46 +157,47 @@ public:
      * @param s ACGT or 0123-string
      */
     explicit Sequence(const char *s, bool rc = false) :
-            from_(0), size_(strlen(s)), rtl_(false), data_(new ST[DataSize(size_)], array_deleter<ST>()) {
+            from_(0), size_(strlen(s)), rtl_(false), data_(new ST[DataSize(size_)], array_deleter<ST>()), hash_(0) {
         InitFromNucls(s, rc);
     }
 
     explicit Sequence(char *s, bool rc = false) :
-            from_(0), size_(strlen(s)), rtl_(false), data_(new ST[DataSize(size_)], array_deleter<ST>()) {
+            from_(0), size_(strlen(s)), rtl_(false), data_(new ST[DataSize(size_)], array_deleter<ST>()), hash_(0) {
         InitFromNucls(s, rc);
     }
 
     template<typename S>
     explicit Sequence(const S &s, bool rc = false) :
-            from_(0), size_(s.size()), rtl_(false), data_(new ST[DataSize(size_)], array_deleter<ST>()) {
+            from_(0), size_(s.size()), rtl_(false), data_(new ST[DataSize(size_)], array_deleter<ST>()), hash_(0) {
         InitFromNucls(s, rc);
     }
 
     Sequence() :
-            from_(0), size_(0), rtl_(false), data_(new ST[DataSize(size_)], array_deleter<ST>()) {
+            from_(0), size_(0), rtl_(false), data_(new ST[DataSize(size_)], array_deleter<ST>()), hash_(0) {
         memset(data_.get(), 0, DataSize(size_));
     }
 
     template<size_t size2_>
     explicit Sequence(const Seq<size2_> &kmer, size_t) :
-            from_(0), size_(kmer.size()), rtl_(false), data_(new ST[DataSize(size_)], array_deleter<ST>()) {
+            from_(0), size_(kmer.size()), rtl_(false), data_(new ST[DataSize(size_)], array_deleter<ST>()), hash_(0) {
 
         kmer.copy_data(data_.get());
     }
 
     template<size_t size2_>
     explicit Sequence(const RuntimeSeq<size2_> &kmer, size_t) :
-            from_(0), size_(kmer.size()), rtl_(false), data_(new ST[DataSize(size_)], array_deleter<ST>()) {
+            from_(0), size_(kmer.size()), rtl_(false), data_(new ST[DataSize(size_)], array_deleter<ST>()), hash_(0) {
 
         kmer.copy_data(data_.get());
     }
 
     Sequence(const Sequence &seq, size_t from, size_t size, bool rtl) :
-            from_(from), size_(size), rtl_(rtl), data_(seq.data_) {
+            from_(from), size_(size), rtl_(rtl), data_(seq.data_), hash_(0) {
     }
 
     Sequence(const Sequence &s) :
-            from_(s.from_), size_(s.size_), rtl_(s.rtl_), data_(s.data_) {
+            from_(s.from_), size_(s.size_), rtl_(s.rtl_), data_(s.data_),
+            hash_(s.hash_.load(std::memory_order_relaxed)) {
     }
 
     ~Sequence() { }
@@ -152,6 +208,7 @@ public:
             size_ = rhs.size_;
             rtl_ = rhs.rtl_;
             data_ = rhs.data_;
+            hash_.store(rhs.hash_.load(std::memory_order_relaxed), std::memory_order_relaxed);
         }
 
         return *this;
@@ -179,10 +236,10 @@ public:
             return true;
         }
 
-        for (size_t i = 0; i < size_; ++i) {
-            if (this->operator[](i) != that[i]) {
+        for (size_t pos = 0; pos < size_; pos += STN) {
+            size_t cnt = std::min(size_t(STN), size_ - pos);
+            if (Word(pos, cnt) != that.Word(pos, cnt))
                 return false;
-            }
         }
         return true;
     }
@@ -191,17 +248,48 @@ public:
         return !(operator==(that));
     }
 
+    bool operator<(const Sequence &that) const {
+        size_t s = std::min(size_, that.size_);
+        size_t i = FirstMismatch(that, s);
+        if (i != s)
+            return this->operator[](i) < that[i];
+
+        return (size_ < that.size_);
+    }
+
     /**
-     * @todo Might be optimized via int comparison (not so easy)
+     * @return length of the longest common prefix of two sequences
      */
-    bool operator<(const Sequence &that) const {
+    size_t CommonPrefixLength(const Sequence &that) const {
+        return FirstMismatch(that, std::min(size_, that.size_));
+    }
+
+    /**
+     * @return number of mismatches within the first min(size(), that.size()) positions
+     */
+    size_t HammingDistance(const Sequence &that) const {
         size_t s = std::min(size_, that.size_);
-        for (size_t i = 0; i < s; ++i) {
-            if (this->operator[](i) != that[i]) {
-                return (this->operator[](i) < that[i]);
-            }
+        size_t res = 0;
+        for (size_t pos = 0; pos < s; pos += STN) {
+            size_t cnt = std::min(size_t(STN), s - pos);
+            ST diff = Word(pos, cnt) ^ that.Word(pos, cnt);
+            res += __builtin_popcountll((diff | (diff >> 1)) & 0x5555555555555555ull);
         }
-        return (size_ < that.size_);
+        return res;
+    }
+
+    /**
+     * Hash of the nucleotide content, equal sequences have equal hashes
+     * regardless of the way they are stored (offset, orientation).
+     * Computed on the first call, the copies share the computed value.
+     */
+    size_t hash() const {
+        size_t h = hash_.load(std::memory_order_relaxed);
+        if (!h) {
+            h = ComputeHash();
+            hash_.store(h, std::memory_order_relaxed);
+        }
+        return h;
     }
 
     Sequence operator!() const {
@@ -281,11 +369,40 @@ private:
 public:
     inline bool BinRead(std::istream &file);
 
+    /**
+     * Reads the sequence written by BinWrite from the memory buffer without
+     * copying: the sequence refers to the packed data in the buffer and keeps
+     * the buffer owner alive. The data must be aligned on ST boundary.
+     * @return pointer past the end of the sequence in the buffer
+     */
+    inline const char *BinRead(const char *buf, const std::shared_ptr<const void> &owner);
+
     inline bool BinWrite(std::ostream &file) const;
+
+    /**
+     * Writes the sequence in the same format as BinWrite to the memory buffer
+     * of at least BinSize() bytes. Any view (offset, orientation) is packed
+     * anew. The buffer must be aligned on ST boundary.
+     * @return pointer past the end of the sequence in the buffer
+     */
+    inline char *BinWrite(char *buf) const;
+
+    size_t BinSize() const {
+        return sizeof(size_) + DataSize(size_) * sizeof(ST);
+    }
 };
 
 inline std::ostream &operator<<(std::ostream &os, const Sequence &s);
 
+namespace std {
+template<>
+struct hash<Sequence> {
+    size_t operator()(const Sequence &s) const {
+        return s.hash();
+    }
+};
+}
+
 /**
  * start of Sequence is Seq with preferred size
  */
@@ -412,13 +529,7 @@ size_t Sequence::rightSimilar(const Sequence &t, size_t k) const {
     for (size_t res = find(d, 0); res != -1ULL; res = find(d, res + 1)) {
         if (res + tsz < sz)
             continue;
-        size_t i;
-        for (i = k; i + res < sz; i++) {
-            if (t[i] != this->operator[](i + res)) {
-                break;
-            };
-        }
-        if (i == sz - res)
+        if (Subseq(res) == t.Subseq(0, sz - res))
             return 1;
     }
     return 0;
@@ -487,11 +598,39 @@ bool Sequence::BinRead(std::istream &file) {
 
     data_ = std::shared_ptr<ST>(new ST[DataSize(size_)], array_deleter<ST>());
     file.read((char *) data_.get(), DataSize(size_) * sizeof(ST));
+    hash_.store(0, std::memory_order_relaxed);
 
     return !file.fail();
 }
 
 
+const char *Sequence::BinRead(const char *buf, const std::shared_ptr<const void> &owner) {
+    memcpy(&size_, buf, sizeof(size_));
+    buf += sizeof(size_);
+    from_ = 0;
+    rtl_ = false;
+
+    VERIFY(reinterpret_cast<uintptr_t>(buf) % alignof(ST) == 0);
+    // The data is never modified after construction, so it is safe to share
+    // the read-only buffer
+    data_ = std::shared_ptr<ST>(owner, const_cast<ST *>(reinterpret_cast<const ST *>(buf)));
+    hash_.store(0, std::memory_order_relaxed);
+
+    return buf + DataSize(size_) * sizeof(ST);
+}
+
+char *Sequence::BinWrite(char *buf) const {
+    memcpy(buf, &size_, sizeof(size_));
+    buf += sizeof(size_);
+
+    VERIFY(reinterpret_cast<uintptr_t>(buf) % alignof(ST) == 0);
+    ST *bytes = reinterpret_cast<ST *>(buf);
+    for (size_t pos = 0; pos < size_; pos += STN)
+        *bytes++ = Word(pos, std::min(size_t(STN), size_ - pos));
+
+    return buf + DataSize(size_) * sizeof(ST);
+}
+
 bool Sequence::BinWrite(std::ostream &file) const {
     if (from_ != 0 || rtl_) {
         Sequence clear(this->str());
@@ -12,6 +12,7 @@
 
 #include "modules/graph_construction.hpp"
 #include "assembly_graph/stats/picture_dump.hpp"
+#include "utils/telemetry.hpp"
 #include "construction.hpp"
 
 namespace debruijn_graph {
@@ -25,6 +26,9 @@ void construct_graph(io::ReadStreamList<Read>& streams,
     ReadStatistics stats = ConstructGraphWithCoverage(params, streams, gp.g,
                                                       gp.index, gp.flanking_cov, contigs_stream);
     size_t rl = stats.max_read_length_;
+    telemetry::set("reads", (double) stats.reads_);
+    telemetry::set("bases", (double) stats.bases_);
+    telemetry::set("kmers", (double) gp.index.inner_index().size());
 
     if (!cfg::get().ds.RL()) {
         INFO("Figured out: read length = " << rl);
@@ -0,0 +1,46 @@
+//***************************************************************************
+//* Copyright (c) 2016 Saint Petersburg State University
+//* All Rights Reserved
+//* See file LICENSE for details.
+//***************************************************************************
+
+#pragma once
+
+#include "utils/perfcounter.hpp"
+
+#include <iostream>
+#include <string>
+
+/*
+ * Timing helpers of the micro-benchmarks. A benchmarked function returns a
+ * checksum of its work, so that the results of the compared variants can be
+ * checked to match (and the work is not optimized away).
+ */
+namespace bench {
+
+template<class F>
+void Run(const std::string &name, size_t rounds, F f) {
+    perf_counter pc;
+    size_t res = 0;
+    for (size_t r = 0; r < rounds; ++r)
+        res += f();
+    double time = pc.time();
+    std::cout << "  " << name << ": " << time << " s (checksum " << res << ")" << std::endl;
+}
+
+template<class F>
+void Run(const std::string &name, F f) {
+    Run(name, 1, f);
+}
+
+// Also reports the rate of processing of the count items
+template<class F>
+void RunThroughput(const std::string &name, size_t count, F f) {
+    perf_counter pc;
+    size_t res = f();
+    double time = pc.time();
+    std::cout << "  " << name << ": " << time << " s, "
+              << size_t(double(count) / time) << " per s (checksum " << res << ")" << std::endl;
+}
+
+}
@@ -98,6 +98,35 @@ class CoverageFillingEdgeIndexBuilder : public Builder {
 
  public:
 
+    // Fills the coverage from the multiplicities of the k-mers counted while
+    // splitting the reads during the graph construction, instead of reading
+    // the reads once more.
+    void FillCoverageFromMultiplicities(IndexT &index,
+                                        const KMerMultiplicities &multiplicities,
+                                        unsigned nthreads) const {
+        INFO("Collecting k-mer coverage information from k-mer multiplicities");
+        VERIFY(multiplicities.kmers.size() == multiplicities.counts.size());
+        unsigned k = index.k();
+        typedef MMappedFileRecordArrayIterator<typename Kmer::DataType> kmer_iterator;
+
+        // Merged files have no common k-mers, so no synchronization is necessary
+#       pragma omp parallel for num_threads(nthreads) schedule(dynamic)
+        for (size_t i = 0; i < multiplicities.kmers.size(); ++i) {
+            MMappedRecordReader<uint32_t> counts(multiplicities.counts[i], /* unlink */ false, -1ULL);
+            size_t j = 0;
+            for (kmer_iterator it(multiplicities.kmers[i], Kmer::GetDataSize(k)); it.good(); ++it, ++j) {
+                VERIFY(j < counts.size());
+                if (!counts[j])
+                    continue;
+
+                KeyWithHash kwh = index.ConstructKWH(Kmer(k, *it));
+                if (index.valid(kwh) && ContainsWrap(true, index, kwh, has_contains<IndexT>()))
+                    index.get_raw_value_reference(kwh).count += counts[j];
+            }
+            VERIFY(j == counts.size());
+        }
+    }
+
     template<class Streams>
     size_t ParallelFillCoverage(IndexT &index,
                                 Streams &streams,
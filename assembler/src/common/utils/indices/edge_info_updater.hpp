@@ -87,6 +87,16 @@ class EdgeInfoUpdater {
         DeleteKMers(nucls, e);
     }
 
+    // The edges of the batch should have disjoint k-mers, every conjugate edge
+    // should be in the batch together with its pair
+    void UpdateKmers(const std::vector<EdgeId> &edges) {
+        ForEachConjugatePair(edges, [&](EdgeId e) { UpdateKmers(e); });
+    }
+
+    void DeleteKmers(const std::vector<EdgeId> &edges) {
+        ForEachConjugatePair(edges, [&](EdgeId e) { DeleteKmers(e); });
+    }
+
     void UpdateAll() {
         unsigned nthreads = omp_get_max_threads();
 
@@ -103,6 +113,25 @@ class EdgeInfoUpdater {
     }
 
  private:
+    // Canonical k-mers of an edge and its conjugate coincide, so the pair is
+    // processed by one thread
+    template<class F>
+    void ForEachConjugatePair(const std::vector<EdgeId> &edges, F f) {
+        std::vector<EdgeId> canonical;
+        canonical.reserve(edges.size() / 2 + 1);
+        for (EdgeId e : edges)
+            if (e <= g_.conjugate(e))
+                canonical.push_back(e);
+
+        #pragma omp parallel for schedule(guided)
+        for (size_t i = 0; i < canonical.size(); ++i) {
+            EdgeId e = canonical[i], rc = g_.conjugate(e);
+            f(e);
+            if (rc != e)
+                f(rc);
+        }
+    }
+
     DECL_LOGGER("EdgeInfoUpdater")
 };
 
@@ -36,6 +36,11 @@ public:
     SimpleKeyWithHash(Key key, const HashFunction &hash) : hash_(hash), key_(key), idx_(0), ready_(false) {
     }
 
+    //key with the index already known, all keys are minimal here
+    SimpleKeyWithHash(Key key, const HashFunction &hash, bool /*is_minimal*/, IdxType idx)
+            : hash_(hash), key_(key), idx_(idx), ready_(true) {
+    }
+
     Key key() const {
         return key_;
     }
@@ -133,6 +138,10 @@ private:
     InvertableKeyWithHash(Key key, const HashFunction &hash)
             : hash_(hash), key_(key), idx_(0), is_minimal_(false), ready_(false) {}
 
+    //key with the index (of the minimal of key and !key) already known
+    InvertableKeyWithHash(Key key, const HashFunction &hash, bool is_minimal, IdxType idx)
+            : InvertableKeyWithHash(key, hash, is_minimal, idx, true) {}
+
     const Key &key() const {
         return key_;
     }
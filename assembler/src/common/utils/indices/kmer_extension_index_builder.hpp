@@ -58,9 +58,12 @@ public:
     }
 
 public:
+    // If multiplicities are given, the multiplicities of the k+1-mers in the
+    // reads are counted along the way (k+1-mers of the contigs get zero ones)
     template<class Index, class Streams>
     ReadStatistics BuildExtensionIndexFromStream(Index &index, Streams &streams, io::SingleStream* contigs_stream = 0,
-                                                 size_t read_buffer_size = 0) const {
+                                                 size_t read_buffer_size = 0,
+                                                 KMerMultiplicities *multiplicities = nullptr) const {
         unsigned nthreads = (unsigned) streams.size();
 
         // First, build a k+1-mer index
@@ -68,8 +71,9 @@ public:
                                  StoringTypeFilter<typename Index::storing_type>>
                 splitter(index.workdir(), index.k() + 1, 0xDEADBEEF, streams,
                          contigs_stream, read_buffer_size);
+        splitter.set_count_multiplicity(multiplicities != nullptr);
         KMerDiskCounter<RtSeq> counter(index.workdir(), splitter);
-        counter.CountAll(nthreads, nthreads, /* merge */false);
+        size_t kpomers = counter.CountAll(nthreads, nthreads, /* merge */false);
 
         // Now, count unique k-mers from k+1-mers
         DeBruijnKMerKMerSplitter<StoringTypeFilter<typename Index::storing_type> >
@@ -77,9 +81,16 @@ public:
                           index.k() + 1, Index::storing_type::IsInvertable(), read_buffer_size);
         for (unsigned i = 0; i < nthreads; ++i)
             splitter2.AddKMers(counter.GetMergedKMersFname(i));
-        KMerDiskCounter<RtSeq> counter2(index.workdir(), splitter2);
 
-        BuildIndex(index, counter2, 16, nthreads);
+        // Every k+1-mer contributes at most two k-mers
+        if (KMerInMemoryCounter<RtSeq>::FitsInMemory(index.k(), 2 * kpomers)) {
+            INFO("Estimated " << 2 * kpomers << " k-mers fit into memory, counting them in RAM");
+            KMerInMemoryCounter<RtSeq> counter2(index.workdir(), splitter2);
+            BuildIndex(index, counter2, 16, nthreads);
+        } else {
+            KMerDiskCounter<RtSeq> counter2(index.workdir(), splitter2);
+            BuildIndex(index, counter2, 16, nthreads);
+        }
 
         // Build the kmer extensions
         INFO("Building k-mer extensions from k+1-mers");
@@ -88,6 +99,10 @@ public:
             FillExtensionsFromIndex(counter.GetMergedKMersFname(i), index);
         INFO("Building k-mer extensions from k+1-mers finished.");
 
+        if (multiplicities)
+            for (unsigned i = 0; i < nthreads; ++i)
+                multiplicities->Add(counter.GetMergedKMersFname(i), counter.GetMergedCountsFname(i));
+
         return splitter.stats();
     }
 
@@ -77,6 +77,44 @@ struct ReadStatistics {
   size_t bases_;
 };
 
+/**
+* Multiplicities of the k-mers of the reads counted by the splitter (see
+* KMerSortingSplitter::set_count_multiplicity), i.e. the coverage of the k-mers
+* collected without another pass over the reads. The files are moved to the
+* given working directory and removed in dtor.
+*/
+struct KMerMultiplicities {
+  // Merged k-mer files along with the files of their multiplicities
+  path::files_t kmers;
+  path::files_t counts;
+
+  explicit KMerMultiplicities(const std::string &workdir)
+      : workdir_(workdir) {}
+
+  ~KMerMultiplicities() {
+    for (const auto *files : { &kmers, &counts })
+      for (const auto &fname : *files)
+        ::unlink(fname.c_str());
+  }
+
+  // The files are usually produced in the temporary directory of the index
+  // being built, so they need to be saved from its removal
+  void Add(const std::string &kmers_fname, const std::string &counts_fname) {
+    kmers.push_back(Move(kmers_fname));
+    counts.push_back(Move(counts_fname));
+  }
+
+ private:
+  std::string Move(const std::string &fname) const {
+    std::string res = path::append_path(workdir_, path::filename(fname));
+    VERIFY_MSG(::rename(fname.c_str(), res.c_str()) == 0,
+               "rename(2) failed for " << fname << ". Reason: " << strerror(errno) << ". Error code: " << errno);
+    return res;
+  }
+
+  std::string workdir_;
+};
+
 template<class Read, class KmerFilter>
 class DeBruijnReadKMerSplitter : public DeBruijnKMerSplitter<KmerFilter> {
   io::ReadStreamList<Read> &streams_;
@@ -161,7 +199,8 @@ path::files_t DeBruijnReadKMerSplitter<Read, KmerFilter>::Split(size_t num_files
     contigs_->reset();
     while (!contigs_->eof()) {
       FillBufferFromStream(*contigs_, cnt);
-      this->DumpBuffers(out);
+      // Contigs should not contribute to the coverage
+      this->DumpBuffers(out, /* count */ false);
       if (++cnt >= nthreads)
         cnt = 0;
     }
@@ -104,6 +104,34 @@ public:
         return KeyBase::valid(kwh.idx());
     }
 
+    /**
+     * Split lookup for batches of keys, see KMerIndex::Lookup. prefetch() hashes
+     * the key and prefetches the index data, prefetch_value() finds the index
+     * of the key and prefetches its value slot, then ConstructKWH(key, lookup)
+     * gives the key with the index ready. Each step should be issued for
+     * several keys before the next one is made for the first of them.
+     */
+    struct KeyLookup {
+        typename KMerIndexT::Lookup hash;
+        IdxType idx;
+        bool is_minimal;
+    };
+
+    void prefetch(const KeyType &key, KeyLookup &lookup) const {
+        lookup.is_minimal = !StoringType::IsInvertable() || key.IsMinimal();
+        index_ptr_->prefetch(lookup.is_minimal ? key : !key, lookup.hash);
+    }
+
+    void prefetch_value(KeyLookup &lookup) const {
+        lookup.idx = index_ptr_->seq_idx(lookup.hash);
+        if (KeyBase::valid(lookup.idx))
+            __builtin_prefetch(&ValueBase::operator[](lookup.idx), 0, 1);
+    }
+
+    KeyWithHash ConstructKWH(const KeyType &key, const KeyLookup &lookup) const {
+        return KeyWithHash(key, *index_ptr_, lookup.is_minimal, lookup.idx);
+    }
+
     PerfectHashMap(size_t k, const std::string &workdir) : KeyBase(k, workdir) {
     }
 
@@ -95,8 +95,20 @@ void BuildIndexFromGraph(Index &index, const Graph &g, size_t read_buffer_size =
     DeBruijnGraphKMerSplitter<Graph,
                               StoringTypeFilter<typename Index::storing_type>>
             splitter(index.workdir(), index.k(), g, read_buffer_size);
-    KMerDiskCounter<RtSeq> counter(index.workdir(), splitter);
-    BuildIndex(index, counter, 16, 1);
+
+    // Number of k-mers is bounded by the total length of the edges
+    size_t kmers = 0;
+    for (auto it = g.ConstEdgeBegin(); !it.IsEnd(); ++it)
+        kmers += g.length(*it);
+
+    if (KMerInMemoryCounter<RtSeq>::FitsInMemory(index.k(), kmers)) {
+        INFO("Estimated " << kmers << " k-mers fit into memory, counting them in RAM");
+        KMerInMemoryCounter<RtSeq> counter(index.workdir(), splitter);
+        BuildIndex(index, counter, 16, 1);
+    } else {
+        KMerDiskCounter<RtSeq> counter(index.workdir(), splitter);
+        BuildIndex(index, counter, 16, 1);
+    }
 }
 
 }
@@ -0,0 +1,157 @@
+#pragma once
+//***************************************************************************
+//* Copyright (c) 2015 Saint Petersburg State University
+//* Copyright (c) 2011-2014 Saint Petersburg Academic University
+//* All Rights Reserved
+//* See file LICENSE for details.
+//***************************************************************************
+
+#include "utils/logger/logger.hpp"
+#include "utils/path_helper.hpp"
+#include "utils/perfcounter.hpp"
+#include "utils/verify.hpp"
+
+#include <vector>
+#include <string>
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Writer for the raw k-mer buckets produced by the splitters. Every bucket
+// file is opened once and kept open for the whole splitting phase, so the
+// flushes do not need to reopen the files and can be performed by different
+// threads concurrently (each bucket is owned by a single thread at a time).
+// Sizes of the sorted runs are accumulated in memory and stored into the
+// ".idx" companion files on Close(). When the multiplicities are written, they
+// go to the ".cnt" companion files, one uint32_t per k-mer.
+class KMerBucketWriter {
+ public:
+  KMerBucketWriter()
+      : bytes_(0), flushes_(0), write_time_(0), stall_time_(0) {}
+
+  ~KMerBucketWriter() {
+    Close();
+  }
+
+  void Open(const path::files_t &files, bool with_counts = false) {
+    Close();
+
+    files_ = files;
+    fds_.resize(files_.size());
+    count_fds_.clear();
+    runs_.clear();
+    runs_.resize(files_.size());
+    for (size_t i = 0; i < files_.size(); ++i) {
+      fds_[i] = OpenFile(files_[i]);
+      if (with_counts)
+        count_fds_.push_back(OpenFile(GetCountsFname(files_[i])));
+    }
+
+    bytes_ = flushes_ = 0;
+    write_time_ = stall_time_ = 0;
+  }
+
+  bool is_open() const { return !fds_.empty(); }
+  bool with_counts() const { return !count_fds_.empty(); }
+  size_t num_buckets() const { return fds_.size(); }
+
+  static std::string GetCountsFname(const std::string &fname) {
+    return fname + ".cnt";
+  }
+
+  // Appends one sorted run to the bucket. Thread-safe as long as different
+  // threads write to different buckets.
+  size_t Write(size_t bucket, const void *data, size_t el_size, size_t cnt,
+               const uint32_t *counts = nullptr) {
+    VERIFY(bucket < fds_.size());
+    VERIFY(with_counts() == (counts != nullptr));
+    size_t amount = el_size * cnt;
+    WriteAll(fds_[bucket], data, amount, files_[bucket]);
+    if (counts) {
+      WriteAll(count_fds_[bucket], counts, cnt * sizeof(uint32_t), files_[bucket]);
+      amount += cnt * sizeof(uint32_t);
+    }
+    runs_[bucket].push_back(cnt);
+
+    return amount;
+  }
+
+  // Accounts a single flush (possibly spanning all buckets).
+  void ReportFlush(size_t bytes, double time) {
+    bytes_ += bytes;
+    write_time_ += time;
+    flushes_ += 1;
+    DEBUG("Flush " << flushes_ << ": " << bytes << " bytes written in " << time << " s ("
+          << Throughput(bytes, time) << " Mb/s)");
+  }
+
+  // Accounts the time producers spent waiting for the previous flush to complete.
+  void ReportStall(double time) {
+    stall_time_ += time;
+    DEBUG("Splitting stalled for " << time << " s waiting for the flush to complete");
+  }
+
+  void Close() {
+    if (fds_.empty())
+      return;
+
+    for (int fd : count_fds_)
+      ::close(fd);
+    for (size_t i = 0; i < fds_.size(); ++i) {
+      ::close(fds_[i]);
+
+      // Write index
+      FILE *f = fopen((files_[i] + ".idx").c_str(), "wb");
+      VERIFY_MSG(f, "Cannot open temporary file to write");
+      fwrite(runs_[i].data(), sizeof(size_t), runs_[i].size(), f);
+      fclose(f);
+    }
+
+    INFO("Total " << flushes_ << " bucket flushes, " << bytes_ << " bytes written ("
+         << Throughput(bytes_, write_time_) << " Mb/s). Splitting stalled for " << stall_time_ << " s");
+
+    fds_.clear();
+    count_fds_.clear();
+    runs_.clear();
+    files_.clear();
+  }
+
+ private:
+  static int OpenFile(const std::string &fname) {
+    int fd = ::open(fname.c_str(), O_WRONLY | O_CREAT | O_TRUNC, (mode_t) 0660);
+    VERIFY_MSG(fd != -1,
+               "open(2) failed for " << fname << ". Reason: " << strerror(errno) << ". Error code: " << errno);
+    return fd;
+  }
+
+  static void WriteAll(int fd, const void *data, size_t amount, const std::string &fname) {
+    const char *buf = (const char*)data;
+    size_t written = 0;
+    while (written < amount) {
+      ssize_t res = ::write(fd, buf + written, amount - written);
+      if (res == -1 && errno == EINTR)
+        continue;
+      VERIFY_MSG(res != -1,
+                 "write(2) failed for " << fname << ". Reason: " << strerror(errno) << ". Error code: " << errno);
+      written += res;
+    }
+  }
+
+  static double Throughput(size_t bytes, double time) {
+    return time > 0 ? (double)bytes / time / 1024.0 / 1024.0 : 0;
+  }
+
+  path::files_t files_;
+  std::vector<int> fds_;
+  std::vector<int> count_fds_;
+  std::vector<std::vector<size_t>> runs_;
+
+  size_t bytes_;
+  size_t flushes_;
+  double write_time_;
+  double stall_time_;
+
+  DECL_LOGGER("K-mer Splitting");
+};
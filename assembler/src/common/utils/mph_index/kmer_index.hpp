@@ -74,6 +74,25 @@ class KMerIndex {
             index_[bucket].lookup(s, typename traits::KMerSeqAdaptor());
   }
 
+  // State of the split lookup: prefetch() hashes the k-mer and prefetches the
+  // MPHF data, seq_idx() finishes the lookup once the data is (hopefully) in
+  // the cache. Lookups of several k-mers can be interleaved this way.
+  struct Lookup {
+    size_t bucket;
+    uint64_t nodes[3];
+  };
+
+  void prefetch(const KMerSeq &s, Lookup &lookup) const {
+    lookup.bucket = seq_bucket(s);
+    const KMerDataIndex &index = index_[lookup.bucket];
+    index.hash_nodes(s, typename traits::KMerSeqAdaptor(), lookup.nodes);
+    index.prefetch(lookup.nodes);
+  }
+
+  size_t seq_idx(const Lookup &lookup) const {
+    return bucket_starts_[lookup.bucket] + index_[lookup.bucket].lookup(lookup.nodes);
+  }
+
   size_t raw_seq_idx(const KMerRawReference data) const {
     size_t bucket = raw_seq_bucket(data);
 
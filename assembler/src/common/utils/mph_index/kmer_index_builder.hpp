@@ -17,6 +17,7 @@
 
 #include "utils/logger/logger.hpp"
 #include "utils/path_helper.hpp"
+#include "utils/perfcounter.hpp"
 
 #include "utils/memory_limit.hpp"
 #include "utils/file_limit.hpp"
@@ -26,11 +27,14 @@
 
 #include "mphf.hpp"
 #include "base_hash.hpp"
+#include "kmer_bucket_writer.hpp"
 #include "hypergraph.hpp"
 #include "hypergraph_sorter_seq.hpp"
 
 #include <libcxx/sort.hpp>
 
+#include <boost/iterator/iterator_facade.hpp>
+
 #include <algorithm>
 #ifdef USE_GLIBCXX_PARALLEL
 #include <parallel/algorithm>
@@ -43,7 +47,9 @@
 #endif
 
 #include <fstream>
+#include <future>
 #include <vector>
+#include <limits>
 #include <cmath>
 
 template<class Seq>
@@ -64,6 +70,10 @@ class KMerSplitter {
 
   unsigned K() const { return K_; }
 
+  // Whether the multiplicities of the k-mers are written along with the raw
+  // k-mer files (see KMerBucketWriter)
+  virtual bool count_multiplicity() const { return false; }
+
  protected:
   const std::string &work_dir_;
   hash_function hash_;
@@ -77,15 +87,54 @@ template<class Seq>
 class KMerSortingSplitter : public KMerSplitter<Seq> {
  public:
   KMerSortingSplitter(const std::string &work_dir, unsigned K, uint32_t seed = 0)
-      : KMerSplitter<Seq>(work_dir, K, seed), cell_size_(0), num_files_(0) {}
+      : KMerSplitter<Seq>(work_dir, K, seed), cell_size_(0), num_files_(0), sort_threads_(1), async_flush_(false),
+        in_memory_(false), count_multiplicity_(false), count_flush_(true) {}
+
+  ~KMerSortingSplitter() {
+    WaitFlush();
+  }
+
+  // In memory mode the sorted runs are accumulated in RAM instead of being
+  // written to the raw k-mer files. The files returned by Split() are not
+  // created then, the buckets should be obtained via GetInMemoryBucket().
+  void set_in_memory(bool in_memory) { in_memory_ = in_memory; }
+  bool in_memory() const { return in_memory_; }
+
+  KMerVector<Seq> &GetInMemoryBucket(size_t idx) {
+    VERIFY(idx < memory_buckets_.size());
+    return memory_buckets_[idx];
+  }
+
+  void ReleaseInMemoryBuckets() {
+    std::vector<KMerVector<Seq>>().swap(memory_buckets_);
+  }
+
+  // The number of occurrences of every k-mer in the sorted runs is written
+  // to the companion ".cnt" files, so the counter can sum them up. Not
+  // supported in memory mode.
+  void set_count_multiplicity(bool count) { count_multiplicity_ = count; }
+  bool count_multiplicity() const override { return count_multiplicity_; }
 
  protected:
   using SeqKMerVector = KMerVector<Seq>;
   using KMerBuffer = std::vector<SeqKMerVector>;
 
+  // Buffers are double-buffered when the thread budget leaves room for the
+  // background flush next to the producers: producers fill kmer_buffers_
+  // while the previous generation (flush_buffers_) is being sorted and
+  // written down. Otherwise there is a single generation flushed in place.
   std::vector<KMerBuffer> kmer_buffers_;
+  std::vector<KMerBuffer> flush_buffers_;
   size_t cell_size_;
   size_t num_files_;
+  unsigned sort_threads_;
+  bool async_flush_;
+  KMerBucketWriter writer_;
+  std::future<void> flush_;
+  bool in_memory_;
+  bool count_multiplicity_;
+  bool count_flush_;
+  std::vector<SeqKMerVector> memory_buckets_;
 
   path::files_t PrepareBuffers(size_t num_files, unsigned nthreads, size_t reads_buffer_size) {
     num_files_ = num_files;
@@ -95,7 +144,7 @@ class KMerSortingSplitter : public KMerSplitter<Seq> {
     for (unsigned i = 0; i < num_files_; ++i)
       out.push_back(this->GetRawKMersFname(i));
 
-    size_t file_limit = num_files_ + 2*nthreads;
+    size_t file_limit = (count_multiplicity_ ? 2 : 1) * num_files_ + 2*nthreads;
     size_t res = limit_file(file_limit);
     if (res < file_limit) {
       WARN("Failed to setup necessary limit for number of open files. The process might crash later on.");
@@ -108,17 +157,34 @@ class KMerSortingSplitter : public KMerSplitter<Seq> {
       INFO("Memory available for splitting buffers: " << (double)mem_limit / 1024.0 / 1024.0 / 1024.0 << " Gb");
       reads_buffer_size = std::min(reads_buffer_size, mem_limit);
     }
-    cell_size_ = reads_buffer_size / (num_files_ * this->kmer_size());
+
+    // The background flush runs concurrently with the producers, so it gets
+    // only the threads they leave. Otherwise the flush is performed once the
+    // producers have joined and may use the whole budget.
+    unsigned max_threads = (unsigned) omp_get_max_threads();
+    async_flush_ = max_threads > nthreads;
+    sort_threads_ = async_flush_ ? max_threads - nthreads : max_threads;
+    DEBUG("Flushing " << (async_flush_ ? "in background" : "in foreground") << " using " << sort_threads_ << " threads");
+
+    // Two generations of buffers are alive at the same time in background mode
+    unsigned generations = async_flush_ ? 2 : 1;
+    cell_size_ = reads_buffer_size / (generations * num_files_ * this->kmer_size());
     // Set sane minimum cell size
     if (cell_size_ < 16384)
       cell_size_ = 16384;
 
     INFO("Using cell size of " << cell_size_);
     kmer_buffers_.resize(nthreads);
-    for (unsigned i = 0; i < nthreads; ++i) {
-      KMerBuffer &entry = kmer_buffers_[i];
+    flush_buffers_.resize(async_flush_ ? nthreads : 0);
+    for (unsigned i = 0; i < nthreads; ++i)
+      kmer_buffers_[i].resize(num_files_, KMerVector<Seq>(this->K_, (size_t) (1.1 * (double) cell_size_)));
+    for (auto &entry : flush_buffers_)
       entry.resize(num_files_, KMerVector<Seq>(this->K_, (size_t) (1.1 * (double) cell_size_)));
-    }
+    VERIFY_MSG(!(in_memory_ && count_multiplicity_), "K-mer multiplicities cannot be counted in memory");
+    if (in_memory_)
+      memory_buckets_.assign(num_files_, KMerVector<Seq>(this->K_));
+    else
+      writer_.Open(out, count_multiplicity_);
 
     return out;
   }
@@ -131,55 +197,38 @@ class KMerSortingSplitter : public KMerSplitter<Seq> {
     return entry[idx].size() > cell_size_;
   }
   
-  void DumpBuffers(const path::files_t &ostreams) {
+  // If count is false, the k-mers of the buffers are recorded with zero
+  // multiplicity (e.g. they come from the contigs rather than from the reads).
+  void DumpBuffers(const path::files_t &ostreams, bool count = true) {
     VERIFY(ostreams.size() == num_files_ && kmer_buffers_[0].size() == num_files_);
-
-#   pragma omp parallel for
-    for (unsigned k = 0; k < num_files_; ++k) {
-      // Below k is thread id!
-      
-      size_t sz = 0;
-      for (size_t i = 0; i < kmer_buffers_.size(); ++i)
-        sz += kmer_buffers_[i][k].size();
-
-      KMerVector<Seq> SortBuffer(this->K_, sz);
-      for (auto & entry : kmer_buffers_) {
-        const auto &buffer = entry[k];
-        for (size_t j = 0; j < buffer.size(); ++j)
-          SortBuffer.push_back(buffer[j]);
-      }
-      libcxx::sort(SortBuffer.begin(), SortBuffer.end(), typename KMerVector<Seq>::less2_fast());
-      auto it = std::unique(SortBuffer.begin(), SortBuffer.end(), typename KMerVector<Seq>::equal_to());
-
-#     pragma omp critical
-      {
-        size_t cnt =  it - SortBuffer.begin();
-
-        // Write k-mers
-        FILE *f = fopen(ostreams[k].c_str(), "ab");
-        VERIFY_MSG(f, "Cannot open temporary file to write");
-        fwrite(SortBuffer.data(), SortBuffer.el_data_size(), cnt, f);
-        fclose(f);
-
-        // Write index
-        f = fopen((ostreams[k] + ".idx").c_str(), "ab");
-        VERIFY_MSG(f, "Cannot open temporary file to write");
-        fwrite(&cnt, sizeof(cnt), 1, f);
-        fclose(f);
-      }
+    VERIFY(in_memory_ || (writer_.is_open() && writer_.num_buckets() == num_files_));
+
+    if (!async_flush_) {
+      count_flush_ = count;
+      perf_counter pc;
+      FlushBuffers(kmer_buffers_);
+      writer_.ReportStall(pc.time());
+      return;
     }
 
-    for (auto & entry : kmer_buffers_)
-      for (auto & eentry : entry)
-        eentry.clear();
+    // Wait for the previous generation to hit the disk, then hand the
+    // current one to the writer and let the producers go on.
+    WaitFlush();
+    std::swap(kmer_buffers_, flush_buffers_);
+    count_flush_ = count;
+    flush_ = std::async(std::launch::async, [this]() { FlushBuffers(flush_buffers_); });
   }
 
   void ClearBuffers() {
-    for (auto & entry : kmer_buffers_)
-      for (auto & eentry : entry) {
-        eentry.clear();
-        eentry.shrink_to_fit();
-      }
+    WaitFlush();
+    writer_.Close();
+
+    for (auto *buffers : { &kmer_buffers_, &flush_buffers_ })
+      for (auto & entry : *buffers)
+        for (auto & eentry : entry) {
+          eentry.clear();
+          eentry.shrink_to_fit();
+        }
   }
   
   std::string GetRawKMersFname(unsigned suffix) const {
@@ -190,6 +239,56 @@ class KMerSortingSplitter : public KMerSplitter<Seq> {
     return (unsigned)(this->hash_(s, this->seed_) % total);
   }
 
+ private:
+  void WaitFlush() {
+    if (!flush_.valid())
+      return;
+
+    perf_counter pc;
+    flush_.get();
+    writer_.ReportStall(pc.time());
+  }
+
+  void FlushBuffers(std::vector<KMerBuffer> &buffers) {
+    perf_counter pc;
+    size_t bytes = 0;
+
+#   pragma omp parallel for num_threads(sort_threads_) schedule(dynamic) reduction(+ : bytes)
+    for (unsigned k = 0; k < num_files_; ++k) {
+      size_t sz = 0;
+      for (size_t i = 0; i < buffers.size(); ++i)
+        sz += buffers[i][k].size();
+
+      KMerVector<Seq> SortBuffer(this->K_, sz);
+      for (auto & entry : buffers) {
+        const auto &buffer = entry[k];
+        for (size_t j = 0; j < buffer.size(); ++j)
+          SortBuffer.push_back(buffer[j]);
+      }
+      std::vector<uint32_t> counts;
+      size_t cnt = count_multiplicity_ ? SortBuffer.sort_unique(counts) : SortBuffer.sort_unique();
+      if (!count_flush_)
+        std::fill(counts.begin(), counts.end(), 0);
+
+      // Each bucket is owned by the single iteration, no locking is necessary
+      if (in_memory_) {
+        KMerVector<Seq> &bucket = memory_buckets_[k];
+        if (bucket.size() + cnt > bucket.capacity())
+          bucket.reserve(std::max(bucket.size() + cnt, 2 * bucket.capacity()));
+        for (size_t j = 0; j < cnt; ++j)
+          bucket.push_back(SortBuffer[j]);
+        bytes += cnt * SortBuffer.el_data_size();
+      } else
+        bytes += writer_.Write(k, SortBuffer.data(), SortBuffer.el_data_size(), cnt,
+                               count_multiplicity_ ? counts.data() : nullptr);
+    }
+
+    for (auto & entry : buffers)
+      for (auto & eentry : entry)
+        eentry.clear();
+
+    writer_.ReportFlush(bytes, pc.time());
+  }
 };
 
 template<class Seq, class traits = kmer_index_traits<Seq> >
@@ -250,22 +349,133 @@ public:
     path::files_t raw_kmers = splitter_.Split(num_buckets * num_threads);
 
     INFO("Starting k-mer counting.");
-    size_t kmers = 0;
-#   pragma omp parallel for shared(raw_kmers) num_threads(num_threads) schedule(dynamic) reduction(+:kmers)
-    for (unsigned iFile = 0; iFile < raw_kmers.size(); ++iFile) {
-      kmers += MergeKMers(raw_kmers[iFile], GetUniqueKMersFname(iFile), K);
-    }
-    INFO("K-mer counting done. There are " << kmers << " kmers in total. ");
 
-    INFO("Merging temporary buckets.");
+    // Plan the merge. Files larger than the chunk are split by pivot k-mers
+    // into several disjoint key ranges, so the skewed buckets are merged by
+    // several threads.
+    size_t total = 0;
+    for (const auto &fname : raw_kmers)
+      total += path::file_size(fname);
+    size_t chunk = std::max(total / (4 * num_threads), size_t(64 * 1024 * 1024)) / kmer_size();
+
+    std::vector<MergePlan> plans(raw_kmers.size());
+#   pragma omp parallel for shared(raw_kmers, plans) num_threads(num_threads) schedule(dynamic)
+    for (unsigned iFile = 0; iFile < raw_kmers.size(); ++iFile)
+      plans[iFile] = PlanMerge(raw_kmers[iFile], K, chunk, num_threads);
+
+    // The parts go to the merged bucket file one after another: file by file,
+    // part by part. Tasks are interleaved over the buckets, so the preceding
+    // part of the bucket is usually complete when the next one starts.
+    std::vector<BucketOutput> outputs(num_buckets);
+    size_t max_parts = 0;
     for (unsigned i = 0; i < num_buckets; ++i) {
-      std::string ofname = GetMergedKMersFname(i);
-      std::ofstream ofs(ofname.c_str(), std::ios::out | std::ios::binary);
       for (unsigned j = 0; j < num_threads; ++j) {
-        BucketStorage ins(GetUniqueKMersFname(i + j * num_buckets), Seq::GetDataSize(K), /* unlink */ true);
-        ofs.write((const char*)ins.data(), ins.data_size());
+        unsigned iFile = i + j * num_buckets;
+        for (unsigned part = 0; part < plans[iFile].parts; ++part)
+          outputs[i].parts.emplace_back(iFile, part);
       }
+      outputs[i].complete.resize(outputs[i].parts.size(), false);
+      outputs[i].spilled.resize(outputs[i].parts.size(), false);
+      max_parts = std::max(max_parts, outputs[i].parts.size());
     }
+    std::vector<std::pair<unsigned, unsigned>> tasks;
+    for (unsigned order = 0; order < max_parts; ++order)
+      for (unsigned i = 0; i < num_buckets; ++i)
+        if (order < outputs[i].parts.size())
+          tasks.emplace_back(i, order);
+    if (tasks.size() > raw_kmers.size())
+      INFO("Merging " << raw_kmers.size() << " files in " << tasks.size() << " parts");
+
+    // Raw file is mapped once and shared between all its parts
+    bool with_counts = splitter_.count_multiplicity();
+    std::vector<std::shared_ptr<RawStorage>> inputs(raw_kmers.size());
+    std::vector<std::shared_ptr<CountStorage>> input_counts(raw_kmers.size());
+    std::vector<unsigned> pending(raw_kmers.size());
+    for (unsigned iFile = 0; iFile < raw_kmers.size(); ++iFile)
+      pending[iFile] = plans[iFile].parts;
+
+    size_t kmers = 0;
+#   pragma omp parallel for shared(raw_kmers, plans, tasks, inputs, input_counts, pending, outputs) num_threads(num_threads) schedule(dynamic) reduction(+:kmers)
+    for (size_t i = 0; i < tasks.size(); ++i) {
+      unsigned bucket = tasks[i].first, order = tasks[i].second;
+      BucketOutput &output = outputs[bucket];
+      unsigned iFile = output.parts[order].first, part = output.parts[order].second;
+
+      std::shared_ptr<RawStorage> ins;
+      std::shared_ptr<CountStorage> counts;
+#     pragma omp critical(merge_inputs)
+      {
+        if (!inputs[iFile]) {
+          inputs[iFile] = std::make_shared<RawStorage>(raw_kmers[iFile], Seq::GetDataSize(K), /* unlink */ false);
+          if (with_counts)
+            input_counts[iFile] = std::make_shared<CountStorage>(KMerBucketWriter::GetCountsFname(raw_kmers[iFile]),
+                                                                 /* unlink */ false, -1ULL);
+        }
+        ins = inputs[iFile];
+        counts = input_counts[iFile];
+      }
+
+      // The part is written directly to the bucket file if all the preceding
+      // ones are there, otherwise it is kept aside till they are
+      FILE *g = nullptr, *cg = nullptr;
+      bool spill = false;
+#     pragma omp critical(merge_outputs)
+      {
+        if (output.written == order) {
+          if (order == 0)
+            output.Open(GetMergedKMersFname(bucket), with_counts);
+          g = output.kmers;
+          cg = output.counts;
+        } else
+          spill = output.spilled[order] = true;
+      }
+      if (spill) {
+        std::string ofname = GetUniqueKMersFname(iFile, part);
+        g = OpenOutput(ofname);
+        if (with_counts)
+          cg = OpenOutput(KMerBucketWriter::GetCountsFname(ofname));
+      }
+
+      if (with_counts)
+        kmers += MergeKMersWithCounts(*ins, *counts, plans[iFile], part, g, cg);
+      else
+        kmers += MergeKMers(*ins, plans[iFile], part, g, K);
+
+      if (spill) {
+        fclose(g);
+        if (cg)
+          fclose(cg);
+      }
+
+#     pragma omp critical(merge_inputs)
+      {
+        if (--pending[iFile] == 0) {
+          inputs[iFile].reset();
+          input_counts[iFile].reset();
+        }
+      }
+
+#     pragma omp critical(merge_outputs)
+      {
+        output.complete[order] = true;
+        for (; output.written < output.parts.size() && output.complete[output.written]; ++output.written) {
+          if (!output.spilled[output.written])
+            continue;
+          const auto &spilled = output.parts[output.written];
+          AppendSpilled(GetUniqueKMersFname(spilled.first, spilled.second), output, K);
+        }
+        if (output.written == output.parts.size())
+          output.Close();
+      }
+    }
+
+    for (const auto &fname : raw_kmers) {
+      ::unlink(fname.c_str());
+      ::unlink((fname + ".idx").c_str());
+      if (with_counts)
+        ::unlink(KMerBucketWriter::GetCountsFname(fname).c_str());
+    }
+    INFO("K-mer counting done. There are " << kmers << " kmers in total. ");
 
     return kmers;
   }
@@ -302,6 +512,12 @@ public:
     return kmer_prefix_ + ".merged." + std::to_string(suffix);
   }
 
+  // Multiplicities of the k-mers of the merged file (one uint32_t per
+  // k-mer), available if the splitter counts them
+  std::string GetMergedCountsFname(unsigned suffix) const {
+    return KMerBucketWriter::GetCountsFname(GetMergedKMersFname(suffix));
+  }
+
   std::string GetFinalKMersFname() const {
     return kmer_prefix_ + ".final";
   }
@@ -312,88 +528,390 @@ private:
   int fd_;
   std::string kmer_prefix_;
 
-  std::string GetUniqueKMersFname(unsigned suffix) const {
-    return kmer_prefix_ + ".unique." + std::to_string(suffix);
+  typedef MMappedRecordArrayReader<typename Seq::DataType> RawStorage;
+  typedef MMappedRecordReader<uint32_t> CountStorage;
+
+  // Describes how the sorted runs of the raw k-mer file are split into the
+  // parts with disjoint key ranges: splits[run][part] is the first entry of
+  // the run belonging to the part.
+  struct MergePlan {
+    bool sorted;
+    unsigned parts;
+    std::vector<std::vector<size_t>> splits;
+
+    MergePlan() : sorted(false), parts(1) {}
+  };
+
+  // Merged bucket file being written along with the bookkeeping of its parts
+  struct BucketOutput {
+    std::vector<std::pair<unsigned, unsigned>> parts;
+    std::vector<bool> complete;
+    std::vector<bool> spilled;
+    size_t written;
+    FILE *kmers;
+    FILE *counts;
+
+    BucketOutput() : written(0), kmers(nullptr), counts(nullptr) {}
+
+    void Open(const std::string &fname, bool with_counts) {
+      kmers = OpenOutput(fname);
+      if (with_counts)
+        counts = OpenOutput(KMerBucketWriter::GetCountsFname(fname));
+    }
+
+    void Close() {
+      fclose(kmers);
+      if (counts)
+        fclose(counts);
+      kmers = counts = nullptr;
+    }
+  };
+
+  static FILE *OpenOutput(const std::string &fname) {
+    FILE *f = fopen(fname.c_str(), "wb");
+    VERIFY_MSG(f, "Cannot open temporary file to write");
+    return f;
   }
 
-  size_t MergeKMers(const std::string &ifname, const std::string &ofname,
-                    unsigned K) {
-    MMappedRecordArrayReader<typename Seq::DataType> ins(ifname, Seq::GetDataSize(K), /* unlink */ true);
+  // Appends the part, which had to be written aside, to the bucket file
+  void AppendSpilled(const std::string &fname, BucketOutput &output, unsigned K) const {
+    BucketStorage ins(fname, Seq::GetDataSize(K), /* unlink */ true);
+    fwrite(ins.data(), 1, ins.data_size(), output.kmers);
+    if (output.counts) {
+      CountStorage counts(KMerBucketWriter::GetCountsFname(fname), /* unlink */ true, -1ULL);
+      fwrite(counts.data(), 1, counts.data_size(), output.counts);
+    }
+  }
+
+  std::string GetUniqueKMersFname(unsigned suffix, unsigned part) const {
+    return kmer_prefix_ + ".unique." + std::to_string(suffix) + "." + std::to_string(part);
+  }
+
+  MergePlan PlanMerge(const std::string &ifname, unsigned K,
+                      size_t chunk, unsigned max_parts) const {
+    MergePlan plan;
 
     std::string IdxFileName = ifname + ".idx";
     if (FILE *f = fopen(IdxFileName.c_str(), "rb")) {
       fclose(f);
-      MMappedRecordReader<size_t> index(ifname + ".idx", true, -1ULL);
-
-      // INFO("Total runs: " << index.size());
-
-      // Prepare runs
-      std::vector<adt::iterator_range<decltype(ins.begin())>> ranges;
-      auto beg = ins.begin();
-      for (size_t sz : index) {
-        auto end = std::next(beg, sz);
-        ranges.push_back(adt::make_range(beg, end));
-        VERIFY(std::is_sorted(beg, end, array_less<typename Seq::DataType>()));
-        beg = end;
+    } else {
+      // No runs, the file will be sorted as a whole
+      return plan;
+    }
+
+    plan.sorted = true;
+    MMappedRecordReader<size_t> index(IdxFileName, /* unlink */ false, -1ULL);
+    RawStorage ins(ifname, Seq::GetDataSize(K), /* unlink */ false);
+
+    size_t sz = ins.size();
+    plan.parts = (unsigned)std::min<size_t>(std::max<size_t>((sz + chunk - 1) / chunk, 1), max_parts);
+
+    // Sample pivots from all the runs
+    KMerVector<Seq> samples(K, plan.parts > 1 ? 16 * plan.parts * index.size() : 1);
+    size_t start = 0;
+    for (size_t rsz : index) {
+      auto beg = ins.begin() + start;
+      VERIFY(std::is_sorted(beg, beg + rsz, array_less<typename Seq::DataType>()));
+      if (plan.parts > 1) {
+        size_t cnt = std::min<size_t>(rsz, 16 * plan.parts);
+        for (size_t j = 0; j < cnt; ++j)
+          samples.push_back(*(beg + j * rsz / cnt));
       }
+      start += rsz;
+    }
+    libcxx::sort(samples.begin(), samples.end(), array_less<typename Seq::DataType>());
+
+    start = 0;
+    for (size_t rsz : index) {
+      auto beg = ins.begin() + start, end = beg + rsz;
+      std::vector<size_t> split(plan.parts + 1);
+      split[0] = start;
+      for (unsigned part = 1; part < plan.parts; ++part) {
+        auto pivot = *(samples.begin() + part * samples.size() / plan.parts);
+        split[part] = std::lower_bound(beg, end, pivot, array_less<typename Seq::DataType>()) - ins.begin();
+        // Parts should go one after another
+        split[part] = std::max(split[part], split[part - 1]);
+      }
+      split[plan.parts] = start + rsz;
+      plan.splits.push_back(std::move(split));
+      start += rsz;
+    }
 
-      // Construct tree on top entries of runs
-      adt::loser_tree<decltype(beg),
-                      array_less<typename Seq::DataType>> tree(ranges);
+    return plan;
+  }
 
-      if (tree.empty()) {
-        FILE *g = fopen(ofname.c_str(), "ab");
-        VERIFY_MSG(g, "Cannot open temporary file to write");
-        fclose(g);
-        return 0;
+  size_t MergeKMers(RawStorage &ins, const MergePlan &plan, unsigned part,
+                    FILE *g, unsigned K) {
+    if (!plan.sorted) {
+      VERIFY(part == 0);
+
+      // Sort the stuff
+      size_t cnt = sort_unique_kmers(ins.data(), ins.size(), Seq::GetDataSize(K));
+      fwrite(ins.data(), sizeof(typename Seq::DataType) * Seq::GetDataSize(K), cnt, g);
+
+      return cnt;
+    }
+
+    // Prepare runs
+    std::vector<adt::iterator_range<decltype(ins.begin())>> ranges;
+    for (const auto &split : plan.splits)
+      ranges.push_back(adt::make_range(ins.begin() + split[part], ins.begin() + split[part + 1]));
+
+    // Construct tree on top entries of runs
+    adt::loser_tree<decltype(ins.begin()),
+                    array_less<typename Seq::DataType>> tree(ranges);
+
+    if (tree.empty())
+      return 0;
+
+    // Write it down!
+    KMerVector<Seq> buf(K, 1024*1024);
+    auto pval = tree.pop();
+    size_t total = 0;
+    while (!tree.empty()) {
+      buf.clear();
+      for (size_t cnt = 0; cnt < buf.capacity() && !tree.empty(); ) {
+        auto cval = tree.pop();
+        if (!array_equal_to<typename Seq::DataType>()(pval, cval)) {
+          buf.push_back(pval);
+          pval = cval;
+          cnt += 1;
+        }
       }
+      total += buf.size();
+
+      fwrite(buf.data(), buf.el_data_size(), buf.size(), g);
+    }
+
+    // Handle very last value
+    fwrite(pval.data(), pval.data_size(), 1, g);
+    total += 1;
+
+    return total;
+  }
 
-      // Write it down!
-      KMerVector<Seq> buf(K, 1024*1024);
-      auto pval = tree.pop();
-      size_t total = 0;
-      while (!tree.empty()) {
-          buf.clear();
-          for (size_t cnt = 0; cnt < buf.capacity() && !tree.empty(); ) {
-              auto cval = tree.pop();
-              if (!array_equal_to<typename Seq::DataType>()(pval, cval)) {
-                  buf.push_back(pval);
-                  pval = cval;
-                  cnt += 1;
-              }
-          }
-          total += buf.size();
-
-          FILE *g = fopen(ofname.c_str(), "ab");
-          VERIFY_MSG(g, "Cannot open temporary file to write");
-          fwrite(buf.data(), buf.el_data_size(), buf.size(), g);
-          fclose(g);
+  // Iterates over the positions of the entries of the raw file
+  class PositionIterator : public boost::iterator_facade<PositionIterator, size_t,
+                                                         boost::forward_traversal_tag, size_t> {
+   public:
+    explicit PositionIterator(size_t pos = 0) : pos_(pos) {}
+
+   private:
+    friend class boost::iterator_core_access;
+
+    size_t dereference() const { return pos_; }
+    bool equal(const PositionIterator &that) const { return pos_ == that.pos_; }
+    void increment() { ++pos_; }
+
+    size_t pos_;
+  };
+
+  // Orders the positions of the raw file by the k-mers stored there
+  struct PositionLess {
+    const typename Seq::DataType *data;
+    size_t el_sz;
+
+    bool operator()(size_t a, size_t b) const {
+      const typename Seq::DataType *pa = data + a * el_sz, *pb = data + b * el_sz;
+      return std::lexicographical_compare(pa, pa + el_sz, pb, pb + el_sz);
+    }
+  };
+
+  // Same as MergeKMers, but sums up the multiplicities of the equal k-mers
+  // coming from the different runs. The merged multiplicities are written to cg.
+  size_t MergeKMersWithCounts(RawStorage &ins, const CountStorage &counts, const MergePlan &plan, unsigned part,
+                              FILE *g, FILE *cg) {
+    VERIFY_MSG(plan.sorted, "K-mer multiplicities require the sorted runs");
+    VERIFY(counts.size() == ins.size());
+
+    // Merge the positions of the entries, so the multiplicity might be looked up
+    std::vector<adt::iterator_range<PositionIterator>> ranges;
+    for (const auto &split : plan.splits)
+      ranges.push_back(adt::make_range(PositionIterator(split[part]), PositionIterator(split[part + 1])));
+
+    const size_t el_sz = ins.elcnt();
+    const typename Seq::DataType *data = ins.data();
+    adt::loser_tree<PositionIterator, PositionLess> tree(ranges, PositionLess{data, el_sz});
+
+    std::vector<typename Seq::DataType> buf;
+    std::vector<uint32_t> cbuf;
+    const size_t buf_size = 1024 * 1024;
+    buf.reserve(buf_size * el_sz);
+    cbuf.reserve(buf_size);
+    size_t total = 0;
+    while (!tree.empty()) {
+      size_t pos = tree.pop();
+      const typename Seq::DataType *kmer = data + pos * el_sz;
+      if (!cbuf.empty() && std::equal(kmer, kmer + el_sz, buf.end() - el_sz)) {
+        uint64_t sum = uint64_t(cbuf.back()) + counts[pos];
+        cbuf.back() = uint32_t(std::min<uint64_t>(sum, std::numeric_limits<uint32_t>::max()));
+        continue;
       }
 
-      // Handle very last value
-      {
-        FILE *g = fopen(ofname.c_str(), "ab");
-        VERIFY_MSG(g, "Cannot open temporary file to write");
-        fwrite(pval.data(), pval.data_size(), 1, g);
-        fclose(g);
-        total += 1;
+      // Keep the last k-mer in the buffer, more entries of it might follow
+      if (cbuf.size() == buf_size) {
+        fwrite(buf.data(), sizeof(typename Seq::DataType) * el_sz, cbuf.size() - 1, g);
+        fwrite(cbuf.data(), sizeof(uint32_t), cbuf.size() - 1, cg);
+        buf.erase(buf.begin(), buf.end() - el_sz);
+        cbuf.erase(cbuf.begin(), cbuf.end() - 1);
+        total += buf_size - 1;
       }
-      
-      return total;
-    } else {
-      // Sort the stuff
-      libcxx::sort(ins.begin(), ins.end(), array_less<typename Seq::DataType>());
+      buf.insert(buf.end(), kmer, kmer + el_sz);
+      cbuf.push_back(counts[pos]);
+    }
+    fwrite(buf.data(), sizeof(typename Seq::DataType) * el_sz, cbuf.size(), g);
+    fwrite(cbuf.data(), sizeof(uint32_t), cbuf.size(), cg);
+    total += cbuf.size();
 
-      // FIXME: Use something like parallel version of unique_copy but with explicit
-      // resizing.
-      auto it = std::unique(ins.begin(), ins.end(), array_equal_to<typename Seq::DataType>());
+    return total;
+  }
+};
+
+template<class Seq, class traits = kmer_index_traits<Seq> >
+class KMerInMemoryCounter : public KMerCounter<Seq> {
+  typedef KMerCounter<Seq, traits> __super;
+  typedef typename traits::RawKMerStorage BucketStorage;
+  typedef typename traits::FinalKMerStorage FinalStorage;
+public:
+  KMerInMemoryCounter(const std::string &work_dir, KMerSortingSplitter<Seq> &splitter)
+      : work_dir_(work_dir), splitter_(splitter), final_saved_(false) {
+    std::string prefix = path::append_path(work_dir, "kmers_XXXXXX");
+    char *tempprefix = strcpy(new char[prefix.length() + 1], prefix.c_str());
+    VERIFY_MSG(-1 != (fd_ = ::mkstemp(tempprefix)), "Cannot create temporary file");
+    kmer_prefix_ = tempprefix;
+    delete[] tempprefix;
+  }
+
+  ~KMerInMemoryCounter() {
+    ::close(fd_);
+    ::unlink(kmer_prefix_.c_str());
+  }
 
-      MMappedRecordArrayWriter<typename Seq::DataType> os(ofname, Seq::GetDataSize(K));
-      os.resize(it - ins.begin());
-      std::copy(ins.begin(), it, os.begin());
+  // Rough estimate: unique k-mers are kept up to three times (splitter
+  // buckets with the growth slack and the final copy). The budget is half
+  // of the memory limit, as the index building below is limited by it.
+  static bool FitsInMemory(unsigned K, size_t kmers) {
+    size_t required = 3 * kmers * Seq::GetDataSize(K) * sizeof(typename Seq::DataType);
+    return required < get_memory_limit() / 2;
+  }
+
+  size_t kmer_size() const override {
+    return Seq::GetDataSize(splitter_.K()) * sizeof(typename Seq::DataType);
+  }
 
-      return it - ins.begin();
+  std::unique_ptr<BucketStorage> GetBucket(size_t idx, bool unlink = true) override {
+    VERIFY(idx < buckets_.size() && buckets_[idx]);
+    if (unlink)
+      return std::move(buckets_[idx]);
+
+    const BucketStorage &bucket = *buckets_[idx];
+    return std::unique_ptr<BucketStorage>(new BucketStorage((uint8_t*)bucket.data(), bucket.data_size(),
+                                                            bucket.elcnt(), /* owned */ false));
+  }
+
+  size_t Count(unsigned num_buckets, unsigned num_threads) override {
+    unsigned K = splitter_.K();
+    size_t el_size = Seq::GetDataSize(K);
+
+    bool in_memory = splitter_.in_memory();
+    splitter_.set_in_memory(true);
+    splitter_.Split(num_buckets);
+
+    INFO("Starting in-memory k-mer counting.");
+    buckets_.clear();
+    buckets_.resize(num_buckets);
+    size_t kmers = 0;
+#   pragma omp parallel for num_threads(num_threads) schedule(dynamic) reduction(+:kmers)
+    for (unsigned i = 0; i < num_buckets; ++i) {
+      KMerVector<Seq> &bucket = splitter_.GetInMemoryBucket(i);
+      size_t cnt = bucket.sort_unique();
+
+      size_t sz = cnt * bucket.el_data_size();
+      uint8_t *region = AllocateRegion(sz);
+      if (sz)
+        memcpy(region, bucket.data(), sz);
+      buckets_[i].reset(new BucketStorage(region, sz, el_size));
+
+      bucket.clear();
+      bucket.shrink_to_fit();
+      kmers += cnt;
+    }
+    splitter_.ReleaseInMemoryBuckets();
+    splitter_.set_in_memory(in_memory);
+    INFO("K-mer counting done. There are " << kmers << " kmers in total. ");
+
+    return kmers;
+  }
+
+  void MergeBuckets(unsigned num_buckets) override {
+    unsigned K = splitter_.K();
+    VERIFY(num_buckets == buckets_.size());
+
+    INFO("Merging final buckets.");
+
+    size_t sz = 0;
+    for (const auto &bucket : buckets_)
+      if (bucket)
+        sz += bucket->data_size();
+
+    uint8_t *region = AllocateRegion(sz), *cur = region;
+    for (auto &bucket : buckets_) {
+      if (!bucket)
+        continue;
+      if (bucket->data_size())
+        memcpy(cur, bucket->data(), bucket->data_size());
+      cur += bucket->data_size();
+      bucket.reset();
+    }
+
+    final_.reset(new FinalStorage(region, sz, Seq::GetDataSize(K)));
+    final_saved_ = false;
+  }
+
+  size_t CountAll(unsigned num_buckets, unsigned num_threads, bool merge = true) override {
+    size_t kmers = Count(num_buckets, num_threads);
+    if (merge)
+      MergeBuckets(num_buckets);
+
+    return kmers;
+  }
+
+  std::unique_ptr<typename __super::FinalKMerStorage> GetFinalKMers() override {
+    VERIFY(final_);
+    return std::move(final_);
+  }
+
+  // Users iterating over the k-mers from the file still need the final
+  // k-mers on disk. Save them on demand.
+  std::string GetFinalKMersFname() {
+    std::string ofname = kmer_prefix_ + ".final";
+    if (!final_saved_) {
+      VERIFY(final_);
+      std::ofstream ofs(ofname.c_str(), std::ios::out | std::ios::binary);
+      ofs.write((const char*)final_->data(), final_->data_size());
+      final_saved_ = true;
     }
+
+    return ofname;
+  }
+
+private:
+  std::string work_dir_;
+  KMerSortingSplitter<Seq> &splitter_;
+  int fd_;
+  std::string kmer_prefix_;
+  std::vector<std::unique_ptr<BucketStorage>> buckets_;
+  std::unique_ptr<FinalStorage> final_;
+  bool final_saved_;
+
+  static uint8_t *AllocateRegion(size_t sz) {
+    if (!sz)
+      return NULL;
+
+    void *res = mmap(NULL, sz, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
+    VERIFY_MSG(res != MAP_FAILED,
+               "mmap(2) failed. Reason: " << strerror(errno) << ". Error code: " << errno);
+    return (uint8_t*)res;
   }
 };
 
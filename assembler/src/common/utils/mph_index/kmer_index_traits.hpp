@@ -6,6 +6,7 @@
 //***************************************************************************
 
 #include "io/kmers/mmapped_reader.hpp"
+#include "adt/fixed_width_kmer.hpp"
 #include "mphf.hpp"
 
 template<class Seq>
@@ -21,7 +22,7 @@ struct kmer_index_traits {
 
   struct raw_equal_to {
     bool operator()(const Seq &lhs, const KMerRawReference rhs) {
-      return (array_equal_to<typename Seq::DataType>()(lhs.data(), lhs.data_size(), rhs));
+      return kmer_words_equal(lhs.data(), rhs.data(), lhs.data_size());
     }
   };
 
@@ -88,13 +88,33 @@ namespace emphf {
 
         template <typename T, typename Adaptor>
         uint64_t lookup(const T &val, Adaptor adaptor)
+        {
+            uint64_t nodes[3];
+            hash_nodes(val, adaptor, nodes);
+            return lookup(nodes);
+        }
+
+        // Split lookup: hash_nodes() computes the hypergraph nodes of the
+        // value, prefetch() requests the memory lookup(nodes) is going to read.
+        template <typename T, typename Adaptor>
+        void hash_nodes(const T &val, Adaptor adaptor, uint64_t (&nodes)[3]) const
         {
             using std::get;
             auto hashes = m_hasher(adaptor(val));
-            uint64_t nodes[3] = {get<0>(hashes) % m_hash_domain,
-                                 m_hash_domain + (get<1>(hashes) % m_hash_domain),
-                                 2 * m_hash_domain + (get<2>(hashes) % m_hash_domain)};
+            nodes[0] = get<0>(hashes) % m_hash_domain;
+            nodes[1] = m_hash_domain + (get<1>(hashes) % m_hash_domain);
+            nodes[2] = 2 * m_hash_domain + (get<2>(hashes) % m_hash_domain);
+        }
 
+        void prefetch(const uint64_t (&nodes)[3]) const
+        {
+            m_bv.prefetch(nodes[0]);
+            m_bv.prefetch(nodes[1]);
+            m_bv.prefetch(nodes[2]);
+        }
+
+        uint64_t lookup(const uint64_t (&nodes)[3]) const
+        {
             uint64_t hidx = (m_bv[nodes[0]] + m_bv[nodes[1]] + m_bv[nodes[2]]) % 3;
             return m_bv.rank(nodes[hidx]);
         }
@@ -58,6 +58,13 @@ namespace emphf {
             return r;
         }
 
+        // Prefetches the word holding the pair and the rank of its block
+        void prefetch(uint64_t pos) const
+        {
+            __builtin_prefetch(m_bv.data().data() + pos / 32, 0, 1);
+            __builtin_prefetch(m_block_ranks.data() + pos / pairs_per_block, 0, 1);
+        }
+
         void swap(ranked_bitpair_vector& other)
         {
             m_bv.swap(other.m_bv);
@@ -134,6 +134,11 @@ bool check_existence(std::string const& path) {
             && (S_ISREG(st_buf.st_mode) || S_ISDIR(st_buf.st_mode));  // exists and (file or dir)
 }
 
+size_t file_size(std::string const& path) {
+    struct stat st_buf;
+    return (stat(path.c_str(), &st_buf) == 0 ? st_buf.st_size : 0);
+}
+
 void remove_if_exists(std::string const& path) {
     if (check_existence(path)) {
         if (is_regular_file(path)) // file
@@ -47,6 +47,8 @@ std::string parent_path(std::string const &path);
 
 bool check_existence(std::string const &path);
 
+size_t file_size(std::string const &path);
+
 void remove_if_exists(std::string const &path);
 
 std::string screen_whitespaces(std::string const &path);
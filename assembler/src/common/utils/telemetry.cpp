@@ -0,0 +1,338 @@
+//***************************************************************************
+//* Copyright (c) 2016 Saint Petersburg State University
+//* All Rights Reserved
+//* See file LICENSE for details.
+//***************************************************************************
+
+#include "utils/telemetry.hpp"
+#include "utils/logger/logger.hpp"
+#include "utils/verify.hpp"
+#include "utils/memory_limit.hpp"
+#include "utils/openmp_wrapper.h"
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#ifdef SPADES_USE_JEMALLOC
+# include <jemalloc/jemalloc.h>
+#endif
+
+namespace telemetry {
+
+namespace {
+
+double seconds(const timeval &tv) {
+    return (double) tv.tv_sec + (double) tv.tv_usec * 1e-6;
+}
+
+// Sizes of the regular files under the directory, symlinks are not followed
+size_t directory_size(const std::string &dir) {
+    DIR *d = opendir(dir.c_str());
+    if (!d)
+        return 0;
+
+    size_t res = 0;
+    while (dirent *entry = readdir(d)) {
+        std::string name(entry->d_name);
+        if (name == "." || name == "..")
+            continue;
+
+        std::string path = dir + "/" + name;
+        struct stat st;
+        if (lstat(path.c_str(), &st) != 0)
+            continue;
+        if (S_ISDIR(st.st_mode))
+            res += directory_size(path);
+        else if (S_ISREG(st.st_mode))
+            res += (size_t) st.st_size;
+    }
+    closedir(d);
+
+    return res;
+}
+
+// Reads "key: value" lines of /proc/self/io, missing file (e.g. not Linux) gives zeros
+void storage_io(size_t &read_bytes, size_t &write_bytes) {
+    std::ifstream in("/proc/self/io");
+    std::string key;
+    size_t value;
+    while (in >> key >> value) {
+        if (key == "read_bytes:")
+            read_bytes = value;
+        else if (key == "write_bytes:")
+            write_bytes = value;
+    }
+}
+
+size_t current_rss() {
+    std::ifstream in("/proc/self/statm");
+    size_t size = 0, resident = 0;
+    if (!(in >> size >> resident))
+        return 0;
+
+    return resident * (size_t) sysconf(_SC_PAGESIZE);
+}
+
+// CPU time of every thread of the process from /proc/self/task/<tid>/stat
+void threads_cpu(std::map<long, double> &res) {
+    DIR *d = opendir("/proc/self/task");
+    if (!d)
+        return;
+
+    double tick = 1.0 / (double) sysconf(_SC_CLK_TCK);
+    while (dirent *entry = readdir(d)) {
+        if (entry->d_name[0] == '.')
+            continue;
+
+        std::ifstream in(std::string("/proc/self/task/") + entry->d_name + "/stat");
+        std::string stat((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        // Thread name may contain spaces, the fields are counted after it
+        size_t pos = stat.rfind(')');
+        if (pos == std::string::npos)
+            continue;
+
+        std::istringstream fields(stat.substr(pos + 1));
+        std::string field;
+        double utime = 0, stime = 0;
+        // utime and stime are the 14th and 15th fields, the 3rd one follows the name
+        for (size_t i = 3; i <= 15 && fields >> field; ++i) {
+            if (i == 14)
+                utime = std::stod(field);
+            else if (i == 15)
+                stime = std::stod(field);
+        }
+        res[std::stol(entry->d_name)] = (utime + stime) * tick;
+    }
+    closedir(d);
+}
+
+std::string escape(const std::string &s) {
+    std::string res;
+    for (char c : s) {
+        switch (c) {
+            case '"': res += "\\\""; break;
+            case '\\': res += "\\\\"; break;
+            case '\n': res += "\\n"; break;
+            case '\t': res += "\\t"; break;
+            default:
+                if ((unsigned char) c < 0x20) {
+                    char buf[8];
+                    snprintf(buf, sizeof buf, "\\u%04x", c);
+                    res += buf;
+                } else {
+                    res += c;
+                }
+        }
+    }
+    return res;
+}
+
+void WriteCounters(std::ostream &os, const std::map<std::string, double> &counters) {
+    os << "{";
+    for (auto it = counters.begin(); it != counters.end(); ++it) {
+        os << (it == counters.begin() ? "" : ", ") << "\"" << escape(it->first) << "\": ";
+        // Most of the counters are integral
+        if (std::floor(it->second) == it->second && std::fabs(it->second) < 1e15)
+            os << (long long) it->second;
+        else
+            os << it->second;
+    }
+    os << "}";
+}
+
+}
+
+Report::Report()
+        : threads_(1) {
+}
+
+void Report::set_tmp_dir(const std::string &dir) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tmp_dir_ = dir;
+}
+
+void Report::set_label(const std::string &key, const std::string &value) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    labels_[key] = value;
+}
+
+Usage Report::Sample() const {
+    Usage res;
+    res.wall = timer_.time();
+
+    rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    res.user_cpu = seconds(ru.ru_utime);
+    res.sys_cpu = seconds(ru.ru_stime);
+    res.max_rss = get_max_rss() * 1024;
+    res.rss = current_rss();
+
+#ifdef SPADES_USE_JEMALLOC
+    // jemalloc statistics are refreshed on the epoch update
+    uint64_t epoch = 1;
+    size_t len = sizeof(epoch);
+    je_mallctl("epoch", &epoch, &len, &epoch, len);
+
+    const size_t *cactive = 0;
+    len = sizeof(cactive);
+    je_mallctl("stats.cactive", &cactive, &len, NULL, 0);
+    res.cactive = *cactive;
+
+    len = sizeof(res.active);
+    je_mallctl("stats.active", &res.active, &len, NULL, 0);
+#endif
+
+    storage_io(res.read_bytes, res.write_bytes);
+    if (!tmp_dir_.empty())
+        res.tmp_bytes = directory_size(tmp_dir_);
+    threads_cpu(res.thread_cpu);
+
+    return res;
+}
+
+std::map<std::string, double> &Report::counters() {
+    return open_.empty() ? counters_ : scopes_[open_.back()].counters;
+}
+
+size_t Report::open(const std::string &name, const std::string &id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    threads_ = std::max(threads_, (unsigned) omp_get_max_threads());
+
+    Scope scope;
+    scope.name = name;
+    scope.id = id;
+    scope.depth = open_.size();
+    scope.open = true;
+    scope.start = Sample();
+    scopes_.push_back(scope);
+    open_.push_back(scopes_.size() - 1);
+
+    return scopes_.size() - 1;
+}
+
+void Report::close(size_t scope) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    VERIFY_MSG(!open_.empty() && open_.back() == scope,
+               "Telemetry scope " << scopes_[scope].id << " is not the innermost one");
+    scopes_[scope].finish = Sample();
+    scopes_[scope].open = false;
+    open_.pop_back();
+}
+
+void Report::add(const std::string &counter, double value) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    counters()[counter] += value;
+}
+
+void Report::set(const std::string &counter, double value) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    counters()[counter] = value;
+}
+
+void Report::WriteJson(const std::string &filename) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Usage now = Sample();
+
+    std::ofstream os(filename);
+    os << std::setprecision(6) << std::fixed;
+    os << "{\n  \"labels\": {";
+    for (auto it = labels_.begin(); it != labels_.end(); ++it)
+        os << (it == labels_.begin() ? "" : ", ") << "\"" << escape(it->first) << "\": \"" << escape(it->second) << "\"";
+    os << "},\n";
+    os << "  \"threads\": " << threads_ << ",\n";
+    os << "  \"wall\": " << now.wall << ",\n";
+    os << "  \"cpu_user\": " << now.user_cpu << ",\n";
+    os << "  \"cpu_sys\": " << now.sys_cpu << ",\n";
+    os << "  \"max_rss\": " << now.max_rss << ",\n";
+    os << "  \"counters\": ";
+    WriteCounters(os, counters_);
+    os << ",\n  \"scopes\": [";
+
+    for (size_t i = 0; i < scopes_.size(); ++i) {
+        const Scope &scope = scopes_[i];
+        const Usage &start = scope.start, &finish = scope.open ? now : scope.finish;
+        double wall = finish.wall - start.wall;
+        double cpu = (finish.user_cpu - start.user_cpu) + (finish.sys_cpu - start.sys_cpu);
+
+        os << (i ? "," : "") << "\n    {\n";
+        os << "      \"name\": \"" << escape(scope.name) << "\",\n";
+        os << "      \"id\": \"" << escape(scope.id) << "\",\n";
+        os << "      \"depth\": " << scope.depth << ",\n";
+        os << "      \"start\": " << start.wall << ",\n";
+        os << "      \"wall\": " << wall << ",\n";
+        os << "      \"cpu_user\": " << finish.user_cpu - start.user_cpu << ",\n";
+        os << "      \"cpu_sys\": " << finish.sys_cpu - start.sys_cpu << ",\n";
+        os << "      \"utilization\": " << (wall > 0 ? cpu / (wall * threads_) : 0.) << ",\n";
+
+        // Busy fraction of every thread which was alive at the end of the scope, busiest first
+        std::vector<double> utilization;
+        for (const auto &entry : finish.thread_cpu) {
+            auto it = start.thread_cpu.find(entry.first);
+            double busy = entry.second - (it == start.thread_cpu.end() ? 0. : it->second);
+            utilization.push_back(wall > 0 ? busy / wall : 0.);
+        }
+        std::sort(utilization.rbegin(), utilization.rend());
+        os << "      \"thread_utilization\": [";
+        for (size_t j = 0; j < utilization.size(); ++j)
+            os << (j ? ", " : "") << utilization[j];
+        os << "],\n";
+
+        os << "      \"rss\": " << finish.rss << ",\n";
+        os << "      \"max_rss\": " << finish.max_rss << ",\n";
+        os << "      \"active\": " << finish.active << ",\n";
+        os << "      \"cactive\": " << finish.cactive << ",\n";
+        os << "      \"read_bytes\": " << finish.read_bytes - start.read_bytes << ",\n";
+        os << "      \"write_bytes\": " << finish.write_bytes - start.write_bytes << ",\n";
+        os << "      \"tmp_bytes\": " << finish.tmp_bytes << ",\n";
+        os << "      \"counters\": ";
+        WriteCounters(os, scope.counters);
+        os << "\n    }";
+    }
+    os << "\n  ]\n}\n";
+}
+
+void Report::WriteTrace(const std::string &filename) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Usage now = Sample();
+    long pid = (long) getpid();
+
+    std::ofstream os(filename);
+    os << std::setprecision(3) << std::fixed;
+    os << "{\"traceEvents\": [\n";
+
+    std::string process_name = "spades";
+    for (const auto &label : labels_)
+        process_name += " " + label.first + "=" + label.second;
+    os << "  {\"name\": \"process_name\", \"ph\": \"M\", \"pid\": " << pid << ", \"tid\": 0, "
+       << "\"args\": {\"name\": \"" << escape(process_name) << "\"}}";
+
+    // Scopes are complete events on the single track, nesting is restored by the viewer
+    for (const Scope &scope : scopes_) {
+        const Usage &start = scope.start, &finish = scope.open ? now : scope.finish;
+        os << ",\n  {\"name\": \"" << escape(scope.name) << "\", \"cat\": \"" << (scope.depth ? "phase" : "stage")
+           << "\", \"ph\": \"X\", \"pid\": " << pid << ", \"tid\": 0, \"ts\": " << start.wall * 1e6
+           << ", \"dur\": " << (finish.wall - start.wall) * 1e6 << ", \"args\": ";
+        WriteCounters(os, scope.counters);
+        os << "}";
+
+        for (const Usage *usage : {&start, &finish})
+            os << ",\n  {\"name\": \"memory\", \"ph\": \"C\", \"pid\": " << pid << ", \"ts\": " << usage->wall * 1e6
+               << ", \"args\": {\"rss_mb\": " << (double) usage->rss / 1024 / 1024
+               << ", \"cactive_mb\": " << (double) usage->cactive / 1024 / 1024 << "}}";
+    }
+    os << "\n]}\n";
+}
+
+Report &report() {
+    static Report instance;
+    return instance;
+}
+
+}
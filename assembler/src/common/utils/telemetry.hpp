@@ -0,0 +1,112 @@
+//***************************************************************************
+//* Copyright (c) 2016 Saint Petersburg State University
+//* All Rights Reserved
+//* See file LICENSE for details.
+//***************************************************************************
+
+#pragma once
+
+#include "utils/perfcounter.hpp"
+
+#include <boost/noncopyable.hpp>
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * Machine-readable performance report of the run. Stages and phases open
+ * scopes (see StageManager), resource usage is sampled when a scope is opened
+ * and closed, the code inside a scope can emit counters into it. The report
+ * is written as JSON and, optionally, as a Chrome trace-event timeline
+ * (chrome://tracing).
+ */
+namespace telemetry {
+
+// Resource usage of the process at some point of time
+struct Usage {
+    double wall;                        // seconds since the report start
+    double user_cpu, sys_cpu;           // seconds
+    size_t rss, max_rss;                // bytes
+    size_t active, cactive;             // jemalloc stats.active / stats.cactive, 0 without jemalloc
+    size_t read_bytes, write_bytes;     // storage I/O of the process
+    size_t tmp_bytes;                   // size of the temporary directory
+    std::map<long, double> thread_cpu;  // CPU seconds by thread id
+
+    Usage()
+            : wall(0), user_cpu(0), sys_cpu(0), rss(0), max_rss(0), active(0), cactive(0),
+              read_bytes(0), write_bytes(0), tmp_bytes(0) { }
+};
+
+class Report : private boost::noncopyable {
+public:
+    struct Scope {
+        std::string name;
+        std::string id;
+        size_t depth;
+        bool open;
+        Usage start, finish;
+        std::map<std::string, double> counters;
+    };
+
+    Report();
+
+    // Temporary directory to be watched, empty one is not watched
+    void set_tmp_dir(const std::string &dir);
+
+    // Run-wide value written to the report header, e.g. K
+    void set_label(const std::string &key, const std::string &value);
+
+    size_t open(const std::string &name, const std::string &id);
+
+    void close(size_t scope);
+
+    // Counters go to the innermost open scope
+    void add(const std::string &counter, double value);
+
+    void set(const std::string &counter, double value);
+
+    void WriteJson(const std::string &filename) const;
+
+    void WriteTrace(const std::string &filename) const;
+
+private:
+    Usage Sample() const;
+
+    std::map<std::string, double> &counters();
+
+    mutable std::mutex mutex_;
+    perf_counter timer_;
+    std::string tmp_dir_;
+    unsigned threads_;
+    std::map<std::string, std::string> labels_;
+    std::map<std::string, double> counters_;
+    std::vector<Scope> scopes_;
+    std::vector<size_t> open_;
+};
+
+Report &report();
+
+inline void add(const std::string &counter, double value) {
+    report().add(counter, value);
+}
+
+inline void set(const std::string &counter, double value) {
+    report().set(counter, value);
+}
+
+class ScopeGuard : private boost::noncopyable {
+public:
+    ScopeGuard(const std::string &name, const std::string &id)
+            : scope_(report().open(name, id)) { }
+
+    ~ScopeGuard() {
+        report().close(scope_);
+    }
+
+private:
+    size_t scope_;
+};
+
+}
@@ -0,0 +1,125 @@
+//***************************************************************************
+//* Copyright (c) 2016 Saint Petersburg State University
+//* All Rights Reserved
+//* See file LICENSE for details.
+//***************************************************************************
+
+#pragma once
+
+#include "modules/alignment/bwa_index.hpp"
+#include "pipeline/library.hpp"
+#include "utils/verify.hpp"
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace corrector {
+
+/*
+ * Alignments of one library to one contig. Reads are kept in memory and
+ * appended to the spill file on request, paired reads are stored mate after mate.
+ */
+class AlignmentStorage {
+    typedef alignment::SequenceAlignment Alignment;
+
+    io::LibraryType type_;
+    std::string spill_file_;
+    std::vector<Alignment> reads_;
+    size_t bytes_;
+    size_t spilled_;
+
+    template<class T>
+    static void WriteVector(std::ostream &os, const T &v) {
+        size_t size = v.size();
+        os.write((const char*) &size, sizeof(size));
+        os.write((const char*) v.data(), size * sizeof(v[0]));
+    }
+
+    template<class T>
+    static bool ReadVector(std::istream &is, T &v) {
+        size_t size;
+        if (!is.read((char*) &size, sizeof(size)))
+            return false;
+        v.resize(size);
+        return size == 0 || is.read((char*) &v[0], size * sizeof(v[0]));
+    }
+
+    static void BinWrite(std::ostream &os, const Alignment &read) {
+        os.write((const char*) &read.ref, sizeof(read.ref));
+        os.write((const char*) &read.pos, sizeof(read.pos));
+        os.write((const char*) &read.flag, sizeof(read.flag));
+        os.write((const char*) &read.map_qual, sizeof(read.map_qual));
+        WriteVector(os, read.cigar);
+        WriteVector(os, read.seq);
+    }
+
+    static bool BinRead(std::istream &is, Alignment &read) {
+        is.read((char*) &read.ref, sizeof(read.ref));
+        is.read((char*) &read.pos, sizeof(read.pos));
+        is.read((char*) &read.flag, sizeof(read.flag));
+        is.read((char*) &read.map_qual, sizeof(read.map_qual));
+        return is && ReadVector(is, read.cigar) && ReadVector(is, read.seq);
+    }
+
+public:
+    AlignmentStorage(io::LibraryType type, const std::string &spill_file)
+            : type_(type), spill_file_(spill_file), bytes_(0), spilled_(0) {
+    }
+
+    io::LibraryType type() const {
+        return type_;
+    }
+
+    bool paired() const {
+        return type_ == io::LibraryType::PairedEnd;
+    }
+
+    size_t size() const {
+        return spilled_ + reads_.size();
+    }
+
+    //Memory taken by the reads which are not spilled
+    size_t bytes() const {
+        return bytes_;
+    }
+
+    //Memory taken by the record
+    static size_t byte_size(const Alignment &read) {
+        return sizeof(Alignment) + read.cigar.capacity() * sizeof(uint32_t) + read.seq.capacity();
+    }
+
+    void Add(Alignment &&read) {
+        bytes_ += byte_size(read);
+        reads_.push_back(std::move(read));
+    }
+
+    void Spill() {
+        if (reads_.empty())
+            return;
+        std::ofstream os(spill_file_, std::ios_base::binary | std::ios_base::app);
+        for (const auto &read : reads_)
+            BinWrite(os, read);
+        VERIFY_MSG(os, "Failed to write alignments to " << spill_file_);
+        spilled_ += reads_.size();
+        std::vector<Alignment>().swap(reads_);
+        bytes_ = 0;
+    }
+
+    //Calls f for every read, the spilled ones first, so the order is the order of addition
+    template<class F>
+    void ForEach(F f) const {
+        if (spilled_) {
+            std::ifstream is(spill_file_, std::ios_base::binary);
+            Alignment read;
+            for (size_t i = 0; i < spilled_; ++i) {
+                VERIFY_MSG(BinRead(is, read), "Failed to read alignments from " << spill_file_);
+                f(read);
+            }
+        }
+        for (const auto &read : reads_)
+            f(read);
+    }
+};
+
+}
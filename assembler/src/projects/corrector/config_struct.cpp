@@ -51,8 +51,8 @@ struct MappingTraits<corrector::corrector_config> {
         io.mapOptional("work_dir", cfg.work_dir, std::string("."));
         io.mapOptional("output_dir", cfg.output_dir, std::string("."));
         io.mapOptional("max_nthreads", cfg.max_nthreads, 1u);
+        io.mapOptional("max_memory", cfg.max_memory, 250u);
         io.mapRequired("strategy", cfg.strat);
-        io.mapOptional("bwa", cfg.bwa, std::string("."));
     }
 };
 }}
@@ -23,8 +23,8 @@ struct corrector_config {
     std::string work_dir;
     std::string output_dir;
     unsigned max_nthreads;
+    unsigned max_memory;
     Strategy strat;
-    std::string bwa;
 };
 
 void load(corrector::corrector_config& cfg, const std::string &filename);
@@ -9,11 +9,7 @@
 #include "config_struct.hpp"
 #include "variants_table.hpp"
 
-#include "io/reads/ireader.hpp"
-#include "io/reads/osequencestream.hpp"
-#include "io/reads/file_reader.hpp"
-#include "io/reads/single_read.hpp"
-#include "utils/path_helper.hpp"
+#include "utils/logger/logger.hpp"
 
 #include <boost/algorithm/string.hpp>
 
@@ -21,30 +17,18 @@ using namespace std;
 
 namespace corrector {
 
-void ContigProcessor::ReadContig() {
-    io::FileReadStream frs(contig_file_);
-    io::SingleRead cur_read;
-    frs >> cur_read;
-    if (!frs.eof()) {
-#pragma omp critical
-        {
-            ERROR("Non unique sequnce in one contig fasta!");
-        }
-    }
-    contig_name_ = cur_read.name();
-    contig_ = cur_read.GetSequenceString();
+//cigar operations are in the BAM encoding
+static char cigar_opchr(uint32_t op) {
+    return "MIDNSHP=X"[op & 0xf];
+}
 
-    output_contig_file_ = path::append_path(path::parent_path(contig_file_), path::basename(contig_file_) + ".ref.fasta");
-    charts_.resize(contig_.length());
+static uint32_t cigar_oplen(uint32_t op) {
+    return op >> 4;
 }
 
-void ContigProcessor::UpdateOneRead(const SingleSamRead &tmp, MappedSamStream &sm) {
+void ContigProcessor::UpdateOneRead(const SequenceAlignment &tmp) {
     unordered_map<size_t, position_description> all_positions;
-    if (tmp.contig_id() < 0) {
-        return;
-    }
-    auto cur_s = sm.get_contig_name(tmp.contig_id());
-    if (contig_name_.compare(cur_s) != 0) {
+    if (tmp.ref != contig_id_) {
         return;
     }
     CountPositions(tmp, all_positions);
@@ -124,37 +108,34 @@ size_t ContigProcessor::UpdateOneBase(size_t i, stringstream &ss, const unordere
 }
 
 
-bool ContigProcessor::CountPositions(const SingleSamRead &read, unordered_map<size_t, position_description> &ps) const {
+bool ContigProcessor::CountPositions(const SequenceAlignment &read, unordered_map<size_t, position_description> &ps) const {
 
-    if (read.contig_id() < 0) {
+    if (read.ref != contig_id_) {
         DEBUG("not this contig");
         return false;
     }
     //TODO: maybe change to read.is_properly_aligned() ?
-    if (read.map_qual() == 0) {
+    if (read.map_qual == 0) {
         DEBUG("zero qual");
         return false;
     }
-    int pos = read.pos();
-    if (pos < 0) {
-        WARN("Negative position " << pos << " found on read " << read.name() << ", skipping");
+    if (read.pos < 0) {
+        WARN("Negative position " << read.pos << " found, skipping the read");
         return false;
     }
-    size_t position = size_t(pos);
+    size_t position = size_t(read.pos);
     int mate = 1;  // bonus for mate mapped can be here;
-    size_t l_read = (size_t) read.data_len();
-    size_t l_cigar = read.cigar_len();
+    size_t l_read = read.seq.length();
+    size_t l_cigar = read.cigar.size();
 
     int aligned_length = 0;
-    uint32_t *cigar = read.cigar_ptr();
+    const auto &cigar = read.cigar;
     //* in cigar;
     if (l_cigar == 0)
         return false;
-    if (bam_cigar_opchr(cigar[0]) == '*')
-        return false;
     for (size_t i = 0; i < l_cigar; i++)
-        if (bam_cigar_opchr(cigar[i]) == 'M')
-            aligned_length += bam_cigar_oplen(cigar[i]);
+        if (cigar_opchr(cigar[i]) == 'M')
+            aligned_length += cigar_oplen(cigar[i]);
 //It's about bad aligned reads, but whether it is necessary?
     double read_len_double = (double) l_read;
     if ((aligned_length < min(read_len_double * 0.4, 40.0)) && (position > read_len_double / 2) && (contig_.length() > read_len_double / 2 + (double) position)) {
@@ -165,14 +146,14 @@ bool ContigProcessor::CountPositions(const SingleSamRead &read, unordered_map<si
     size_t skipped = 0;
     size_t deleted = 0;
     string insertion_string = "";
-    auto seq = read.seq_ptr();
+    const auto &seq = read.seq;
     for (size_t i = 0; i < l_read; i++) {
         DEBUG(i << " " << position << " " << skipped);
-        if (shift + bam_cigar_oplen(cigar[state_pos]) <= i) {
-            shift += bam_cigar_oplen(cigar[state_pos]);
+        if (shift + cigar_oplen(cigar[state_pos]) <= i) {
+            shift += cigar_oplen(cigar[state_pos]);
             state_pos += 1;
         }
-        if (insertion_string != "" and bam_cigar_opchr(cigar[state_pos]) != 'I') {
+        if (insertion_string != "" and cigar_opchr(cigar[state_pos]) != 'I') {
             VERIFY(i + position >= skipped + 1);
             size_t ind = i + position - skipped - 1;
             if (ind >= contig_.length())
@@ -180,17 +161,16 @@ bool ContigProcessor::CountPositions(const SingleSamRead &read, unordered_map<si
             ps[ind].insertions[insertion_string] += 1;
             insertion_string = "";
         }
-        char cur_state = bam_cigar_opchr(cigar[state_pos]);
+        char cur_state = cigar_opchr(cigar[state_pos]);
         if (cur_state == 'M') {
             VERIFY(i >= deleted);
             if (i + position < skipped) {
                 WARN(i << " " << position << " " << skipped);
-                INFO(read.name());
             }
             VERIFY(i + position >= skipped);
 
             size_t ind = i + position - skipped;
-            size_t cur = var_to_pos[(int) bam_nt16_rev_table[bam1_seqi(seq, i - deleted)]];
+            size_t cur = var_to_pos[(int) seq[i - deleted]];
             if (ind >= contig_.length())
                 continue;
             ps[ind].votes[cur] = ps[ind].votes[cur] + mate;
@@ -204,10 +184,10 @@ bool ContigProcessor::CountPositions(const SingleSamRead &read, unordered_map<si
                             break;
                         ps[ind].votes[Variants::Insertion] += mate;
                     }
-                    insertion_string += bam_nt16_rev_table[bam1_seqi(seq, i - deleted)];
+                    insertion_string += seq[i - deleted];
                 }
                 skipped += 1;
-            } else if (bam_cigar_opchr(cigar[state_pos]) == 'D') {
+            } else if (cigar_opchr(cigar[state_pos]) == 'D') {
                 if (i + position - skipped >= contig_.length())
                     break;
                 ps[i + position - skipped].votes[Variants::Deletion] += mate;
@@ -215,7 +195,7 @@ bool ContigProcessor::CountPositions(const SingleSamRead &read, unordered_map<si
             }
         }
     }
-    if (insertion_string != "" and bam_cigar_opchr(cigar[state_pos]) != 'I') {
+    if (insertion_string != "" and cigar_opchr(cigar[state_pos]) != 'I') {
         VERIFY(l_read + position >= skipped + 1);
         size_t ind = l_read + position - skipped - 1;
         if (ind < contig_.length()) {
@@ -227,12 +207,13 @@ bool ContigProcessor::CountPositions(const SingleSamRead &read, unordered_map<si
 }
 
 
-bool ContigProcessor::CountPositions(const PairedSamRead &read, unordered_map<size_t, position_description> &ps) const {
+bool ContigProcessor::CountPositions(const SequenceAlignment &left, const SequenceAlignment &right,
+                                     unordered_map<size_t, position_description> &ps) const {
 
     TRACE("starting pairing");
-    bool t1 = CountPositions(read.Left(), ps );
+    bool t1 = CountPositions(left, ps );
     unordered_map<size_t, position_description> tmp;
-    bool t2 = CountPositions(read.Right(), tmp);
+    bool t2 = CountPositions(right, tmp);
     //overlaps.. multimap? Look on qual?
     if (ps.size() == 0 || tmp.size() == 0) {
         //We do not need paired reads which are not really paired
@@ -245,36 +226,37 @@ bool ContigProcessor::CountPositions(const PairedSamRead &read, unordered_map<si
     return (t1 && t2);
 }
 
-size_t ContigProcessor::ProcessMultipleSamFiles() {
+size_t ContigProcessor::ProcessAlignments() {
     error_counts_.resize(kMaxErrorNum);
-    for (const auto &sf : sam_files_) {
-        MappedSamStream sm(sf.first);
-        while (!sm.eof()) {
-            SingleSamRead tmp;
-            sm >> tmp;
-
-            UpdateOneRead(tmp, sm);
-        }
-        sm.close();
+    for (const auto &storage : alignments_) {
+        storage.ForEach([&](const SequenceAlignment &tmp) {
+            UpdateOneRead(tmp);
+        });
     }
 
     ipp_.FillInterestingPositions(charts_);
-    for (const auto &sf : sam_files_) {
-        MappedSamStream sm(sf.first);
-        while (!sm.eof()) {
-            unordered_map<size_t, position_description> ps;
-            if (sf.second == io::LibraryType::PairedEnd ) {
-                PairedSamRead tmp;
-                sm >> tmp;
-                CountPositions(tmp, ps);
-            } else {
-                SingleSamRead tmp;
-                sm >> tmp;
+    for (const auto &storage : alignments_) {
+        if (storage.paired()) {
+            SequenceAlignment left;
+            bool has_left = false;
+            storage.ForEach([&](const SequenceAlignment &tmp) {
+                if (!has_left) {
+                    left = tmp;
+                    has_left = true;
+                    return;
+                }
+                has_left = false;
+                unordered_map<size_t, position_description> ps;
+                CountPositions(left, tmp, ps);
+                ipp_.UpdateInterestingRead(ps);
+            });
+        } else {
+            storage.ForEach([&](const SequenceAlignment &tmp) {
+                unordered_map<size_t, position_description> ps;
                 CountPositions(tmp, ps);
-            }
-            ipp_.UpdateInterestingRead(ps);
+                ipp_.UpdateInterestingRead(ps);
+            });
         }
-        sm.close();
     }
     ipp_.UpdateInterestingPositions();
     unordered_map<size_t, position_description> interesting_positions = ipp_.get_weights();
@@ -283,21 +265,19 @@ size_t ContigProcessor::ProcessMultipleSamFiles() {
     for (size_t i = 0; i < contig_.length(); i++) {
         total_changes += UpdateOneBase(i, s_new_contig, interesting_positions);
     }
+    corrected_contig_ = s_new_contig.str();
     vector<string> contig_name_splitted;
     boost::split(contig_name_splitted, contig_name_, boost::is_any_of("_"));
-    io::osequencestream_simple oss(output_contig_file_);
     for(size_t i = 0; i < contig_name_splitted.size(); i++) {
         if (contig_name_splitted[i] == "length" && i + 1 < contig_name_splitted.size()) {
-            contig_name_splitted[i + 1] = std::to_string(int(s_new_contig.str().length()));
+            contig_name_splitted[i + 1] = std::to_string(int(corrected_contig_.length()));
             break;
         }
     }
-    std::string new_header = contig_name_splitted[0];
+    corrected_header_ = contig_name_splitted[0];
     for(size_t i = 1; i < contig_name_splitted.size(); i++) {
-        new_header += "_" + contig_name_splitted[i];
+        corrected_header_ += "_" + contig_name_splitted[i];
     }
-    oss.set_header(new_header);
-    oss << s_new_contig.str();
 
     return total_changes;
 }
@@ -15,10 +15,9 @@
 #pragma once
 #include "interesting_pos_processor.hpp"
 #include "positional_read.hpp"
+#include "alignment_storage.hpp"
 #include "utils/openmp_wrapper.h"
 
-#include <io/sam/sam_reader.hpp>
-#include <io/sam/read.hpp>
 #include "pipeline/library.hpp"
 
 #include <string>
@@ -27,15 +26,15 @@
 
 namespace corrector {
 
-using namespace sam_reader;
+using alignment::SequenceAlignment;
 
-typedef std::vector<std::pair<std::string, io::LibraryType> > sam_files_type;
 class ContigProcessor {
-    sam_files_type sam_files_;
-    std::string contig_file_;
+    const std::vector<AlignmentStorage> &alignments_;
     std::string contig_name_;
-    std::string output_contig_file_;
     std::string contig_;
+    int contig_id_;
+    std::string corrected_header_;
+    std::string corrected_contig_;
     std::vector<position_description> charts_;
     InterestingPositionProcessor ipp_;
     std::vector<int> error_counts_;
@@ -43,19 +42,29 @@ class ContigProcessor {
     const size_t kMaxErrorNum = 20;
 
 public:
-    ContigProcessor(const sam_files_type &sam_files, const std::string &contig_file)
-            : sam_files_(sam_files), contig_file_(contig_file) {
-        ReadContig();
+    ContigProcessor(const std::vector<AlignmentStorage> &alignments, const std::string &contig_name,
+                    const std::string &contig, int contig_id)
+            : alignments_(alignments), contig_name_(contig_name), contig_(contig), contig_id_(contig_id) {
+        charts_.resize(contig_.length());
         ipp_.set_contig(contig_);
     }
-    size_t ProcessMultipleSamFiles();
+    //returns: number of changed nucleotides;
+    size_t ProcessAlignments();
+
+    const std::string &corrected_header() const {
+        return corrected_header_;
+    }
+
+    const std::string &corrected_contig() const {
+        return corrected_contig_;
+    }
 private:
-    void ReadContig();
 //Moved from read.hpp
-    bool CountPositions(const SingleSamRead &read, std::unordered_map<size_t, position_description> &ps) const;
-    bool CountPositions(const PairedSamRead &read, std::unordered_map<size_t, position_description> &ps) const;
+    bool CountPositions(const SequenceAlignment &read, std::unordered_map<size_t, position_description> &ps) const;
+    bool CountPositions(const SequenceAlignment &left, const SequenceAlignment &right,
+                        std::unordered_map<size_t, position_description> &ps) const;
 
-    void UpdateOneRead(const SingleSamRead &tmp, MappedSamStream &sm);
+    void UpdateOneRead(const SequenceAlignment &tmp);
     //returns: number of changed nucleotides;
 
     size_t UpdateOneBase(size_t i, std::stringstream &ss, const std::unordered_map<size_t, position_description> &interesting_positions) const ;
@@ -15,186 +15,150 @@
 #include "io/reads/osequencestream.hpp"
 #include "utils/openmp_wrapper.h"
 
-#include <boost/algorithm/string.hpp>
-
 #include <iostream>
-#include <unistd.h>
+#include <map>
 
 using namespace std;
+using alignment::SequenceAlignment;
 
 namespace corrector {
-std::string DatasetProcessor::GetLibDir(const size_t lib_count) {
-    if (lib_dirs_.find(lib_count) != lib_dirs_.end())
-        return lib_dirs_[lib_count];
-    std::string res = path::make_temp_dir(corr_cfg::get().work_dir, "lib" + to_string(lib_count));
-    lib_dirs_[lib_count] = res;
-    return res;
-}
 
-void DatasetProcessor::SplitGenome(const string &genome_splitted_dir) {
+void DatasetProcessor::ReadGenome() {
     io::FileReadStream frs(genome_file_);
-    size_t cur_id = 0;
     while (!frs.eof()) {
         io::SingleRead cur_read;
         frs >> cur_read;
         string contig_name = cur_read.name();
-        string contig_seq = cur_read.GetSequenceString();
-        if (all_contigs_.find(contig_name) != all_contigs_.end()) {
+        if (contig_ids_.find(contig_name) != contig_ids_.end()) {
             WARN("Duplicated contig names! Multiple contigs with name" << contig_name);
         }
-        string full_path = path::append_path(genome_splitted_dir, contig_name + ".fasta");
-        string out_full_path = path::append_path(genome_splitted_dir, contig_name + ".ref.fasta");
-        string sam_filename = path::append_path(genome_splitted_dir, contig_name + ".pair.sam");
-        all_contigs_[contig_name] = {full_path, out_full_path, contig_seq.length(), sam_files_type(), sam_filename, cur_id};
-        cur_id ++;
-        buffered_reads_[contig_name].clear();
-        io::osequencestream oss(full_path);
-        oss << io::SingleRead(contig_name, contig_seq);
-        DEBUG("full_path " + full_path)
+        contig_ids_[contig_name] = (int) contig_names_.size();
+        contig_names_.push_back(contig_name);
+        contig_seqs_.push_back(cur_read.GetSequenceString());
     }
+    alignments_.resize(contig_names_.size());
 }
 
-//contigs - set of aligned contig names
-void DatasetProcessor::GetAlignedContigs(const string &read, set<string> &contigs) const {
-    vector<string> arr;
-    boost::split(arr, read, boost::is_any_of("\t"));
-    if (arr.size() > 5) {
-        if (arr[2] != "*" && stoi(arr[4]) > 0) {
+//contigs - set of aligned contig ids
+void DatasetProcessor::GetAlignedContigs(const SequenceAlignment &read, set<int> &contigs) const {
+    if (read.ref >= 0 && read.map_qual > 0) {
 // here can be multuple aligned parsing if neeeded;
-            contigs.insert(arr[2]);
-        }
+        contigs.insert(read.ref);
     }
-
 }
 
-void DatasetProcessor::SplitSingleLibrary(const string &all_reads_filename, const size_t lib_count) {
-    ifstream fs(all_reads_filename);
-    while (!fs.eof()) {
-        set<string> contigs;
-        string r1;
-        getline(fs, r1);
-        if (r1[0] == '@')
-            continue;
-        GetAlignedContigs(r1, contigs);
-        for (auto &contig : contigs) {
-            VERIFY_MSG(all_contigs_.find(contig) != all_contigs_.end(), "wrong contig name in SAM file header: " + contig);
-            BufferedOutputRead(r1, contig, lib_count);
-        }
+void DatasetProcessor::PrepareLibrary(io::LibraryType type, const size_t lib_count) {
+    string lib_dir = path::make_temp_dir(work_dir_, "lib" + to_string(lib_count));
+    for (size_t i = 0; i < alignments_.size(); ++i) {
+        alignments_[i].emplace_back(type, path::append_path(lib_dir, to_string(i) + ".bin"));
     }
-    FlushAll(lib_count);
 }
 
-void DatasetProcessor::FlushAll(const size_t lib_count) {
-    for (const auto &ac : all_contigs_) {
-        if (buffered_reads_[ac.first].size() > 0) {
-            ofstream stream(ac.second.sam_filenames[lib_count].first.c_str(), std::ios_base::app | std::ios_base::out);
-            for (const string &read : buffered_reads_[ac.first]) {
-                stream << read;
-                stream << '\n';
-            }
-            buffered_reads_[ac.first].clear();
-        }
+void DatasetProcessor::SpillAll() {
+    INFO("Buffered alignments take " << (buffered_bytes_ >> 20) << "MB, flushing");
+    for (auto &contig_alignments : alignments_) {
+        for (auto &storage : contig_alignments)
+            storage.Spill();
     }
+    buffered_bytes_ = 0;
 }
 
-void DatasetProcessor::BufferedOutputRead(const string &read, const string &contig_name, const size_t lib_count) {
-    buffered_reads_[contig_name].push_back(read);
-    buffered_count_++;
-    if (buffered_count_ % kBuffSize == 0) {
-        if (buffered_count_ % (10 * kBuffSize) == 0)
-            INFO("processed " << buffered_count_ << "reads, flushing");
-        FlushAll(lib_count);
-    }
-}
-
-void DatasetProcessor::SplitPairedLibrary(const string &all_reads_filename, const size_t lib_count) {
-    ifstream fs(all_reads_filename);
-    while (!fs.eof()) {
-        set<string> contigs;
-        string r1;
-        string r2;
-        getline(fs, r1);
-        if (r1[0] == '@')
-            continue;
-        getline(fs, r2);
-        GetAlignedContigs(r1, contigs);
-        GetAlignedContigs(r2, contigs);
-        for (const auto &contig : contigs) {
-            VERIFY_MSG(all_contigs_.find(contig) != all_contigs_.end(), "wrong contig name in SAM file header: " + contig);
-            if (all_contigs_.find(contig) != all_contigs_.end()) {
-                BufferedOutputRead(r1, contig, lib_count);
-                BufferedOutputRead(r2, contig, lib_count);
+//alignments - bwa records of every read of the batch, for paired libraries mates go one after another
+void DatasetProcessor::AddAlignments(const vector<vector<SequenceAlignment>> &alignments, bool paired, const size_t lib_count) {
+    auto add = [&](int contig, const SequenceAlignment &read) {
+        VERIFY(contig >= 0 && size_t(contig) < alignments_.size());
+        SequenceAlignment copy(read);
+        buffered_bytes_ += AlignmentStorage::byte_size(copy);
+        alignments_[contig][lib_count].Add(std::move(copy));
+    };
+
+    if (paired) {
+        auto primary = [](const vector<SequenceAlignment> &read_records) -> const SequenceAlignment& {
+            for (const auto &r : read_records) {
+                if (r.is_main_alignment())
+                    return r;
+            }
+            VERIFY_MSG(false, "No primary alignment reported for the read");
+            return read_records.front();
+        };
+        for (size_t i = 0; i + 1 < alignments.size(); i += 2) {
+            const SequenceAlignment &r1 = primary(alignments[i]);
+            const SequenceAlignment &r2 = primary(alignments[i + 1]);
+            set<int> contigs;
+            GetAlignedContigs(r1, contigs);
+            GetAlignedContigs(r2, contigs);
+            for (int contig : contigs) {
+                add(contig, r1);
+                add(contig, r2);
+            }
+        }
+    } else {
+        for (const auto &read_records : alignments) {
+            for (const auto &r : read_records) {
+                set<int> contigs;
+                GetAlignedContigs(r, contigs);
+                for (int contig : contigs)
+                    add(contig, r);
             }
         }
     }
-    FlushAll(lib_count);
-}
 
-string DatasetProcessor::RunPairedBwa(const string &left, const string &right, const size_t lib)  {
-    string cur_dir = GetLibDir(lib);
-    int run_res = 0;
-    string tmp_sam_filename = path::append_path(cur_dir, "tmp.sam");
-    string bwa_string = path::screen_whitespaces(path::screen_whitespaces(corr_cfg::get().bwa));
-    string genome_screened = path::screen_whitespaces(genome_file_);
-    string index_line = bwa_string + string(" index ") + "-a " + "is " + genome_screened ;
-    INFO("Running bwa index ...: " << index_line);
-    run_res = system(index_line.c_str());
-    if (run_res != 0) {
-        INFO("bwa failed, skipping sublib");
-        return "";
-    }
-    string nthreads_str = to_string(nthreads_);
-    string last_line = bwa_string + string(" mem ") + " -v 1 -t " + nthreads_str + " "+ genome_screened + " " + path::screen_whitespaces(left) + " " + path::screen_whitespaces(right)  + "  > "
-            + path::screen_whitespaces(tmp_sam_filename) ;
-    INFO("Running bwa mem ...:" << last_line);
-    run_res = system(last_line.c_str());
-    if (run_res != 0) {
-        INFO("bwa failed, skipping sublib");
-        return "";
-    }
-    return tmp_sam_filename;
+    if (buffered_bytes_ > max_buffered_bytes_)
+        SpillAll();
 }
 
-string DatasetProcessor::RunSingleBwa(const string &single, const size_t lib)  {
-    int run_res = 0;
-    string cur_dir = GetLibDir(lib);
-    string tmp_sam_filename = path::append_path(cur_dir, "tmp.sam");
-    string bwa_string = path::screen_whitespaces(path::screen_whitespaces(corr_cfg::get().bwa));
-    string genome_screened = path::screen_whitespaces(genome_file_);
-    string index_line = bwa_string + string(" index ") + "-a " + "is " + genome_screened ;
-    INFO("Running bwa index ...: " << index_line);
-    run_res = system(index_line.c_str());
-    if (run_res != 0) {
-        INFO("bwa failed, skipping sublib");
-        return "";
-    }
-    string nthreads_str = to_string(nthreads_);
-    string last_line = bwa_string + " mem "+ " -v 1 -t " + nthreads_str + " " + genome_screened + " "  + path::screen_whitespaces(single)  + "  > " + path::screen_whitespaces(tmp_sam_filename);
-    INFO("Running bwa mem ...:" << last_line);
-    run_res = system(last_line.c_str());
-    if (run_res != 0) {
-        INFO("bwa failed, skipping sublib");
-        return "";
+void DatasetProcessor::AlignPairedLibrary(alignment::BWASequenceIndex &index, const string &left, const string &right,
+                                          io::LibraryType type, const size_t lib_count) {
+    PrepareLibrary(type, lib_count);
+    io::FileReadStream left_stream(left), right_stream(right);
+    vector<io::SingleRead> batch;
+    size_t batch_bases = 0, processed = 0;
+    while (!left_stream.eof() && !right_stream.eof()) {
+        io::SingleRead r1, r2;
+        left_stream >> r1;
+        right_stream >> r2;
+        batch_bases += r1.size() + r2.size();
+        batch.push_back(r1);
+        batch.push_back(r2);
+        if (batch_bases >= index.batch_bases() || left_stream.eof() || right_stream.eof()) {
+            AddAlignments(index.Align(batch, true, processed), true, lib_count);
+            processed += batch.size();
+            INFO("Processed " << processed << " reads");
+            batch.clear();
+            batch_bases = 0;
+        }
     }
-    return tmp_sam_filename;
+    if (!left_stream.eof() || !right_stream.eof())
+        WARN("Different number of reads in " << left << " and " << right << ", the rest is skipped");
 }
 
-void DatasetProcessor::PrepareContigDirs(const size_t lib_count) {
-    string out_dir = GetLibDir(lib_count);
-    for (auto &ac : all_contigs_) {
-        auto contig_name = ac.first;
-        string out_name = path::append_path(out_dir, contig_name + ".sam");
-        ac.second.sam_filenames.push_back(make_pair(out_name, unsplitted_sam_files_[lib_count].second));
-        BufferedOutputRead("@SQ\tSN:" + contig_name + "\tLN:" + to_string(all_contigs_[contig_name].contig_length), contig_name, lib_count);
+void DatasetProcessor::AlignSingleLibrary(alignment::BWASequenceIndex &index, const string &single, const size_t lib_count) {
+    PrepareLibrary(io::LibraryType::SingleReads, lib_count);
+    io::FileReadStream stream(single);
+    vector<io::SingleRead> batch;
+    size_t batch_bases = 0, processed = 0;
+    while (!stream.eof()) {
+        io::SingleRead r;
+        stream >> r;
+        batch_bases += r.size();
+        batch.push_back(r);
+        if (batch_bases >= index.batch_bases() || stream.eof()) {
+            AddAlignments(index.Align(batch, false, processed), false, lib_count);
+            processed += batch.size();
+            INFO("Processed " << processed << " reads");
+            batch.clear();
+            batch_bases = 0;
+        }
     }
-    FlushAll(lib_count);
 }
 
 void DatasetProcessor::ProcessDataset() {
     size_t lib_num = 0;
-    INFO("Splitting assembly...");
+    INFO("Reading assembly...");
     INFO("Assembly file: " + genome_file_);
-    SplitGenome(work_dir_);
+    ReadGenome();
+    INFO("Building bwa index");
+    alignment::BWASequenceIndex index(contig_names_, contig_seqs_, (unsigned) nthreads_);
     for (size_t i = 0; i < corr_cfg::get().dataset.lib_count(); ++i) {
         const auto& dataset = corr_cfg::get().dataset[i];
         auto lib_type = dataset.type();
@@ -204,69 +168,57 @@ void DatasetProcessor::ProcessDataset() {
                 string left = iter->first;
                 string right = iter->second;
                 INFO(left + " " + right);
-                string samf = RunPairedBwa(left, right, lib_num);
-                if (samf != "") {
-                    INFO("Adding samfile " << samf);
-                    unsplitted_sam_files_.push_back(make_pair(samf, lib_type));
-                    PrepareContigDirs(lib_num);
-                    SplitPairedLibrary(samf, lib_num);
-                    lib_num++;
-                } else {
-                    FATAL_ERROR("Failed to align paired reads " << left << " and " << right);
-                }
+                AlignPairedLibrary(index, left, right, lib_type, lib_num);
+                lib_num++;
             }
             for (auto iter = dataset.single_begin(); iter != dataset.single_end(); iter++) {
                 INFO("Processing single sublib of number " << lib_num);
                 string left = *iter;
                 INFO(left);
-                string samf = RunSingleBwa(left, lib_num);
-                if (samf != "") {
-                    INFO("Adding samfile " << samf);
-                    unsplitted_sam_files_.push_back(make_pair(samf, io::LibraryType::SingleReads));
-                    PrepareContigDirs(lib_num);
-                    SplitSingleLibrary(samf, lib_num);
-                    lib_num++;
-                } else {
-                    FATAL_ERROR("Failed to align single reads " << left);
-                }
+                AlignSingleLibrary(index, left, lib_num);
+                lib_num++;
             }
         }
     }
     INFO("Processing contigs");
-    vector<pair<size_t, string> > ordered_contigs;
-    for (const auto &ac : all_contigs_) {
-        ordered_contigs.push_back(make_pair(ac.second.contig_length, ac.first));
+    vector<pair<size_t, size_t> > ordered_contigs;
+    for (size_t i = 0; i < contig_seqs_.size(); ++i) {
+        ordered_contigs.push_back(make_pair(contig_seqs_[i].length(), i));
     }
     size_t cont_num = ordered_contigs.size();
-    sort(ordered_contigs.begin(), ordered_contigs.end(), std::greater<pair<size_t, string> >());
-    auto all_contigs_ptr = &all_contigs_;
-# pragma omp parallel for shared(all_contigs_ptr, ordered_contigs) num_threads(nthreads_) schedule(dynamic,1)
+    sort(ordered_contigs.begin(), ordered_contigs.end(), std::greater<pair<size_t, size_t> >());
+    // Contigs are processed longest first, but written in the input order:
+    // each finished contig is flushed as soon as all the preceding ones are written,
+    // only the ones finished out of order are kept in memory.
+    io::osequencestream_simple oss(output_contig_file_);
+    map<size_t, pair<string, string>> pending;
+    size_t next_to_write = 0;
+# pragma omp parallel for shared(ordered_contigs, pending, next_to_write, oss) num_threads(nthreads_) schedule(dynamic,1)
     for (size_t i = 0; i < cont_num; i++) {
-        bool long_enough = (*all_contigs_ptr)[ordered_contigs[i].second].contig_length > kMinContigLengthForInfo;
-        ContigProcessor pc((*all_contigs_ptr)[ordered_contigs[i].second].sam_filenames, (*all_contigs_ptr)[ordered_contigs[i].second].input_contig_filename);
-        size_t changes = pc.ProcessMultipleSamFiles();
+        size_t id = ordered_contigs[i].second;
+        bool long_enough = contig_seqs_[id].length() > kMinContigLengthForInfo;
+        ContigProcessor pc(alignments_[id], contig_names_[id], contig_seqs_[id], (int) id);
+        size_t changes = pc.ProcessAlignments();
+        //alignments are not needed anymore
+        vector<AlignmentStorage>().swap(alignments_[id]);
+#pragma omp critical(write_contigs)
+        {
+            pending[id] = make_pair(pc.corrected_header(), pc.corrected_contig());
+            for (auto it = pending.begin(); it != pending.end() && it->first == next_to_write;
+                 it = pending.erase(it), ++next_to_write) {
+                oss.set_header(it->second.first);
+                oss << it->second.second;
+            }
+        }
         if (long_enough) {
 #pragma omp critical
             {
-                INFO("Contig " << ordered_contigs[i].second << " processed with " << changes << " changes in thread " << omp_get_thread_num());
+                INFO("Contig " << contig_names_[id] << " processed with " << changes << " changes in thread " << omp_get_thread_num());
             }
         }
     }
-    INFO("Gluing processed contigs");
-    GlueSplittedContigs(output_contig_file_);
-}
-
-void DatasetProcessor::GlueSplittedContigs(string &out_contigs_filename) {
-    ofstream of_c(out_contigs_filename, std::ios_base::binary);
-    vector<string> ordered_names;
-    ordered_names.resize(all_contigs_.size());
-    for (const auto &ac : all_contigs_) {
-        ordered_names[ac.second.id] = ac.first;
-    }
-    for (size_t i = 0; i < ordered_names.size(); i++) {
-        ifstream a_f(all_contigs_[ordered_names[i]].output_contig_filename, std::ios_base::binary);
-        of_c << a_f.rdbuf();
-    }
+    VERIFY(pending.empty() && next_to_write == cont_num);
+    INFO("Corrected contigs written");
 }
 
 }
@@ -50,7 +50,8 @@ int main(int argc, char** argv) {
 
         INFO("Starting MismatchCorrector, built from " SPADES_GIT_REFSPEC ", git revision " SPADES_GIT_SHA1);
 
-        corrector::DatasetProcessor dp(contig_name, corr_cfg::get().work_dir, corr_cfg::get().output_dir, corr_cfg::get().max_nthreads);
+        corrector::DatasetProcessor dp(contig_name, corr_cfg::get().work_dir, corr_cfg::get().output_dir,
+                                      corr_cfg::get().max_nthreads, corr_cfg::get().max_memory);
         dp.ProcessDataset();
     } catch (std::string const &s) {
         std::cerr << s;
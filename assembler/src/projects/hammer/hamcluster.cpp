@@ -88,20 +88,40 @@ static bool canMerge(const ConcurrentDSU &uf, size_t x, size_t y) {
 #endif
 
 
+// Scratch space of processBlockQuadratic, reused between the blocks
+struct QuadraticBlockBuffers {
+  std::vector<hammer::KMer> kmers;
+  std::vector<uint8_t> dist;
+};
+
 static void processBlockQuadratic(ConcurrentDSU  &uf,
                                   const std::vector<size_t>::iterator &block,
                                   size_t block_size,
                                   const KMerData &data,
-                                  unsigned tau) {
+                                  unsigned tau,
+                                  QuadraticBlockBuffers &buffers) {
+  if (block_size < 2)
+    return;
+
+  // Pack the k-mers of the block once, every row of the distance matrix is
+  // then computed against the contiguous tail of the block at once.
+  std::vector<hammer::KMer> &kmers = buffers.kmers;
+  kmers.clear();
+  for (size_t i = 0; i < block_size; ++i)
+    kmers.push_back(data.kmer(block[i]));
+
+  std::vector<uint8_t> &dist = buffers.dist;
+  dist.resize(block_size);
   for (size_t i = 0; i < block_size; ++i) {
     size_t x = block[i];
-    hammer::KMer kmerx = data.kmer(x);
+    hamdistKMerBlock(kmers[i], kmers.data() + i + 1, block_size - i - 1, tau, dist.data());
     for (size_t j = i + 1; j < block_size; j++) {
+      if (dist[j - i - 1] > tau)
+        continue;
+
       size_t y = block[j];
-      hammer::KMer kmery = data.kmer(y);
       if (!uf.same(x, y) &&
-          canMerge(uf, x, y) &&
-          hamdistKMer(kmerx, kmery, tau) <= tau) {
+          canMerge(uf, x, y)) {
         uf.unite(x, y);
       }
     }
@@ -130,6 +150,7 @@ void KMerHamClusterer::cluster(const std::string &prefix,
   VERIFY(!bfs.fail()); VERIFY(!kfs.fail());
   bfs.close(); kfs.close();
 
+  QuadraticBlockBuffers buffers;
   size_t big_blocks1 = 0;
   {
     unsigned block_thr = cfg::get().hamming_blocksize_quadratic_threshold;
@@ -146,7 +167,7 @@ void KMerHamClusterer::cluster(const std::string &prefix,
       Splitter.split([&] (const std::vector<size_t>::iterator &start, size_t sz) {
         if (sz < block_thr) {
           // Merge small blocks.
-          processBlockQuadratic(uf, start, sz, data, tau_);
+          processBlockQuadratic(uf, start, sz, data, tau_, buffers);
         } else {
           big_blocks1 += 1;
           // Otherwise - dump for next iteration.
@@ -187,7 +208,7 @@ void KMerHamClusterer::cluster(const std::string &prefix,
           }
 #endif
         }
-        processBlockQuadratic(uf, start, sz, data, tau_);
+        processBlockQuadratic(uf, start, sz, data, tau_, buffers);
         nblocks += 1;
     });
     INFO("Splitting done."
@@ -230,6 +251,11 @@ static void ClusterChunk(size_t start_idx, size_t end_idx, const KMerData &data,
     // INFO("Cluster: " << start_idx << ":" << end_idx);
 #   pragma omp parallel num_threads(nthreads)
     {
+        // All the k-mers at the Hamming distance of 1
+        std::vector<hammer::KMer> candidates(3 * hammer::K);
+        std::vector<KMerData::Lookup> lookups(candidates.size());
+        std::vector<size_t> cidxs(candidates.size());
+
 #       pragma omp for
         for (size_t idx = start_idx; idx < end_idx; ++idx) {
             hammer::KMer kmer = data.kmer(idx);
@@ -241,23 +267,38 @@ static void ClusterChunk(size_t start_idx, size_t end_idx, const KMerData &data,
             size_t rckidx = -1ULL;
             // INFO("" << kmer << ":" << kidx);
 
-            for (size_t k = 0; k < hammer::K; ++k) {
+            for (size_t k = 0, i = 0; k < hammer::K; ++k) {
                 hammer::KMer candidate = kmer;
                 char c = candidate[k];
                 for (char nc = 0; nc < 4; ++nc) {
                     if (nc == c)
                         continue;
                     candidate.set(k, nc);
-                    size_t cidx = data.checking_seq_idx(candidate);
-                    // INFO("" << candidate << ":" << cidx);
-                    if (cidx != -1ULL && canMerge2(uf, kidx, cidx)) {
-                        uf.unite(kidx, cidx);
-
-                        size_t rccidx = data.seq_idx(!candidate);
-                        if (rckidx == -1ULL)
-                            rckidx = data.seq_idx(!kmer);
-                        uf.unite(rckidx, rccidx);
-                    }
+                    candidates[i++] = candidate;
+                }
+            }
+
+            // Batched lookup: hash all the neighbours and prefetch the MPHF
+            // data, then resolve the indices and prefetch the k-mers to be
+            // verified, so the cache misses of different neighbours overlap.
+            for (size_t i = 0; i < candidates.size(); ++i)
+                data.prefetch(candidates[i], lookups[i]);
+            for (size_t i = 0; i < candidates.size(); ++i) {
+                cidxs[i] = data.seq_idx(lookups[i]);
+                data.prefetch_kmer(cidxs[i]);
+            }
+
+            for (size_t i = 0; i < candidates.size(); ++i) {
+                const hammer::KMer &candidate = candidates[i];
+                size_t cidx = data.checking_seq_idx(candidate, cidxs[i]);
+                // INFO("" << candidate << ":" << cidx);
+                if (cidx != -1ULL && canMerge2(uf, kidx, cidx)) {
+                    uf.unite(kidx, cidx);
+
+                    size_t rccidx = data.seq_idx(!candidate);
+                    if (rckidx == -1ULL)
+                        rckidx = data.seq_idx(!kmer);
+                    uf.unite(rckidx, rccidx);
                 }
             }
         }
@@ -0,0 +1,157 @@
+//***************************************************************************
+//* Copyright (c) 2016 Saint Petersburg State University
+//* All Rights Reserved
+//* See file LICENSE for details.
+//***************************************************************************
+
+// Benchmark of the Hamming graph clustering kernels on the k-mer index dumped
+// by BayesHammer in debug mode (<working dir>/00.kmer.index). The distance
+// kernels are run over the windows of consecutive k-mers the way the quadratic
+// block processing does it, the tau = 1 neighbour lookups are done one by one
+// and in batches. The checksums of the variants should match.
+
+#include "kmer_data.hpp"
+
+#include "utils/benchmark.hpp"
+#include "utils/logger/log_writers.hpp"
+
+#include <fstream>
+#include <iostream>
+
+void create_console_logger() {
+  logging::logger *log = logging::create_logger("", logging::L_INFO);
+  log->add_writer(std::make_shared<logging::console_writer>());
+  logging::attach_logger(log);
+}
+
+// Per-nucleotide reference implementation
+static unsigned hamdistKMerNaive(const hammer::KMer &x, const hammer::KMer &y, unsigned tau) {
+  unsigned dist = 0;
+  for (unsigned i = 0; i < hammer::K; ++i) {
+    if (x[i] != y[i]) {
+      ++dist; if (dist > tau) return dist;
+    }
+  }
+  return dist;
+}
+
+// Sum of the distances capped at tau + 1 over all the pairs within the windows
+template<class Dist>
+static size_t Windows(const std::vector<hammer::KMer> &kmers, size_t window, unsigned tau, Dist dist) {
+  size_t res = 0;
+  for (size_t start = 0; start < kmers.size(); start += window) {
+    size_t end = std::min(start + window, kmers.size());
+    for (size_t i = start; i < end; ++i)
+      for (size_t j = i + 1; j < end; ++j)
+        res += std::min(dist(kmers[i], kmers[j]), tau + 1);
+  }
+  return res;
+}
+
+static size_t WindowsBlock(const std::vector<hammer::KMer> &kmers, size_t window, unsigned tau) {
+  std::vector<uint8_t> dist(window);
+  size_t res = 0;
+  for (size_t start = 0; start < kmers.size(); start += window) {
+    size_t end = std::min(start + window, kmers.size());
+    for (size_t i = start; i < end; ++i) {
+      hamdistKMerBlock(kmers[i], kmers.data() + i + 1, end - i - 1, tau, dist.data());
+      for (size_t j = 0; j < end - i - 1; ++j)
+        res += dist[j];
+    }
+  }
+  return res;
+}
+
+// Number of the k-mers of the data at the distance of 1
+static size_t Neighbours(const KMerData &data) {
+  size_t res = 0;
+  for (size_t idx = 0; idx < data.size(); ++idx) {
+    hammer::KMer kmer = data.kmer(idx);
+    for (size_t k = 0; k < hammer::K; ++k) {
+      hammer::KMer candidate = kmer;
+      char c = candidate[k];
+      for (char nc = 0; nc < 4; ++nc) {
+        if (nc == c)
+          continue;
+        candidate.set(k, nc);
+        res += data.checking_seq_idx(candidate) != -1ULL;
+      }
+    }
+  }
+  return res;
+}
+
+static size_t NeighboursBatched(const KMerData &data) {
+  std::vector<hammer::KMer> candidates(3 * hammer::K);
+  std::vector<KMerData::Lookup> lookups(candidates.size());
+  std::vector<size_t> cidxs(candidates.size());
+
+  size_t res = 0;
+  for (size_t idx = 0; idx < data.size(); ++idx) {
+    hammer::KMer kmer = data.kmer(idx);
+    for (size_t k = 0, i = 0; k < hammer::K; ++k) {
+      hammer::KMer candidate = kmer;
+      char c = candidate[k];
+      for (char nc = 0; nc < 4; ++nc) {
+        if (nc == c)
+          continue;
+        candidate.set(k, nc);
+        candidates[i++] = candidate;
+      }
+    }
+
+    for (size_t i = 0; i < candidates.size(); ++i)
+      data.prefetch(candidates[i], lookups[i]);
+    for (size_t i = 0; i < candidates.size(); ++i) {
+      cidxs[i] = data.seq_idx(lookups[i]);
+      data.prefetch_kmer(cidxs[i]);
+    }
+    for (size_t i = 0; i < candidates.size(); ++i)
+      res += data.checking_seq_idx(candidates[i], cidxs[i]) != -1ULL;
+  }
+  return res;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    std::cout << "Usage: hamcluster_bench <kmer index> [tau] [window]" << std::endl;
+    return 1;
+  }
+  create_console_logger();
+  unsigned tau = argc > 2 ? (unsigned)std::strtoul(argv[2], NULL, 10) : 2;
+  size_t window = argc > 3 ? std::strtoul(argv[3], NULL, 10) : 64;
+
+  KMerData data;
+  {
+    std::ifstream is(argv[1], std::ios::binary);
+    VERIFY(is.good());
+    data.binary_read(is, argv[1]);
+  }
+  INFO("K-mer index loaded, " << data.size() << " k-mers");
+
+  std::vector<hammer::KMer> kmers;
+  kmers.reserve(data.size());
+  for (size_t idx = 0; idx < data.size(); ++idx)
+    kmers.push_back(data.kmer(idx));
+
+  std::cout << "Hamming distances, tau = " << tau << ", windows of " << window << " k-mers" << std::endl;
+  bench::Run("per-nucleotide", [&]() {
+    return Windows(kmers, window, tau, [=](const hammer::KMer &x, const hammer::KMer &y) {
+      return hamdistKMerNaive(x, y, tau);
+    });
+  });
+  bench::Run("word-parallel", [&]() {
+    return Windows(kmers, window, tau, [=](const hammer::KMer &x, const hammer::KMer &y) {
+      return hamdistKMer(x, y, tau);
+    });
+  });
+  bench::Run("block", [&]() {
+    return WindowsBlock(kmers, window, tau);
+  });
+
+  std::cout << "Neighbour lookups, " << 3 * hammer::K << " per k-mer" << std::endl;
+  bench::Run("one by one", [&]() { return Neighbours(data); });
+  bench::Run("batched", [&]() { return NeighboursBatched(data); });
+
+  return 0;
+}
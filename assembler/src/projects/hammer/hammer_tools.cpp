@@ -16,6 +16,8 @@
 #include <iostream>
 #include <fstream>
 #include <iomanip>
+#include <sstream>
+#include <thread>
 
 #include "config_struct_hammer.hpp"
 #include "hammer_tools.hpp"
@@ -74,7 +76,7 @@ string getFilename( const string & dirprefix, int iter_count, const string & suf
   return tmp.str();
 }
 
-void CorrectReadsBatch(std::vector<bool> &res,
+void CorrectReadsBatch(std::vector<uint8_t> &res,
                        std::vector<Read> &reads, size_t buf_size,
                        size_t &changedReads, size_t &changedNucleotides, size_t &uncorrectedNucleotides, size_t &totalNucleotides,
                        const KMerData &data) {
@@ -100,6 +102,92 @@ void CorrectReadsBatch(std::vector<bool> &res,
   totalNucleotides += corrector.total_nucleotides();
 }
 
+// Reads and trims the reads into every stride-th slot of the batch starting from the first one,
+// returns the number of reads read
+static size_t ReadReadsBatch(ireadstream &irs, std::vector<Read> &reads,
+                             size_t first, size_t stride, int trim_quality) {
+  size_t n = 0;
+  for (size_t i = first; i < reads.size() && !irs.eof(); i += stride, ++n) {
+    irs >> reads[i];
+    reads[i].trimNsAndBadQuality(trim_quality);
+  }
+  return n;
+}
+
+// Formatted reads of the batch: [chunk][output file]
+typedef std::vector<std::vector<std::string>> FormattedBatch;
+
+// Formats the chunks of the batch in parallel, output(i) gives the output file of the i-th read
+template<class OutputF>
+static FormattedBatch FormatReadsBatch(const std::vector<Read> &reads, size_t buf_size,
+                                       size_t output_count, const OutputF &output) {
+  unsigned correct_nthreads = min(cfg::get().correct_nthreads, cfg::get().general_max_nthreads);
+  int qvoffset = cfg::get().input_qvoffset;
+
+  size_t chunk_count = std::max<size_t>(std::min<size_t>(4 * correct_nthreads, buf_size), 1);
+  size_t chunk_size = (buf_size + chunk_count - 1) / chunk_count;
+  FormattedBatch res(chunk_count, std::vector<std::string>(output_count));
+# pragma omp parallel for schedule(dynamic) num_threads(correct_nthreads)
+  for (size_t chunk = 0; chunk < chunk_count; ++chunk) {
+    std::ostringstream ss;
+    for (size_t i = chunk * chunk_size; i < std::min((chunk + 1) * chunk_size, buf_size); ++i) {
+      ss.str("");
+      reads[i].print(ss, qvoffset);
+      res[chunk][output(i)] += ss.str();
+    }
+  }
+
+  return res;
+}
+
+// Three-stage pipeline: while a batch is corrected, the next one is read and trimmed
+// and the previous one is written. read_batch fills a batch and returns the number
+// of the reads there, output(res, i) gives the output file of the i-th read of the batch.
+template<class ReadBatchF, class OutputF>
+static void CorrectReadsPipelined(const KMerData &data,
+                                  size_t &changedReads, size_t &changedNucleotides, size_t &uncorrectedNucleotides, size_t &totalNucleotides,
+                                  size_t read_buffer_size, const ReadBatchF &read_batch, const OutputF &output,
+                                  const std::vector<std::ofstream*> &outputs) {
+  std::vector<Read> batches[2] = { std::vector<Read>(read_buffer_size), std::vector<Read>(read_buffer_size) };
+  std::vector<uint8_t> res(read_buffer_size, false);
+
+  FormattedBatch formatted;
+  std::thread writer;
+  unsigned buffer_no = 0;
+  size_t buf_size = read_batch(batches[0]);
+  for (size_t cur = 0; buf_size > 0; cur ^= 1, ++buffer_no) {
+    INFO("Prepared batch " << buffer_no << " of " << buf_size << " reads.");
+
+    size_t next_size = 0;
+    std::vector<Read> &next = batches[cur ^ 1];
+    std::thread reader([&]() { next_size = read_batch(next); });
+
+    CorrectReadsBatch(res, batches[cur], buf_size,
+                      changedReads, changedNucleotides, uncorrectedNucleotides, totalNucleotides,
+                      data);
+    INFO("Processed batch " << buffer_no);
+
+    FormattedBatch next_formatted =
+        FormatReadsBatch(batches[cur], buf_size, outputs.size(),
+                         [&](size_t i) { return output(res, i); });
+
+    if (writer.joinable())
+      writer.join();
+    formatted = std::move(next_formatted);
+    writer = std::thread([&outputs, &formatted, buffer_no]() {
+        for (const auto &chunk : formatted)
+          for (size_t j = 0; j < outputs.size(); ++j)
+            *outputs[j] << chunk[j];
+        INFO("Written batch " << buffer_no);
+      });
+
+    reader.join();
+    buf_size = next_size;
+  }
+  if (writer.joinable())
+    writer.join();
+}
+
 void CorrectReadFile(const KMerData &data,
                      size_t &changedReads, size_t &changedNucleotides, size_t &uncorrectedNucleotides, size_t &totalNucleotides,
                      const std::string &fname,
@@ -109,32 +197,20 @@ void CorrectReadFile(const KMerData &data,
 
   unsigned correct_nthreads = min(cfg::get().correct_nthreads, cfg::get().general_max_nthreads);
   size_t read_buffer_size = correct_nthreads * cfg::get().correct_readbuffer;
-  std::vector<Read> reads(read_buffer_size);
-  std::vector<bool> res(read_buffer_size, false);
 
   ireadstream irs(fname, qvoffset);
   VERIFY(irs.is_open());
 
-  unsigned buffer_no = 0;
-  while (!irs.eof()) {
-    size_t buf_size = 0;
-    for (; buf_size < read_buffer_size && !irs.eof(); ++buf_size) {
-      irs >> reads[buf_size];
-      reads[buf_size].trimNsAndBadQuality(trim_quality);
-    }
-    INFO("Prepared batch " << buffer_no << " of " << buf_size << " reads.");
-
-    CorrectReadsBatch(res, reads, buf_size,
-                      changedReads, changedNucleotides, uncorrectedNucleotides, totalNucleotides,
-                      data);
-
-    INFO("Processed batch " << buffer_no);
-    for (size_t i = 0; i < buf_size; ++i) {
-      reads[i].print(*(res[i] ? outf_good : outf_bad), qvoffset);
-    }
-    INFO("Written batch " << buffer_no);
-    ++buffer_no;
-  }
+  CorrectReadsPipelined(data,
+                        changedReads, changedNucleotides, uncorrectedNucleotides, totalNucleotides,
+                        read_buffer_size,
+                        [&](std::vector<Read> &reads) {
+                          return ReadReadsBatch(irs, reads, 0, 1, trim_quality);
+                        },
+                        [](const std::vector<uint8_t> &res, size_t i) -> size_t {
+                          return res[i] ? 0 : 1;
+                        },
+                        { outf_good, outf_bad });
 }
 
 void CorrectPairedReadFiles(const KMerData &data,
@@ -146,46 +222,39 @@ void CorrectPairedReadFiles(const KMerData &data,
 
   unsigned correct_nthreads = min(cfg::get().correct_nthreads, cfg::get().general_max_nthreads);
   size_t read_buffer_size = correct_nthreads * cfg::get().correct_readbuffer;
-  std::vector<Read> l(read_buffer_size);
-  std::vector<Read> r(read_buffer_size);
-  std::vector<bool> left_res(read_buffer_size, false);
-  std::vector<bool> right_res(read_buffer_size, false);
-
-  unsigned buffer_no = 0;
 
   ireadstream irsl(fnamel, qvoffset), irsr(fnamer, qvoffset);
   VERIFY(irsl.is_open()); VERIFY(irsr.is_open());
 
-  while (!irsl.eof() && !irsr.eof()) {
-    size_t buf_size = 0;
-    for (; buf_size < read_buffer_size && !irsl.eof() && !irsr.eof(); ++buf_size) {
-      irsl >> l[buf_size]; irsr >> r[buf_size];
-      l[buf_size].trimNsAndBadQuality(trim_quality);
-      r[buf_size].trimNsAndBadQuality(trim_quality);
-    }
-    INFO("Prepared batch " << buffer_no << " of " << buf_size << " reads.");
-
-    CorrectReadsBatch(left_res, l, buf_size,
-                      changedReads, changedNucleotides, uncorrectedNucleotides, totalNucleotides,
-                      data);
-    CorrectReadsBatch(right_res, r, buf_size,
-                      changedReads, changedNucleotides, uncorrectedNucleotides, totalNucleotides,
-                      data);
-
-    INFO("Processed batch " << buffer_no);
-    for (size_t i = 0; i < buf_size; ++i) {
-      if (left_res[i] && right_res[i]) {
-        l[i].print(*ofcorl, qvoffset);
-        r[i].print(*ofcorr, qvoffset);
-      } else {
-        l[i].print(*(left_res[i] ? ofunp : ofbadl), qvoffset);
-        r[i].print(*(right_res[i] ? ofunp : ofbadr), qvoffset);
-      }
-    }
-    INFO("Written batch " << buffer_no);
-    ++buffer_no;
-  }
-  VERIFY_MSG(irsl.eof() && irsr.eof(), "Pair of read files " + fnamel + " and " + fnamer + " contain unequal amount of reads");
+  // Mates are interleaved in the batch, so both files are read and corrected at once
+  bool unequal = false;
+  auto read_batch = [&](std::vector<Read> &reads) -> size_t {
+    if (unequal)
+      return 0;
+    size_t right_size = 0;
+    std::thread right_reader([&]() { right_size = ReadReadsBatch(irsr, reads, 1, 2, trim_quality); });
+    size_t left_size = ReadReadsBatch(irsl, reads, 0, 2, trim_quality);
+    right_reader.join();
+    unequal = (left_size != right_size);
+    return 2 * std::min(left_size, right_size);
+  };
+
+  enum { BadLeft, CorrectedLeft, BadRight, CorrectedRight, Unpaired };
+  auto output = [](const std::vector<uint8_t> &res, size_t i) -> size_t {
+    bool left = (i % 2 == 0);
+    bool left_res = res[i & ~size_t(1)], right_res = res[i | 1];
+    if (left_res && right_res)
+      return left ? CorrectedLeft : CorrectedRight;
+    if (left)
+      return left_res ? Unpaired : BadLeft;
+    return right_res ? Unpaired : BadRight;
+  };
+
+  CorrectReadsPipelined(data,
+                        changedReads, changedNucleotides, uncorrectedNucleotides, totalNucleotides,
+                        2 * read_buffer_size, read_batch, output,
+                        { ofbadl, ofcorl, ofbadr, ofcorr, ofunp });
+  VERIFY_MSG(!unequal && irsl.eof() && irsr.eof(), "Pair of read files " + fnamel + " and " + fnamer + " contain unequal amount of reads");
 }
 
 std::string getLargestPrefix(const std::string &str1, const std::string &str2) {
@@ -26,7 +26,7 @@ namespace hammer {
 void InitializeSubKMerPositions();
 
 /// parallel correction of batch of reads
-void CorrectReadsBatch(std::vector<bool> &res, std::vector<Read> &reads, size_t buf_size,
+void CorrectReadsBatch(std::vector<uint8_t> &res, std::vector<Read> &reads, size_t buf_size,
                        size_t &changedReads, size_t &changedNucleotides, size_t &uncorrectedNucleotides, size_t &totalNucleotides,
                        const KMerData &data);
 
@@ -63,7 +63,12 @@ class KMerData {
   }
 
   size_t checking_seq_idx(hammer::KMer s) const {
-    size_t idx = seq_idx(s);
+    return checking_seq_idx(s, seq_idx(s));
+  }
+
+  // Verifies the index of s obtained from the MPHF, which maps the k-mers
+  // absent from the data to arbitrary indices.
+  size_t checking_seq_idx(hammer::KMer s, size_t idx) const {
     if (idx >= size())
         return -1ULL;
 
@@ -74,6 +79,16 @@ class KMerData {
   const KMerStat& operator[](hammer::KMer s) const { return operator[](seq_idx(s)); }
   size_t seq_idx(hammer::KMer s) const { return index_.seq_idx(s); }
 
+  // Split lookup, see HammerKMerIndex::Lookup. Batches of k-mers are
+  // prefetched first and resolved afterwards to overlap the cache misses.
+  typedef HammerKMerIndex::Lookup Lookup;
+  void prefetch(hammer::KMer s, Lookup &lookup) const { index_.prefetch(s, lookup); }
+  size_t seq_idx(const Lookup &lookup) const { return index_.seq_idx(lookup); }
+  void prefetch_kmer(size_t idx) const {
+    if (idx < kmers_.size())
+      __builtin_prefetch(kmers_.data() + idx * hammer::KMer::DataSize, 0, 1);
+  }
+
   template <class Writer>
   void binary_write(Writer &os) {
     size_t sz = data_.size();
@@ -14,6 +14,7 @@
 
 #include <folly/SmallLocks.h>
 
+#include <algorithm>
 #include <functional>
 #include <vector>
 #include <iostream>
@@ -35,17 +36,51 @@ typedef Seq<K> KMer;
 class Read;
 struct KMerStat;
 
+static_assert(sizeof(hammer::KMer::DataType) == sizeof(uint64_t), "Hamming distance expects 64-bit words");
+
+// Number of nucleotides which differ in two packed words given their XOR.
+// The bits are counted by shifts and adds, not by the popcount builtin, which
+// is a library call without -mpopcnt and keeps the loops from vectorizing.
+static inline unsigned hamdistWord(uint64_t diff) {
+  diff = (diff | (diff >> 1)) & 0x5555555555555555ull;
+  diff = (diff & 0x3333333333333333ull) + ((diff >> 2) & 0x3333333333333333ull);
+  diff = (diff + (diff >> 4)) & 0x0f0f0f0f0f0f0f0full;
+  diff += diff >> 8;
+  diff += diff >> 16;
+  diff += diff >> 32;
+  return (unsigned)(diff & 0x7f);
+}
+
+// Word-parallel: every packed word is compared at once. The nucleotides
+// past K are always 'A's, so the last word needs no masking.
 static inline unsigned hamdistKMer(const hammer::KMer &x, const hammer::KMer &y,
                                    unsigned tau = hammer::K) {
+  const uint64_t *xd = x.data(), *yd = y.data();
   unsigned dist = 0;
-  for (unsigned i = 0; i < hammer::K; ++i) {
-    if (x[i] != y[i]) {
-      ++dist; if (dist > tau) return dist;
-    }
+  for (size_t i = 0; i < hammer::KMer::DataSize; ++i) {
+    dist += hamdistWord(xd[i] ^ yd[i]);
+    if (dist > tau) return dist;
   }
   return dist;
 }
 
+// Distances from x to each of the n k-mers of the block, capped at tau + 1.
+// K-mers fitting a single word are compared without branches, so the loop
+// is unrolled / vectorized by the compiler.
+static inline void hamdistKMerBlock(const hammer::KMer &x,
+                                    const hammer::KMer *block, size_t n,
+                                    unsigned tau, uint8_t *dist) {
+  const unsigned cap = std::min(tau + 1, hammer::K + 1);
+  if (hammer::KMer::DataSize == 1) {
+    uint64_t xd = x.data()[0];
+    for (size_t j = 0; j < n; ++j)
+      dist[j] = (uint8_t)std::min(hamdistWord(xd ^ block[j].data()[0]), cap);
+  } else {
+    for (size_t j = 0; j < n; ++j)
+      dist[j] = (uint8_t)std::min(hamdistKMer(x, block[j], tau), cap);
+  }
+}
+
 template<unsigned N, unsigned bits,
          typename Storage = uint64_t>
 class NibbleString {
@@ -434,7 +434,7 @@ void GapClosing::run(conj_graph_pack &gp, const char *) {
     auto& dataset = cfg::get_writable().ds;
     for (size_t i = 0; i < dataset.reads.lib_count(); ++i) {
         if (dataset.reads[i].type() == io::LibraryType::PairedEnd) {
-            auto streams = paired_binary_readers(dataset.reads[i], false, 0);
+            auto streams = paired_binary_readers(dataset.reads[i], false, 0, cfg::get().max_threads);
             CloseGaps(gp, streams);
         }
     }
@@ -347,6 +347,7 @@ void PacbioAlignLibrary(const conj_graph_pack& gp,
 
     auto stream = GetReadsStream(lib);
     aligner(*stream, thread_cnt);
+    pac_index.ReportDistanceCacheStats();
 
     INFO("For library of " << (lib.is_long_read_lib() ? "long reads" : "contigs") << " :");
     aligner.stats().report();
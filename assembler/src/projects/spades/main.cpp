@@ -12,6 +12,7 @@
 
 #include "utils/memory_limit.hpp"
 #include "utils/segfault_handler.hpp"
+#include "utils/telemetry.hpp"
 #include "launch.hpp"
 #include "utils/copy_file.hpp"
 #include "version.hpp"
@@ -89,8 +90,15 @@ int main(int argc, char **argv) {
         INFO("Maximum k-mer length: " << runtime_k::MAX_K);
         INFO("Assembling dataset (" << cfg::get().dataset_file << ") with K=" << cfg::get().K);
 
+        telemetry::report().set_label("K", std::to_string(cfg::get().K));
+        telemetry::report().set_tmp_dir(cfg::get().tmp_dir);
+
         spades::assemble_genome();
 
+        telemetry::report().WriteJson(path::append_path(cfg::get().output_dir, "telemetry.json"));
+        if (cfg::get().telemetry_trace)
+            telemetry::report().WriteTrace(path::append_path(cfg::get().output_dir, "telemetry_trace.json"));
+
     } catch (std::bad_alloc const &e) {
         std::cerr << "Not enough memory to run SPAdes. " << e.what() << std::endl;
         return EINTR;
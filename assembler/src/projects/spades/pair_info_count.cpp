@@ -41,6 +41,10 @@ class DEFilter : public SequenceMapperListener {
                            const MappingPath<EdgeId>& read2) override {
         ProcessPairedRead(read1, read2);
     }
+
+    bool IsMergeThreadSafe() const override {
+        return true;
+    }
   private:
     void ProcessPairedRead(const MappingPath<EdgeId>& path1,
                            const MappingPath<EdgeId>& path2) {
@@ -123,7 +127,7 @@ static bool CollectLibInformation(const conj_graph_pack &gp,
 
     SequencingLib &reads = cfg::get_writable().ds.reads[ilib];
     auto &data = reads.data();
-    auto paired_streams = paired_binary_readers(reads, false);
+    auto paired_streams = paired_binary_readers(reads, false, 0, cfg::get().max_threads);
 
     notifier.ProcessLibrary(paired_streams, ilib, *ChooseProperMapper(gp, reads, cfg::get().bwa.bwa_enable));
     //Check read length after lib processing since mate pairs a not used until this step
@@ -173,7 +177,7 @@ void ProcessSingleReads(conj_graph_pack &gp,
 
     auto mapper_ptr = ChooseProperMapper(gp, reads, cfg::get().bwa.bwa_enable);
     if (use_binary) {
-        auto single_streams = single_binary_readers(reads, false, map_paired);
+        auto single_streams = single_binary_readers(reads, false, map_paired, cfg::get().max_threads);
         notifier.ProcessLibrary(single_streams, ilib, *mapper_ptr);
     } else {
         auto single_streams = single_easy_readers(reads, false,
@@ -232,7 +236,8 @@ static void ProcessPairedReads(conj_graph_pack &gp,
                               gp.paired_indices[ilib]);
     notifier.Subscribe(ilib, &pif);
 
-    auto paired_streams = paired_binary_readers(reads, false, (size_t) data.mean_insert_size);
+    auto paired_streams = paired_binary_readers(reads, false, (size_t) data.mean_insert_size,
+                                                cfg::get().max_threads);
     notifier.ProcessLibrary(paired_streams, ilib, *ChooseProperMapper(gp, reads, cfg::get().bwa.bwa_enable));
     cfg::get_writable().ds.reads[ilib].data().pi_threshold = split_graph.GetThreshold();
 }
@@ -354,7 +359,7 @@ void PairInfoCount::run(conj_graph_pack &gp, const char *) {
                         DEFilter filter_counter(*filter, gp.g);
                         notifier.Subscribe(i, &filter_counter);
 
-                        auto reads = paired_binary_readers(lib, false);
+                        auto reads = paired_binary_readers(lib, false, 0, cfg::get().max_threads);
                         VERIFY(lib.data().read_length != 0);
                         notifier.ProcessLibrary(reads, i, *ChooseProperMapper(gp, lib, cfg::get().bwa.bwa_enable));
                     }
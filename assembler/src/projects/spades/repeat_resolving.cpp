@@ -20,7 +20,8 @@ static void PEResolving(conj_graph_pack& gp) {
                                                   cfg::get().mode,
                                                   cfg::get().uneven_depth,
                                                   cfg::get().avoid_rc_connections,
-                                                  cfg::get().use_scaffolder);
+                                                  cfg::get().use_scaffolder,
+                                                  cfg::get().max_threads);
 
     path_extend::PathExtendLauncher exspander(cfg::get().ds, params, gp);
     exspander.Launch();
@@ -28,9 +28,8 @@ def prepare_config_corr(filename, cfg, ext_python_modules_home):
     data["dataset"] = cfg.dataset
     data["output_dir"] = cfg.output_dir
     data["work_dir"] = process_cfg.process_spaces(cfg.tmp_dir)
-    #data["hard_memory_limit"] = cfg.max_memory
+    data["max_memory"] = cfg.max_memory
     data["max_nthreads"] = cfg.max_threads
-    data["bwa"] = cfg.bwa
     file_c = open(filename, 'w')
     pyyaml.dump(data, file_c, default_flow_style = False, default_style='"', width=100500)
     file_c.close()
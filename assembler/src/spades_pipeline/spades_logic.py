@@ -189,6 +189,59 @@ def run_iteration(configs_dir, execution_home, cfg, log, K, prev_K, last_one):
     support.sys_call(command, log)
 
 
+def merge_telemetry(output_dir, used_K, log):
+    # telemetry reports of the iterations (see utils/telemetry.hpp) are merged into one,
+    # the stages and phases are aggregated over all K values
+    try:
+        import json
+    except ImportError:  # Python 2.4 and 2.5
+        return
+
+    iterations = []
+    stages = dict()
+    stage_ids = []
+    trace_events = []
+    for K in used_K:
+        data_dir = os.path.join(output_dir, "K%d" % K)
+        report_fname = os.path.join(data_dir, "telemetry.json")
+        if not os.path.isfile(report_fname):
+            continue
+        report = json.load(open(report_fname))
+        report["K"] = K
+        iterations.append(report)
+        for scope in report["scopes"]:
+            if scope["id"] not in stages:
+                stage_ids.append(scope["id"])
+                stages[scope["id"]] = {"name": scope["name"], "id": scope["id"], "depth": scope["depth"], "runs": 0,
+                                       "wall": 0.0, "cpu_user": 0.0, "cpu_sys": 0.0, "max_rss": 0,
+                                       "read_bytes": 0, "write_bytes": 0, "counters": dict()}
+            stage = stages[scope["id"]]
+            stage["runs"] += 1
+            for key in ["wall", "cpu_user", "cpu_sys", "read_bytes", "write_bytes"]:
+                stage[key] += scope[key]
+            stage["max_rss"] = max(stage["max_rss"], scope["max_rss"])
+            for name, value in scope["counters"].items():
+                stage["counters"][name] = stage["counters"].get(name, 0) + value
+
+        trace_fname = os.path.join(data_dir, "telemetry_trace.json")
+        if os.path.isfile(trace_fname):
+            trace_events += json.load(open(trace_fname))["traceEvents"]
+
+    if not iterations:
+        return
+    report = {"wall": sum([it["wall"] for it in iterations]),
+              "cpu_user": sum([it["cpu_user"] for it in iterations]),
+              "cpu_sys": sum([it["cpu_sys"] for it in iterations]),
+              "max_rss": max([it["max_rss"] for it in iterations]),
+              "stages": [stages[id] for id in stage_ids],
+              "iterations": iterations}
+    report_fname = os.path.join(output_dir, "telemetry.json")
+    json.dump(report, open(report_fname, "w"), indent=2)
+    if trace_events:
+        json.dump({"traceEvents": trace_events}, open(os.path.join(output_dir, "telemetry_trace.json"), "w"))
+    log.info("\n== Telemetry report saved to " + report_fname)
+
+
 def prepare_config_scaffold_correction(filename, cfg, log, saves_dir, K):
     subst_dict = dict()
 
@@ -321,6 +374,8 @@ def run_spades(configs_dir, execution_home, cfg, dataset_data, ext_python_module
                     support.warning("Iterations stopped. Value of K (%d) exceeded estimated read length (%d)" %
                                     (cfg.iterative_K[count], RL), log)
 
+    merge_telemetry(cfg.output_dir, used_K, log)
+
     if options_storage.stop_after and options_storage.stop_after.startswith('k'):
         support.finish_here(log)
     latest = os.path.join(cfg.output_dir, "K%d" % K)
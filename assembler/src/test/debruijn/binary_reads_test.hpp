@@ -0,0 +1,187 @@
+//***************************************************************************
+//* Copyright (c) 2016 Saint Petersburg State University
+//* All Rights Reserved
+//* See file LICENSE for details.
+//***************************************************************************
+
+#pragma once
+
+#include <boost/test/unit_test.hpp>
+#include "io/reads/binary_converter.hpp"
+#include "io/reads/binary_streams.hpp"
+#include "io/dataset_support/read_converter.hpp"
+
+#include <random>
+
+namespace debruijn_graph {
+
+BOOST_FIXTURE_TEST_SUITE(binary_reads_tests, TmpFolderFixture)
+
+std::string RandomSequence(std::mt19937 &rand, size_t len) {
+    std::string res(len, 'A');
+    for (size_t i = 0; i < len; ++i)
+        res[i] = nucl(char(rand() % 4));
+    return res;
+}
+
+// Writes the reads round robin into file_num files of small blocks,
+// returns the sequences in the order of files
+template<class Read>
+std::vector<std::string> WriteBinaryReads(const std::string &prefix, const std::vector<Read> &reads,
+                                          size_t file_num, size_t block_size,
+                                          std::function<std::string(const Read &)> seq) {
+    io::ReadBinaryWriter<Read> read_writer(io::LibraryOrientation::FF);
+    std::vector<std::string> res;
+    for (size_t i = 0; i < file_num; ++i) {
+        io::BinaryBlockWriter writer(prefix + "_" + ToString(i) + ".seq", block_size);
+        for (size_t j = i; j < reads.size(); j += file_num) {
+            writer.Write(reads[j], read_writer);
+            res.push_back(seq(reads[j]));
+        }
+    }
+    return res;
+}
+
+std::vector<std::shared_ptr<io::BinaryReadFile>> OpenBinaryReads(const std::string &prefix, size_t file_num) {
+    std::vector<std::shared_ptr<io::BinaryReadFile>> files;
+    for (size_t i = 0; i < file_num; ++i)
+        files.push_back(io::BinaryReadFile::Open(prefix, i));
+    return files;
+}
+
+// Every block of every file belongs to exactly one part, the parts go in the order of files and blocks
+void CheckBinaryBlockParts(const std::vector<std::shared_ptr<io::BinaryReadFile>> &files, size_t part_num) {
+    auto parts = io::SplitBinaryBlocks(files, part_num);
+    BOOST_REQUIRE_EQUAL(parts.size(), part_num);
+    size_t file = 0, block = 0;
+    for (const auto &part : parts) {
+        for (const auto &range : part) {
+            while (file < files.size() && block == files[file]->block_count()) {
+                ++file;
+                block = 0;
+            }
+            BOOST_REQUIRE_EQUAL(range.file, file);
+            BOOST_CHECK_EQUAL(range.first_block, block);
+            BOOST_CHECK(range.first_block < range.last_block);
+            block = range.last_block;
+        }
+    }
+    BOOST_CHECK_EQUAL(file, files.size() - 1);
+    BOOST_CHECK_EQUAL(block, files.back()->block_count());
+}
+
+template<class Stream>
+std::vector<std::string> ReadBinaryStreams(io::ReadStreamList<typename Stream::ReadT> streams,
+                                           std::function<std::string(const typename Stream::ReadT &)> seq) {
+    std::vector<std::string> res;
+    typename Stream::ReadT r;
+    for (size_t i = 0; i < streams.size(); ++i) {
+        while (!streams[i].eof()) {
+            streams[i] >> r;
+            res.push_back(seq(r));
+        }
+    }
+    return res;
+}
+
+BOOST_AUTO_TEST_CASE( BinarySingleReadsRoundTrip ) {
+    std::mt19937 rand(42);
+    std::vector<io::SingleRead> reads;
+    for (size_t i = 0; i < 2000; ++i)
+        reads.emplace_back("read" + ToString(i), RandomSequence(rand, 20 + rand() % 200));
+
+    auto seq = [](const io::SingleRead &r) { return r.GetSequenceString(); };
+    auto expected = WriteBinaryReads<io::SingleRead>("tmp/single", reads, 3, 4096, seq);
+
+    auto files = OpenBinaryReads("tmp/single", 3);
+    size_t total = 0;
+    for (const auto &file : files) {
+        BOOST_CHECK(file->block_count() > 1);
+        size_t block_reads = 0;
+        for (size_t i = 0; i < file->block_count(); ++i) {
+            BOOST_CHECK(file->block(i).size <= 4096);
+            BOOST_CHECK_EQUAL(file->block(i).offset % 8, 0);
+            if (i > 0)
+                BOOST_CHECK_EQUAL(file->block(i).offset, file->block(i - 1).end());
+            block_reads += file->block(i).read_count;
+        }
+        BOOST_CHECK_EQUAL(block_reads, file->stat().read_count_);
+        total += block_reads;
+    }
+    BOOST_CHECK_EQUAL(total, reads.size());
+
+    // Fewer, as many and more parts than the files, and more parts than the blocks
+    for (size_t part_num : {1, 2, 3, 4, 7, 16, 1000}) {
+        CheckBinaryBlockParts(files, part_num);
+        auto streams = io::binary_block_readers<io::BinaryFileSingleStream>("tmp/single", 3, part_num);
+        BOOST_CHECK_EQUAL(streams.size(), part_num);
+        BOOST_CHECK_EQUAL(streams.get_stat().read_count_, reads.size());
+        auto actual = ReadBinaryStreams<io::BinaryFileSingleStream>(streams, [](const io::SingleReadSeq &r) {
+            return r.sequence().str();
+        });
+        BOOST_CHECK(actual == expected);
+    }
+}
+
+BOOST_AUTO_TEST_CASE( BinaryPairedReadsRoundTrip ) {
+    std::mt19937 rand(239);
+    std::vector<io::PairedRead> reads;
+    for (size_t i = 0; i < 1000; ++i)
+        reads.emplace_back(io::SingleRead("left" + ToString(i), RandomSequence(rand, 20 + rand() % 100)),
+                           io::SingleRead("right" + ToString(i), RandomSequence(rand, 20 + rand() % 100)),
+                           300);
+
+    auto seq = [](const io::PairedRead &r) {
+        return r.first().GetSequenceString() + "/" + r.second().GetSequenceString();
+    };
+    auto expected = WriteBinaryReads<io::PairedRead>("tmp/paired", reads, 2, 2048, seq);
+
+    auto files = OpenBinaryReads("tmp/paired", 2);
+    for (size_t part_num : {1, 2, 5})
+        CheckBinaryBlockParts(files, part_num);
+
+    for (size_t part_num : {1, 2, 5}) {
+        auto streams = io::binary_block_readers<io::BinaryFilePairedStream>("tmp/paired", 2, part_num, size_t(300));
+        BOOST_CHECK_EQUAL(streams.size(), part_num);
+        auto actual = ReadBinaryStreams<io::BinaryFilePairedStream>(streams, [](const io::PairedReadSeq &r) {
+            BOOST_CHECK_EQUAL(r.insert_size(), 300);
+            return r.first().sequence().str() + "/" + r.second().sequence().str();
+        });
+        BOOST_CHECK(actual == expected);
+    }
+}
+
+BOOST_AUTO_TEST_CASE( BinaryConversionKeepsInputOrder ) {
+    std::mt19937 rand(57);
+    std::vector<std::vector<io::SingleRead>> inputs(3);
+    std::vector<io::SingleRead> all_reads;
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        for (size_t j = 0; j < 5000 * (i + 1); ++j) {
+            inputs[i].emplace_back("read" + ToString(i) + "_" + ToString(j), RandomSequence(rand, 20 + rand() % 30));
+            all_reads.push_back(inputs[i].back());
+        }
+    }
+
+    // Inputs are read ahead in small batches, while a batch of the converter
+    // holds all the reads, so it is filled from all the inputs at once
+    io::ReadStreamList<io::SingleRead> streams;
+    for (const auto &input : inputs)
+        streams.push_back(std::make_shared<io::AsyncReadStream<io::SingleRead>>(
+                std::make_shared<io::VectorReadStream<io::SingleRead>>(input), 16, 2));
+    io::BinaryWriter converter("tmp/converted", 2, 64 << 20);
+    auto stat = converter.ToBinary(streams);
+    BOOST_CHECK_EQUAL(stat.read_count_, all_reads.size());
+
+    // Reads of the consecutive inputs go round robin into the files
+    std::vector<std::string> expected;
+    for (size_t i = 0; i < 2; ++i)
+        for (size_t j = i; j < all_reads.size(); j += 2)
+            expected.push_back(all_reads[j].GetSequenceString());
+    auto actual = ReadBinaryStreams<io::BinaryFileSingleStream>(
+            io::binary_block_readers<io::BinaryFileSingleStream>("tmp/converted", 2, 2),
+            [](const io::SingleReadSeq &r) { return r.sequence().str(); });
+    BOOST_CHECK(actual == expected);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+}
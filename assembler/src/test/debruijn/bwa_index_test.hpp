@@ -0,0 +1,169 @@
+//***************************************************************************
+//* Copyright (c) 2016 Saint Petersburg State University
+//* All Rights Reserved
+//* See file LICENSE for details.
+//***************************************************************************
+
+#pragma once
+
+#include <boost/test/unit_test.hpp>
+#include "modules/alignment/bwa_index.hpp"
+
+#include <random>
+
+namespace debruijn_graph {
+
+BOOST_AUTO_TEST_SUITE(bwa_index_tests)
+
+typedef alignment::SequenceAlignment Alignment;
+
+const size_t kRefLength = 3000;
+const uint32_t kBamMatch = 0, kBamSoftClip = 4, kBamHardClip = 5;
+
+std::string RandomNucls(std::mt19937 &rand, size_t len) {
+    std::string res(len, 'A');
+    for (size_t i = 0; i < len; ++i)
+        res[i] = nucl(char(rand() % 4));
+    return res;
+}
+
+std::vector<std::string> RandomRefs(std::mt19937 &rand, size_t n) {
+    std::vector<std::string> res;
+    for (size_t i = 0; i < n; ++i)
+        res.push_back(RandomNucls(rand, kRefLength));
+    return res;
+}
+
+std::vector<std::string> RefNames(size_t n) {
+    std::vector<std::string> res;
+    for (size_t i = 0; i < n; ++i)
+        res.push_back("ref" + ToString(i));
+    return res;
+}
+
+const Alignment &PrimaryAlignment(const std::vector<Alignment> &records) {
+    for (const auto &a : records) {
+        if (a.is_main_alignment())
+            return a;
+    }
+    BOOST_FAIL("no primary alignment");
+    return records.front();
+}
+
+void CheckFullAlignment(const Alignment &a, int ref, size_t pos, bool rev, const std::string &seq) {
+    BOOST_CHECK(a.is_aligned());
+    BOOST_CHECK_EQUAL(a.ref, ref);
+    BOOST_CHECK_EQUAL(a.pos, pos);
+    BOOST_CHECK_EQUAL(bool(a.flag & 0x10), rev);
+    BOOST_CHECK(a.map_qual > 0);
+    BOOST_REQUIRE_EQUAL(a.cigar.size(), 1);
+    BOOST_CHECK_EQUAL(a.cigar[0], seq.length() << 4 | kBamMatch);
+    // the sequence goes on the reference strand
+    BOOST_CHECK_EQUAL(a.seq, seq);
+}
+
+BOOST_AUTO_TEST_CASE( BWASequenceIndexSingleReads ) {
+    std::mt19937 rand(11);
+    auto refs = RandomRefs(rand, 3);
+    alignment::BWASequenceIndex index(RefNames(refs.size()), refs, 1);
+
+    std::vector<io::SingleRead> reads;
+    std::vector<std::tuple<int, size_t, std::string>> expected;
+    for (size_t i = 0; i < 100; ++i) {
+        int ref = int(rand() % refs.size());
+        size_t pos = rand() % (kRefLength - 100);
+        std::string seq = refs[ref].substr(pos, 100);
+        if (i % 5 == 0)
+            seq[50] = seq[50] == 'A' ? 'C' : 'A';
+        io::SingleRead read("read" + ToString(i), seq);
+        reads.push_back(i % 2 ? !read : read);
+        expected.emplace_back(ref, pos, seq);
+    }
+    std::string random = RandomNucls(rand, 100);
+    reads.emplace_back("random", random);
+
+    auto res = index.Align(reads, false, 0);
+    BOOST_REQUIRE_EQUAL(res.size(), reads.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        BOOST_REQUIRE_EQUAL(res[i].size(), 1);
+        CheckFullAlignment(res[i][0], std::get<0>(expected[i]), std::get<1>(expected[i]), i % 2,
+                           std::get<2>(expected[i]));
+        BOOST_CHECK(res[i][0].is_main_alignment());
+    }
+
+    const auto &unaligned = res.back();
+    BOOST_REQUIRE_EQUAL(unaligned.size(), 1);
+    BOOST_CHECK(!unaligned[0].is_aligned());
+    BOOST_CHECK_EQUAL(unaligned[0].ref, -1);
+    BOOST_CHECK(unaligned[0].cigar.empty());
+    BOOST_CHECK_EQUAL(unaligned[0].seq, random);
+}
+
+BOOST_AUTO_TEST_CASE( BWASequenceIndexSupplementary ) {
+    std::mt19937 rand(17);
+    auto refs = RandomRefs(rand, 2);
+    alignment::BWASequenceIndex index(RefNames(refs.size()), refs, 1);
+
+    // a chimera of the two references
+    std::string seq = refs[0].substr(1000, 60) + refs[1].substr(2000, 60);
+    auto res = index.Align({io::SingleRead("chimera", seq)}, false, 0);
+    BOOST_REQUIRE_EQUAL(res.size(), 1);
+    BOOST_REQUIRE_EQUAL(res[0].size(), 2);
+
+    for (const auto &a : res[0]) {
+        BOOST_REQUIRE_EQUAL(a.cigar.size(), 2);
+        bool first_half = a.ref == 0;
+        BOOST_CHECK_EQUAL(a.pos, first_half ? 1000 : 2000);
+        uint32_t match = 60 << 4 | kBamMatch;
+        if (a.is_main_alignment()) {
+            // the primary record keeps the whole read and soft clips the rest
+            uint32_t clip = 60 << 4 | kBamSoftClip;
+            BOOST_CHECK_EQUAL(a.cigar[0], first_half ? match : clip);
+            BOOST_CHECK_EQUAL(a.cigar[1], first_half ? clip : match);
+            BOOST_CHECK_EQUAL(a.seq, seq);
+        } else {
+            BOOST_CHECK(a.flag & 0x800);
+            uint32_t clip = 60 << 4 | kBamHardClip;
+            BOOST_CHECK_EQUAL(a.cigar[0], first_half ? match : clip);
+            BOOST_CHECK_EQUAL(a.cigar[1], first_half ? clip : match);
+            BOOST_CHECK_EQUAL(a.seq, first_half ? seq.substr(0, 60) : seq.substr(60));
+        }
+    }
+    BOOST_CHECK(res[0][0].is_main_alignment() != res[0][1].is_main_alignment());
+}
+
+BOOST_AUTO_TEST_CASE( BWASequenceIndexPairedReads ) {
+    std::mt19937 rand(23);
+    auto refs = RandomRefs(rand, 2);
+    alignment::BWASequenceIndex index(RefNames(refs.size()), refs, 1);
+
+    const size_t read_length = 100, insert_size = 300;
+    std::vector<io::SingleRead> reads;
+    std::vector<std::pair<int, size_t>> fragments;
+    for (size_t i = 0; i < 200; ++i) {
+        int ref = int(rand() % refs.size());
+        size_t pos = rand() % (kRefLength - insert_size);
+        // forward-reverse pairs, mates are interleaved
+        std::string name = "pair" + ToString(i);
+        reads.emplace_back(name, refs[ref].substr(pos, read_length));
+        reads.push_back(!io::SingleRead(name, refs[ref].substr(pos + insert_size - read_length, read_length)));
+        fragments.emplace_back(ref, pos);
+    }
+
+    auto res = index.Align(reads, true, 0);
+    BOOST_REQUIRE_EQUAL(res.size(), reads.size());
+    for (size_t i = 0; i < fragments.size(); ++i) {
+        int ref = fragments[i].first;
+        size_t pos = fragments[i].second;
+        const Alignment &left = PrimaryAlignment(res[2 * i]), &right = PrimaryAlignment(res[2 * i + 1]);
+        CheckFullAlignment(left, ref, pos, false, refs[ref].substr(pos, read_length));
+        CheckFullAlignment(right, ref, pos + insert_size - read_length, true,
+                           refs[ref].substr(pos + insert_size - read_length, read_length));
+        // paired, properly paired, mate reverse / reverse, first / second
+        BOOST_CHECK_EQUAL(left.flag, 0x1 | 0x2 | 0x20 | 0x40);
+        BOOST_CHECK_EQUAL(right.flag, 0x1 | 0x2 | 0x10 | 0x80);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+}
@@ -0,0 +1,235 @@
+//***************************************************************************
+//* Copyright (c) 2015 Saint Petersburg State University
+//* All Rights Reserved
+//* See file LICENSE for details.
+//***************************************************************************
+
+// Benchmark of GraphCoverageMap. Path extension is run on the saved graph and
+// the listener traffic it sends to the coverage map is recorded, then the
+// traffic is replayed against the hash map based coverage map (the way
+// GraphCoverageMap used to be implemented) and against GraphCoverageMap, both
+// sequentially and concurrently (the paths are split between the threads).
+
+#include "utils/standard_base.hpp"
+#include "utils/simple_tools.hpp"
+#include "utils/benchmark.hpp"
+#include "utils/logger/log_writers.hpp"
+
+#include "pipeline/graphio.hpp"
+#include "pipeline/graph_pack.hpp"
+#include "modules/path_extend/path_extender.hpp"
+#include "modules/path_extend/pe_resolver.hpp"
+
+void create_console_logger() {
+    logging::logger *log = logging::create_logger("", logging::L_INFO);
+    log->add_writer(std::make_shared<logging::console_writer>());
+    logging::attach_logger(log);
+}
+
+namespace path_extend {
+
+struct CoverageEvent {
+    EdgeId e;
+    uint32_t path;
+    bool added;
+};
+
+// Coverage map which records the traffic
+class RecordingCoverageMap : public GraphCoverageMap {
+public:
+    RecordingCoverageMap(const Graph& g) : GraphCoverageMap(g) {}
+
+    void FrontEdgeAdded(EdgeId e, BidirectionalPath * path, Gap gap) override {
+        Record(e, path, true);
+        GraphCoverageMap::FrontEdgeAdded(e, path, gap);
+    }
+
+    void BackEdgeAdded(EdgeId e, BidirectionalPath * path, Gap gap) override {
+        Record(e, path, true);
+        GraphCoverageMap::BackEdgeAdded(e, path, gap);
+    }
+
+    void FrontEdgeRemoved(EdgeId e, BidirectionalPath * path) override {
+        Record(e, path, false);
+        GraphCoverageMap::FrontEdgeRemoved(e, path);
+    }
+
+    void BackEdgeRemoved(EdgeId e, BidirectionalPath * path) override {
+        Record(e, path, false);
+        GraphCoverageMap::BackEdgeRemoved(e, path);
+    }
+
+    void BackEdgesAdded(const vector<EdgeId>& edges, const vector<Gap>& gaps, BidirectionalPath * path) override {
+        for (EdgeId e : edges)
+            Record(e, path, true);
+        GraphCoverageMap::BackEdgesAdded(edges, gaps, path);
+    }
+
+    void BackEdgesRemoved(const vector<EdgeId>& edges, BidirectionalPath * path) override {
+        for (EdgeId e : edges)
+            Record(e, path, false);
+        GraphCoverageMap::BackEdgesRemoved(edges, path);
+    }
+
+    const vector<CoverageEvent>& events() const { return events_; }
+    size_t path_count() const { return path_index_.size(); }
+
+private:
+    void Record(EdgeId e, BidirectionalPath * path, bool added) {
+        auto it = path_index_.insert(std::make_pair(path, uint32_t(path_index_.size()))).first;
+        events_.push_back(CoverageEvent{e, it->second, added});
+    }
+
+    vector<CoverageEvent> events_;
+    std::unordered_map<BidirectionalPath *, uint32_t> path_index_;
+};
+
+// GraphCoverageMap as it used to be
+class HashCoverageMap {
+public:
+    HashCoverageMap(const Graph& g) {
+        edge_coverage_.reserve(g.size());
+    }
+
+    ~HashCoverageMap() {
+        for (auto& entry : edge_coverage_)
+            delete entry.second;
+    }
+
+    void EdgeAdded(EdgeId e, BidirectionalPath * path) {
+        auto iter = edge_coverage_.find(e);
+        if (iter == edge_coverage_.end())
+            iter = edge_coverage_.insert(std::make_pair(e, new BidirectionalPathMultiset())).first;
+        iter->second->insert(path);
+    }
+
+    void EdgeRemoved(EdgeId e, BidirectionalPath * path) {
+        auto iter = edge_coverage_.find(e);
+        if (iter != edge_coverage_.end()) {
+            auto entry = iter->second->find(path);
+            if (entry != iter->second->end())
+                iter->second->erase(entry);
+        }
+    }
+
+    size_t GetCoverage(EdgeId e) const {
+        auto iter = edge_coverage_.find(e);
+        return iter == edge_coverage_.end() ? 0 : iter->second->size();
+    }
+
+private:
+    std::unordered_map<EdgeId, BidirectionalPathMultiset *> edge_coverage_;
+};
+
+// Picks the most covered extension, two of them if the coverages are close.
+// Paths are not extended beyond the length limit, so that cycles are not
+// traversed forever.
+class CoverageExtensionChooser : public ExtensionChooser {
+    static const size_t MAX_PATH_LENGTH = 100000;
+
+public:
+    CoverageExtensionChooser(const Graph& g) : ExtensionChooser(g) {}
+
+    EdgeContainer Filter(const BidirectionalPath& path, const EdgeContainer& edges) const override {
+        if (path.Length() > MAX_PATH_LENGTH)
+            return EdgeContainer();
+        EdgeContainer sorted = edges;
+        std::sort(sorted.begin(), sorted.end(), [&](const EdgeWithDistance& a, const EdgeWithDistance& b) {
+            return g_.coverage(a.e_) > g_.coverage(b.e_) ||
+                   (g_.coverage(a.e_) == g_.coverage(b.e_) && a.e_ < b.e_);
+        });
+        if (sorted.size() > 1 && g_.coverage(sorted[1].e_) > 0.8 * g_.coverage(sorted[0].e_))
+            sorted.erase(sorted.begin() + 2, sorted.end());
+        else if (sorted.size() > 1)
+            sorted.erase(sorted.begin() + 1, sorted.end());
+        return sorted;
+    }
+};
+
+template<class Map>
+size_t TotalCoverage(const Graph& g, const Map& map) {
+    size_t res = 0;
+    for (auto it = g.ConstEdgeBegin(); !it.IsEnd(); ++it)
+        res += map.GetCoverage(*it);
+    return res;
+}
+
+void Launch(size_t K, const string& saves_path, size_t threads) {
+    TmpFolderFixture tmp_dir("tmp");
+    conj_graph_pack gp(K, "tmp", 0);
+    graphio::ScanBasicGraph(saves_path, gp.g);
+    INFO("Graph loaded, " << gp.g.size() << " edges");
+
+    PathExtendResolver resolver(gp.g);
+    auto seeds = resolver.MakeSimpleSeeds();
+    seeds.SortByLength();
+    RecordingCoverageMap recorder(gp.g);
+    vector<shared_ptr<PathExtender>> extenders;
+    extenders.push_back(make_shared<MultiExtender>(gp, recorder, make_shared<CoverageExtensionChooser>(gp.g),
+                                                   /*is*/ 500, /*investigate_short_loops*/ true,
+                                                   /*use_short_loop_cov_resolver*/ false, /*max_candidates*/ 2));
+    ScaffoldingUniqueEdgeStorage unique;
+    CompositeExtender composite(gp.g, recorder, extenders, unique, /*max_diff_len*/ 500,
+                                /*max_repeat_length*/ 8000, /*detect_repeats_online*/ false);
+    PathContainer paths;
+    composite.GrowAll(seeds, paths);
+
+    const auto& events = recorder.events();
+    INFO(events.size() << " events of " << recorder.path_count() << " paths recorded");
+
+    vector<std::unique_ptr<BidirectionalPath>> replay_paths;
+    for (size_t i = 0; i < recorder.path_count(); ++i)
+        replay_paths.emplace_back(new BidirectionalPath(gp.g));
+
+    std::cout << "Replaying " << events.size() << " events" << std::endl;
+    bench::Run("hash map", [&]() {
+        HashCoverageMap map(gp.g);
+        for (const auto& event : events) {
+            if (event.added)
+                map.EdgeAdded(event.e, replay_paths[event.path].get());
+            else
+                map.EdgeRemoved(event.e, replay_paths[event.path].get());
+        }
+        return TotalCoverage(gp.g, map);
+    });
+    bench::Run("GraphCoverageMap", [&]() {
+        GraphCoverageMap map(gp.g);
+        for (const auto& event : events) {
+            if (event.added)
+                map.BackEdgeAdded(event.e, replay_paths[event.path].get(), Gap(0));
+            else
+                map.BackEdgeRemoved(event.e, replay_paths[event.path].get());
+        }
+        return TotalCoverage(gp.g, map);
+    });
+    vector<vector<CoverageEvent>> thread_events(threads);
+    for (const auto& event : events)
+        thread_events[event.path % threads].push_back(event);
+    bench::Run("GraphCoverageMap, " + ToString(threads) + " threads", [&]() {
+        GraphCoverageMap map(gp.g);
+#       pragma omp parallel for num_threads(threads) schedule(static, 1)
+        for (size_t i = 0; i < threads; ++i) {
+            for (const auto& event : thread_events[i]) {
+                if (event.added)
+                    map.BackEdgeAdded(event.e, replay_paths[event.path].get(), Gap(0));
+                else
+                    map.BackEdgeRemoved(event.e, replay_paths[event.path].get());
+            }
+        }
+        return TotalCoverage(gp.g, map);
+    });
+}
+
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 3) {
+        std::cout << "Usage: coverage_map_bench <K> <saved graph> [threads]" << std::endl;
+        return 1;
+    }
+    create_console_logger();
+    size_t K = std::strtoul(argv[1], NULL, 10);
+    size_t threads = argc > 3 ? std::strtoul(argv[3], NULL, 10) : 4;
+    path_extend::Launch(K, argv[2], threads);
+    return 0;
+}
@@ -122,6 +122,33 @@ BOOST_AUTO_TEST_CASE( SmartIteratorTest ) {
     }
 }
 
+BOOST_AUTO_TEST_CASE( SmartHeapIteratorTest ) {
+    Graph g(11);
+    pair<vector<VertexId> , vector<EdgeId> > data = createGraph(g, 4);
+    const vector<EdgeId> &edges = data.second;
+    SmartHeapIterator<Graph, EdgeId> it(g, edges.begin(), edges.end(), /*add_new*/ true);
+
+    vector<EdgeId> visited;
+    set<EdgeId> added;
+    for (; !it.IsEnd(); ++it) {
+        EdgeId e = *it;
+        visited.push_back(e);
+        if (e == edges[0]) {
+            // The current edge is not visited again, the new ones and their
+            // conjugates are, the deleted one is not
+            it.push(e);
+            EdgeId new_edge = g.AddEdge(data.first[4], data.first[0], Sequence("AAAAAAAAAAAAAAAAA"));
+            added = {new_edge, g.conjugate(new_edge)};
+            g.DeleteEdge(edges[2]);
+        }
+    }
+
+    set<EdgeId> expected = {edges[0], edges[1], edges[3]};
+    expected.insert(added.begin(), added.end());
+    BOOST_CHECK_EQUAL(added.size(), 2);
+    BOOST_CHECK(visited == vector<EdgeId>(expected.begin(), expected.end()));
+}
+
 //todo rename tests
 
 BOOST_AUTO_TEST_CASE( TestSimpleThread ) {
@@ -228,6 +255,37 @@ BOOST_AUTO_TEST_CASE( TestSelfRCEdgeMerge ) {
     BOOST_CHECK_EQUAL(Sequence("AACGCTATTCACGTGAATAGCGTT"), g.EdgeNucls(g.GetUniqueOutgoingEdge(v1)));
 }
 
+size_t CountEdges(const Graph &g) {
+    size_t cnt = 0;
+    for (auto it = g.ConstEdgeBegin(); !it.IsEnd(); ++it)
+        ++cnt;
+    return cnt;
+}
+
+BOOST_AUTO_TEST_CASE( EdgeCountTest ) {
+    Graph g(11);
+    BOOST_CHECK_EQUAL(0u, g.e_size());
+    pair<vector<VertexId> , vector<EdgeId> > data = createGraph(g, 4);
+    BOOST_CHECK_EQUAL(8u, g.e_size());
+
+    g.SplitEdge(data.second[0], 3);
+    BOOST_CHECK_EQUAL(10u, g.e_size());
+    BOOST_CHECK_EQUAL(CountEdges(g), g.e_size());
+
+    g.MergePath(vector<EdgeId>(data.second.begin() + 1, data.second.end()));
+    BOOST_CHECK_EQUAL(6u, g.e_size());
+    BOOST_CHECK_EQUAL(CountEdges(g), g.e_size());
+
+    VertexId v = g.AddVertex();
+    g.AddEdge(v, g.conjugate(v), Sequence("CTATTCACGTGAATAG"));
+    BOOST_CHECK_EQUAL(7u, g.e_size());
+    BOOST_CHECK_EQUAL(CountEdges(g), g.e_size());
+
+    g.DeleteEdge(g.GetUniqueOutgoingEdge(v));
+    BOOST_CHECK_EQUAL(6u, g.e_size());
+    BOOST_CHECK_EQUAL(CountEdges(g), g.e_size());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 }
@@ -0,0 +1,166 @@
+//***************************************************************************
+//* Copyright (c) 2016 Saint Petersburg State University
+//* All Rights Reserved
+//* See file LICENSE for details.
+//***************************************************************************
+
+#pragma once
+
+#include <boost/test/unit_test.hpp>
+#include "assembly_graph/dijkstra/dijkstra_helper.hpp"
+#include "pipeline/graphio.hpp"
+
+#include <queue>
+
+namespace debruijn_graph {
+
+BOOST_AUTO_TEST_SUITE(dijkstra_tests)
+
+typedef omnigraph::DijkstraHelper<Graph> DijkstraHelper;
+
+// Result of the textbook search over std::map / std::set with the same bounds
+struct ReferenceSearch {
+    std::map<VertexId, size_t> distances;
+    std::map<VertexId, std::pair<VertexId, EdgeId>> prev;
+    std::set<VertexId> processed;
+    bool limit_exceeded;
+};
+
+ReferenceSearch RunReferenceSearch(const Graph &g, VertexId start, bool backward,
+                                   size_t bound, size_t max_vertex_number) {
+    typedef omnigraph::element_t<Graph> element;
+    std::priority_queue<element, std::vector<element>, omnigraph::ReverseDistanceComparator<element>> queue;
+    ReferenceSearch res;
+    res.limit_exceeded = false;
+    size_t vertex_number = 0;
+    queue.push(element(0, start, VertexId(0), EdgeId(0)));
+    while (!queue.empty()) {
+        element next = queue.top();
+        queue.pop();
+        VertexId v = next.curr_vertex;
+        if (res.distances.count(v))
+            continue;
+        res.distances[v] = next.distance;
+        res.prev[v] = std::make_pair(next.prev_vertex, next.edge_between);
+        if (++vertex_number > max_vertex_number) {
+            res.limit_exceeded = true;
+            continue;
+        }
+        if (vertex_number == max_vertex_number || next.distance > bound)
+            continue;
+        res.processed.insert(v);
+        std::vector<EdgeId> edges;
+        if (backward)
+            edges.insert(edges.end(), g.in_begin(v), g.in_end(v));
+        else
+            edges.insert(edges.end(), g.out_begin(v), g.out_end(v));
+        for (EdgeId e : edges) {
+            VertexId u = backward ? g.EdgeStart(e) : g.EdgeEnd(e);
+            size_t distance = next.distance + g.length(e);
+            if (!res.distances.count(u) && distance <= bound)
+                queue.push(element(distance, u, v, e));
+        }
+    }
+    return res;
+}
+
+std::vector<EdgeId> ReferencePath(const Graph &g, const ReferenceSearch &search, VertexId v) {
+    std::vector<EdgeId> path;
+    while (search.prev.at(v).first != VertexId(0)) {
+        auto prev = search.prev.at(v);
+        if (g.EdgeStart(prev.second) == prev.first)
+            path.insert(path.begin(), prev.second);
+        else
+            path.push_back(prev.second);
+        v = prev.first;
+    }
+    return path;
+}
+
+template<class Dijkstra>
+void CheckSearch(const Graph &g, Dijkstra &dijkstra, VertexId start, bool backward,
+                 size_t bound, size_t max_vertex_number) {
+    dijkstra.Run(start);
+    ReferenceSearch expected = RunReferenceSearch(g, start, backward, bound, max_vertex_number);
+
+    std::vector<VertexId> reached = dijkstra.ReachedVertices();
+    BOOST_REQUIRE_EQUAL(reached.size(), expected.distances.size());
+    for (VertexId v : reached) {
+        BOOST_REQUIRE(expected.distances.count(v));
+        BOOST_CHECK_EQUAL(dijkstra.GetDistance(v), expected.distances[v]);
+        auto path = dijkstra.GetShortestPathTo(v), expected_path = ReferencePath(g, expected, v);
+        BOOST_CHECK_EQUAL_COLLECTIONS(path.begin(), path.end(), expected_path.begin(), expected_path.end());
+    }
+    std::vector<VertexId> processed = dijkstra.ProcessedVertices();
+    BOOST_CHECK_EQUAL_COLLECTIONS(processed.begin(), processed.end(),
+                                  expected.processed.begin(), expected.processed.end());
+    BOOST_CHECK_EQUAL(dijkstra.VertexLimitExceeded(), expected.limit_exceeded);
+}
+
+// Searches from every vertex with a single object, so the workspace is reset between the runs
+void CheckAllSearches(const Graph &g) {
+    for (size_t bound : {size_t(0), size_t(50), size_t(300), size_t(5000)}) {
+        for (size_t max_vertex_number : {size_t(-1), size_t(1), size_t(7)}) {
+            auto forward = DijkstraHelper::CreateBoundedDijkstra(g, bound, max_vertex_number);
+            auto backward = DijkstraHelper::CreateBackwardBoundedDijkstra(g, bound, max_vertex_number);
+            for (VertexId v : g) {
+                CheckSearch(g, forward, v, false, bound, max_vertex_number);
+                CheckSearch(g, backward, v, true, bound, max_vertex_number);
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE( DijkstraMatchesReference ) {
+    Graph g(13);
+    graphio::ScanBasicGraph("./src/test/debruijn/graph_fragments/path_extend/distance_estimation", g);
+    CheckAllSearches(g);
+}
+
+BOOST_AUTO_TEST_CASE( DijkstraTies ) {
+    // Equal length alternatives: a diamond with parallel edges and a loop
+    Graph g(13);
+    std::vector<VertexId> v;
+    for (size_t i = 0; i < 5; ++i)
+        v.push_back(g.AddVertex());
+    auto add_edge = [&](size_t from, size_t to, size_t length, char nucl) {
+        g.AddEdge(v[from], v[to], Sequence(std::string(g.k() + length, nucl)));
+    };
+    add_edge(0, 1, 10, 'A');
+    add_edge(0, 1, 10, 'C');
+    add_edge(0, 2, 10, 'A');
+    add_edge(1, 3, 10, 'C');
+    add_edge(2, 3, 10, 'G');
+    add_edge(3, 3, 5, 'T');
+    add_edge(3, 4, 20, 'A');
+    add_edge(1, 4, 30, 'G');
+    CheckAllSearches(g);
+
+    auto dijkstra = DijkstraHelper::CreateBoundedDijkstra(g, 1000);
+    dijkstra.Run(v[0]);
+    BOOST_CHECK_EQUAL(dijkstra.GetDistance(v[3]), 20);
+    BOOST_CHECK_EQUAL(dijkstra.GetDistance(v[4]), 40);
+    BOOST_CHECK_EQUAL(dijkstra.GetShortestPathTo(v[4]).size(), 2);
+}
+
+BOOST_AUTO_TEST_CASE( DijkstraWorkspacePool ) {
+    typedef omnigraph::DijkstraWorkspace<Graph, size_t> Workspace;
+    Graph g(13);
+    graphio::ScanBasicGraph("./src/test/debruijn/graph_fragments/path_extend/distance_estimation", g);
+    auto run_all = [&]() {
+        for (VertexId v : g) {
+            auto dijkstra = DijkstraHelper::CreateBoundedDijkstra(g, 5000);
+            dijkstra.Run(v);
+        }
+    };
+
+    // The released workspaces are taken back, so the pool does not grow with the number of searches
+    run_all();
+    size_t pooled = Workspace::PooledBytes();
+    BOOST_CHECK(pooled > 0);
+    run_all();
+    BOOST_CHECK_EQUAL(Workspace::PooledBytes(), pooled);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+}
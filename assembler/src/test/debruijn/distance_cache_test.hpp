@@ -0,0 +1,125 @@
+//***************************************************************************
+//* Copyright (c) 2016 Saint Petersburg State University
+//* All Rights Reserved
+//* See file LICENSE for details.
+//***************************************************************************
+
+#pragma once
+
+#include <boost/test/unit_test.hpp>
+#include "modules/alignment/pacbio/distance_cache.hpp"
+
+#include <random>
+
+namespace debruijn_graph {
+
+BOOST_AUTO_TEST_SUITE(distance_cache_tests)
+
+typedef pacbio::DistanceCache<Graph> DistanceCache;
+
+std::vector<VertexId> AddVertices(Graph &g, size_t cnt) {
+    std::vector<VertexId> res;
+    for (size_t i = 0; i < cnt; ++i)
+        res.push_back(g.AddVertex());
+    return res;
+}
+
+// Deterministic run from the i-th vertex: distances to the next ones
+DistanceCache::Distances ExpectedRun(const std::vector<VertexId> &vertices, size_t i, size_t length) {
+    DistanceCache::Distances res;
+    for (size_t j = 1; j <= length; ++j)
+        res.push_back(std::make_pair(vertices[(i + j) % vertices.size()], i * 100 + j));
+    std::sort(res.begin(), res.end());
+    return res;
+}
+
+BOOST_AUTO_TEST_CASE( DistanceCacheHitMiss ) {
+    Graph g(11);
+    auto vertices = AddVertices(g, 4);
+    DistanceCache cache(100, 4);
+
+    BOOST_CHECK(!cache.Find(vertices[0]));
+    auto stored = cache.Insert(vertices[0], ExpectedRun(vertices, 0, 2));
+    auto found = cache.Find(vertices[0]);
+    BOOST_REQUIRE(found);
+    BOOST_CHECK(found == stored);
+    BOOST_CHECK(*found == ExpectedRun(vertices, 0, 2));
+    BOOST_CHECK(!cache.Find(vertices[1]));
+
+    BOOST_CHECK_EQUAL(1u, cache.hits());
+    BOOST_CHECK_EQUAL(2u, cache.misses());
+    BOOST_CHECK_EQUAL(0u, cache.evictions());
+
+    BOOST_CHECK_EQUAL(1u, DistanceCache::Distance(*found, vertices[1]));
+    BOOST_CHECK_EQUAL(2u, DistanceCache::Distance(*found, vertices[2]));
+    BOOST_CHECK_EQUAL(DistanceCache::NOT_REACHED, DistanceCache::Distance(*found, vertices[3]));
+
+    // The first stored run wins
+    auto again = cache.Insert(vertices[0], ExpectedRun(vertices, 0, 3));
+    BOOST_CHECK(again == stored);
+    BOOST_CHECK_EQUAL(2u, cache.Find(vertices[0])->size());
+}
+
+BOOST_AUTO_TEST_CASE( DistanceCacheClockEviction ) {
+    Graph g(11);
+    auto vertices = AddVertices(g, 12);
+    // Single shard with room for six empty runs
+    DistanceCache cache(6, 1);
+    for (size_t i = 0; i < 6; ++i)
+        cache.Insert(vertices[i], {});
+    BOOST_CHECK(cache.Find(vertices[1]));
+    BOOST_CHECK(cache.Find(vertices[3]));
+
+    // The hand passes the referenced runs once and takes the others in the insertion order,
+    // new runs get right behind the hand and are the last to be taken
+    std::vector<size_t> expected_evicted = {0, 2, 4, 5, 6};
+    for (size_t i = 6; i < 11; ++i) {
+        cache.Insert(vertices[i], {});
+        BOOST_CHECK_EQUAL(i - 5, cache.evictions());
+    }
+    std::set<size_t> evicted;
+    for (size_t i = 0; i < 11; ++i)
+        if (!cache.Find(vertices[i]))
+            evicted.insert(i);
+    BOOST_CHECK(evicted == std::set<size_t>(expected_evicted.begin(), expected_evicted.end()));
+
+    // A heavy run takes the place of several light ones
+    cache.Insert(vertices[11], ExpectedRun(vertices, 11, 2));
+    BOOST_CHECK_EQUAL(8u, cache.evictions());
+    BOOST_CHECK(cache.Find(vertices[11]));
+}
+
+BOOST_AUTO_TEST_CASE( DistanceCacheConcurrentAccess ) {
+    Graph g(11);
+    const size_t vertex_cnt = 200;
+    const size_t ops_per_thread = 20000;
+    auto vertices = AddVertices(g, vertex_cnt);
+    // Far less than all the runs, so eviction keeps going on
+    DistanceCache cache(300, 8);
+
+    size_t found_cnt = 0, wrong_cnt = 0;
+    #pragma omp parallel num_threads(4) reduction(+:found_cnt, wrong_cnt)
+    {
+        std::mt19937 rand(42 + omp_get_thread_num());
+        for (size_t op = 0; op < ops_per_thread; ++op) {
+            size_t i = rand() % vertex_cnt;
+            auto expected = ExpectedRun(vertices, i, i % 5);
+            auto distances = cache.Find(vertices[i]);
+            if (distances)
+                ++found_cnt;
+            else
+                distances = cache.Insert(vertices[i], expected);
+            if (*distances != expected)
+                ++wrong_cnt;
+        }
+    }
+
+    BOOST_CHECK_EQUAL(0u, wrong_cnt);
+    BOOST_CHECK_EQUAL(found_cnt, cache.hits());
+    BOOST_CHECK_EQUAL(4 * ops_per_thread, cache.hits() + cache.misses());
+    BOOST_CHECK(cache.evictions() > 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
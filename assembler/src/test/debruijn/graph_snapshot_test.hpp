@@ -0,0 +1,96 @@
+//***************************************************************************
+//* Copyright (c) 2016 Saint Petersburg State University
+//* All Rights Reserved
+//* See file LICENSE for details.
+//***************************************************************************
+
+#pragma once
+
+#include <boost/test/unit_test.hpp>
+#include "assembly_graph/core/graph_snapshot.hpp"
+#include "pipeline/graphio.hpp"
+
+namespace debruijn_graph {
+
+BOOST_FIXTURE_TEST_SUITE(graph_snapshot_tests, TmpFolderFixture)
+
+typedef omnigraph::GraphSnapshot<Graph> Snapshot;
+
+size_t EdgeCount(const Graph &g) {
+    size_t res = 0;
+    for (auto it = g.ConstEdgeBegin(); !it.IsEnd(); ++it)
+        ++res;
+    return res;
+}
+
+void CheckSnapshot(const Graph &g, const Snapshot &snapshot) {
+    BOOST_REQUIRE(snapshot.valid());
+    BOOST_CHECK_EQUAL(snapshot.vertex_count(), g.size());
+    BOOST_CHECK_EQUAL(snapshot.edge_count(), EdgeCount(g));
+
+    for (VertexId v : g) {
+        Snapshot::Index iv = snapshot.index(v);
+        BOOST_REQUIRE(iv != Snapshot::NO_INDEX);
+        BOOST_CHECK_EQUAL(snapshot.vertex(iv), v);
+
+        std::set<EdgeId> outgoing, snapshot_outgoing;
+        for (EdgeId e : g.OutgoingEdges(v))
+            outgoing.insert(e);
+        for (Snapshot::Index ie = snapshot.out_begin(iv); ie < snapshot.out_end(iv); ++ie) {
+            snapshot_outgoing.insert(snapshot.edge(ie));
+            BOOST_CHECK_EQUAL(snapshot.EdgeStart(ie), iv);
+        }
+        BOOST_CHECK(outgoing == snapshot_outgoing);
+
+        std::set<EdgeId> incoming, snapshot_incoming;
+        for (EdgeId e : g.IncomingEdges(v))
+            incoming.insert(e);
+        for (Snapshot::Index ie : snapshot.IncomingEdges(iv)) {
+            snapshot_incoming.insert(snapshot.edge(ie));
+            BOOST_CHECK_EQUAL(snapshot.EdgeEnd(ie), iv);
+        }
+        BOOST_CHECK(incoming == snapshot_incoming);
+    }
+
+    for (auto it = g.ConstEdgeBegin(); !it.IsEnd(); ++it) {
+        EdgeId e = *it;
+        Snapshot::Index ie = snapshot.index(e);
+        BOOST_REQUIRE(ie != Snapshot::NO_INDEX);
+        BOOST_CHECK_EQUAL(snapshot.edge(ie), e);
+        BOOST_CHECK_EQUAL(snapshot.vertex(snapshot.EdgeStart(ie)), g.EdgeStart(e));
+        BOOST_CHECK_EQUAL(snapshot.vertex(snapshot.EdgeEnd(ie)), g.EdgeEnd(e));
+        BOOST_CHECK_EQUAL(snapshot.edge(snapshot.conjugate(ie)), g.conjugate(e));
+        BOOST_CHECK_EQUAL(snapshot.length(ie), g.length(e));
+        BOOST_CHECK_EQUAL(snapshot.coverage(ie), g.coverage(e));
+    }
+}
+
+BOOST_AUTO_TEST_CASE( GraphSnapshotConstruction ) {
+    Graph g(13);
+    graphio::ScanBasicGraph("./src/test/debruijn/graph_fragments/path_extend/distance_estimation", g);
+    Snapshot snapshot(g);
+    CheckSnapshot(g, snapshot);
+}
+
+BOOST_AUTO_TEST_CASE( GraphSnapshotInvalidation ) {
+    Graph g(13);
+    graphio::ScanBasicGraph("./src/test/debruijn/graph_fragments/path_extend/distance_estimation", g);
+    Snapshot snapshot(g);
+    BOOST_CHECK(snapshot.valid());
+
+    EdgeId e = *g.ConstEdgeBegin();
+    VERIFY(g.length(e) > 1);
+    auto split = g.SplitEdge(e, 1);
+    BOOST_CHECK(!snapshot.valid());
+
+    // The saves have no .gid, so the ids are reserved up to 1e9 on load and
+    // the new edges get the ids way above the dense part of the index
+    BOOST_CHECK(split.first.int_id() > 16 * EdgeCount(g) + 4096);
+    snapshot.Build();
+    CheckSnapshot(g, snapshot);
+    BOOST_CHECK(snapshot.index(split.first) != Snapshot::NO_INDEX);
+    BOOST_CHECK(snapshot.index(split.second) != Snapshot::NO_INDEX);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+}
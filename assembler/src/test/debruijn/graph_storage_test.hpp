@@ -0,0 +1,210 @@
+//***************************************************************************
+//* Copyright (c) 2016 Saint Petersburg State University
+//* All Rights Reserved
+//* See file LICENSE for details.
+//***************************************************************************
+
+#pragma once
+
+#include <boost/test/unit_test.hpp>
+#include "adt/slab_allocator.hpp"
+#include "adt/small_vector.hpp"
+#include "pipeline/graphio.hpp"
+
+namespace debruijn_graph {
+
+BOOST_AUTO_TEST_SUITE(graph_storage_tests)
+
+struct SlabItem {
+    size_t a, b, c;
+};
+
+BOOST_AUTO_TEST_CASE( SlabAllocatorAllocate ) {
+    adt::PairedSlabAllocator<SlabItem> allocator;
+    std::vector<SlabItem*> pairs;
+    for (size_t i = 0; i < 1000; ++i) {
+        SlabItem *pair = allocator.allocate();
+        BOOST_CHECK_EQUAL((size_t) pair % alignof(SlabItem), 0);
+        pair[0] = {i, i, i};
+        pair[1] = {i + 1, i + 1, i + 1};
+        pairs.push_back(pair);
+    }
+    // The cells do not overlap
+    for (size_t i = 0; i < pairs.size(); ++i) {
+        BOOST_CHECK_EQUAL(pairs[i][0].c, i);
+        BOOST_CHECK_EQUAL(pairs[i][1].c, i + 1);
+    }
+    std::set<SlabItem*> distinct(pairs.begin(), pairs.end());
+    BOOST_CHECK_EQUAL(distinct.size(), pairs.size());
+
+    auto stats = allocator.stats();
+    BOOST_CHECK_EQUAL(stats.live, 1000);
+    BOOST_CHECK_EQUAL(stats.allocations, 1000);
+    BOOST_CHECK(stats.slabs > 0);
+    BOOST_CHECK(stats.bytes >= 1000 * 2 * sizeof(SlabItem));
+
+    // The freed cells are reused before the new slabs are taken
+    size_t slabs = stats.slabs;
+    std::set<SlabItem*> freed;
+    for (size_t i = 0; i < pairs.size(); i += 2) {
+        allocator.deallocate(pairs[i]);
+        freed.insert(pairs[i]);
+    }
+    BOOST_CHECK_EQUAL(allocator.stats().live, 500);
+    for (size_t i = 0; i < freed.size(); ++i)
+        BOOST_CHECK(freed.count(allocator.allocate()));
+    stats = allocator.stats();
+    BOOST_CHECK_EQUAL(stats.live, 1000);
+    BOOST_CHECK_EQUAL(stats.allocations, 1500);
+    BOOST_CHECK_EQUAL(stats.slabs, slabs);
+}
+
+BOOST_AUTO_TEST_CASE( SlabAllocatorPairBase ) {
+    adt::PairedSlabAllocator<SlabItem> allocator;
+    SlabItem *pair = allocator.allocate();
+    BOOST_CHECK_EQUAL(allocator.pair_base(pair, pair + 1), pair);
+    BOOST_CHECK_EQUAL(allocator.pair_base(pair + 1, pair), pair);
+    // The cell is freed with its base got from any of the halves
+    allocator.deallocate(allocator.pair_base(pair + 1, pair));
+    BOOST_CHECK_EQUAL(allocator.stats().live, 0);
+    BOOST_CHECK_EQUAL(allocator.allocate(), pair);
+}
+
+BOOST_AUTO_TEST_CASE( SlabAllocatorRelease ) {
+    adt::PairedSlabAllocator<SlabItem> allocator;
+    for (size_t i = 0; i < 1000; ++i)
+        allocator.allocate();
+    allocator.release();
+    auto stats = allocator.stats();
+    BOOST_CHECK_EQUAL(stats.live, 0);
+    BOOST_CHECK_EQUAL(stats.slabs, 0);
+    BOOST_CHECK_EQUAL(stats.bytes, 0);
+
+    // The allocator is usable after the release
+    SlabItem *pair = allocator.allocate();
+    pair[1] = {1, 2, 3};
+    BOOST_CHECK_EQUAL(allocator.stats().live, 1);
+    BOOST_CHECK_EQUAL(allocator.stats().slabs, 1);
+}
+
+typedef adt::SmallVector<size_t, 2> SmallVector;
+
+void CheckElements(const SmallVector &v, const std::vector<size_t> &expected) {
+    BOOST_CHECK_EQUAL_COLLECTIONS(v.begin(), v.end(), expected.begin(), expected.end());
+}
+
+BOOST_AUTO_TEST_CASE( SmallVectorGrowth ) {
+    SmallVector v;
+    std::vector<size_t> expected;
+    const size_t *inline_data = v.data();
+    for (size_t i = 0; i < 2; ++i) {
+        v.push_back(i);
+        expected.push_back(i);
+    }
+    BOOST_CHECK_EQUAL(v.data(), inline_data);
+    BOOST_CHECK_EQUAL(v.capacity(), 2);
+
+    v.push_back(2);
+    expected.push_back(2);
+    BOOST_CHECK(v.data() != inline_data);
+    BOOST_CHECK_EQUAL(v.capacity(), 4);
+    CheckElements(v, expected);
+
+    // The inserted value refers to the element being moved by the growth
+    for (size_t i = 3; i < 20; ++i) {
+        v.insert(v.begin(), v[v.size() - 1]);
+        expected.insert(expected.begin(), expected.back());
+    }
+    CheckElements(v, expected);
+}
+
+BOOST_AUTO_TEST_CASE( SmallVectorErase ) {
+    SmallVector v;
+    std::vector<size_t> expected;
+    for (size_t i = 0; i < 5; ++i) {
+        v.push_back(i);
+        expected.push_back(i);
+    }
+    auto it = v.erase(v.begin() + 1);
+    expected.erase(expected.begin() + 1);
+    BOOST_CHECK_EQUAL(*it, 2);
+    CheckElements(v, expected);
+
+    v.erase(v.end() - 1);
+    expected.pop_back();
+    CheckElements(v, expected);
+    while (!v.empty())
+        v.erase(v.begin());
+    BOOST_CHECK_EQUAL(v.size(), 0);
+
+    SmallVector small;
+    small.push_back(1);
+    small.push_back(2);
+    small.erase(small.begin());
+    CheckElements(small, {2});
+}
+
+BOOST_AUTO_TEST_CASE( SmallVectorMove ) {
+    SmallVector small, large;
+    small.push_back(1);
+    for (size_t i = 0; i < 10; ++i)
+        large.push_back(i);
+
+    // The heap storage is taken over
+    const size_t *large_data = large.data();
+    SmallVector moved(std::move(large));
+    BOOST_CHECK_EQUAL(moved.data(), large_data);
+    BOOST_CHECK_EQUAL(moved.size(), 10);
+    BOOST_CHECK(large.empty());
+    BOOST_CHECK_EQUAL(large.capacity(), 2);
+    large.push_back(5);
+    CheckElements(large, {5});
+
+    // The inline elements are copied
+    SmallVector moved_small(std::move(small));
+    CheckElements(moved_small, {1});
+    BOOST_CHECK(small.empty());
+
+    moved_small = std::move(moved);
+    BOOST_CHECK_EQUAL(moved_small.data(), large_data);
+    CheckElements(moved_small, {0, 1, 2, 3, 4, 5, 6, 7, 8, 9});
+    BOOST_CHECK(moved.empty());
+
+    SmallVector copy(moved_small);
+    BOOST_CHECK(copy.data() != moved_small.data());
+    CheckElements(copy, {0, 1, 2, 3, 4, 5, 6, 7, 8, 9});
+}
+
+class HiddenDeletingGraph : public Graph {
+public:
+    HiddenDeletingGraph(size_t k) : Graph(k) {}
+
+    using Graph::HiddenDeleteAll;
+};
+
+BOOST_AUTO_TEST_CASE( GraphHiddenDeleteAll ) {
+    HiddenDeletingGraph g(13);
+    graphio::ScanBasicGraph("./src/test/debruijn/graph_fragments/path_extend/distance_estimation", g);
+    size_t edge_pairs = 0;
+    for (auto it = g.ConstEdgeBegin(true); !it.IsEnd(); ++it)
+        ++edge_pairs;
+    BOOST_REQUIRE(g.size() > 0);
+    BOOST_CHECK_EQUAL(g.vertex_allocation_stats().live, g.size() / 2);
+    BOOST_CHECK_EQUAL(g.edge_allocation_stats().live, edge_pairs);
+
+    g.HiddenDeleteAll();
+    BOOST_CHECK_EQUAL(g.size(), 0);
+    BOOST_CHECK_EQUAL(g.vertex_allocation_stats().live, 0);
+    BOOST_CHECK_EQUAL(g.vertex_allocation_stats().bytes, 0);
+    BOOST_CHECK_EQUAL(g.edge_allocation_stats().live, 0);
+    BOOST_CHECK_EQUAL(g.edge_allocation_stats().bytes, 0);
+
+    // The graph is usable afterwards
+    VertexId v1 = g.AddVertex(), v2 = g.AddVertex();
+    g.AddEdge(v1, v2, Sequence("ACGTACGTACGTAC"));
+    BOOST_CHECK_EQUAL(g.size(), 4);
+    BOOST_CHECK_EQUAL(g.edge_allocation_stats().live, 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+}
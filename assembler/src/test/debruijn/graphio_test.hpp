@@ -0,0 +1,124 @@
+//***************************************************************************
+//* Copyright (c) 2016 Saint Petersburg State University
+//* All Rights Reserved
+//* See file LICENSE for details.
+//***************************************************************************
+
+#pragma once
+
+#include <boost/test/unit_test.hpp>
+#include "pipeline/graphio.hpp"
+#include "utils/path_helper.hpp"
+
+namespace debruijn_graph {
+
+BOOST_FIXTURE_TEST_SUITE(graphio_tests, TmpFolderFixture)
+
+typedef omnigraph::de::PairedInfoIndexT<Graph> ClusteredIndex;
+typedef omnigraph::de::UnclusteredPairedInfoIndexT<Graph> UnclusteredIndex;
+
+std::map<size_t, EdgeId> EdgesById(const Graph &g) {
+    std::map<size_t, EdgeId> res;
+    for (auto it = g.ConstEdgeBegin(); !it.IsEnd(); ++it)
+        res[(*it).int_id()] = *it;
+    return res;
+}
+
+void CheckSameGraphs(const Graph &expected, const Graph &g) {
+    BOOST_CHECK_EQUAL(expected.size(), g.size());
+    auto expected_edges = EdgesById(expected), edges = EdgesById(g);
+    BOOST_REQUIRE_EQUAL(expected_edges.size(), edges.size());
+    for (const auto &entry : expected_edges) {
+        BOOST_REQUIRE(edges.count(entry.first));
+        EdgeId e1 = entry.second, e2 = edges[entry.first];
+        BOOST_CHECK_EQUAL(expected.EdgeStart(e1).int_id(), g.EdgeStart(e2).int_id());
+        BOOST_CHECK_EQUAL(expected.EdgeEnd(e1).int_id(), g.EdgeEnd(e2).int_id());
+        BOOST_CHECK_EQUAL(expected.conjugate(e1).int_id(), g.conjugate(e2).int_id());
+        BOOST_CHECK_EQUAL(expected.conjugate(expected.EdgeStart(e1)).int_id(),
+                          g.conjugate(g.EdgeStart(e2)).int_id());
+        BOOST_CHECK(expected.EdgeNucls(e1) == g.EdgeNucls(e2));
+        BOOST_CHECK_EQUAL(expected.coverage_index().RawCoverage(e1), g.coverage_index().RawCoverage(e2));
+    }
+}
+
+bool SamePoints(const omnigraph::de::RawPoint &p1, const omnigraph::de::RawPoint &p2) {
+    return p1.d == p2.d && p1.weight == p2.weight;
+}
+
+bool SamePoints(const omnigraph::de::Point &p1, const omnigraph::de::Point &p2) {
+    return p1.d == p2.d && p1.weight == p2.weight && p1.var == p2.var;
+}
+
+template<class Index>
+void CheckSameIndices(const Graph &expected_g, const Index &expected,
+                      const Graph &g, const Index &index) {
+    BOOST_CHECK_EQUAL(expected.size(), index.size());
+    auto edges = EdgesById(g);
+    for (auto it = expected_g.ConstEdgeBegin(); !it.IsEnd(); ++it) {
+        EdgeId e1 = *it;
+        for (auto entry : expected.Get(e1)) {
+            std::vector<typename Index::Point> expected_points(entry.second.begin(), entry.second.end());
+            auto hist = index.Get(edges[e1.int_id()], edges[entry.first.int_id()]);
+            std::vector<typename Index::Point> points(hist.begin(), hist.end());
+            BOOST_REQUIRE_EQUAL(expected_points.size(), points.size());
+            for (size_t i = 0; i < points.size(); ++i) {
+                BOOST_CHECK(SamePoints(expected_points[i], points[i]));
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE( BinaryCheckpointRoundTrip ) {
+    Graph g(13);
+    graphio::ScanBasicGraph("./src/test/debruijn/graph_fragments/path_extend/distance_estimation", g);
+    ClusteredIndex index(g);
+    UnclusteredIndex raw_index(g);
+    std::vector<EdgeId> edges;
+    for (auto it = g.ConstEdgeBegin(); !it.IsEnd(); ++it)
+        edges.push_back(*it);
+    for (size_t i = 0; i < edges.size(); ++i) {
+        g.coverage_index().SetRawCoverage(edges[i], (unsigned) (i * 7 + 1));
+        for (size_t j = i; j < std::min(edges.size(), i + 4); ++j) {
+            index.Add(edges[i], edges[j], omnigraph::de::Point((float) (j - i) * 10.f + 0.5f, (float) (i + 1), 1.5f));
+            raw_index.Add(edges[i], edges[j], omnigraph::de::RawPoint((float) (j - i) * 10.f, (float) (2 * i + 2)));
+        }
+    }
+
+    graphio::ConjugateDataPrinter<Graph> printer(g);
+    graphio::PrintBasicGraph("tmp/text", printer);
+    graphio::PrintPaired("tmp/text", printer, index);
+    graphio::PrintPaired("tmp/text_raw", printer, raw_index);
+    printer.set_binary(true);
+    graphio::PrintBasicGraph("tmp/binary", printer);
+    graphio::PrintPaired("tmp/binary", printer, index);
+    graphio::PrintPaired("tmp/binary_raw", printer, raw_index);
+    BOOST_CHECK(path::FileExists("tmp/binary.bgr") && !path::FileExists("tmp/binary.grp"));
+    BOOST_CHECK(path::FileExists("tmp/binary.bprd") && !path::FileExists("tmp/binary.prd"));
+
+    Graph text_g(13), binary_g(13);
+    ClusteredIndex text_index(text_g), binary_index(binary_g);
+    UnclusteredIndex text_raw_index(text_g), binary_raw_index(binary_g);
+    {
+        graphio::ConjugateDataScanner<Graph> scanner(text_g);
+        graphio::ScanBasicGraph<Graph>("tmp/text", scanner);
+        scanner.LoadPaired("tmp/text", text_index);
+        scanner.LoadPaired("tmp/text_raw", text_raw_index);
+    }
+    {
+        graphio::ConjugateDataScanner<Graph> scanner(binary_g);
+        graphio::ScanBasicGraph<Graph>("tmp/binary", scanner);
+        scanner.LoadPaired("tmp/binary", binary_index);
+        scanner.LoadPaired("tmp/binary_raw", binary_raw_index);
+    }
+
+    CheckSameGraphs(g, text_g);
+    CheckSameGraphs(text_g, binary_g);
+    CheckSameIndices(g, index, text_g, text_index);
+    CheckSameIndices(text_g, text_index, binary_g, binary_index);
+    CheckSameIndices(g, raw_index, text_g, text_raw_index);
+    CheckSameIndices(text_g, text_raw_index, binary_g, binary_raw_index);
+    BOOST_CHECK_EQUAL(text_g.GetGraphIdDistributor().GetMax(), binary_g.GetGraphIdDistributor().GetMax());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+}
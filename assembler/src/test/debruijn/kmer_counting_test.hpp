@@ -0,0 +1,187 @@
+//***************************************************************************
+//* Copyright (c) 2016 Saint Petersburg State University
+//* All Rights Reserved
+//* See file LICENSE for details.
+//***************************************************************************
+
+#pragma once
+
+#include <boost/test/unit_test.hpp>
+#include "utils/indices/kmer_splitters.hpp"
+#include "io/reads/vector_reader.hpp"
+
+#include <random>
+
+namespace debruijn_graph {
+
+BOOST_FIXTURE_TEST_SUITE(kmer_counting_tests, TmpFolderFixture)
+
+typedef DeBruijnReadKMerSplitter<io::SingleRead, StoringTypeFilter<SimpleStoring>> ReadKMerSplitter;
+
+const unsigned kCountingK = 21;
+const unsigned kCountingBuckets = 4;
+
+// Reads sampled from a short random genome, so most of the k-mers occur several times
+std::vector<io::SingleRead> SampledReads(size_t n) {
+    std::mt19937 rand(57);
+    std::string genome(50000, 'A');
+    for (char &c : genome)
+        c = nucl(char(rand() % 4));
+
+    std::vector<io::SingleRead> reads;
+    for (size_t i = 0; i < n; ++i) {
+        size_t pos = rand() % (genome.size() - 100);
+        reads.emplace_back("read" + ToString(i), genome.substr(pos, 100));
+    }
+    return reads;
+}
+
+std::string FileContents(const std::string &fname) {
+    std::ifstream ifs(fname, std::ios::in | std::ios::binary);
+    BOOST_REQUIRE(ifs.good());
+    return std::string(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+}
+
+// Merged buckets along with the multiplicities of their k-mers
+struct CountedKMers {
+    size_t kmers;
+    std::vector<std::string> buckets;
+    std::vector<std::string> counts;
+};
+
+// The splitter gets one producer thread, so the flush is done in background
+// if the thread budget is larger than one
+CountedKMers CountOnDisk(const std::vector<io::SingleRead> &reads, int max_threads) {
+    int saved_threads = omp_get_max_threads();
+    omp_set_num_threads(max_threads);
+
+    std::string workdir = "tmp";
+    io::ReadStreamList<io::SingleRead> streams(std::make_shared<io::VectorReadStream<io::SingleRead>>(reads));
+    // The smallest buffers possible, so there are many flushes
+    ReadKMerSplitter splitter(workdir, kCountingK, 0, streams, nullptr, /* read_buffer_size */ 1);
+    splitter.set_count_multiplicity(true);
+    KMerDiskCounter<RtSeq> counter(workdir, splitter);
+
+    CountedKMers res;
+    res.kmers = counter.Count(kCountingBuckets, 1);
+    for (unsigned i = 0; i < kCountingBuckets; ++i) {
+        res.buckets.push_back(FileContents(counter.GetMergedKMersFname(i)));
+        res.counts.push_back(FileContents(counter.GetMergedCountsFname(i)));
+        ::unlink(counter.GetMergedCountsFname(i).c_str());
+        counter.GetBucket(i, /* unlink */ true);
+    }
+
+    omp_set_num_threads(saved_threads);
+    return res;
+}
+
+// Multiplicities are not counted in memory, so only the buckets are filled
+CountedKMers CountInMemory(const std::vector<io::SingleRead> &reads) {
+    std::string workdir = "tmp";
+    io::ReadStreamList<io::SingleRead> streams(std::make_shared<io::VectorReadStream<io::SingleRead>>(reads));
+    ReadKMerSplitter splitter(workdir, kCountingK, 0, streams, nullptr, /* read_buffer_size */ 1);
+    KMerInMemoryCounter<RtSeq> counter(workdir, splitter);
+
+    CountedKMers res;
+    res.kmers = counter.Count(kCountingBuckets, 1);
+    for (unsigned i = 0; i < kCountingBuckets; ++i) {
+        auto bucket = counter.GetBucket(i, /* unlink */ true);
+        const char *data = (const char*) bucket->data();
+        res.buckets.emplace_back(data, data + bucket->data_size());
+    }
+    return res;
+}
+
+BOOST_AUTO_TEST_CASE( KMerSplitterFlushModes ) {
+    // Many more k-mers than a single generation of the buffers holds
+    auto reads = SampledReads(30000);
+    CountedKMers sync = CountOnDisk(reads, 1), async = CountOnDisk(reads, 3);
+
+    BOOST_CHECK(sync.kmers > 0);
+    BOOST_CHECK_EQUAL(sync.kmers, async.kmers);
+    size_t total = 0, occurrences = 0;
+    for (unsigned i = 0; i < kCountingBuckets; ++i) {
+        BOOST_CHECK(sync.buckets[i] == async.buckets[i]);
+        BOOST_CHECK(sync.counts[i] == async.counts[i]);
+        BOOST_REQUIRE_EQUAL(sync.counts[i].size() % sizeof(uint32_t), 0);
+        const uint32_t *counts = (const uint32_t*) sync.counts[i].data();
+        size_t cnt = sync.counts[i].size() / sizeof(uint32_t);
+        total += cnt;
+        occurrences += std::accumulate(counts, counts + cnt, size_t(0));
+    }
+    BOOST_CHECK_EQUAL(total, sync.kmers);
+    // Every k-mer of every read is counted once
+    BOOST_CHECK_EQUAL(occurrences, reads.size() * (100 - kCountingK + 1));
+}
+
+BOOST_AUTO_TEST_CASE( KMerInMemoryCounting ) {
+    auto reads = SampledReads(30000);
+    CountedKMers on_disk = CountOnDisk(reads, 1), in_memory = CountInMemory(reads);
+
+    BOOST_CHECK(on_disk.kmers > 0);
+    BOOST_CHECK_EQUAL(on_disk.kmers, in_memory.kmers);
+    // Both ways split the k-mers into the same buckets and sort them the same way
+    size_t el_size = RtSeq::GetDataSize(kCountingK) * sizeof(RtSeq::DataType);
+    for (unsigned i = 0; i < kCountingBuckets; ++i) {
+        BOOST_CHECK_EQUAL(on_disk.buckets[i].size(), in_memory.buckets[i].size());
+        BOOST_CHECK_EQUAL(on_disk.counts[i].size() / sizeof(uint32_t), in_memory.buckets[i].size() / el_size);
+        BOOST_CHECK(on_disk.buckets[i] == in_memory.buckets[i]);
+    }
+}
+
+// Sampled reads with a substitution in every tenth one, so that the graph
+// gets tips and bulges with the coverage differing from the genome one
+std::vector<io::SingleRead> ReadsWithErrors(size_t n) {
+    std::mt19937 rand(239);
+    std::vector<io::SingleRead> reads;
+    for (const auto &read : SampledReads(n)) {
+        std::string s = read.GetSequenceString();
+        if (rand() % 10 == 0) {
+            size_t pos = rand() % s.size();
+            s[pos] = nucl(char((dignucl(s[pos]) + 1 + rand() % 3) % 4));
+        }
+        reads.emplace_back(read.name(), s);
+    }
+    return reads;
+}
+
+// Coverage and flanking coverage of every edge after the graph construction
+std::map<std::string, std::vector<double>> ConstructedCoverage(const std::vector<io::SingleRead> &reads,
+                                                               bool single_pass) {
+    const size_t k = 21;
+    conj_graph_pack gp(k, "tmp", 0);
+    size_t half = reads.size() / 2;
+    io::ReadStreamList<io::SingleRead> streams;
+    streams.push_back(io::RCWrap<io::SingleRead>(std::make_shared<io::VectorReadStream<io::SingleRead>>(
+            std::vector<io::SingleRead>(reads.begin(), reads.begin() + half))));
+    streams.push_back(io::RCWrap<io::SingleRead>(std::make_shared<io::VectorReadStream<io::SingleRead>>(
+            std::vector<io::SingleRead>(reads.begin() + half, reads.end()))));
+
+    config::debruijn_config::construction params;
+    params.single_pass_coverage = single_pass;
+    ConstructGraphWithCoverage(params, streams, gp.g, gp.index, gp.flanking_cov);
+
+    std::map<std::string, std::vector<double>> res;
+    for (auto it = gp.g.ConstEdgeBegin(); !it.IsEnd(); ++it) {
+        EdgeId e = *it;
+        res[gp.g.EdgeNucls(e).str()] = {gp.g.coverage(e),
+                                        gp.flanking_cov.GetInCov(e), gp.flanking_cov.GetOutCov(e)};
+    }
+    return res;
+}
+
+BOOST_AUTO_TEST_CASE( SinglePassCoverage ) {
+    auto reads = ReadsWithErrors(10000);
+    auto from_reads = ConstructedCoverage(reads, false);
+    auto single_pass = ConstructedCoverage(reads, true);
+
+    BOOST_CHECK(from_reads.size() > 2);
+    BOOST_CHECK(std::any_of(from_reads.begin(), from_reads.end(),
+                            [](const std::pair<const std::string, std::vector<double>> &edge) {
+                                return edge.second[0] > 0;
+                            }));
+    BOOST_CHECK(from_reads == single_pass);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+}
@@ -0,0 +1,145 @@
+//***************************************************************************
+//* Copyright (c) 2015 Saint Petersburg State University
+//* All Rights Reserved
+//* See file LICENSE for details.
+//***************************************************************************
+
+// Mapping throughput benchmark. Reads are sampled from the edges of the saved
+// graph (with and without substitution errors) or generated at random, then
+// mapped with BasicSequenceMapper. Raw edge index lookups of all the k-mers of
+// the random reads are timed as well, one by one and batched with prefetching.
+
+#include "utils/standard_base.hpp"
+#include "utils/simple_tools.hpp"
+#include "utils/benchmark.hpp"
+#include "utils/logger/log_writers.hpp"
+
+#include "pipeline/graphio.hpp"
+#include "pipeline/graph_pack.hpp"
+#include "modules/alignment/sequence_mapper.hpp"
+
+#include <random>
+
+void create_console_logger() {
+    logging::logger *log = logging::create_logger("", logging::L_INFO);
+    log->add_writer(std::make_shared<logging::console_writer>());
+    logging::attach_logger(log);
+}
+
+namespace debruijn_graph {
+
+static const size_t READ_LENGTH = 150;
+
+Sequence RandomSequence(std::mt19937_64 &rng, size_t length) {
+    std::string s(length, 'A');
+    for (size_t i = 0; i < length; ++i)
+        s[i] = nucl(char(rng() % 4));
+    return Sequence(s);
+}
+
+// Reads sampled from the edges not shorter than the read, every position is
+// substituted with the error_rate probability
+std::vector<Sequence> SampleReads(const Graph &g, std::mt19937_64 &rng,
+                                  size_t count, double error_rate) {
+    std::vector<EdgeId> edges;
+    for (auto it = g.ConstEdgeBegin(); !it.IsEnd(); ++it)
+        if (g.length(*it) + g.k() >= READ_LENGTH)
+            edges.push_back(*it);
+    VERIFY_MSG(!edges.empty(), "No edges longer than the reads");
+
+    std::uniform_real_distribution<double> error(0, 1);
+    std::vector<Sequence> reads;
+    for (size_t i = 0; i < count; ++i) {
+        const Sequence &nucls = g.EdgeNucls(edges[rng() % edges.size()]);
+        size_t pos = rng() % (nucls.size() - READ_LENGTH + 1);
+        std::string s = nucls.Subseq(pos, pos + READ_LENGTH).str();
+        for (size_t j = 0; j < s.size(); ++j)
+            if (error(rng) < error_rate)
+                s[j] = nucl(char((dignucl(s[j]) + 1 + rng() % 3) % 4));
+        reads.push_back(Sequence(s));
+    }
+    return reads;
+}
+
+template<class Mapper>
+void MapReads(const std::string &name, const Mapper &mapper, const std::vector<Sequence> &reads) {
+    bench::RunThroughput(name, reads.size(), [&]() {
+        size_t res = 0;
+        for (const auto &read : reads) {
+            MappingPath<EdgeId> path = mapper.MapSequence(read);
+            for (size_t i = 0; i < path.size(); ++i)
+                res += path[i].first.int_id() + path[i].second.mapped_range.end_pos;
+        }
+        return res;
+    });
+}
+
+void LookupKmers(const conj_graph_pack::index_t &index, const std::vector<RtSeq> &kmers) {
+    typedef conj_graph_pack::index_t::KmerLookup KmerLookup;
+    const size_t window = 16;
+
+    bench::RunThroughput("k-mer lookups", kmers.size(), [&]() {
+        size_t res = 0;
+        for (const auto &kmer : kmers)
+            res += index.get(kmer).second;
+        return res;
+    });
+    bench::RunThroughput("k-mer lookups, prefetched", kmers.size(), [&]() {
+        size_t res = 0;
+        KmerLookup lookups[window];
+        for (size_t i = 0; i < kmers.size() + window; ++i) {
+            if (i >= window)
+                res += index.get(kmers[i - window], lookups[i % window]).second;
+            if (i >= window / 2 && i - window / 2 < kmers.size())
+                index.prefetch_value(lookups[(i - window / 2) % window]);
+            if (i < kmers.size())
+                index.prefetch(kmers[i], lookups[i % window]);
+        }
+        return res;
+    });
+}
+
+void Launch(size_t K, const string &saves_path, size_t read_count) {
+    TmpFolderFixture tmp_dir("tmp");
+    conj_graph_pack gp(K, "tmp", 0);
+    graphio::ScanGraphPack(saves_path, gp);
+    gp.kmer_mapper.Attach();
+    INFO("Graph loaded, " << gp.g.size() << " edges");
+
+    std::mt19937_64 rng(42);
+    auto mapper = MapperInstance(gp);
+    std::cout << "Mapping " << read_count << " reads of length " << READ_LENGTH << std::endl;
+    MapReads("exact reads", *mapper, SampleReads(gp.g, rng, read_count, 0.));
+    MapReads("reads with 1% errors", *mapper, SampleReads(gp.g, rng, read_count, 0.01));
+
+    std::vector<Sequence> random_reads;
+    for (size_t i = 0; i < read_count; ++i)
+        random_reads.push_back(RandomSequence(rng, READ_LENGTH));
+    MapReads("random reads", *mapper, random_reads);
+
+    std::vector<RtSeq> kmers;
+    for (const auto &read : random_reads) {
+        RtSeq kmer = read.start<RtSeq>(K + 1);
+        kmers.push_back(kmer);
+        for (size_t i = K + 1; i < read.size(); ++i) {
+            kmer <<= read[i];
+            kmers.push_back(kmer);
+        }
+    }
+    std::cout << "Looking up " << kmers.size() << " k-mers" << std::endl;
+    LookupKmers(gp.index, kmers);
+}
+
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 3) {
+        std::cout << "Usage: mapping_bench <K> <saved graph> [reads]" << std::endl;
+        return 1;
+    }
+    create_console_logger();
+    size_t K = std::strtoul(argv[1], NULL, 10);
+    size_t read_count = argc > 3 ? std::strtoul(argv[3], NULL, 10) : 1000000;
+    debruijn_graph::Launch(K, argv[2], read_count);
+    return 0;
+}
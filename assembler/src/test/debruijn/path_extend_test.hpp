@@ -20,6 +20,8 @@
 #include "test_utils.hpp"
 #include "modules/path_extend/path_visualizer.hpp"
 #include "modules/path_extend/pe_utils.hpp"
+#include "modules/path_extend/path_extender.hpp"
+#include "modules/path_extend/pe_resolver.hpp"
 namespace path_extend {
 
 BOOST_FIXTURE_TEST_SUITE(path_extend_basic, TmpFolderFixture)
@@ -766,6 +768,195 @@ BOOST_AUTO_TEST_CASE( BidirectionalPathLoopDetector ) {
 }
 
 
+// Always takes the longest of the following edges, so that the paths from different seeds overlap
+class LongestEdgeExtensionChooser : public ExtensionChooser {
+public:
+    LongestEdgeExtensionChooser(const Graph& g) : ExtensionChooser(g) {}
+
+    EdgeContainer Filter(const BidirectionalPath& /*path*/, const EdgeContainer& edges) const override {
+        if (edges.empty())
+            return EdgeContainer();
+        EdgeWithDistance best = edges.front();
+        for (const auto& ewd : edges) {
+            if (std::make_pair(g_.length(ewd.e_), g_.int_id(ewd.e_)) > std::make_pair(g_.length(best.e_), g_.int_id(best.e_)))
+                best = ewd;
+        }
+        return EdgeContainer(1, best);
+    }
+};
+
+// Grows the seeds of every edge, ids of the paths are given relative to the first one
+vector<pair<vector<EdgeId>, uint64_t>> GrowSimpleSeeds(const conj_graph_pack& gp, size_t max_threads) {
+    GraphCoverageMap cover_map(gp.g);
+    ScaffoldingUniqueEdgeStorage unique;
+    auto extender = make_shared<SimpleExtender>(gp, cover_map, make_shared<LongestEdgeExtensionChooser>(gp.g),
+                                                /*is*/ 200, false, false);
+    CompositeExtender composite(gp.g, cover_map, {extender}, unique, /*max_diff_len*/ 100,
+                                /*max_repeat_length*/ 1000, /*detect_repeats_online*/ false, max_threads);
+
+    PathContainer seeds = PathExtendResolver(gp.g).MakeSimpleSeeds();
+    PathContainer paths;
+    composite.GrowAll(seeds, paths);
+
+    vector<pair<vector<EdgeId>, uint64_t>> res;
+    uint64_t first_id = paths.size() ? paths.Get(0)->GetId() : 0;
+    for (auto it = paths.begin(); it != paths.end(); ++it) {
+        for (const BidirectionalPath* p : {it.get(), it.getConjugate()}) {
+            vector<EdgeId> edges;
+            for (size_t i = 0; i < p->Size(); ++i)
+                edges.push_back(p->At(i));
+            res.emplace_back(edges, p->GetId() - first_id);
+        }
+    }
+    seeds.DeleteAllPaths();
+    paths.DeleteAllPaths();
+    return res;
+}
+
+BOOST_AUTO_TEST_CASE( CompositeExtenderParallelGrowth ) {
+    conj_graph_pack gp(13, "tmp", 0);
+    graphio::ScanBasicGraph("./src/test/debruijn/graph_fragments/path_extend/distance_estimation", gp.g);
+
+    auto expected = GrowSimpleSeeds(gp, 1);
+    BOOST_REQUIRE(!expected.empty());
+    // Windows smaller and larger than the number of seeds
+    for (size_t max_threads : {2, 3, 8}) {
+        auto actual = GrowSimpleSeeds(gp, max_threads);
+        BOOST_REQUIRE_EQUAL(actual.size(), expected.size());
+        for (size_t i = 0; i < expected.size(); ++i) {
+            BOOST_CHECK_EQUAL_COLLECTIONS(actual[i].first.begin(), actual[i].first.end(),
+                                          expected[i].first.begin(), expected[i].first.end());
+            BOOST_CHECK_EQUAL(actual[i].second, expected[i].second);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE( GraphCoverageMapUpdates ) {
+    Graph g(13);
+    graphio::ScanBasicGraph("./src/test/debruijn/graph_fragments/path_extend/distance_estimation", g);
+    EdgeId e1 = g.conjugate(*g.ConstEdgeBegin());
+    EdgeId e2 = *(g.OutgoingEdges(g.EdgeEnd(e1)).begin());
+    EdgeId e3 = *(g.OutgoingEdges(g.EdgeEnd(e2)).begin());
+    EdgeId e4 = *(g.OutgoingEdges(g.EdgeEnd(e3)).begin());
+
+    BidirectionalPath p(g), cp(g), other(g);
+    cp.Subscribe(&p);
+    p.Subscribe(&cp);
+    GraphCoverageMap cover_map(g);
+    cover_map.Subscribe(&p);
+    cover_map.Subscribe(&cp);
+    cover_map.Subscribe(&other);
+
+    p.PushBack(e1);
+    p.PushBack(e2);
+    BOOST_CHECK_EQUAL(cover_map.GetCoverage(e1), 1);
+    BOOST_CHECK_EQUAL(cover_map.GetCoverage(g.conjugate(e2)), 1);
+    BOOST_CHECK(!cover_map.IsCovered(e3));
+    BOOST_CHECK_EQUAL(cover_map.size(), 4);
+
+    // Pushed at once
+    BidirectionalPath tail(g, vector<EdgeId>{e3, e4});
+    p.PushBack(tail);
+    BOOST_CHECK(cover_map.IsCovered(p));
+    BOOST_CHECK(cover_map.IsCovered(cp));
+    BOOST_CHECK(cover_map.GetCoveringPaths(e3) == BidirectionalPathSet({&p}));
+    BOOST_CHECK(cover_map.GetCoveringPaths(g.conjugate(e3)) == BidirectionalPathSet({&cp}));
+    BOOST_CHECK_EQUAL(cover_map.size(), 8);
+
+    // Every occurrence of the edge is counted
+    other.PushBack(e2);
+    other.PushBack(e3);
+    other.PushBack(e2);
+    BOOST_CHECK_EQUAL(cover_map.GetCoverage(e2), 3);
+    BOOST_CHECK_EQUAL(cover_map.GetCoveringPaths(e2).size(), 2);
+
+    // Popped at once
+    p.PopBack(3);
+    BOOST_CHECK_EQUAL(cover_map.GetCoverage(e1), 1);
+    BOOST_CHECK_EQUAL(cover_map.GetCoverage(e2), 2);
+    BOOST_CHECK_EQUAL(cover_map.GetCoverage(e3), 1);
+    BOOST_CHECK(!cover_map.IsCovered(e4));
+    BOOST_CHECK(!cover_map.IsCovered(g.conjugate(e2)));
+    BOOST_CHECK_EQUAL(cover_map.size(), 4);
+
+    p.Clear();
+    other.Clear();
+    BOOST_CHECK_EQUAL(cover_map.size(), 0);
+    BOOST_CHECK(cover_map.GetEdgePaths(e2)->empty());
+}
+
+BOOST_AUTO_TEST_CASE( GraphCoverageMapNewEdges ) {
+    Graph g(13);
+    graphio::ScanBasicGraph("./src/test/debruijn/graph_fragments/path_extend/distance_estimation", g);
+    GraphCoverageMap cover_map(g);
+
+    // Edges created after the map get the ids far beyond the ones it was sized for
+    g.GetGraphIdDistributor().Reserve(100000);
+    VertexId v1 = g.AddVertex();
+    VertexId v2 = g.AddVertex();
+    EdgeId fresh = g.AddEdge(v1, v2, Sequence("ACGTACGTACGTACG"));
+    EdgeId old = *g.ConstEdgeBegin();
+    BOOST_CHECK(!cover_map.IsCovered(fresh));
+
+    BidirectionalPath p(g);
+    cover_map.Subscribe(&p);
+    p.PushBack(old);
+    p.PushBack(fresh);
+    BOOST_CHECK(cover_map.IsCovered(p));
+    BOOST_CHECK_EQUAL(cover_map.GetCoverage(fresh), 1);
+    BOOST_CHECK_EQUAL(cover_map.size(), 2);
+
+    p.PopBack();
+    BOOST_CHECK(!cover_map.IsCovered(fresh));
+    BOOST_CHECK(cover_map.IsCovered(old));
+}
+
+BOOST_AUTO_TEST_CASE( GraphCoverageMapConcurrentUpdates ) {
+    Graph g(13);
+    graphio::ScanBasicGraph("./src/test/debruijn/graph_fragments/path_extend/distance_estimation", g);
+    vector<EdgeId> edges;
+    for (auto it = g.ConstEdgeBegin(); !it.IsEnd(); ++it)
+        edges.push_back(*it);
+
+    GraphCoverageMap cover_map(g);
+    const size_t path_cnt = 16;
+    vector<std::unique_ptr<BidirectionalPath>> paths;
+    for (size_t i = 0; i < path_cnt; ++i) {
+        paths.emplace_back(new BidirectionalPath(g));
+        cover_map.Subscribe(paths.back().get());
+    }
+
+    #pragma omp parallel for num_threads(4) schedule(dynamic)
+    for (size_t i = 0; i < path_cnt; ++i) {
+        BidirectionalPath &path = *paths[i];
+        for (size_t round = 0; round < 50; ++round) {
+            for (size_t j = 0; j < edges.size(); ++j)
+                if ((i + j + round) % 3 == 0)
+                    path.PushBack(edges[j]);
+            path.PopBack(path.Size() / 2);
+            if (round % 10 == 0)
+                path.PushBack(BidirectionalPath(g, edges));
+        }
+    }
+
+    size_t covered = 0;
+    for (EdgeId e : edges) {
+        int expected = 0;
+        BidirectionalPathSet covering;
+        for (const auto &path : paths) {
+            for (size_t i = 0; i < path->Size(); ++i)
+                if (path->At(i) == e) {
+                    ++expected;
+                    covering.insert(path.get());
+                }
+        }
+        BOOST_CHECK_EQUAL(cover_map.GetCoverage(e), expected);
+        BOOST_CHECK(cover_map.GetCoveringPaths(e) == covering);
+        covered += expected > 0;
+    }
+    BOOST_CHECK_EQUAL(cover_map.size(), covered);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 }
@@ -8,6 +8,7 @@
 #pragma once
 
 #include <boost/test/unit_test.hpp>
+#include <random>
 #include "test_utils.hpp"
 #include "modules/simplification/parallel_simplification_algorithms.hpp"
 #include "stages/simplification_pipeline/graph_simplification.hpp"
@@ -140,6 +141,13 @@ void DefaultRemoveBulges(Graph& graph) {
     debruijn::simplification::BRInstance(graph, standard_br_config(), standard_simplif_relevant_info())->Run();
 }
 
+void ParallelRemoveBulges(Graph& graph, size_t buff_size) {
+    auto br_config = standard_br_config();
+    br_config.parallel = true;
+    br_config.buff_size = buff_size;
+    debruijn::simplification::BRInstance(graph, br_config, standard_simplif_relevant_info())->Run();
+}
+
 BOOST_AUTO_TEST_CASE( SimpleTipClipperTest ) {
     ConjugateDeBruijnGraph g(55);
     graphio::ScanBasicGraph<ConjugateDeBruijnGraph>("./src/test/debruijn/graph_fragments/simpliest_tip/simpliest_tip", g);
@@ -169,6 +177,95 @@ BOOST_AUTO_TEST_CASE( TipobulgeTest ) {
     BOOST_CHECK_EQUAL(g.size(), 16u);
 }
 
+BOOST_AUTO_TEST_CASE( ParallelBulgeRemovalTest ) {
+    //small buffer to get several rounds
+    for (size_t buff_size : {1, 2, 10000}) {
+        Graph g(55);
+        graphio::ScanBasicGraph("./src/test/debruijn/graph_fragments/simpliest_bulge/simpliest_bulge", g);
+        ParallelRemoveBulges(g, buff_size);
+        BOOST_CHECK_EQUAL(g.size(), 4u);
+
+        Graph g2(55);
+        graphio::ScanBasicGraph("./src/test/debruijn/graph_fragments/tipobulge/tipobulge", g2);
+        DefaultClipTips(g2);
+        ParallelRemoveBulges(g2, buff_size);
+        BOOST_CHECK_EQUAL(g2.size(), 16u);
+    }
+}
+
+//Chain of bulges on the random sequences. Some bulges are adjacent, so they interact,
+//the alternatives of some consist of two edges, so the low covered edge is split when glued
+void FillBulgeChain(Graph& g, size_t bulge_cnt, unsigned seed) {
+    std::mt19937 rand(seed);
+    size_t k = g.k();
+    auto random_seq = [&](size_t len) {
+        std::string s(len, 'A');
+        for (char& c : s)
+            c = nucl(char(rand() % 4));
+        return s;
+    };
+    auto add_edge = [&](VertexId v1, VertexId v2, const std::string& s, unsigned cov) {
+        EdgeId e = g.AddEdge(v1, v2, Sequence(s));
+        g.coverage_index().SetRawCoverage(e, unsigned(g.length(e)) * cov);
+    };
+
+    VertexId v = g.AddVertex();
+    std::string kmer = random_seq(k);
+    for (size_t i = 0; i < bulge_cnt; ++i) {
+        if (rand() % 2) {
+            std::string s = kmer + random_seq(30 + rand() % 20);
+            VertexId u = g.AddVertex();
+            add_edge(v, u, s, 50);
+            v = u;
+            kmer = s.substr(s.size() - k);
+        }
+        std::string s = kmer + random_seq(80 + rand() % 40);
+        VertexId u = g.AddVertex();
+        std::string low = s;
+        size_t pos = s.size() / 2;
+        low[pos] = nucl(char((dignucl(low[pos]) + 1) % 4));
+        add_edge(v, u, low, 1 + rand() % 10);
+        if (rand() % 2) {
+            add_edge(v, u, s, 50);
+        } else {
+            size_t p = 1 + rand() % (s.size() - k - 1);
+            VertexId w = g.AddVertex();
+            add_edge(v, w, s.substr(0, p + k), 50);
+            add_edge(w, u, s.substr(p), 50);
+        }
+        v = u;
+        kmer = s.substr(s.size() - k);
+    }
+}
+
+std::vector<std::pair<std::string, unsigned>> EdgeContents(const Graph& g) {
+    std::vector<std::pair<std::string, unsigned>> res;
+    for (auto it = g.ConstEdgeBegin(); !it.IsEnd(); ++it)
+        res.push_back(std::make_pair(g.EdgeNucls(*it).str(), g.coverage_index().RawCoverage(*it)));
+    std::sort(res.begin(), res.end());
+    return res;
+}
+
+BOOST_AUTO_TEST_CASE( ParallelBulgeRemovalConcurrentGluing ) {
+    Graph expected(55);
+    FillBulgeChain(expected, 300, 239);
+    DefaultRemoveBulges(expected);
+    //all the bulges are gone, the chain is a path
+    for (VertexId v : expected)
+        BOOST_CHECK_LE(expected.OutgoingEdgeCount(v), 1u);
+
+    int saved_threads = omp_get_max_threads();
+    omp_set_num_threads(4);
+    for (size_t buff_size : {1, 7, 10000}) {
+        Graph g(55);
+        FillBulgeChain(g, 300, 239);
+        ParallelRemoveBulges(g, buff_size);
+        BOOST_CHECK_EQUAL(g.size(), expected.size());
+        BOOST_CHECK(EdgeContents(g) == EdgeContents(expected));
+    }
+    omp_set_num_threads(saved_threads);
+}
+
 BOOST_AUTO_TEST_CASE( SimpleECTest ) {
     Graph g(55);
     graphio::ScanBasicGraph("./src/test/debruijn/graph_fragments/topology_ec/iter_unique_path", g);
@@ -413,6 +510,46 @@ BOOST_AUTO_TEST_CASE( ParallelECRemover2 ) {
     BOOST_CHECK_EQUAL(gp.g.size(), 20u);
 }
 
+//k-mers of the edges that were ever in the graph should be mapped the same way by the index
+//updated in the batch and by the refilled one
+void CheckIndexConsistency(const conj_graph_pack &gp, const vector<Sequence> &seqs) {
+    conj_graph_pack::index_t refilled(gp.g, "tmp");
+    refilled.Refill();
+    size_t k = gp.index.k();
+    for (const Sequence &seq : seqs) {
+        for (size_t i = 0; i + k <= seq.size(); ++i) {
+            RtSeq kmer(k, seq, i);
+            BOOST_CHECK_EQUAL(gp.index.contains(kmer), refilled.contains(kmer));
+            if (refilled.contains(kmer))
+                BOOST_CHECK(gp.index.get(kmer) == refilled.get(kmer));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE( BatchedIndexUpdate ) {
+    string path = graph_fragment_root() + "complex_bulge/complex_bulge";
+    string condition = "{ cb 1000 , ec_lb 20 }";
+    conj_graph_pack gp(55, "tmp", 0);
+    graphio::ScanGraphPack(path, gp);
+    if (gp.index.IsAttached())
+        gp.index.Detach();
+    gp.EnsureIndex();
+
+    vector<Sequence> seqs;
+    for (auto it = gp.g.ConstEdgeBegin(); !it.IsEnd(); ++it)
+        seqs.push_back(gp.g.EdgeNucls(*it));
+
+    debruijn::simplification::ConditionParser<Graph> parser(gp.g, condition, standard_simplif_relevant_info());
+    parser();
+    debruijn::simplification::ParallelEC(gp.g, parser.max_length_bound(), parser.max_coverage_bound(), standard_simplif_relevant_info().chunk_cnt());
+    debruijn::simplification::ParallelEC(gp.g, parser.max_length_bound(), parser.max_coverage_bound(), standard_simplif_relevant_info().chunk_cnt());
+    BOOST_CHECK_EQUAL(gp.g.size(), 12u);
+
+    for (auto it = gp.g.ConstEdgeBegin(); !it.IsEnd(); ++it)
+        seqs.push_back(gp.g.EdgeNucls(*it));
+    CheckIndexConsistency(gp, seqs);
+}
+
 //BOOST_AUTO_TEST_CASE( ComplexTipRemover ) {
 //    string path = "./src/test/debruijn/graph_fragments/ecs/graph";
 //    size_t graph_size = 0;
@@ -15,6 +15,14 @@
 #include "debruijn_graph_test.hpp"
 #include "simplification_test.hpp"
 #include "order_and_law_test.hpp"
+#include "graphio_test.hpp"
+#include "graph_snapshot_test.hpp"
+#include "graph_storage_test.hpp"
+#include "binary_reads_test.hpp"
+#include "bwa_index_test.hpp"
+#include "dijkstra_test.hpp"
+#include "distance_cache_test.hpp"
+#include "kmer_counting_test.hpp"
 #include "path_extend_test.hpp"
 #include "overlap_analysis_test.hpp"
 //#include "detail_coverage_test.hpp"
@@ -0,0 +1,108 @@
+//***************************************************************************
+//* Copyright (c) 2016 Saint Petersburg State University
+//* All Rights Reserved
+//* See file LICENSE for details.
+//***************************************************************************
+
+// Benchmark of the simplification worklists. All the edges of the saved graph
+// are put into the worklist ordered by coverage (the primary launch), then the
+// worklist is drained while some edges are erased and some are returned for
+// consideration, the way the persistent simplification algorithms do it. The
+// same workload is replayed with the ordered set and the indexed heap backends,
+// the checksums of the processing order should match.
+
+#include "utils/standard_base.hpp"
+#include "utils/simple_tools.hpp"
+#include "utils/benchmark.hpp"
+#include "utils/logger/log_writers.hpp"
+
+#include "pipeline/graphio.hpp"
+#include "pipeline/graph_pack.hpp"
+#include "assembly_graph/graph_support/comparators.hpp"
+#include "common/adt/queue_iterator.hpp"
+#include "common/adt/indexed_heap.hpp"
+
+#include <random>
+
+void create_console_logger() {
+    logging::logger *log = logging::create_logger("", logging::L_INFO);
+    log->add_writer(std::make_shared<logging::console_writer>());
+    logging::attach_logger(log);
+}
+
+namespace debruijn_graph {
+
+struct WorklistOp {
+    enum { Erase, Push } type;
+    EdgeId e;
+};
+
+// Every processed edge is followed by the ops on the randomly chosen edges
+vector<vector<WorklistOp>> GenerateOps(const vector<EdgeId>& edges, size_t rounds) {
+    std::mt19937_64 rng(239);
+    vector<vector<WorklistOp>> ops(rounds);
+    for (auto& round : ops) {
+        size_t cnt = rng() % 4;
+        for (size_t i = 0; i < cnt; ++i) {
+            EdgeId e = edges[rng() % edges.size()];
+            round.push_back(WorklistOp{(rng() % 2) ? WorklistOp::Erase : WorklistOp::Push, e});
+        }
+    }
+    return ops;
+}
+
+template<class Queue>
+size_t Replay(const Graph& g, const vector<EdgeId>& edges, const vector<vector<WorklistOp>>& ops) {
+    typedef omnigraph::CoverageComparator<Graph> Comparator;
+    DynamicQueueIterator<EdgeId, Comparator, Queue> it((Comparator(g)));
+    it.insert(edges.begin(), edges.end());
+
+    size_t processed = 0, checksum = 0;
+    for (; !it.IsEnd() && processed < ops.size(); ++it) {
+        EdgeId e = *it;
+        checksum = checksum * 31 + e.int_id();
+        for (const auto& op : ops[processed]) {
+            if (op.type == WorklistOp::Erase)
+                it.erase(op.e);
+            else
+                it.push(op.e);
+        }
+        ++processed;
+    }
+    return checksum;
+}
+
+void Launch(size_t K, const string& saves_path, size_t rounds) {
+    TmpFolderFixture tmp_dir("tmp");
+    conj_graph_pack gp(K, "tmp", 0);
+    graphio::ScanBasicGraph(saves_path, gp.g);
+    INFO("Graph loaded, " << gp.g.size() << " edges");
+
+    vector<EdgeId> edges;
+    for (auto it = gp.g.ConstEdgeBegin(); !it.IsEnd(); ++it)
+        edges.push_back(*it);
+    auto ops = GenerateOps(edges, rounds);
+
+    typedef omnigraph::CoverageComparator<Graph> Comparator;
+    std::cout << "Replaying " << rounds << " rounds over " << edges.size() << " edges" << std::endl;
+    bench::Run("ordered set", [&]() {
+        return Replay<erasable_priority_queue<EdgeId, Comparator>>(gp.g, edges, ops);
+    });
+    bench::Run("indexed heap", [&]() {
+        return Replay<adt::indexed_heap<EdgeId, Comparator>>(gp.g, edges, ops);
+    });
+}
+
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 3) {
+        std::cout << "Usage: worklist_bench <K> <saved graph> [rounds]" << std::endl;
+        return 1;
+    }
+    create_console_logger();
+    size_t K = std::strtoul(argv[1], NULL, 10);
+    size_t rounds = argc > 3 ? std::strtoul(argv[3], NULL, 10) : 10000000;
+    debruijn_graph::Launch(K, argv[2], rounds);
+    return 0;
+}
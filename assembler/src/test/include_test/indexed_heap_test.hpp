@@ -0,0 +1,218 @@
+//***************************************************************************
+//* Copyright (c) 2016 Saint Petersburg State University
+//* All Rights Reserved
+//* See file LICENSE for details.
+//***************************************************************************
+
+#pragma once
+#include <boost/test/unit_test.hpp>
+#include "adt/indexed_heap.hpp"
+#include "adt/queue_iterator.hpp"
+#include <map>
+#include <random>
+#include <vector>
+
+// Element with the integer id, the heap is ordered by the priority kept outside
+struct HeapItem {
+    size_t id;
+
+    size_t int_id() const { return id; }
+    bool operator==(const HeapItem &other) const { return id == other.id; }
+};
+
+struct HeapItemLess {
+    const std::map<size_t, int> *priority;
+
+    HeapItemLess(const std::map<size_t, int> *p = nullptr) : priority(p) {}
+
+    bool operator()(const HeapItem &a, const HeapItem &b) const {
+        int pa = priority->at(a.id), pb = priority->at(b.id);
+        return pa < pb || (pa == pb && a.id < b.id);
+    }
+};
+
+typedef adt::indexed_heap<HeapItem, HeapItemLess> ItemHeap;
+
+std::vector<size_t> PopAll(ItemHeap &heap) {
+    std::vector<size_t> res;
+    while (!heap.empty()) {
+        res.push_back(heap.top().id);
+        heap.pop();
+    }
+    return res;
+}
+
+// Ids of the map sorted by their priorities, i.e. the expected order of the heap
+std::vector<size_t> SortedIds(const std::map<size_t, int> &priority) {
+    std::vector<std::pair<int, size_t>> order;
+    for (const auto &entry : priority)
+        order.push_back({entry.second, entry.first});
+    std::sort(order.begin(), order.end());
+    std::vector<size_t> res;
+    for (const auto &entry : order)
+        res.push_back(entry.second);
+    return res;
+}
+
+BOOST_AUTO_TEST_CASE( TestIndexedHeapOrder ) {
+    std::mt19937 rand(11);
+    std::map<size_t, int> priority;
+    ItemHeap heap{HeapItemLess(&priority)};
+    for (size_t id = 0; id < 1000; ++id) {
+        priority[id] = int(rand() % 100);
+        heap.push({id});
+    }
+    BOOST_CHECK_EQUAL(heap.size(), 1000);
+    BOOST_CHECK(PopAll(heap) == SortedIds(priority));
+}
+
+BOOST_AUTO_TEST_CASE( TestIndexedHeapKeyUpdates ) {
+    std::map<size_t, int> priority;
+    ItemHeap heap{HeapItemLess(&priority)};
+    for (size_t id = 0; id < 100; ++id) {
+        priority[id] = int(id) * 10;
+        heap.push({id});
+    }
+
+    // Decrease-key: the element goes to the top
+    priority[70] = -1;
+    heap.push({70});
+    BOOST_CHECK_EQUAL(heap.top().id, 70);
+
+    // Increase-key: the top goes down
+    priority[70] = 10000;
+    heap.push({70});
+    BOOST_CHECK_EQUAL(heap.top().id, 0);
+    priority[0] = 555;
+    heap.push({0});
+    BOOST_CHECK_EQUAL(heap.top().id, 1);
+
+    // Pushing the element again does not duplicate it
+    BOOST_CHECK_EQUAL(heap.size(), 100);
+    BOOST_CHECK(PopAll(heap) == SortedIds(priority));
+}
+
+BOOST_AUTO_TEST_CASE( TestIndexedHeapErase ) {
+    std::mt19937 rand(13);
+    std::map<size_t, int> priority;
+    ItemHeap heap{HeapItemLess(&priority)};
+    for (size_t id = 0; id < 500; ++id) {
+        priority[id] = int(rand() % 1000);
+        heap.push({id});
+    }
+
+    // Elements from the middle of the heap
+    for (size_t id = 1; id < 500; id += 3) {
+        BOOST_CHECK(heap.contains({id}));
+        BOOST_CHECK(heap.erase({id}));
+        BOOST_CHECK(!heap.contains({id}));
+        BOOST_CHECK(!heap.erase({id}));
+        priority.erase(id);
+    }
+    BOOST_CHECK_EQUAL(heap.size(), priority.size());
+    BOOST_CHECK(PopAll(heap) == SortedIds(priority));
+}
+
+BOOST_AUTO_TEST_CASE( TestIndexedHeapReinsertErased ) {
+    std::map<size_t, int> priority = {{1, 5}, {2, 3}, {3, 7}, {4, 1}};
+    ItemHeap heap{HeapItemLess(&priority)};
+    for (const auto &entry : priority)
+        heap.push({entry.first});
+
+    BOOST_CHECK(heap.erase({4}));
+    BOOST_CHECK(heap.erase({3}));
+    priority[3] = 0;
+    heap.push({3});
+    BOOST_CHECK(heap.contains({3}));
+    BOOST_CHECK(!heap.contains({4}));
+    BOOST_CHECK_EQUAL(heap.size(), 3);
+
+    priority.erase(4);
+    BOOST_CHECK(PopAll(heap) == SortedIds(priority));
+
+    // The popped elements can be pushed again as well
+    heap.push({1});
+    BOOST_CHECK_EQUAL(heap.size(), 1);
+    BOOST_CHECK_EQUAL(heap.top().id, 1);
+    heap.clear();
+    BOOST_CHECK(heap.empty());
+    BOOST_CHECK(!heap.contains({1}));
+}
+
+BOOST_AUTO_TEST_CASE( TestIndexedHeapSparseIds ) {
+    std::mt19937 rand(17);
+    std::map<size_t, int> priority;
+    ItemHeap heap{HeapItemLess(&priority)};
+
+    // Few elements with large ids are kept in the sparse index
+    const size_t large = 100005;
+    for (size_t i = 0; i < 10; ++i) {
+        priority[large + i * 10] = int(rand() % 100);
+        heap.push({large + i * 10});
+    }
+    // Small ids go to the dense one
+    for (size_t id = 0; id < 100; ++id) {
+        priority[id] = int(rand() % 100);
+        heap.push({id});
+    }
+
+    priority[large] = -1;
+    heap.push({large});
+    BOOST_CHECK_EQUAL(heap.top().id, large);
+    BOOST_CHECK(heap.erase({large + 50}));
+    priority.erase(large + 50);
+
+    // Enough elements, so the dense index grows over most of the ids which were sparse
+    std::vector<HeapItem> many;
+    for (size_t id = 100; id < large; id += 10) {
+        priority[id] = int(rand() % 100);
+        many.push_back({id});
+    }
+    heap.insert(many.begin(), many.end());
+    // Ids which were indexed before the growth are still found
+    for (const auto &entry : priority)
+        BOOST_CHECK(heap.contains({entry.first}));
+    BOOST_CHECK(!heap.contains({large + 50}));
+
+    // Bulk insertion of the elements which are already there updates their keys
+    std::vector<HeapItem> updated;
+    for (size_t id = 0; id < 100; id += 7) {
+        priority[id] = 1000 + int(id);
+        updated.push_back({id});
+    }
+    heap.insert(updated.begin(), updated.end());
+
+    BOOST_CHECK_EQUAL(heap.size(), priority.size());
+    BOOST_CHECK(PopAll(heap) == SortedIds(priority));
+}
+
+BOOST_AUTO_TEST_CASE( TestIndexedHeapQueueIterator ) {
+    std::map<size_t, int> priority;
+    for (size_t id = 0; id < 10; ++id)
+        priority[id] = int(id) * 10;
+    DynamicQueueIterator<HeapItem, HeapItemLess, ItemHeap> it{HeapItemLess(&priority)};
+    for (size_t id = 0; id < 10; ++id)
+        it.push({id});
+
+    std::vector<size_t> visited;
+    for (; !it.IsEnd(); ++it) {
+        size_t id = (*it).id;
+        visited.push_back(id);
+        if (id == 2) {
+            // Pushed during the iteration: the ones ahead of the current element
+            // are visited next, the current one is not visited again
+            priority[100] = 25;
+            priority[101] = 0;
+            it.push({100});
+            it.push({101});
+            it.push({2});
+        }
+        if (id == 3) {
+            priority[9] = 31;
+            it.push({9});
+            it.erase({4});
+        }
+    }
+    std::vector<size_t> expected = {0, 1, 2, 101, 100, 3, 9, 5, 6, 7, 8};
+    BOOST_CHECK(visited == expected);
+}
@@ -13,6 +13,7 @@
 #include <boost/function.hpp>
 #include <boost/bind.hpp>
 #include <string>
+#include <random>
 
 typedef unsigned long long ull;
 
@@ -704,3 +705,27 @@ BOOST_AUTO_TEST_CASE( TestRtSeqFirstLast ) {
     BOOST_CHECK_EQUAL(3, s2.first());
     BOOST_CHECK_EQUAL(3, s2.last());
 }
+
+BOOST_AUTO_TEST_CASE( TestRtSeqCompare ) {
+    std::mt19937 rand(239);
+    const char nucls[] = "ACGT";
+    for (size_t k : {1, 15, 21, 31, 32, 33, 55, 64, 65, 77, 96, 127}) {
+        for (size_t iter = 0; iter < 200; ++iter) {
+            std::string s1(k, 'A'), s2;
+            for (size_t i = 0; i < k; ++i)
+                s1[i] = nucls[rand() % 4];
+            // Pairs with a long common prefix differ in the later words
+            s2 = s1;
+            size_t pos = rand() % k;
+            s2[pos] = nucls[rand() % 4];
+            for (size_t i = pos + 1; i < k; ++i)
+                s2[i] = nucls[rand() % 4];
+
+            RtSeq kmer1(k, s1.c_str()), kmer2(k, s2.c_str());
+            BOOST_CHECK_EQUAL(s1 == s2, kmer1 == kmer2);
+            BOOST_CHECK_EQUAL(s1 < s2, kmer1 < kmer2);
+            BOOST_CHECK_EQUAL(s2 < s1, kmer2 < kmer1);
+            BOOST_CHECK_EQUAL(s1 < s2, (bool) RtSeq::less2()(kmer1, kmer2));
+        }
+    }
+}
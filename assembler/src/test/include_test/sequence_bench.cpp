@@ -0,0 +1,93 @@
+//***************************************************************************
+//* Copyright (c) 2015 Saint Petersburg State University
+//* All Rights Reserved
+//* See file LICENSE for details.
+//***************************************************************************
+
+// Micro-benchmark of the Sequence comparison routines: the word-parallel
+// implementations vs. the nucleotide-by-nucleotide ones (via operator[]).
+
+#include "sequence/sequence.hpp"
+#include "sequence/nucl.hpp"
+#include "utils/benchmark.hpp"
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdlib>
+
+namespace {
+
+// Reference implementations (the way Sequence used to do it)
+bool NaiveEqual(const Sequence &a, const Sequence &b) {
+    if (a.size() != b.size())
+        return false;
+    for (size_t i = 0; i < a.size(); ++i)
+        if (a[i] != b[i])
+            return false;
+    return true;
+}
+
+bool NaiveLess(const Sequence &a, const Sequence &b) {
+    size_t s = std::min(a.size(), b.size());
+    for (size_t i = 0; i < s; ++i)
+        if (a[i] != b[i])
+            return a[i] < b[i];
+    return a.size() < b.size();
+}
+
+size_t NaiveHamming(const Sequence &a, const Sequence &b) {
+    size_t s = std::min(a.size(), b.size()), res = 0;
+    for (size_t i = 0; i < s; ++i)
+        res += (a[i] != b[i]);
+    return res;
+}
+
+Sequence RandomSequence(size_t size) {
+    std::string s(size, 'A');
+    for (size_t i = 0; i < size; ++i)
+        s[i] = nucl(char(rand() % 4));
+    return Sequence(s);
+}
+
+// Equal content stored in a different layout (shifted and/or reverse-complemented)
+Sequence OtherLayout(const Sequence &s, bool rc) {
+    Sequence padded(std::string(size_t(rand() % 31 + 1), 'A') + (rc ? (!s).str() : s.str()));
+    Sequence view = padded.Subseq(padded.size() - s.size());
+    return rc ? !view : view;
+}
+
+}
+
+int main(int argc, char *argv[]) {
+    size_t len = argc > 1 ? std::strtoul(argv[1], NULL, 10) : 1000;
+    size_t count = argc > 2 ? std::strtoul(argv[2], NULL, 10) : 10000;
+    size_t rounds = argc > 3 ? std::strtoul(argv[3], NULL, 10) : 20;
+
+    std::vector<Sequence> a, b, c;
+    for (size_t i = 0; i < count; ++i) {
+        a.push_back(RandomSequence(len));
+        b.push_back(OtherLayout(a.back(), i % 2));
+        c.push_back(RandomSequence(len));
+    }
+
+    std::cout << count << " pairs of sequences of length " << len << ", " << rounds << " rounds" << std::endl;
+
+    std::cout << "Equality (equal sequences, different layouts)" << std::endl;
+    bench::Run("naive", rounds, [&]() { size_t res = 0; for (size_t i = 0; i < count; ++i) res += NaiveEqual(a[i], b[i]); return res; });
+    bench::Run("words", rounds, [&]() { size_t res = 0; for (size_t i = 0; i < count; ++i) res += (a[i] == b[i]); return res; });
+
+    std::cout << "Self-conjugacy check (s == !s)" << std::endl;
+    bench::Run("naive", rounds, [&]() { size_t res = 0; for (size_t i = 0; i < count; ++i) res += NaiveEqual(b[i], !b[i]); return res; });
+    bench::Run("words", rounds, [&]() { size_t res = 0; for (size_t i = 0; i < count; ++i) res += (b[i] == !b[i]); return res; });
+
+    std::cout << "Ordering (sequences with long common prefix)" << std::endl;
+    bench::Run("naive", rounds, [&]() { size_t res = 0; for (size_t i = 0; i + 1 < count; ++i) res += NaiveLess(a[i], b[i + 1]) + NaiveLess(a[i], b[i]); return res; });
+    bench::Run("words", rounds, [&]() { size_t res = 0; for (size_t i = 0; i + 1 < count; ++i) res += (a[i] < b[i + 1]) + (a[i] < b[i]); return res; });
+
+    std::cout << "Hamming distance" << std::endl;
+    bench::Run("naive", rounds, [&]() { size_t res = 0; for (size_t i = 0; i < count; ++i) res += NaiveHamming(b[i], c[i]); return res; });
+    bench::Run("words", rounds, [&]() { size_t res = 0; for (size_t i = 0; i < count; ++i) res += b[i].HammingDistance(c[i]); return res; });
+
+    return 0;
+}
@@ -70,6 +70,57 @@ BOOST_AUTO_TEST_CASE( TestSequenceRefCount2 ) {
     delete ss;
 }
 
+static Sequence RandomView(size_t size) {
+    std::string s(size + 70, '-');
+    for (size_t j = 0; j < s.size(); ++j)
+        s[j] = nucl(char(rand() % 4));
+    Sequence res(s);
+    size_t from = rand() % 70;
+    res = res.Subseq(from, from + size);
+    return (rand() % 2 ? !!res : !res);
+}
+
+BOOST_AUTO_TEST_CASE( TestSequenceWordComparison ) {
+    for (size_t i = 0; i < 2000; ++i) {
+        Sequence a = RandomView(rand() % 150);
+        // Copy the random prefix of a in a different layout, then mutate
+        size_t common = rand() % (a.size() + 1);
+        Sequence b(a.Subseq(0, common).str() + RandomView(rand() % 150).str());
+        if (rand() % 2)
+            b = !Sequence(b.str(), true);
+        std::string as = a.str(), bs = b.str();
+
+        BOOST_CHECK_EQUAL(as == bs, a == b);
+        BOOST_CHECK_EQUAL(as < bs, a < b);
+        BOOST_CHECK_EQUAL(bs < as, b < a);
+
+        size_t lcp = 0;
+        while (lcp < std::min(as.size(), bs.size()) && as[lcp] == bs[lcp])
+            ++lcp;
+        BOOST_CHECK_EQUAL(lcp, a.CommonPrefixLength(b));
+
+        size_t hamming = 0;
+        for (size_t j = 0; j < std::min(as.size(), bs.size()); ++j)
+            hamming += (as[j] != bs[j]);
+        BOOST_CHECK_EQUAL(hamming, a.HammingDistance(b));
+
+        Sequence a2(as);
+        BOOST_CHECK(a == a2);
+        BOOST_CHECK_EQUAL(a.hash(), a2.hash());
+        BOOST_CHECK_EQUAL((!a).hash(), (!a2).hash());
+        // The cached hash follows the copies and the assignments
+        Sequence a3(a);
+        BOOST_CHECK_EQUAL(a3.hash(), a.hash());
+        a3 = !a;
+        BOOST_CHECK_EQUAL(a3.hash(), (!a2).hash());
+        BOOST_CHECK_EQUAL(std::hash<Sequence>()(a3), a3.hash());
+        if (!as.empty()) {
+            a3 = a.Subseq(1);
+            BOOST_CHECK_EQUAL(a3.hash(), Sequence(as.substr(1)).hash());
+        }
+    }
+}
+
 //todo is it suitable here???
 //BOOST_AUTO_TEST_CASE( TestSequenceMemory ) {
 //    time_t now = time(NULL);
@@ -15,6 +15,7 @@
 #include "sequence_test.hpp"
 #include "quality_test.hpp"
 #include "nucl_test.hpp"
+#include "indexed_heap_test.hpp"
 
 ::boost::unit_test::test_suite*    init_unit_test_suite( int, char* [] )
 {